@@ -6,6 +6,8 @@
 */
 
 #include "checkpoint.h"
+#include <algorithm>            // for std::min
+#include <atomic>               // for std::atomic
 #include <iostream>             // for std::cout
 #include <system_error>         // for std::system_category
 #include <boost/assert.hpp>     // for boost::assert
@@ -24,6 +26,36 @@
 #endif
 
 namespace checkpoint {
+    // #region 無名名前空間
+
+    namespace {
+        //! A global variable (constant expression).
+        /*!
+            名称を記録するチェックポイントの最大の数
+        */
+        static std::int32_t constexpr MAXPHASE = 256;
+
+        //! A global variable.
+        /*!
+            これまでに設定された全てのチェックポイントの数
+        */
+        std::atomic<std::int32_t> phasecount(0);
+
+        //! A global variable.
+        /*!
+            設定された順のチェックポイントの名称
+        */
+        std::array<std::atomic<char const *>, MAXPHASE> phases;
+
+        //! A global variable.
+        /*!
+            設定された順のチェックポイントの、同じCheckPointの直前のチェックポイントからの経過時間（ミリ秒）
+        */
+        std::array<std::atomic<double>, MAXPHASE> elapsedtimes;
+    }
+
+    // #endregion 無名名前空間
+
     CheckPoint::CheckPoint()
         : cfp(
             reinterpret_cast<CheckPoint::CheckPointFastImpl *>(
@@ -45,7 +77,19 @@ namespace checkpoint {
         p->line = line;
 		p->realtime = std::chrono::high_resolution_clock::now();
 
+        auto const elapsed = cfp->cur ?
+            std::chrono::duration<double, std::milli>(p->realtime - (p - 1)->realtime).count() :
+            -1.0;
+
 		cfp->cur++;
+
+        // 全てのCheckPointを通した名称と経過時間を記録し、数を増やす
+        auto const n = phasecount.load(std::memory_order_relaxed);
+        if (n < MAXPHASE) {
+            phases[n].store(action, std::memory_order_relaxed);
+            elapsedtimes[n].store(elapsed, std::memory_order_relaxed);
+        }
+        phasecount.store(n + 1, std::memory_order_release);
 	}
 	
 	void CheckPoint::checkpoint_print() const
@@ -78,8 +122,23 @@ namespace checkpoint {
 
     // #region 非メンバ関数
 
+    std::int32_t currentphase()
+    {
+        return phasecount.load(std::memory_order_acquire);
+    }
+
+    char const * phasename(std::int32_t n)
+    {
+        return n >= 0 && n < std::min(currentphase(), MAXPHASE) ? phases[n].load(std::memory_order_relaxed) : nullptr;
+    }
+
+    double phaseelapsed(std::int32_t n)
+    {
+        return n >= 0 && n < std::min(currentphase(), MAXPHASE) ? elapsedtimes[n].load(std::memory_order_relaxed) : -1.0;
+    }
+
 #ifdef _WIN32
-    void usedmem()
+    std::uint64_t peakmemory()
 	{
 		PROCESS_MEMORY_COUNTERS memInfo = { 0 };
 		
@@ -87,13 +146,10 @@ namespace checkpoint {
 			throw std::system_error(std::error_code(::GetLastError(), std::system_category()));
 		}
 
-		std::cout << "Used Memory Size: "
-				  << boost::numeric_cast<std::uint32_t>(memInfo.PeakWorkingSetSize >> 10)
-				  << "(kB)"
-                  << std::endl; 
+        return static_cast<std::uint64_t>(memInfo.PeakWorkingSetSize >> 10);
 	}
 #else
-    void usedmem()
+    std::uint64_t peakmemory()
 	{
 	    struct rusage r;
 
@@ -101,12 +157,17 @@ namespace checkpoint {
 		    throw std::system_error(errno, std::system_category());
     	}
 
+        return static_cast<std::uint64_t>(r.ru_maxrss);
+    }
+#endif
+
+    void usedmem()
+	{
         std::cout << "Used Memory Size: "
-				  << boost::numeric_cast<std::uint32_t>(r.ru_maxrss)
+				  << boost::numeric_cast<std::uint32_t>(peakmemory())
 				  << "(kB)"
                   << std::endl;
     }
-#endif
 
     // #endregion 非メンバ関数
 }
@@ -13,7 +13,7 @@
 #include "fastarenaobject.h"
 #include <array>				// for std::array			
 #include <chrono>               // for std::chrono               
-#include <cstdint>              // for std::int32_t, std::int64_t
+#include <cstdint>              // for std::int32_t, std::int64_t, std::uint64_t
 #include <memory>               // for std::unique_ptr
 #include <utility>              // for std::pair
 
@@ -181,6 +181,37 @@ namespace checkpoint {
 
     // #region 非メンバ関数
 
+    //! A function.
+    /*!
+        これまでに設定された全てのチェックポイントの数を返す
+        シグナルハンドラの中からも呼び出せる
+        \return チェックポイントの数
+    */
+    std::int32_t currentphase();
+
+    //! A function.
+    /*!
+        n番目（0から数える）に設定されたチェックポイントの名称を返す
+        \param n チェックポイントの番号
+        \return チェックポイントの名称（範囲外の場合はnullptr）
+    */
+    char const * phasename(std::int32_t n);
+
+    //! A function.
+    /*!
+        n番目（0から数える）に設定されたチェックポイントの、同じCheckPointの直前のチェックポイントからの経過時間を返す
+        \param n チェックポイントの番号
+        \return 経過時間（ミリ秒、そのCheckPointの最初のチェックポイントか範囲外の場合は負の値）
+    */
+    double phaseelapsed(std::int32_t n);
+
+    //! A function.
+    /*!
+        自分自身のプロセスの最大のメモリ使用量を返す
+        \return 最大のメモリ使用量（kB）
+    */
+    std::uint64_t peakmemory();
+
     //! A function.
     /*!
         自分自身のプロセスのメモリ使用量を計測する    
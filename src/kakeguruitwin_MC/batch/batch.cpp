@@ -0,0 +1,596 @@
+﻿/*! \file batch.cpp
+    \brief 複数の実験の設定を一つのスレッドのアリーナで、乱数列を共有しながらまとめて実行する関数の実装
+
+    Copyright © 2017 @dc1394 All Rights Reserved.
+    This software is released under the BSD 2-Clause License.
+*/
+
+#include "batch.h"
+#include "../flips/patternscan.h"
+#ifdef HAVE_SSE2
+    #include "../myrandom/myrandsfmt.h"
+#else
+    #include "../myrandom/myrand.h"
+#endif
+#include <algorithm>                            // for std::max, std::min, std::sort
+#include <atomic>                               // for std::atomic
+#include <cmath>                                // for std::sqrt
+#include <fstream>                              // for std::ifstream, std::ofstream
+#include <iomanip>                              // for std::setprecision
+#include <map>                                  // for std::map
+#include <memory>                               // for std::make_unique, std::unique_ptr
+#include <mutex>                                // for std::lock_guard, std::mutex
+#include <set>                                  // for std::set
+#include <sstream>                              // for std::istringstream
+#include <stdexcept>                            // for std::invalid_argument, std::logic_error, std::runtime_error
+#include <utility>                              // for std::make_pair, std::move, std::pair
+#include <tbb/enumerable_thread_specific.h>     // for tbb::enumerable_thread_specific
+#include <tbb/parallel_for.h>                   // for tbb::parallel_for
+#include <tbb/partitioner.h>                    // for tbb::simple_partitioner
+#include <tbb/task_arena.h>                     // for tbb::task_arena
+
+namespace batch {
+    namespace {
+#ifdef HAVE_SSE2
+        using myrand = myrandom::MyRandSfmt;
+#else
+        using myrand = myrandom::MyRand;
+#endif
+
+        //! A global variable (constant expression).
+        /*!
+            同じ種から乱数エンジンを初期化する試行の塊の大きさ（corpusモードと同じ）
+        */
+        static auto constexpr CHUNK = 4096U;
+
+        //! A global variable (constant expression).
+        /*!
+            コストの見積もりにおける、一つのワードを生成するコストと一つのUかDを一つの文字列と比べるコストの比
+        */
+        static auto constexpr GENERATECOST = 16.0;
+
+        //! A struct.
+        /*!
+            実験毎の集計結果
+        */
+        struct Tally final {
+            //! A constructor.
+            /*!
+                唯一のコンストラクタ
+                \param npattern 文字列の数
+                \param npair ペアの数
+            */
+            Tally(std::uint32_t npattern, std::uint32_t npair)
+                : firstsum(npattern, 0U), wins(npair * 2U, 0U)
+            {
+            }
+
+            //! A public member variable.
+            /*!
+                各文字列の最初の出現位置の和
+            */
+            std::vector<std::uint64_t> firstsum;
+
+            //! A public member variable.
+            /*!
+                集計結果を足し合わせるためのミューテックス
+            */
+            std::mutex mtx;
+
+            //! A public member variable.
+            /*!
+                ペア毎の前者と後者の勝利回数
+            */
+            std::vector<std::uint64_t> wins;
+        };
+
+        //! A struct.
+        /*!
+            複数の実験が共有する乱数列
+        */
+        struct Source final {
+            //! A public member variable.
+            /*!
+                Uとする32ビットの一様乱数の上限（0の場合はUが出る確率を1/2とする）
+            */
+            std::uint32_t threshold;
+
+            //! A public member variable.
+            /*!
+                乱数の種
+            */
+            std::uint64_t seed;
+
+            //! A public member variable.
+            /*!
+                最も多い実験の試行回数
+            */
+            std::uint64_t trials;
+
+            //! A public member variable.
+            /*!
+                この乱数列を使う実験の添字
+            */
+            std::vector<std::uint32_t> experiments;
+
+            //! A public member variable.
+            /*!
+                全ての試行の塊の推定コストの和
+            */
+            double cost;
+        };
+
+        //! A struct.
+        /*!
+            一つの乱数列の一つの試行の塊の仕事
+        */
+        struct Item final {
+            //! A public member variable.
+            /*!
+                乱数列の添字
+            */
+            std::uint32_t source;
+
+            //! A public member variable.
+            /*!
+                試行の塊の添字
+            */
+            std::uint64_t block;
+
+            //! A public member variable.
+            /*!
+                この塊を始める時点の、乱数列全体に対する進み具合（推定コストの割合）
+            */
+            double progress;
+
+            //! A public member variable.
+            /*!
+                この塊で生成する試行毎のワード数（この塊に試行がある実験の中で最も長いUかDの文字列の長さに対するもの）
+            */
+            std::uint32_t wordspertrial;
+        };
+
+        //! A struct.
+        /*!
+            スレッド毎の作業領域
+        */
+        struct Scratch final {
+            //! A constructor.
+            /*!
+                唯一のコンストラクタ
+            */
+            Scratch()
+                : mr(1, 6)
+            {
+            }
+
+            //! A public member variable.
+            /*!
+                各文字列の最初の出現位置（試行毎に使い回す）
+            */
+            std::vector<std::uint32_t> first;
+
+            //! A public member variable.
+            /*!
+                自作乱数クラスのオブジェクト
+            */
+            myrand mr;
+
+            //! A public member variable.
+            /*!
+                試行の塊のUとDのランダム列（試行iのj番目のワードはj * CHUNK + i番目）
+            */
+            std::vector<std::uint64_t> words;
+        };
+
+        //! A function.
+        /*!
+            試行の塊の中で、その実験が使う試行の数を返す
+            \param trials 実験の試行回数
+            \param block 試行の塊の添字
+            \return 試行の数
+        */
+        inline std::uint64_t trialsinblock(std::uint64_t trials, std::uint64_t block)
+        {
+            auto const begin = block * CHUNK;
+
+            return begin < trials ? std::min(static_cast<std::uint64_t>(CHUNK), trials - begin) : 0U;
+        }
+
+        //! A function.
+        /*!
+            文字列の組のカンマ区切りの表記を分割する
+            \param str カンマ区切りの文字列の組
+            \return 文字列の組
+        */
+        std::vector<std::string> splitpatterns(std::string const & str)
+        {
+            std::vector<std::string> patterns;
+            std::istringstream iss(str);
+            std::string token;
+            while (std::getline(iss, token, ',')) {
+                if (!token.empty()) {
+                    patterns.push_back(token);
+                }
+            }
+
+            return patterns;
+        }
+    }
+
+    // #region 非メンバ関数
+
+    std::vector<Experiment> readexperiments(std::string const & filename, simulator::RunConfig const & defaults)
+    {
+        std::ifstream ifs(filename);
+        if (!ifs) {
+            throw std::runtime_error("ファイルを開けませんでした: " + filename);
+        }
+
+        std::vector<Experiment> experiments;
+
+        // 同じファイルに書き出すと前の実験の結果が上書きされるので、出力先の重複は許さない
+        std::set<std::string> outputs;
+
+        std::string line;
+        for (auto lineno = 1U; std::getline(ifs, line); lineno++) {
+            // コメントを取り除く
+            line = line.substr(0U, line.find('#'));
+
+            std::istringstream iss(line);
+            std::string token;
+            Experiment experiment;
+            experiment.config.bias = defaults.bias;
+            experiment.config.horizon = defaults.horizon;
+            experiment.config.seed = defaults.seed;
+            experiment.config.trials = defaults.trials;
+
+            auto empty = true;
+            while (iss >> token) {
+                empty = false;
+
+                auto const eq = token.find('=');
+                if (eq == std::string::npos) {
+                    throw std::invalid_argument(filename + "の" + std::to_string(lineno) + "行目: 「キー=値」の形式ではありません: " + token);
+                }
+
+                auto const key = token.substr(0U, eq);
+                auto const value = token.substr(eq + 1U);
+                if (key != "name" && key != "patterns" && key != "bias" && key != "horizon" &&
+                    key != "trials" && key != "seed" && key != "output") {
+                    throw std::invalid_argument(filename + "の" + std::to_string(lineno) + "行目: 不明なキーです: " + key);
+                }
+
+                try {
+                    if (key == "name") {
+                        experiment.name = value;
+                    }
+                    else if (key == "patterns") {
+                        experiment.config.patterns = splitpatterns(value);
+                    }
+                    else if (key == "bias") {
+                        experiment.config.bias = std::stod(value);
+                    }
+                    else if (key == "horizon") {
+                        experiment.config.horizon = static_cast<std::uint32_t>(std::stoul(value));
+                    }
+                    else if (key == "trials") {
+                        experiment.config.trials = std::stoull(value);
+                    }
+                    else if (key == "seed") {
+                        experiment.config.seed = std::stoull(value);
+                    }
+                    else {
+                        experiment.output = value;
+                    }
+                }
+                catch (std::logic_error const &) {
+                    // std::stodなどが投げるstd::invalid_argumentとstd::out_of_range
+                    throw std::invalid_argument(filename + "の" + std::to_string(lineno) + "行目: 値が不正です: " + token);
+                }
+            }
+
+            if (empty) {
+                continue;
+            }
+
+            if (experiment.config.patterns.size() < 2U) {
+                throw std::invalid_argument(filename + "の" + std::to_string(lineno) + "行目: patternsに二つ以上の文字列が必要です");
+            }
+
+            if (experiment.name.empty()) {
+                experiment.name = "line" + std::to_string(lineno);
+            }
+
+            if (experiment.output.empty()) {
+                experiment.output = experiment.name + ".txt";
+            }
+
+            if (!outputs.insert(experiment.output).second) {
+                throw std::invalid_argument(filename + "の" + std::to_string(lineno) + "行目: 出力先のファイルが他の実験と重複しています: " + experiment.output);
+            }
+
+            experiments.push_back(std::move(experiment));
+        }
+
+        if (experiments.empty()) {
+            throw std::invalid_argument("実験が一つもありません: " + filename);
+        }
+
+        return experiments;
+    }
+
+    BatchResult run(std::vector<Experiment> const & experiments, int nthread)
+    {
+        auto const nexperiment = static_cast<std::uint32_t>(experiments.size());
+
+        // 実験毎の探索する文字列と集計結果
+        std::vector<std::vector<flips::Target>> targets(nexperiment);
+        std::vector<std::unique_ptr<Tally>> tallies;
+
+        // Uが出る確率、乱数の種が等しい実験は、UかDの文字列の長さによらず一つの乱数列を共有する
+        std::map<std::pair<std::uint32_t, std::uint64_t>, std::uint32_t> sourceindex;
+        std::vector<Source> sources;
+
+        BatchResult result;
+        result.unshared = 0U;
+
+        for (auto e = 0U; e < nexperiment; e++) {
+            auto const & config = experiments[e].config;
+
+            if (!(config.bias > 0.0 && config.bias < 1.0)) {
+                throw std::invalid_argument(experiments[e].name + ": Uが出る確率は0より大きく1より小さくなければなりません");
+            }
+
+            if (!config.horizon || !config.trials || !config.seed) {
+                throw std::invalid_argument(experiments[e].name + ": UかDの文字列の長さ、試行回数、乱数の種は1以上でなければなりません");
+            }
+
+            for (auto const & str : config.patterns) {
+                targets[e].push_back(flips::maketarget(str));
+            }
+
+            auto const npattern = static_cast<std::uint32_t>(config.patterns.size());
+            tallies.push_back(std::make_unique<Tally>(npattern, npattern * (npattern - 1U)));
+
+            auto const threshold = flips::biasthreshold(config.bias);
+            auto const wordspertrial = flips::wordsize(config.horizon);
+            auto const itr = sourceindex.emplace(
+                std::make_pair(threshold, config.seed),
+                static_cast<std::uint32_t>(sources.size()));
+            if (itr.second) {
+                sources.push_back({ threshold, config.seed, 0U, {}, 0.0 });
+            }
+
+            auto & source = sources[itr.first->second];
+            source.trials = std::max(source.trials, config.trials);
+            source.experiments.push_back(e);
+
+            // 試行の塊は端数でも試行CHUNK個分を生成する
+            result.unshared += (config.trials + CHUNK - 1U) / CHUNK * CHUNK * wordspertrial;
+        }
+
+        // 試行の塊毎の試行毎のワード数（この塊に試行がある実験の中で最も長いUかDの文字列の長さに対するもの）
+        // 短い実験や試行回数の少ない実験だけが残る塊は、その分だけ生成すればよい
+        auto const blockwords = [&](Source const & source, std::uint64_t block) {
+            auto words = 0U;
+            for (auto const e : source.experiments) {
+                auto const & config = experiments[e].config;
+                if (trialsinblock(config.trials, block)) {
+                    words = std::max(words, flips::wordsize(config.horizon));
+                }
+            }
+
+            return words;
+        };
+
+        // 試行の塊毎の推定コスト（ワードの生成と、UかD一つと文字列一つの比較を単位とする）
+        auto const blockcost = [&](Source const & source, std::uint64_t block, std::uint32_t wordspertrial) {
+            auto cost = static_cast<double>(CHUNK) * wordspertrial * GENERATECOST;
+            for (auto const e : source.experiments) {
+                auto const & config = experiments[e].config;
+                cost += static_cast<double>(trialsinblock(config.trials, block)) * config.horizon * config.patterns.size();
+            }
+
+            return cost;
+        };
+
+        // 各乱数列の試行の塊を、その乱数列の推定コストに対する進み具合の順に並べる
+        // 進み具合が等しい場合は、推定コストの大きい乱数列を先にする
+        std::vector<Item> items;
+        result.generated = 0U;
+        for (auto s = 0U; s < sources.size(); s++) {
+            auto & source = sources[s];
+            auto const nblock = (source.trials + CHUNK - 1U) / CHUNK;
+
+            std::vector<double> costs;
+            std::vector<std::uint32_t> words;
+            for (auto b = UINT64_C(0); b < nblock; b++) {
+                words.push_back(blockwords(source, b));
+                costs.push_back(blockcost(source, b, words.back()));
+                source.cost += costs.back();
+                result.generated += static_cast<std::uint64_t>(CHUNK) * words.back();
+            }
+
+            auto done = 0.0;
+            for (auto b = UINT64_C(0); b < nblock; b++) {
+                items.push_back({ s, b, done / source.cost, words[b] });
+                done += costs[b];
+            }
+        }
+
+        // 塊毎に、その塊に試行がある実験の中で最も長いものだけを生成するので、共有しない場合より多くはならない
+        if (result.generated > result.unshared) {
+            throw std::logic_error("共有した乱数列のワード数が、共有しない場合のワード数を超えています");
+        }
+
+        std::sort(items.begin(), items.end(), [&sources](auto const & a, auto const & b) {
+            if (a.progress != b.progress) {
+                return a.progress < b.progress;
+            }
+
+            if (sources[a.source].cost != sources[b.source].cost) {
+                return sources[a.source].cost > sources[b.source].cost;
+            }
+
+            return a.source != b.source ? a.source < b.source : a.block < b.block;
+        });
+
+        // スレッド毎の作業領域
+        tbb::enumerable_thread_specific<Scratch> scratches;
+
+        // 次に実行する仕事の添字
+        std::atomic<std::size_t> next(0U);
+
+        auto const work = [&](Item const & item) {
+            auto & scratch = scratches.local();
+            auto const & source = sources[item.source];
+
+            // この塊のUとDのランダム列を一度だけ生成する
+            // 全ての試行の1番目のワード、全ての試行の2番目のワード、…の順に生成するので、各試行の先頭のワードは
+            // この塊の試行毎のワード数（同じ乱数列を使う他の実験のUかDの文字列の長さ）や試行回数によらず、
+            // UかDの文字列の長さだけが異なる実験は同じ乱数で始まる（共通乱数）
+            scratch.words.resize(static_cast<std::size_t>(CHUNK) * item.wordspertrial);
+            scratch.mr.seed(flips::chunkseed(source.seed, item.block));
+            for (auto && w : scratch.words) {
+                w = flips::makeword(scratch.mr, source.threshold);
+            }
+
+            // この乱数列を使う全ての実験で集計する
+            for (auto const e : source.experiments) {
+                auto const & config = experiments[e].config;
+                auto const n = trialsinblock(config.trials, item.block);
+                if (!n) {
+                    continue;
+                }
+
+                auto const & target = targets[e];
+                auto const npattern = static_cast<std::uint32_t>(target.size());
+                Tally local(npattern, npattern * (npattern - 1U));
+                scratch.first.resize(npattern);
+
+                for (auto i = UINT64_C(0); i < n; i++) {
+                    // UかDの文字列の長さが短い実験は、この試行の先頭のflips::wordsize(config.horizon)ワードだけを読む
+                    auto words = scratch.words.data() + i;
+                    flips::firstoccurrence(
+                        [&words] {
+                            auto const w = *words;
+                            words += CHUNK;
+                            return w;
+                        },
+                        config.horizon,
+                        target,
+                        scratch.first);
+
+                    for (auto p = 0U; p < npattern; p++) {
+                        local.firstsum[p] += scratch.first[p] ? scratch.first[p] : config.horizon;
+                    }
+
+                    // 見つからなかった場合は最も遅いものとして扱う
+                    auto k = 0U;
+                    for (auto a = 0U; a < npattern; a++) {
+                        for (auto b = 0U; b < npattern; b++) {
+                            if (a != b) {
+                                flips::countwins(scratch.first[a], scratch.first[b], local.wins.data() + k);
+                                k += 2U;
+                            }
+                        }
+                    }
+                }
+
+                auto & tally = *tallies[e];
+                std::lock_guard<std::mutex> lock(tally.mtx);
+                for (auto p = 0U; p < npattern; p++) {
+                    tally.firstsum[p] += local.firstsum[p];
+                }
+
+                for (auto k = 0U; k < local.wins.size(); k++) {
+                    tally.wins[k] += local.wins[k];
+                }
+            }
+        };
+
+        // 全てのスレッドが並べた順に仕事を取り出して実行する
+        tbb::task_arena arena(nthread);
+        arena.execute([&] {
+            auto const nworker = arena.max_concurrency();
+            tbb::parallel_for(
+                0,
+                nworker,
+                1,
+                [&](int) {
+                    for (auto i = next++; i < items.size(); i = next++) {
+                        work(items[i]);
+                    }
+                },
+                tbb::simple_partitioner());
+        });
+
+        result.nsource = static_cast<std::uint32_t>(sources.size());
+
+        for (auto e = 0U; e < nexperiment; e++) {
+            auto const & config = experiments[e].config;
+            auto const & tally = *tallies[e];
+            auto const npattern = static_cast<std::uint32_t>(config.patterns.size());
+            auto const trials = static_cast<double>(config.trials);
+
+            simulator::Result r;
+            r.trials = config.trials;
+
+            for (auto p = 0U; p < npattern; p++) {
+                r.firstsum.push_back(tally.firstsum[p]);
+                r.waitingtime.push_back(static_cast<double>(tally.firstsum[p]) / trials);
+            }
+
+            auto k = 0U;
+            for (auto a = 0U; a < npattern; a++) {
+                for (auto b = 0U; b < npattern; b++) {
+                    if (a != b) {
+                        auto const prob = static_cast<double>(tally.wins[k]) / trials;
+                        r.pairs.push_back({ a, b, prob, std::sqrt(prob * (1.0 - prob) / trials), tally.wins[k], tally.wins[k + 1U] });
+                        k += 2U;
+                    }
+                }
+            }
+
+            result.results.push_back(std::move(r));
+        }
+
+        return result;
+    }
+
+    void writeresult(Experiment const & experiment, simulator::Result const & result)
+    {
+        std::ofstream ofs(experiment.output);
+        if (!ofs) {
+            throw std::runtime_error("ファイルを開けませんでした: " + experiment.output);
+        }
+
+        auto const & config = experiment.config;
+
+        ofs << "# name=" << experiment.name << " patterns=";
+        for (auto p = 0U; p < config.patterns.size(); p++) {
+            ofs << (p ? "," : "") << config.patterns[p];
+        }
+        // Uが出る確率は、読み込み直して同じ値になる最も短い表記で書く
+        ofs << " bias=" << flips::biasstring(config.bias)
+            << " horizon=" << config.horizon << " trials=" << config.trials << " seed=" << config.seed << '\n';
+
+        ofs << std::setprecision(10) << "pattern\twaitingtime\n";
+        for (auto p = 0U; p < config.patterns.size(); p++) {
+            ofs << config.patterns[p] << '\t' << result.waitingtime[p] << '\n';
+        }
+
+        ofs << "a\tb\tprobability\tstderror\twinsa\twinsb\n";
+        for (auto const & pair : result.pairs) {
+            ofs << config.patterns[pair.a] << '\t' << config.patterns[pair.b] << '\t'
+                << pair.probability << '\t' << pair.stderror << '\t' << pair.winsa << '\t' << pair.winsb << '\n';
+        }
+
+        if (!ofs) {
+            throw std::runtime_error("ファイルに書き込めませんでした: " + experiment.output);
+        }
+    }
+
+    // #endregion 非メンバ関数
+}
@@ -0,0 +1,111 @@
+﻿/*! \file batch.h
+    \brief 複数の実験の設定を一つのスレッドのアリーナで、乱数列を共有しながらまとめて実行する関数の宣言
+
+    Copyright © 2017 @dc1394 All Rights Reserved.
+    This software is released under the BSD 2-Clause License.
+*/
+
+#ifndef _BATCH_H_
+#define _BATCH_H_
+
+#pragma once
+
+#include "../simulator/simulator.h"
+#include <cstdint>  // for std::uint32_t, std::uint64_t
+#include <string>   // for std::string
+#include <vector>   // for std::vector
+
+namespace batch {
+    //! A struct.
+    /*!
+        一つの実験
+    */
+    struct Experiment final {
+        //! A public member variable.
+        /*!
+            実験の設定（patterns, bias, horizon, trials, seedのみを使う）
+        */
+        simulator::RunConfig config;
+
+        //! A public member variable.
+        /*!
+            実験の名前
+        */
+        std::string name;
+
+        //! A public member variable.
+        /*!
+            結果を書き出すファイル名
+        */
+        std::string output;
+    };
+
+    //! A struct.
+    /*!
+        まとめて実行した結果
+    */
+    struct BatchResult final {
+        //! A public member variable.
+        /*!
+            生成したUとDのランダム列のワード数（試行の塊は端数でも4096試行分を生成する）
+        */
+        std::uint64_t generated;
+
+        //! A public member variable.
+        /*!
+            乱数列の数（Uが出る確率、乱数の種が等しい実験は、UかDの文字列の長さによらず一つの乱数列を共有する）
+        */
+        std::uint32_t nsource;
+
+        //! A public member variable.
+        /*!
+            実験毎の結果（実験の順、pairsは全ての順序付きのペア）
+        */
+        std::vector<simulator::Result> results;
+
+        //! A public member variable.
+        /*!
+            乱数列を共有しなかった場合に生成するワード数
+        */
+        std::uint64_t unshared;
+    };
+
+    //! A function.
+    /*!
+        実験の設定のファイルを読み込む
+        一行に一つの実験を「キー=値」を空白で区切って書く（#から行末まではコメント）
+        キーはname, patterns（カンマ区切り）, bias, horizon, trials, seed, outputで、
+        patterns以外は省略すると、nameは行番号、outputは「name.txt」、それ以外はdefaultsの値になる
+        outputが他の実験と重複する場合は例外を投げる
+        \param filename ファイル名
+        \param defaults 省略された値
+        \return 実験の配列
+    */
+    std::vector<Experiment> readexperiments(std::string const & filename, simulator::RunConfig const & defaults);
+
+    //! A function.
+    /*!
+        全ての実験を一つのスレッドのアリーナで実行する
+        乱数列を共有する実験は、試行の塊毎に一度だけ生成したUとDのランダム列で同時に集計するので、
+        実験の間の比較の誤差が小さくなり（共通乱数）、乱数の生成の時間も一度で済む
+        試行の塊は、その塊に試行がある実験の中で最も長いUかDの文字列の長さの分だけ生成し、短い実験は各試行の先頭の部分だけを使う
+        （生成するワード数は、乱数列を共有しない場合を超えない）
+        試行の塊は、それぞれの乱数列の推定コストに比例して進むように並べて実行するので、
+        長い実験と短い実験が交互に進み、最後に長い実験だけが残ることがない
+        結果は乱数の種、Uが出る確率、UかDの文字列の長さ、試行回数だけで決まり、同じファイルの他の実験やスレッドの数によらない
+        \param experiments 実験の配列
+        \param nthread 使用するスレッドの数（tbb::task_arena::automaticの場合は全てのコア）
+        \return まとめて実行した結果
+    */
+    BatchResult run(std::vector<Experiment> const & experiments, int nthread);
+
+    //! A function.
+    /*!
+        一つの実験の結果をテキストファイルに書き出す
+        \param experiment 実験
+        \param result 実験の結果
+    */
+    void writeresult(Experiment const & experiment, simulator::Result const & result);
+}
+
+#endif  // _BATCH_H_
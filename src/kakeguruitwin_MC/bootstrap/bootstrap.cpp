@@ -0,0 +1,52 @@
+﻿/*! \file bootstrap.cpp
+    \brief 試行を復元抽出し直して、統計量の信頼区間を求める関数の実装
+
+    Copyright © 2017 @dc1394 All Rights Reserved.
+    This software is released under the BSD 2-Clause License.
+*/
+
+#include "bootstrap.h"
+#include <algorithm>    // for std::sort
+#include <cmath>        // for std::sqrt
+#include <stdexcept>    // for std::invalid_argument
+
+namespace bootstrap {
+    Interval interval(Resamples const & resamples, std::function<double(double const *)> const & statistic, double level)
+    {
+        if (!resamples.nresample) {
+            throw std::invalid_argument("再標本の数は1以上でなければなりません");
+        }
+
+        if (level <= 0.0 || level >= 1.0) {
+            throw std::invalid_argument("信頼係数は0より大きく1より小さくなければなりません");
+        }
+
+        std::vector<double> values(resamples.nresample);
+        auto sum = 0.0;
+        auto sumsq = 0.0;
+        for (auto b = 0U; b < resamples.nresample; b++) {
+            values[b] = statistic(resamples.means.data() + static_cast<std::size_t>(b) * resamples.nfeature);
+            sum += values[b];
+            sumsq += values[b] * values[b];
+        }
+
+        std::sort(values.begin(), values.end());
+
+        auto const n = static_cast<double>(resamples.nresample);
+        auto const mean = sum / n;
+        auto const var = sumsq / n - mean * mean;
+
+        // 両側の(1 - level) / 2の分位数
+        auto const alpha = (1.0 - level) / 2.0;
+        auto const lo = static_cast<std::size_t>(alpha * (n - 1.0));
+        auto const hi = static_cast<std::size_t>((1.0 - alpha) * (n - 1.0) + 0.5);
+
+        Interval result;
+        result.estimate = statistic(resamples.estimate.data());
+        result.lower = values[lo];
+        result.stderror = var > 0.0 ? std::sqrt(var) : 0.0;
+        result.upper = values[hi];
+
+        return result;
+    }
+}
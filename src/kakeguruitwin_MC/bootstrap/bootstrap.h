@@ -0,0 +1,264 @@
+﻿/*! \file bootstrap.h
+    \brief 試行を復元抽出し直して、統計量の信頼区間を求める関数の宣言
+
+    Copyright © 2017 @dc1394 All Rights Reserved.
+    This software is released under the BSD 2-Clause License.
+*/
+
+#ifndef _BOOTSTRAP_H_
+#define _BOOTSTRAP_H_
+
+#pragma once
+
+#include "../trialstore/trialstore.h"
+#include <algorithm>                            // for std::min
+#include <array>                                // for std::array
+#include <cmath>                                // for std::exp
+#include <cstddef>                              // for std::size_t
+#include <cstdint>                              // for std::uint32_t, std::uint64_t
+#include <functional>                           // for std::function
+#include <vector>                               // for std::vector
+#include <tbb/blocked_range.h>                  // for tbb::blocked_range
+#include <tbb/parallel_reduce.h>                // for tbb::parallel_deterministic_reduce
+#include <tbb/partitioner.h>                    // for tbb::simple_partitioner
+
+namespace bootstrap {
+    //! A struct.
+    /*!
+        信頼区間
+    */
+    struct Interval final {
+        //! A public member variable.
+        /*!
+            全試行から求めた統計量の値
+        */
+        double estimate;
+
+        //! A public member variable.
+        /*!
+            信頼区間の下限
+        */
+        double lower;
+
+        //! A public member variable.
+        /*!
+            標準誤差（再標本の統計量の標準偏差）
+        */
+        double stderror;
+
+        //! A public member variable.
+        /*!
+            信頼区間の上限
+        */
+        double upper;
+    };
+
+    //! A struct.
+    /*!
+        再標本毎の、試行毎の特徴量の平均
+        統計量は特徴量の平均の関数として表すので、一度の再標本化で任意の数の統計量の信頼区間が求まる
+    */
+    struct Resamples final {
+        //! A public member variable.
+        /*!
+            全試行の特徴量の平均
+        */
+        std::vector<double> estimate;
+
+        //! A public member variable.
+        /*!
+            再標本毎の特徴量の平均（nresample × nfeatureの行列）
+        */
+        std::vector<double> means;
+
+        //! A public member variable.
+        /*!
+            特徴量の数
+        */
+        std::uint32_t nfeature;
+
+        //! A public member variable.
+        /*!
+            再標本の数
+        */
+        std::uint32_t nresample;
+    };
+
+    //! A global variable (constant expression).
+    /*!
+        特徴量を一度に求める試行の数（特徴量の配列がL1キャッシュに収まる大きさ）
+    */
+    static auto constexpr BLOCK = 1024U;
+
+    //! A function.
+    /*!
+        SplitMix64で64ビットの乱数を生成する
+        状態は添字から直接作れるので、再標本毎・ブロック毎の乱数列がスレッドの割り当てによらず決まる
+        \param state 乱数の状態
+        \return 64ビットの乱数
+    */
+    inline std::uint64_t splitmix64(std::uint64_t & state)
+    {
+        auto z = (state += UINT64_C(0x9E3779B97F4A7C15));
+        z = (z ^ (z >> 30)) * UINT64_C(0xBF58476D1CE4E5B9);
+        z = (z ^ (z >> 27)) * UINT64_C(0x94D049BB133111EB);
+        return z ^ (z >> 31);
+    }
+
+    //! A global variable (constant expression).
+    /*!
+        ポアソン分布に従う重みを求めるのに使う一様乱数のビット数
+    */
+    static auto constexpr WEIGHTBITS = 12U;
+
+    //! A function.
+    /*!
+        WEIGHTBITSビットの一様乱数から平均1のポアソン分布に従う重みを引く表を返す
+        表はL1キャッシュに収まる大きさで、分岐なしに重みが求まる
+        \return WEIGHTBITSビットの一様乱数を添字とする重みの表
+    */
+    inline std::array<std::uint8_t, 1U << WEIGHTBITS> const & poissontable()
+    {
+        static auto const table = [] {
+            std::array<std::uint8_t, 1U << WEIGHTBITS> t;
+
+            // P(X ≦ k)が一様乱数の区間の中央を超える最小のkを重みとする
+            auto k = 0U;
+            auto p = std::exp(-1.0);
+            auto cdf = p;
+            for (auto u = 0U; u < t.size(); u++) {
+                auto const x = (static_cast<double>(u) + 0.5) / static_cast<double>(t.size());
+                while (x >= cdf) {
+                    k++;
+                    p /= static_cast<double>(k);
+                    cdf += p;
+                }
+
+                t[u] = static_cast<std::uint8_t>(k);
+            }
+
+            return t;
+        }();
+
+        return table;
+    }
+
+    template <typename F>
+    //! A template function.
+    /*!
+        ポアソン・ブートストラップで、全試行を再標本化した特徴量の平均を求める
+        各試行に再標本毎に独立な平均1のポアソン分布に従う重みを与えるので、試行の列を一度読むだけでよく、
+        再標本毎の添字の配列も必要ない
+        重みの乱数は再標本とBLOCK個毎のブロックの添字から決まり、和を足し合わせる順序も一定なので、
+        同じ試行と乱数の種からはスレッド数によらず同じ結果になる
+        \param store 試行毎の出現位置を保持するオブジェクト
+        \param nfeature 特徴量の数
+        \param feature 試行の特徴量を求める関数オブジェクト（引数は、store、試行の添字、特徴量を格納する配列）
+        \param nresample 再標本の数
+        \param seed 乱数の種
+        \return 再標本毎の特徴量の平均
+    */
+    Resamples resample(
+        trialstore::TrialStore const & store,
+        std::uint32_t nfeature,
+        F feature,
+        std::uint32_t nresample,
+        std::uint64_t seed)
+    {
+        // 再標本毎の重みの和と重み付きの特徴量の和、最後の行は全試行の特徴量の和
+        auto const stride = nfeature + 1U;
+        auto const nsum = static_cast<std::size_t>(nresample + 1U) * stride;
+
+        auto const & table = poissontable();
+
+        // BLOCK個毎の試行のブロックを単位に分割し、分割と足し合わせの順序をスレッドの割り当てによらず一定にする
+        auto const nblock = (store.trials() + BLOCK - 1U) / BLOCK;
+        auto const total = tbb::parallel_deterministic_reduce(
+            tbb::blocked_range<std::uint64_t>(0U, nblock, 1U),
+            std::vector<double>(nsum, 0.0),
+            [&](tbb::blocked_range<std::uint64_t> const & range, std::vector<double> sum) {
+            // 試行毎の特徴量（キャッシュに載せたまま全ての再標本で使う）
+            std::vector<double> features(static_cast<std::size_t>(BLOCK) * nfeature);
+
+            for (auto blk = range.begin(); blk != range.end(); ++blk) {
+                auto const begin = blk * BLOCK;
+                auto const ntrial = static_cast<std::uint32_t>(std::min(static_cast<std::uint64_t>(BLOCK), store.trials() - begin));
+
+                for (auto i = 0U; i < ntrial; i++) {
+                    feature(store, begin + i, features.data() + static_cast<std::size_t>(i) * nfeature);
+                }
+
+                auto * const all = sum.data() + static_cast<std::size_t>(nresample) * stride;
+                for (auto i = 0U; i < ntrial; i++) {
+                    all[0] += 1.0;
+                    for (auto f = 0U; f < nfeature; f++) {
+                        all[f + 1U] += features[i * nfeature + f];
+                    }
+                }
+
+                for (auto b = 0U; b < nresample; b++) {
+                    auto * const s = sum.data() + static_cast<std::size_t>(b) * stride;
+
+                    // 再標本とブロックの添字から乱数の状態を作り、64ビットの乱数一つから5個の重みを作る
+                    auto state = seed ^ ((static_cast<std::uint64_t>(b) << 40) + blk);
+                    auto bits = UINT64_C(0);
+                    for (auto i = 0U, nbits = 0U; i < ntrial; i++, nbits--) {
+                        if (!nbits) {
+                            bits = splitmix64(state);
+                            nbits = 64U / WEIGHTBITS;
+                        }
+
+                        auto const w = table[bits & ((1U << WEIGHTBITS) - 1U)];
+                        bits >>= WEIGHTBITS;
+
+                        s[0] += w;
+                        for (auto f = 0U; f < nfeature; f++) {
+                            s[f + 1U] += w * features[i * nfeature + f];
+                        }
+                    }
+                }
+            }
+
+            return sum;
+        },
+            [](std::vector<double> lhs, std::vector<double> const & rhs) {
+            for (auto k = std::size_t(0); k < lhs.size(); k++) {
+                lhs[k] += rhs[k];
+            }
+
+            return lhs;
+        },
+            tbb::simple_partitioner());
+
+        Resamples result;
+        result.nfeature = nfeature;
+        result.nresample = nresample;
+        result.estimate.resize(nfeature);
+        result.means.resize(static_cast<std::size_t>(nresample) * nfeature);
+
+        for (auto f = 0U; f < nfeature; f++) {
+            result.estimate[f] = total[static_cast<std::size_t>(nresample) * stride + f + 1U] / total[static_cast<std::size_t>(nresample) * stride];
+        }
+
+        for (auto b = 0U; b < nresample; b++) {
+            auto const * const s = total.data() + static_cast<std::size_t>(b) * stride;
+            for (auto f = 0U; f < nfeature; f++) {
+                result.means[static_cast<std::size_t>(b) * nfeature + f] = s[0] > 0.0 ? s[f + 1U] / s[0] : 0.0;
+            }
+        }
+
+        return result;
+    }
+
+    //! A function.
+    /*!
+        特徴量の平均の関数として表される統計量の、パーセンタイル法による信頼区間を求める
+        \param resamples 再標本毎の特徴量の平均
+        \param statistic 特徴量の平均の配列から統計量を求める関数オブジェクト
+        \param level 信頼係数
+        \return 信頼区間
+    */
+    Interval interval(Resamples const & resamples, std::function<double(double const *)> const & statistic, double level);
+}
+
+#endif  // _BOOTSTRAP_H_
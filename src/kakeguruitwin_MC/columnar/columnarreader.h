@@ -0,0 +1,612 @@
+﻿/*! \file columnarreader.h
+    \brief 列指向の結果ファイルの形式の定義と、メモリマップしてそのまま読むクラスの宣言と実装
+    他のプログラムからはこのヘッダだけをインクルードすればよい（C++17の標準ライブラリ以外に依存しない）
+
+    Copyright © 2017 @dc1394 All Rights Reserved.
+    This software is released under the BSD 2-Clause License.
+*/
+
+#ifndef _COLUMNARREADER_H_
+#define _COLUMNARREADER_H_
+
+#pragma once
+
+#include <cstdint>      // for std::uint32_t, std::uint64_t
+#include <cstring>      // for std::memcmp, std::strncmp
+#include <stdexcept>    // for std::runtime_error
+#include <string>       // for std::string
+#include <string_view>  // for std::string_view
+
+#ifdef _WIN32
+    #include <Windows.h>    // for CreateFileA, CreateFileMappingA, MapViewOfFile
+#else
+    #include <fcntl.h>      // for open
+    #include <sys/mman.h>   // for mmap, munmap
+    #include <sys/stat.h>   // for fstat
+    #include <unistd.h>     // for close
+#endif
+
+namespace columnar {
+    // #region ファイルの形式
+
+    //! A global variable (constant expression).
+    /*!
+        ファイルの識別子
+    */
+    static char constexpr MAGIC[8] = { 'K', 'M', 'C', 'C', 'O', 'L', 'S', '\0' };
+
+    //! A global variable (constant expression).
+    /*!
+        ファイルのバージョン
+    */
+    static std::uint32_t constexpr VERSION = 1U;
+
+    //! A global variable (constant expression).
+    /*!
+        バイト順を確認するための値（書き出したマシンのバイト順で格納される）
+    */
+    static std::uint32_t constexpr BYTEORDER = 0x01020304U;
+
+    //! A global variable (constant expression).
+    /*!
+        各列の先頭の境界（バイト）
+    */
+    static std::uint64_t constexpr ALIGNMENT = 64U;
+
+    //! An enumeration.
+    /*!
+        列の要素の型
+    */
+    enum class Type : std::uint32_t {
+        //! 符号なし32ビット整数
+        UINT32 = 1,
+
+        //! 符号なし64ビット整数
+        UINT64 = 2,
+
+        //! 倍精度浮動小数点数
+        FLOAT64 = 3,
+
+        //! 文字列（count + 1個のuint64の終端の位置の後に、文字の並びが続く）
+        STRING = 4
+    };
+
+    //! A struct.
+    /*!
+        ファイルの先頭のヘッダ（64バイト）
+        ヘッダの直後にncolumn個のColumnEntryが続き、各列のデータはALIGNMENTの倍数の位置から始まる
+    */
+    struct Header final {
+        //! ファイルの識別子
+        char magic[8];
+
+        //! ファイルのバージョン
+        std::uint32_t version;
+
+        //! BYTEORDER
+        std::uint32_t byteorder;
+
+        //! 列の数
+        std::uint32_t ncolumn;
+
+        //! 予約（0）
+        std::uint32_t reserved;
+
+        //! ファイルの大きさ（バイト）
+        std::uint64_t filesize;
+
+        //! 予約（0）
+        std::uint64_t padding[4];
+    };
+
+    //! A struct.
+    /*!
+        列の目次の一項目（64バイト）
+    */
+    struct ColumnEntry final {
+        //! 列の名前（終端の'\0'を含む）
+        char name[40];
+
+        //! 要素の型（Type）
+        std::uint32_t type;
+
+        //! 予約（0）
+        std::uint32_t reserved;
+
+        //! ファイルの先頭からの列のデータの位置（バイト）
+        std::uint64_t offset;
+
+        //! 要素の数
+        std::uint64_t count;
+    };
+
+    static_assert(sizeof(Header) == 64U, "Headerは64バイトでなければなりません");
+    static_assert(sizeof(ColumnEntry) == 64U, "ColumnEntryは64バイトでなければなりません");
+
+    //! A template struct.
+    /*!
+        C++の型から列の要素の型を求める
+    */
+    template <typename T>
+    struct TypeOf;
+
+    template <>
+    struct TypeOf<std::uint32_t> {
+        static Type constexpr value = Type::UINT32;
+    };
+
+    template <>
+    struct TypeOf<std::uint64_t> {
+        static Type constexpr value = Type::UINT64;
+    };
+
+    template <>
+    struct TypeOf<double> {
+        static Type constexpr value = Type::FLOAT64;
+    };
+
+    // #endregion ファイルの形式
+
+    //! A template class.
+    /*!
+        メモリマップされた列への型付きのビュー（コピーしない）
+    */
+    template <typename T>
+    class View final {
+    public:
+        //! A constructor.
+        /*!
+            唯一のコンストラクタ
+            \param data 先頭の要素へのポインタ
+            \param size 要素の数
+        */
+        View(T const * data, std::size_t size) : data_(data), size_(size) {}
+
+        //! A public member function.
+        /*!
+            i番目の要素を返す
+            \param i 添字
+            \return i番目の要素
+        */
+        T const & operator[](std::size_t i) const { return data_[i]; }
+
+        //! A public member function.
+        /*!
+            先頭の要素へのポインタを返す
+        */
+        T const * begin() const { return data_; }
+
+        //! A public member function.
+        /*!
+            末尾の次の要素へのポインタを返す
+        */
+        T const * end() const { return data_ + size_; }
+
+        //! A public member function.
+        /*!
+            先頭の要素へのポインタを返す
+        */
+        T const * data() const { return data_; }
+
+        //! A public member function.
+        /*!
+            要素の数を返す
+        */
+        std::size_t size() const { return size_; }
+
+    private:
+        //! A private member variable.
+        /*!
+            先頭の要素へのポインタ
+        */
+        T const * data_;
+
+        //! A private member variable.
+        /*!
+            要素の数
+        */
+        std::size_t size_;
+    };
+
+    //! A class.
+    /*!
+        メモリマップされた文字列の列へのビュー（コピーしない）
+    */
+    class StringView final {
+    public:
+        //! A constructor.
+        /*!
+            唯一のコンストラクタ
+            \param ends 各文字列の終端の位置（先頭は0、要素数はsize + 1）
+            \param chars 文字の並び
+            \param size 文字列の数
+        */
+        StringView(std::uint64_t const * ends, char const * chars, std::size_t size) : chars_(chars), ends_(ends), size_(size) {}
+
+        //! A public member function.
+        /*!
+            i番目の文字列を返す
+            \param i 添字
+            \return i番目の文字列
+        */
+        std::string_view operator[](std::size_t i) const
+        {
+            return std::string_view(chars_ + ends_[i], static_cast<std::size_t>(ends_[i + 1U] - ends_[i]));
+        }
+
+        //! A public member function.
+        /*!
+            文字列の数を返す
+        */
+        std::size_t size() const { return size_; }
+
+    private:
+        //! A private member variable.
+        /*!
+            文字の並び
+        */
+        char const * chars_;
+
+        //! A private member variable.
+        /*!
+            各文字列の終端の位置
+        */
+        std::uint64_t const * ends_;
+
+        //! A private member variable.
+        /*!
+            文字列の数
+        */
+        std::size_t size_;
+    };
+
+    //! A class.
+    /*!
+        列指向の結果ファイルを読み込み専用でメモリマップし、列への型付きのビューを返すクラス
+        ヘッダと目次と文字列の列の終端の位置を確認するだけで、それ以外のデータは読み込まない
+    */
+    class Reader final {
+        // #region コンストラクタ・デストラクタ
+
+    public:
+        //! A constructor.
+        /*!
+            唯一のコンストラクタ
+            \param filename ファイル名
+        */
+        explicit Reader(std::string const & filename)
+        {
+#ifdef _WIN32
+            file_ = ::CreateFileA(filename.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr);
+            LARGE_INTEGER size;
+            if (file_ == INVALID_HANDLE_VALUE || !::GetFileSizeEx(file_, &size)) {
+                throw std::runtime_error("ファイルを開けませんでした: " + filename);
+            }
+
+            size_ = static_cast<std::size_t>(size.QuadPart);
+            mapping_ = size_ ? ::CreateFileMappingA(file_, nullptr, PAGE_READONLY, 0, 0, nullptr) : nullptr;
+            auto const p = mapping_ ? ::MapViewOfFile(mapping_, FILE_MAP_READ, 0, 0, 0) : nullptr;
+            if (!p) {
+                close();
+                throw std::runtime_error("ファイルをメモリマップできませんでした: " + filename);
+            }
+#else
+            auto const fd = ::open(filename.c_str(), O_RDONLY);
+            struct stat st;
+            if (fd < 0 || ::fstat(fd, &st)) {
+                if (fd >= 0) {
+                    ::close(fd);
+                }
+                throw std::runtime_error("ファイルを開けませんでした: " + filename);
+            }
+
+            size_ = static_cast<std::size_t>(st.st_size);
+            auto const p = size_ ? ::mmap(nullptr, size_, PROT_READ, MAP_SHARED, fd, 0) : MAP_FAILED;
+            ::close(fd);
+            if (p == MAP_FAILED) {
+                throw std::runtime_error("ファイルをメモリマップできませんでした: " + filename);
+            }
+#endif
+            base_ = static_cast<char const *>(p);
+
+            if (size_ < sizeof(Header) || std::memcmp(header().magic, MAGIC, sizeof(MAGIC))) {
+                close();
+                throw std::runtime_error("列指向の結果ファイルではありません: " + filename);
+            }
+
+            if (header().version != VERSION || header().byteorder != BYTEORDER) {
+                close();
+                throw std::runtime_error("列指向の結果ファイルのバージョンかバイト順が異なります: " + filename);
+            }
+
+            if (header().filesize != size_ || sizeof(Header) + header().ncolumn * sizeof(ColumnEntry) > size_) {
+                close();
+                throw std::runtime_error("ファイルが壊れています: " + filename);
+            }
+
+            for (auto i = 0U; i < header().ncolumn; i++) {
+                auto const & e = entry(i);
+                if (e.offset % ALIGNMENT || e.offset > size_ || bytes(e) > size_ - e.offset) {
+                    close();
+                    throw std::runtime_error("ファイルが壊れています: " + filename);
+                }
+            }
+        }
+
+        //! A destructor.
+        /*!
+            デストラクタ
+        */
+        ~Reader()
+        {
+            close();
+        }
+
+        // #endregion コンストラクタ・デストラクタ
+
+        // #region メンバ関数
+
+        //! A public member function.
+        /*!
+            列が存在するかどうかを返す
+            \param name 列の名前
+            \return 存在すればtrue
+        */
+        bool has(std::string const & name) const
+        {
+            return find(name) != nullptr;
+        }
+
+        //! A public member function.
+        /*!
+            数値の列へのビューを返す
+            \param name 列の名前
+            \return 列へのビュー
+        */
+        template <typename T>
+        View<T> column(std::string const & name) const
+        {
+            auto const & e = get(name, TypeOf<T>::value);
+
+            return View<T>(reinterpret_cast<T const *>(base_ + e.offset), static_cast<std::size_t>(e.count));
+        }
+
+        //! A public member function.
+        /*!
+            文字列の列へのビューを返す
+            \param name 列の名前
+            \return 列へのビュー
+        */
+        StringView strings(std::string const & name) const
+        {
+            auto const & e = get(name, Type::STRING);
+            auto const ends = reinterpret_cast<std::uint64_t const *>(base_ + e.offset);
+
+            return StringView(ends, reinterpret_cast<char const *>(ends + e.count + 1U), static_cast<std::size_t>(e.count));
+        }
+
+        //! A public member function.
+        /*!
+            要素が一つの数値の列の値を返す
+            \param name 列の名前
+            \return 値
+        */
+        template <typename T>
+        T scalar(std::string const & name) const
+        {
+            auto const v = column<T>(name);
+            if (v.size() != 1U) {
+                throw std::runtime_error("要素が一つの列ではありません: " + name);
+            }
+
+            return v[0];
+        }
+
+        // #endregion メンバ関数
+
+        // #region プロパティ
+
+        //! A property.
+        /*!
+            列の数を返す
+        */
+        std::uint32_t ncolumn() const
+        {
+            return header().ncolumn;
+        }
+
+        //! A property.
+        /*!
+            i番目の列の目次の項目を返す
+            \param i 添字
+        */
+        ColumnEntry const & entry(std::uint32_t i) const
+        {
+            return reinterpret_cast<ColumnEntry const *>(base_ + sizeof(Header))[i];
+        }
+
+        // #endregion プロパティ
+
+    private:
+        // #region メンバ関数
+
+        //! A private member function.
+        /*!
+            ヘッダを返す
+        */
+        Header const & header() const
+        {
+            return *reinterpret_cast<Header const *>(base_);
+        }
+
+        //! A private member function.
+        /*!
+            列のデータの大きさを返す（列の位置はファイルの大きさ以下であること）
+            文字列の列は、終端の位置が減っていないことも確認する
+            \param e 列の目次の項目
+            \return 大きさ（バイト、型が不明な場合と壊れている場合はファイルより大きな値）
+        */
+        std::uint64_t bytes(ColumnEntry const & e) const
+        {
+            switch (static_cast<Type>(e.type)) {
+            case Type::UINT32:
+                return e.count <= size_ / 4U ? e.count * 4U : ~UINT64_C(0);
+
+            case Type::UINT64:
+            case Type::FLOAT64:
+                return e.count <= size_ / 8U ? e.count * 8U : ~UINT64_C(0);
+
+            case Type::STRING:
+            {
+                // 足し算が桁あふれしないよう、列の位置から後ろの大きさと比べる
+                auto const rest = size_ - e.offset;
+                if (e.count >= rest / 8U) {
+                    return ~UINT64_C(0);
+                }
+
+                auto const head = (e.count + 1U) * 8U;
+                auto const ends = reinterpret_cast<std::uint64_t const *>(base_ + e.offset);
+                if (ends[e.count] > rest - head) {
+                    return ~UINT64_C(0);
+                }
+
+                // 終端の位置が減っていれば、文字列がファイルの外を指す
+                for (auto i = UINT64_C(0); i < e.count; i++) {
+                    if (ends[i] > ends[i + 1U]) {
+                        return ~UINT64_C(0);
+                    }
+                }
+
+                return head + ends[e.count];
+            }
+
+            default:
+                return ~UINT64_C(0);
+            }
+        }
+
+        //! A private member function.
+        /*!
+            名前で列を探す
+            \param name 列の名前
+            \return 列の目次の項目へのポインタ（見つからなければnullptr）
+        */
+        ColumnEntry const * find(std::string const & name) const
+        {
+            for (auto i = 0U; i < header().ncolumn; i++) {
+                auto const & e = entry(i);
+                if (!std::strncmp(e.name, name.c_str(), sizeof(e.name))) {
+                    return &e;
+                }
+            }
+
+            return nullptr;
+        }
+
+        //! A private member function.
+        /*!
+            名前で列を探し、型を確認する
+            \param name 列の名前
+            \param type 要素の型
+            \return 列の目次の項目
+        */
+        ColumnEntry const & get(std::string const & name, Type type) const
+        {
+            auto const e = find(name);
+            if (!e) {
+                throw std::runtime_error("列がありません: " + name);
+            }
+
+            if (static_cast<Type>(e->type) != type) {
+                throw std::runtime_error("列の型が異なります: " + name);
+            }
+
+            return *e;
+        }
+
+        //! A private member function.
+        /*!
+            メモリマップを解除する
+        */
+        void close()
+        {
+#ifdef _WIN32
+            if (base_) {
+                ::UnmapViewOfFile(base_);
+            }
+            if (mapping_) {
+                ::CloseHandle(mapping_);
+            }
+            if (file_ != INVALID_HANDLE_VALUE) {
+                ::CloseHandle(file_);
+            }
+            mapping_ = nullptr;
+            file_ = INVALID_HANDLE_VALUE;
+#else
+            if (base_) {
+                ::munmap(const_cast<char *>(base_), size_);
+            }
+#endif
+            base_ = nullptr;
+        }
+
+        // #endregion メンバ関数
+
+        // #region メンバ変数
+
+        //! A private member variable.
+        /*!
+            メモリマップされた領域の先頭
+        */
+        char const * base_ = nullptr;
+
+#ifdef _WIN32
+        //! A private member variable.
+        /*!
+            ファイルのハンドル
+        */
+        HANDLE file_ = INVALID_HANDLE_VALUE;
+
+        //! A private member variable.
+        /*!
+            ファイルマッピングのハンドル
+        */
+        HANDLE mapping_ = nullptr;
+#endif
+
+        //! A private member variable.
+        /*!
+            ファイルの大きさ（バイト）
+        */
+        std::size_t size_ = 0U;
+
+        // #endregion メンバ変数
+
+        // #region 禁止されたコンストラクタ・メンバ関数
+
+        //! A private constructor (deleted).
+        /*!
+            デフォルトコンストラクタ（禁止）
+        */
+        Reader() = delete;
+
+        //! A private copy constructor (deleted).
+        /*!
+            コピーコンストラクタ（禁止）
+            \param dummy コピー元のオブジェクト（未使用）
+        */
+        Reader(Reader const & dummy) = delete;
+
+        //! A private member function (deleted).
+        /*!
+            operator=()の宣言（禁止）
+            \param dummy コピー元のオブジェクト（未使用）
+            \return コピー元のオブジェクト
+        */
+        Reader & operator=(Reader const & dummy) = delete;
+
+        // #endregion 禁止されたコンストラクタ・メンバ関数
+    };
+}
+
+#endif  // _COLUMNARREADER_H_
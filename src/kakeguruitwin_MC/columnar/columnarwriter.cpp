@@ -0,0 +1,105 @@
+﻿/*! \file columnarwriter.cpp
+    \brief 列指向の結果ファイルを書き出すクラスの実装
+
+    Copyright © 2017 @dc1394 All Rights Reserved.
+    This software is released under the BSD 2-Clause License.
+*/
+
+#include "columnarwriter.h"
+#include <fstream>      // for std::ofstream
+#include <stdexcept>    // for std::invalid_argument, std::runtime_error
+#include <utility>      // for std::move
+
+namespace columnar {
+    namespace {
+        //! A function.
+        /*!
+            位置を境界に切り上げる
+            \param offset 位置
+            \return 切り上げた位置
+        */
+        inline std::uint64_t alignup(std::uint64_t offset)
+        {
+            return (offset + ALIGNMENT - 1U) / ALIGNMENT * ALIGNMENT;
+        }
+    }
+
+    // #region メンバ関数
+
+    void Writer::add(std::string const & name, std::vector<std::string> const & values)
+    {
+        // 各文字列の終端の位置の後に、文字の並びを続ける
+        std::vector<std::uint64_t> ends(values.size() + 1U, 0U);
+        for (auto i = 0U; i < values.size(); i++) {
+            ends[i + 1U] = ends[i] + values[i].size();
+        }
+
+        std::vector<char> data(ends.size() * sizeof(std::uint64_t) + ends.back());
+        std::memcpy(data.data(), ends.data(), ends.size() * sizeof(std::uint64_t));
+
+        auto * chars = data.data() + ends.size() * sizeof(std::uint64_t);
+        for (auto i = 0U; i < values.size(); i++) {
+            values[i].copy(chars + ends[i], values[i].size());
+        }
+
+        addcolumn(name, Type::STRING, values.size(), std::move(data));
+    }
+
+    void Writer::addcolumn(std::string const & name, Type type, std::uint64_t count, std::vector<char> && data)
+    {
+        ColumnEntry e = {};
+        if (name.empty() || name.size() >= sizeof(e.name)) {
+            throw std::invalid_argument("列の名前は1バイト以上39バイト以下でなければなりません: " + name);
+        }
+
+        name.copy(e.name, name.size());
+        e.type = static_cast<std::uint32_t>(type);
+        e.count = count;
+
+        entries_.push_back(e);
+        data_.push_back(std::move(data));
+    }
+
+    void Writer::write(std::string const & filename) const
+    {
+        // 各列の位置を決める
+        auto entries = entries_;
+        auto offset = alignup(sizeof(Header) + entries.size() * sizeof(ColumnEntry));
+        for (auto i = 0U; i < entries.size(); i++) {
+            entries[i].offset = offset;
+            offset = alignup(offset + data_[i].size());
+        }
+
+        Header header = {};
+        std::memcpy(header.magic, MAGIC, sizeof(MAGIC));
+        header.version = VERSION;
+        header.byteorder = BYTEORDER;
+        header.ncolumn = static_cast<std::uint32_t>(entries.size());
+        header.filesize = offset;
+
+        std::ofstream ofs(filename, std::ios::binary);
+        if (!ofs) {
+            throw std::runtime_error("ファイルを開けませんでした: " + filename);
+        }
+
+        // ヘッダと目次
+        ofs.write(reinterpret_cast<char const *>(&header), sizeof(Header));
+        ofs.write(reinterpret_cast<char const *>(entries.data()), entries.size() * sizeof(ColumnEntry));
+
+        // 各列（境界までは0で埋める）
+        char const zeros[ALIGNMENT] = {};
+        auto pos = static_cast<std::uint64_t>(sizeof(Header) + entries.size() * sizeof(ColumnEntry));
+        for (auto i = 0U; i < entries.size(); i++) {
+            ofs.write(zeros, entries[i].offset - pos);
+            ofs.write(data_[i].data(), data_[i].size());
+            pos = entries[i].offset + data_[i].size();
+        }
+        ofs.write(zeros, offset - pos);
+
+        if (!ofs) {
+            throw std::runtime_error("ファイルに書き込めませんでした: " + filename);
+        }
+    }
+
+    // #endregion メンバ関数
+}
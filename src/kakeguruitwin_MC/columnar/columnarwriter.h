@@ -0,0 +1,131 @@
+﻿/*! \file columnarwriter.h
+    \brief 列指向の結果ファイルを書き出すクラスの宣言
+
+    Copyright © 2017 @dc1394 All Rights Reserved.
+    This software is released under the BSD 2-Clause License.
+*/
+
+#ifndef _COLUMNARWRITER_H_
+#define _COLUMNARWRITER_H_
+
+#pragma once
+
+#include "columnarreader.h"
+#include <cstdint>      // for std::uint32_t, std::uint64_t
+#include <cstring>      // for std::memcpy
+#include <string>       // for std::string
+#include <utility>      // for std::move
+#include <vector>       // for std::vector
+
+namespace columnar {
+    //! A class.
+    /*!
+        列を順に加え、メモリマップしてそのまま読める列指向の結果ファイルとして書き出すクラス
+    */
+    class Writer final {
+        // #region コンストラクタ・デストラクタ
+
+    public:
+        //! A constructor.
+        /*!
+            唯一のコンストラクタ
+        */
+        Writer() = default;
+
+        //! A destructor.
+        /*!
+            デフォルトデストラクタ
+        */
+        ~Writer() = default;
+
+        // #endregion コンストラクタ・デストラクタ
+
+        // #region メンバ関数
+
+        //! A public member function.
+        /*!
+            数値の列を加える
+            \param name 列の名前（39バイト以下）
+            \param values 列の要素
+        */
+        template <typename T>
+        void add(std::string const & name, std::vector<T> const & values)
+        {
+            std::vector<char> data(values.size() * sizeof(T));
+            if (!values.empty()) {
+                std::memcpy(data.data(), values.data(), data.size());
+            }
+
+            addcolumn(name, TypeOf<T>::value, values.size(), std::move(data));
+        }
+
+        //! A public member function.
+        /*!
+            文字列の列を加える
+            \param name 列の名前（39バイト以下）
+            \param values 列の要素
+        */
+        void add(std::string const & name, std::vector<std::string> const & values);
+
+        //! A public member function.
+        /*!
+            加えた列をファイルに書き出す
+            \param filename ファイル名
+        */
+        void write(std::string const & filename) const;
+
+        // #endregion メンバ関数
+
+    private:
+        // #region メンバ関数
+
+        //! A private member function.
+        /*!
+            列のデータを加える
+            \param name 列の名前
+            \param type 要素の型
+            \param count 要素の数
+            \param data 列のデータ
+        */
+        void addcolumn(std::string const & name, Type type, std::uint64_t count, std::vector<char> && data);
+
+        // #endregion メンバ関数
+
+        // #region メンバ変数
+
+        //! A private member variable.
+        /*!
+            列のデータ
+        */
+        std::vector<std::vector<char>> data_;
+
+        //! A private member variable.
+        /*!
+            列の目次の項目（位置は書き出すときに決める）
+        */
+        std::vector<ColumnEntry> entries_;
+
+        // #endregion メンバ変数
+
+        // #region 禁止されたコンストラクタ・メンバ関数
+
+        //! A private copy constructor (deleted).
+        /*!
+            コピーコンストラクタ（禁止）
+            \param dummy コピー元のオブジェクト（未使用）
+        */
+        Writer(Writer const & dummy) = delete;
+
+        //! A private member function (deleted).
+        /*!
+            operator=()の宣言（禁止）
+            \param dummy コピー元のオブジェクト（未使用）
+            \return コピー元のオブジェクト
+        */
+        Writer & operator=(Writer const & dummy) = delete;
+
+        // #endregion 禁止されたコンストラクタ・メンバ関数
+    };
+}
+
+#endif  // _COLUMNARWRITER_H_
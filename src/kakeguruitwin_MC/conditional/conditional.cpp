@@ -0,0 +1,340 @@
+﻿/*! \file conditional.cpp
+    \brief 途中から先の勝率を厳密な吸収確率で置き換える、条件付きモンテカルロ法の実装
+
+    Copyright © 2017 @dc1394 All Rights Reserved.
+    This software is released under the BSD 2-Clause License.
+*/
+
+#include "conditional.h"
+#include "../flips/patternscan.h"
+#include "../pattern/pattern.h"
+#ifdef HAVE_SSE2
+    #include "../myrandom/myrandsfmt.h"
+#else
+    #include "../myrandom/myrand.h"
+#endif
+#include <algorithm>                            // for std::find, std::max, std::min, std::sort, std::unique
+#include <cmath>                                // for std::sqrt
+#include <stdexcept>                            // for std::invalid_argument
+#include <string>                               // for std::to_string
+#include <tbb/blocked_range.h>                  // for tbb::blocked_range
+#include <tbb/enumerable_thread_specific.h>     // for tbb::enumerable_thread_specific
+#include <tbb/parallel_for.h>                   // for tbb::parallel_for
+#include <tbb/partitioner.h>                    // for tbb::simple_partitioner
+
+namespace conditional {
+    namespace {
+#ifdef HAVE_SSE2
+        using myrand = myrandom::MyRandSfmt;
+#else
+        using myrand = myrandom::MyRand;
+#endif
+
+        //! A global variable (constant expression).
+        /*!
+            乱数の種を指定した場合に、同じ種から乱数列を作り直す試行の数
+        */
+        static auto constexpr CHUNK = 4096U;
+
+        //! A struct.
+        /*!
+            スレッド毎の集計結果
+        */
+        struct Accumulator final {
+            //! A constructor.
+            /*!
+                唯一のコンストラクタ
+                \param nautomaton オートマトンの数（順列の数の半分）
+            */
+            explicit Accumulator(std::size_t nautomaton)
+                : draws(0U), flips(0U), states(nautomaton), sum(2U * nautomaton, 0.0), sumsq(2U * nautomaton, 0.0), trials(0U)
+            {
+            }
+
+            //! A public member variable.
+            /*!
+                生成した32ビットの乱数の個数
+            */
+            std::uint64_t draws;
+
+            //! A public member variable.
+            /*!
+                生成したUかDの個数
+            */
+            std::uint64_t flips;
+
+            //! A public member variable.
+            /*!
+                オートマトン毎の状態（試行毎に使い回す）
+            */
+            std::vector<std::uint32_t> states;
+
+            //! A public member variable.
+            /*!
+                オートマトン毎の前者と後者の条件付きの勝率の和（添字はオートマトンの添字の2倍と、後者なら1を足したもの）
+            */
+            std::vector<double> sum;
+
+            //! A public member variable.
+            /*!
+                オートマトン毎の前者と後者の条件付きの勝率の2乗の和
+            */
+            std::vector<double> sumsq;
+
+            //! A public member variable.
+            /*!
+                試行回数
+            */
+            std::uint64_t trials;
+        };
+
+        //! A function.
+        /*!
+            文字列が別の文字列で終わっているかどうかを返す
+            \param str 文字列
+            \param suffix 末尾の文字列
+            \return strがsuffixで終わっていればtrue
+        */
+        inline bool endswith(std::string const & str, std::string const & suffix)
+        {
+            return str.size() >= suffix.size() && str.compare(str.size() - suffix.size(), suffix.size(), suffix) == 0;
+        }
+    }
+
+    // #region コンストラクタ
+
+    PairAutomaton::PairAutomaton(std::string const & a, std::string const & b, double bias, std::uint32_t horizon, std::uint32_t cutoff)
+        : base_(horizon - std::min(cutoff, horizon)),
+          nrow_(static_cast<std::size_t>(std::min(cutoff, horizon)) + 1U)
+    {
+        // 文字列として正しいか確認する
+        pattern::tocode(a);
+        pattern::tocode(b);
+
+        // 吸収状態でない状態は、二つの文字列の真の接頭辞（空の列が最初の状態）
+        std::vector<std::string> prefixes;
+        for (auto const & str : { a, b }) {
+            for (auto n = 0U; n < str.size(); n++) {
+                prefixes.push_back(str.substr(0U, n));
+            }
+        }
+
+        std::sort(prefixes.begin(), prefixes.end(), [](auto const & lhs, auto const & rhs) {
+            return lhs.size() != rhs.size() ? lhs.size() < rhs.size() : lhs < rhs;
+        });
+        prefixes.erase(std::unique(prefixes.begin(), prefixes.end()), prefixes.end());
+
+        ntransient_ = static_cast<std::uint32_t>(prefixes.size());
+
+        // 表を作る時間と表の大きさが現実的な範囲に収まるか確認する
+        if (static_cast<std::uint64_t>(horizon) * nstate() > MAXWORK) {
+            throw std::invalid_argument(
+                a + "と" + b + "の状態の数は" + std::to_string(nstate()) + "なので、UかDの文字列の長さは" +
+                std::to_string(MAXWORK / nstate()) + "以下でなければなりません");
+        }
+
+        if (nrow_ * nstate() > MAXTABLE) {
+            throw std::invalid_argument(
+                a + "と" + b + "の状態の数は" + std::to_string(nstate()) + "なので、実際に生成するUかDの個数の上限は" +
+                std::to_string(MAXTABLE / nstate() - 1U) + "以下でなければなりません");
+        }
+        auto const win = ntransient_;
+        auto const lose = ntransient_ + 1U;
+        auto const tie = ntransient_ + 2U;
+
+        // 直近のUとDの列にUかDを加え、完成していなければ接頭辞になっている最長の末尾を次の状態とする
+        next_.resize(2U * static_cast<std::size_t>(nstate()));
+        for (auto s = 0U; s < nstate(); s++) {
+            for (auto flip = 0U; flip < 2U; flip++) {
+                if (absorbed(s)) {
+                    next_[2U * s + flip] = s;
+                    continue;
+                }
+
+                auto const str = prefixes[s] + (flip ? 'U' : 'D');
+                auto const wa = endswith(str, a);
+                auto const wb = endswith(str, b);
+                if (wa || wb) {
+                    next_[2U * s + flip] = wa && wb ? tie : (wa ? win : lose);
+                    continue;
+                }
+
+                for (auto n = 0U; n <= str.size(); n++) {
+                    auto const itr = std::find(prefixes.begin(), prefixes.end(), str.substr(n));
+                    if (itr != prefixes.end()) {
+                        next_[2U * s + flip] = static_cast<std::uint32_t>(itr - prefixes.begin());
+                        break;
+                    }
+                }
+            }
+        }
+
+        // 残りがn個のときの勝率を、残りがn - 1個のときの勝率から求める
+        // 表に残すのは残りがbase_個以上の行だけなので、途中は2行だけで計算する
+        std::vector<double> wina(nstate(), 0.0), winb(nstate(), 0.0);
+        wina[win] = 1.0;
+        winb[lose] = 1.0;
+        auto preva = wina;
+        auto prevb = winb;
+
+        tablea_.resize(nstate() * nrow_);
+        tableb_.resize(nstate() * nrow_);
+        for (auto n = 0U; n <= horizon; n++) {
+            if (n) {
+                wina.swap(preva);
+                winb.swap(prevb);
+                for (auto s = 0U; s < ntransient_; s++) {
+                    wina[s] = bias * preva[next(s, 1U)] + (1.0 - bias) * preva[next(s, 0U)];
+                    winb[s] = bias * prevb[next(s, 1U)] + (1.0 - bias) * prevb[next(s, 0U)];
+                }
+            }
+
+            if (n >= base_) {
+                for (auto s = 0U; s < nstate(); s++) {
+                    tablea_[s * nrow_ + (n - base_)] = wina[s];
+                    tableb_[s * nrow_ + (n - base_)] = winb[s];
+                }
+            }
+        }
+    }
+
+    // #endregion コンストラクタ
+
+    // #region 非メンバ関数
+
+    ConditionalResult montecarlo(ConditionalConfig const & config)
+    {
+        if (config.patterns.size() < 2U) {
+            throw std::invalid_argument("文字列を二つ以上指定してください");
+        }
+
+        if (!(config.bias > 0.0 && config.bias < 1.0)) {
+            throw std::invalid_argument("Uが出る確率は0より大きく1より小さくなければなりません");
+        }
+
+        if (!config.horizon || !config.trials) {
+            throw std::invalid_argument("UかDの文字列の長さと試行回数は1以上でなければなりません");
+        }
+
+        // 全ての組み合わせのオートマトンと勝率の表（(i, j)と(j, i)は同じオートマトンを使う）
+        std::vector<PairAutomaton> automata;
+        auto const npattern = static_cast<std::uint32_t>(config.patterns.size());
+        for (auto i = 0U; i < npattern; i++) {
+            for (auto j = i + 1U; j < npattern; j++) {
+                automata.emplace_back(config.patterns[i], config.patterns[j], config.bias, config.horizon, config.cutoff);
+            }
+        }
+
+        // i < jのペア(i, j)のオートマトンの添字
+        auto const automaton = [npattern](std::uint32_t i, std::uint32_t j) {
+            return static_cast<std::size_t>(i) * (2U * npattern - i - 1U) / 2U + (j - i - 1U);
+        };
+
+        // 全ての順列の厳密な勝率（順列の添字はオートマトンの添字の2倍と、逆順なら1を足したもの）
+        ConditionalResult result;
+        std::vector<std::size_t> order;
+        for (auto i = 0U; i < npattern; i++) {
+            for (auto j = 0U; j < npattern; j++) {
+                if (i != j) {
+                    auto const & pa = automata[automaton(std::min(i, j), std::max(i, j))];
+                    auto const exact = i < j ?
+                        pa.winprobability(PairAutomaton::START, config.horizon) :
+                        pa.loseprobability(PairAutomaton::START, config.horizon);
+                    result.pairs.push_back({ i, j, exact, 0.0, 0.0, 0.0 });
+                    order.push_back(2U * automaton(std::min(i, j), std::max(i, j)) + (i < j ? 0U : 1U));
+                }
+            }
+        }
+
+        auto const nautomaton = automata.size();
+        auto const npair = result.pairs.size();
+        auto const cutoff = std::min(config.cutoff, config.horizon);
+        auto const threshold = flips::biasthreshold(config.bias);
+
+        // スレッド毎の自作乱数クラスのオブジェクト
+        tbb::enumerable_thread_specific<myrand> mrs(1, 6);
+
+        // スレッド毎の集計結果
+        tbb::enumerable_thread_specific<Accumulator> accs(nautomaton);
+
+        auto const body = [&](tbb::blocked_range<std::uint64_t> const & range) {
+            auto & mr = mrs.local();
+            auto & acc = accs.local();
+            auto & states = acc.states;
+
+            if (config.seed) {
+                mr.seed(flips::chunkseed(config.seed, range.begin()));
+            }
+
+            flips::FlipSource<myrand> src(mr, threshold);
+
+            for (auto n = range.begin(); n != range.end(); ++n) {
+                std::fill(states.begin(), states.end(), PairAutomaton::START);
+
+                // cutoff個まで、または全てのペアが決着するまでUとDを生成する
+                auto t = 0U;
+                for (auto live = nautomaton; t < cutoff && live; t++) {
+                    auto const flip = src.next();
+                    for (auto k = 0U; k < nautomaton; k++) {
+                        if (!automata[k].absorbed(states[k])) {
+                            states[k] = automata[k].next(states[k], flip);
+                            live -= automata[k].absorbed(states[k]) ? 1U : 0U;
+                        }
+                    }
+                }
+
+                // 決着していれば0か1、していなければその状態からの厳密な勝率を加える
+                for (auto k = 0U; k < nautomaton; k++) {
+                    auto const pa = automata[k].winprobability(states[k], config.horizon - t);
+                    auto const pb = automata[k].loseprobability(states[k], config.horizon - t);
+                    acc.sum[2U * k] += pa;
+                    acc.sumsq[2U * k] += pa * pa;
+                    acc.sum[2U * k + 1U] += pb;
+                    acc.sumsq[2U * k + 1U] += pb * pb;
+                }
+
+                acc.flips += t;
+            }
+
+            acc.draws += src.draws();
+            acc.trials += range.size();
+        };
+
+        if (config.seed) {
+            // 試行の塊の分け方をスレッドの割り当てによらず一定にし、結果を再現できるようにする
+            tbb::parallel_for(tbb::blocked_range<std::uint64_t>(0U, config.trials, CHUNK), body, tbb::simple_partitioner());
+        }
+        else {
+            tbb::parallel_for(tbb::blocked_range<std::uint64_t>(0U, config.trials, 1024U), body);
+        }
+
+        // スレッド毎の集計結果を足し合わせる
+        Accumulator total(nautomaton);
+        for (auto const & acc : accs) {
+            for (auto k = 0U; k < 2U * nautomaton; k++) {
+                total.sum[k] += acc.sum[k];
+                total.sumsq[k] += acc.sumsq[k];
+            }
+
+            total.draws += acc.draws;
+            total.flips += acc.flips;
+            total.trials += acc.trials;
+        }
+
+        result.draws = total.draws;
+        result.flips = total.flips;
+        result.trials = total.trials;
+
+        auto const n = static_cast<double>(total.trials);
+        for (auto k = 0U; k < npair; k++) {
+            auto & pair = result.pairs[k];
+            pair.probability = total.sum[order[k]] / n;
+            pair.stderror = std::sqrt(std::max(total.sumsq[order[k]] / n - pair.probability * pair.probability, 0.0) / n);
+            pair.naivestderror = std::sqrt(pair.probability * (1.0 - pair.probability) / n);
+        }
+
+        return result;
+    }
+
+    // #endregion 非メンバ関数
+}
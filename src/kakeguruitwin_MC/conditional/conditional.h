@@ -0,0 +1,333 @@
+﻿/*! \file conditional.h
+    \brief 途中から先の勝率を厳密な吸収確率で置き換える、条件付きモンテカルロ法の宣言
+
+    Copyright © 2017 @dc1394 All Rights Reserved.
+    This software is released under the BSD 2-Clause License.
+*/
+
+#ifndef _CONDITIONAL_H_
+#define _CONDITIONAL_H_
+
+#pragma once
+
+#include <cstddef>  // for std::size_t
+#include <cstdint>  // for std::uint32_t, std::uint64_t
+#include <string>   // for std::string
+#include <vector>   // for std::vector
+
+namespace conditional {
+    //! A struct.
+    /*!
+        条件付きモンテカルロ法の設定
+    */
+    struct ConditionalConfig final {
+        //! A public member variable.
+        /*!
+            対象とする文字列（異なる二つの全ての順列を競争させる）
+        */
+        std::vector<std::string> patterns;
+
+        //! A public member variable.
+        /*!
+            Uが出る確率
+        */
+        double bias = 0.5;
+
+        //! A public member variable.
+        /*!
+            実際に生成するUかDの個数の上限（これ以降は厳密な吸収確率で置き換える）
+        */
+        std::uint32_t cutoff = 4U;
+
+        //! A public member variable.
+        /*!
+            UかDの文字列の長さ
+        */
+        std::uint32_t horizon = 100U;
+
+        //! A public member variable.
+        /*!
+            乱数の種（0の場合は試行の塊毎に種を設定しない）
+        */
+        std::uint64_t seed = 0U;
+
+        //! A public member variable.
+        /*!
+            試行回数
+        */
+        std::uint64_t trials = 1000000U;
+    };
+
+    //! A struct.
+    /*!
+        ペア毎の推定結果
+    */
+    struct PairEstimate final {
+        //! A public member variable.
+        /*!
+            前者の文字列の添字
+        */
+        std::uint32_t a;
+
+        //! A public member variable.
+        /*!
+            後者の文字列の添字
+        */
+        std::uint32_t b;
+
+        //! A public member variable.
+        /*!
+            UかDの文字列の長さの中で、前者が先に出現する確率の厳密な値
+        */
+        double exact;
+
+        //! A public member variable.
+        /*!
+            前者が先に出現する確率の推定値
+        */
+        double probability;
+
+        //! A public member variable.
+        /*!
+            推定値の標準誤差
+        */
+        double stderror;
+
+        //! A public member variable.
+        /*!
+            同じ試行回数の、打ち切らないモンテカルロ法（結果が0か1）の標準誤差
+        */
+        double naivestderror;
+    };
+
+    //! A struct.
+    /*!
+        条件付きモンテカルロ法の結果
+    */
+    struct ConditionalResult final {
+        //! A public member variable.
+        /*!
+            生成した32ビットの乱数の個数
+        */
+        std::uint64_t draws;
+
+        //! A public member variable.
+        /*!
+            生成したUかDの個数
+        */
+        std::uint64_t flips;
+
+        //! A public member variable.
+        /*!
+            ペア毎の推定結果
+        */
+        std::vector<PairEstimate> pairs;
+
+        //! A public member variable.
+        /*!
+            試行回数
+        */
+        std::uint64_t trials;
+    };
+
+    //! A class.
+    /*!
+        二つの文字列の競争のオートマトンと、各状態からの残りのUかDの個数毎の、前者と後者それぞれの厳密な勝率の表
+        状態は二つの文字列のどちらかの接頭辞になっている直近のUとDの列の最長のもので、
+        前者の完成・後者の完成・同時の完成の三つの吸収状態を持つ
+        一つのオートマトンで順序付きのペア(a, b)と(b, a)の両方を扱う
+        表は残りのUかDの個数がhorizon - cutoff以上horizon以下の行だけを保持する（それより少ない残りは参照しない）
+    */
+    class PairAutomaton final {
+        // #region コンストラクタ・デストラクタ
+
+    public:
+        //! A constructor.
+        /*!
+            唯一のコンストラクタ
+            \param a 前者の文字列
+            \param b 後者の文字列
+            \param bias Uが出る確率
+            \param horizon UかDの文字列の長さ
+            \param cutoff 実際に生成するUかDの個数の上限（horizon以下）
+        */
+        PairAutomaton(std::string const & a, std::string const & b, double bias, std::uint32_t horizon, std::uint32_t cutoff);
+
+        //! A copy constructor.
+        /*!
+            デフォルトコピーコンストラクタ
+        */
+        PairAutomaton(PairAutomaton const &) = default;
+
+        //! A destructor.
+        /*!
+            デフォルトデストラクタ
+        */
+        ~PairAutomaton() = default;
+
+        // #endregion コンストラクタ・デストラクタ
+
+        // #region メンバ関数
+
+        //! A public member function.
+        /*!
+            状態が吸収状態かどうかを返す
+            \param state 状態
+            \return 吸収状態ならtrue
+        */
+        bool absorbed(std::uint32_t state) const
+        {
+            return state >= ntransient_;
+        }
+
+        //! A public member function.
+        /*!
+            UかDを一つ加えたときの次の状態を返す
+            \param state 状態（吸収状態でないこと）
+            \param flip Uなら1、Dなら0
+            \return 次の状態
+        */
+        std::uint32_t next(std::uint32_t state, std::uint32_t flip) const
+        {
+            return next_[2U * state + flip];
+        }
+
+        //! A public member function.
+        /*!
+            状態から残りのUかDの中で、後者が先に完成する確率を返す
+            \param state 状態
+            \param remain 残りのUかDの個数（horizon - cutoff以上horizon以下）
+            \return 後者が先に完成する確率
+        */
+        double loseprobability(std::uint32_t state, std::uint32_t remain) const
+        {
+            return tableb_[static_cast<std::size_t>(state) * nrow_ + (remain - base_)];
+        }
+
+        //! A public member function.
+        /*!
+            状態から残りのUかDの中で、前者が先に完成する確率を返す
+            \param state 状態
+            \param remain 残りのUかDの個数（horizon - cutoff以上horizon以下）
+            \return 前者が先に完成する確率
+        */
+        double winprobability(std::uint32_t state, std::uint32_t remain) const
+        {
+            return tablea_[static_cast<std::size_t>(state) * nrow_ + (remain - base_)];
+        }
+
+        // #endregion メンバ関数
+
+        // #region プロパティ
+
+        //! A property.
+        /*!
+            吸収状態を含む状態の数を返す
+        */
+        std::uint32_t nstate() const
+        {
+            return ntransient_ + NABSORBING;
+        }
+
+        // #endregion プロパティ
+
+        // #region メンバ変数
+
+        //! A public static member variable (constant expression).
+        /*!
+            最初の状態（何も出ていない状態）
+        */
+        static auto constexpr START = 0U;
+
+    private:
+        //! A private static member variable (constant expression).
+        /*!
+            吸収状態の数（前者の完成、後者の完成、同時の完成）
+        */
+        static auto constexpr NABSORBING = 3U;
+
+        //! A private static member variable (constant expression).
+        /*!
+            表を作る計算量（UかDの文字列の長さ × 状態の数）の上限
+        */
+        static auto constexpr MAXWORK = UINT64_C(1) << 28;
+
+        //! A private static member variable (constant expression).
+        /*!
+            一つの表の要素の数（状態の数 × (cutoff + 1)）の上限
+        */
+        static auto constexpr MAXTABLE = UINT64_C(1) << 24;
+
+        //! A private member variable.
+        /*!
+            表の先頭の行の残りのUかDの個数（horizon - cutoff）
+        */
+        std::uint32_t base_;
+
+        //! A private member variable.
+        /*!
+            状態遷移表（状態 × 2）
+        */
+        std::vector<std::uint32_t> next_;
+
+        //! A private member variable.
+        /*!
+            表の一つの状態の行の数（cutoff + 1）
+        */
+        std::size_t nrow_;
+
+        //! A private member variable.
+        /*!
+            吸収状態でない状態の数（吸収状態の添字はこれ以上）
+        */
+        std::uint32_t ntransient_;
+
+        //! A private member variable.
+        /*!
+            各状態からの残りのUかDの個数毎の、前者が先に完成する確率の表（状態 × (cutoff + 1)）
+        */
+        std::vector<double> tablea_;
+
+        //! A private member variable.
+        /*!
+            各状態からの残りのUかDの個数毎の、後者が先に完成する確率の表（状態 × (cutoff + 1)）
+        */
+        std::vector<double> tableb_;
+
+        // #endregion メンバ変数
+
+        // #region 禁止されたコンストラクタ・メンバ関数
+
+        //! A private constructor (deleted).
+        /*!
+            デフォルトコンストラクタ（禁止）
+        */
+        PairAutomaton() = delete;
+
+        //! A private member function (deleted).
+        /*!
+            operator=()の宣言（禁止）
+            \param dummy コピー元のオブジェクト（未使用）
+            \return コピー元のオブジェクト
+        */
+        PairAutomaton & operator=(PairAutomaton const & dummy) = delete;
+
+        // #endregion 禁止されたコンストラクタ・メンバ関数
+    };
+
+    // #region 非メンバ関数
+
+    //! A function.
+    /*!
+        全ての文字列のペアについて、cutoff個までのUかDを実際に生成し、決着していなければ
+        その時点の状態からの厳密な勝率を0か1の代わりに加える条件付きモンテカルロ法を、TBBで並列化して行う
+        全てのペアが決着した試行はその時点で打ち切る
+        \param config 条件付きモンテカルロ法の設定
+        \return 条件付きモンテカルロ法の結果
+    */
+    ConditionalResult montecarlo(ConditionalConfig const & config);
+
+    // #endregion 非メンバ関数
+}
+
+#endif  // _CONDITIONAL_H_
@@ -0,0 +1,381 @@
+﻿/*! \file corpus.cpp
+    \brief 生成済みのUとDのランダム列をファイルに保存し、複数の文字列の組で使い回すためのクラスと関数の実装
+
+    Copyright © 2017 @dc1394 All Rights Reserved.
+    This software is released under the BSD 2-Clause License.
+*/
+
+#include "corpus.h"
+#include "../flips/patternscan.h"
+#ifdef HAVE_SSE2
+    #include "../myrandom/myrandsfmt.h"
+#else
+    #include "../myrandom/myrand.h"
+#endif
+#include <algorithm>                                // for std::copy, std::min
+#include <cmath>                                    // for std::sqrt
+#include <cstddef>                                  // for std::ptrdiff_t, std::size_t
+#include <cstring>                                  // for std::memcmp, std::memcpy
+#include <fstream>                                  // for std::ifstream, std::ofstream
+#include <future>                                   // for std::async, std::future
+#include <map>                                      // for std::map
+#include <stdexcept>                                // for std::invalid_argument, std::runtime_error
+#include <utility>                                  // for std::move
+#include <boost/interprocess/file_mapping.hpp>      // for boost::interprocess::file_mapping
+#include <tbb/blocked_range.h>                      // for tbb::blocked_range
+#include <tbb/enumerable_thread_specific.h>         // for tbb::enumerable_thread_specific
+#include <tbb/parallel_for.h>                       // for tbb::parallel_for
+
+namespace corpus {
+    namespace {
+#ifdef HAVE_SSE2
+        using myrand = myrandom::MyRandSfmt;
+#else
+        using myrand = myrandom::MyRand;
+#endif
+
+        //! A global variable (constant expression).
+        /*!
+            ファイルの識別子
+        */
+        static char const MAGIC[8] = { 'K', 'M', 'C', 'C', 'R', 'P', 'S', '\0' };
+
+        //! A global variable (constant expression).
+        /*!
+            ファイルのバージョン
+        */
+        static auto constexpr VERSION = 1U;
+
+        //! A global variable (constant expression).
+        /*!
+            ヘッダの大きさ（バイト、試行毎のワードが8バイト境界に揃うようにする）
+        */
+        static auto constexpr HEADERSIZE = 64U;
+
+        //! A global variable (constant expression).
+        /*!
+            同じ種から乱数エンジンを初期化する試行の塊の大きさ
+        */
+        static auto constexpr CHUNK = 4096U;
+
+        //! A global variable (constant expression).
+        /*!
+            一つのバッファに生成する試行の塊の数
+        */
+        static auto constexpr CHUNKSPERBUFFER = 16U;
+
+        //! A global variable (constant expression).
+        /*!
+            乱数エンジンの種類を表す番号（0はmt19937、1はSFMT19937）
+        */
+#ifdef HAVE_SSE2
+        static auto constexpr RNGID = 1U;
+#else
+        static auto constexpr RNGID = 0U;
+#endif
+
+        //! A struct.
+        /*!
+            スレッド毎の集計結果
+        */
+        struct Accumulator final {
+            //! A constructor.
+            /*!
+                唯一のコンストラクタ
+                \param npattern 全ての組の重複を除いた文字列の数
+                \param nwins 全ての組のペアの数の2倍
+            */
+            Accumulator(std::uint32_t npattern, std::size_t nwins)
+                : first(npattern), firstsum(npattern, 0U), wins(nwins, 0U)
+            {
+            }
+
+            //! A public member variable.
+            /*!
+                各文字列の最初の出現位置（試行毎に使い回す）
+            */
+            std::vector<std::uint32_t> first;
+
+            //! A public member variable.
+            /*!
+                各文字列の最初の出現位置の和
+            */
+            std::vector<std::uint64_t> firstsum;
+
+            //! A public member variable.
+            /*!
+                組毎・ペア毎の前者と後者の勝利回数
+            */
+            std::vector<std::uint64_t> wins;
+        };
+
+        //! A function.
+        /*!
+            リトルエンディアンのバイト列から値を読み込む
+            \param p バイト列の先頭へのポインタ
+            \return 読み込んだ値
+        */
+        template <typename T>
+        T readvalue(unsigned char const * p)
+        {
+            auto val = UINT64_C(0);
+            for (auto i = 0U; i < sizeof(T); i++) {
+                val |= static_cast<std::uint64_t>(p[i]) << (8U * i);
+            }
+
+            return static_cast<T>(val);
+        }
+
+        //! A function.
+        /*!
+            値をリトルエンディアンのバイト列として書き込む
+            \param p バイト列の先頭へのポインタ
+            \param val 書き込む値
+        */
+        template <typename T>
+        void writevalue(unsigned char * p, T val)
+        {
+            for (auto i = 0U; i < sizeof(T); i++) {
+                p[i] = static_cast<unsigned char>((static_cast<std::uint64_t>(val) >> (8U * i)) & 0xFFU);
+            }
+        }
+
+        //! A function.
+        /*!
+            ファイルを読み込み専用でメモリマップする
+            \param filename ファイル名
+            \return メモリマップされた領域
+        */
+        boost::interprocess::mapped_region mapfile(std::string const & filename)
+        {
+            if (!std::ifstream(filename, std::ios::binary)) {
+                throw std::runtime_error("ファイルを開けませんでした: " + filename);
+            }
+
+            boost::interprocess::file_mapping const fm(filename.c_str(), boost::interprocess::read_only);
+
+            return boost::interprocess::mapped_region(fm, boost::interprocess::read_only);
+        }
+
+    }
+
+    // #region コンストラクタ
+
+    Corpus::Corpus(std::string const & filename)
+        : region_(mapfile(filename))
+    {
+        auto const head = static_cast<unsigned char const *>(region_.get_address());
+
+        if (region_.get_size() < HEADERSIZE || std::memcmp(head, MAGIC, sizeof(MAGIC))) {
+            throw std::runtime_error("コーパスのファイルではありません: " + filename);
+        }
+
+        if (readvalue<std::uint32_t>(head + 8) != VERSION) {
+            throw std::runtime_error("コーパスのファイルのバージョンが異なります: " + filename);
+        }
+
+        rng_ = readvalue<std::uint32_t>(head + 12) ? "sfmt19937" : "mt19937";
+        seed_ = readvalue<std::uint64_t>(head + 16);
+        horizon_ = readvalue<std::uint32_t>(head + 24);
+        wordspertrial_ = readvalue<std::uint32_t>(head + 28);
+        trials_ = readvalue<std::uint64_t>(head + 32);
+
+        if (wordspertrial_ != flips::wordsize(horizon_) ||
+            region_.get_size() != HEADERSIZE + trials_ * wordspertrial_ * sizeof(std::uint64_t)) {
+            throw std::runtime_error("ファイルが壊れています: " + filename);
+        }
+
+        data_ = reinterpret_cast<std::uint64_t const *>(head + HEADERSIZE);
+    }
+
+    // #endregion コンストラクタ
+
+    // #region 非メンバ関数
+
+    std::vector<simulator::Result> evaluate(Corpus const & corpus, std::vector<std::vector<std::string>> const & sets)
+    {
+        auto const horizon = corpus.horizon();
+
+        // 全ての組の文字列の重複を除き、一度の走査で探索する
+        std::vector<flips::Target> targets;
+        std::map<std::string, std::uint32_t> patternindex;
+        std::vector<std::vector<std::uint32_t>> setindex;
+
+        for (auto const & set : sets) {
+            if (set.size() < 2U) {
+                throw std::invalid_argument("文字列の組には二つ以上の文字列が必要です");
+            }
+
+            std::vector<std::uint32_t> index;
+            for (auto const & str : set) {
+                auto const itr = patternindex.emplace(str, static_cast<std::uint32_t>(targets.size()));
+                if (itr.second) {
+                    targets.push_back(flips::maketarget(str));
+                }
+
+                index.push_back(itr.first->second);
+            }
+
+            setindex.push_back(std::move(index));
+        }
+
+        // 組毎の勝利回数の先頭の添字
+        std::vector<std::size_t> winoffset;
+        auto nwins = std::size_t(0);
+        for (auto const & index : setindex) {
+            winoffset.push_back(nwins);
+            nwins += index.size() * (index.size() - 1U) * 2U;
+        }
+
+        auto const npattern = static_cast<std::uint32_t>(targets.size());
+
+        // スレッド毎の集計結果
+        tbb::enumerable_thread_specific<Accumulator> accs(npattern, nwins);
+
+        tbb::parallel_for(
+            tbb::blocked_range<std::uint64_t>(0U, corpus.trials(), 1024U),
+            [&](auto const & range) {
+            auto & acc = accs.local();
+
+            for (auto n = range.begin(); n != range.end(); ++n) {
+                auto words = corpus.trial(n);
+                flips::firstoccurrence([&words] { return *words++; }, horizon, targets, acc.first);
+
+                for (auto p = 0U; p < npattern; p++) {
+                    acc.firstsum[p] += acc.first[p] ? acc.first[p] : horizon;
+                }
+
+                // 見つからなかった場合は最も遅いものとして扱う
+                for (auto s = 0U; s < setindex.size(); s++) {
+                    auto const & index = setindex[s];
+                    auto * const wins = acc.wins.data() + winoffset[s];
+                    auto k = std::size_t(0);
+                    for (auto i = 0U; i < index.size(); i++) {
+                        for (auto j = 0U; j < index.size(); j++) {
+                            if (i != j) {
+                                flips::countwins(acc.first[index[i]], acc.first[index[j]], wins + k);
+                                k += 2U;
+                            }
+                        }
+                    }
+                }
+            }
+        });
+
+        // スレッド毎の集計結果を足し合わせる
+        Accumulator total(npattern, nwins);
+        for (auto const & acc : accs) {
+            for (auto p = 0U; p < npattern; p++) {
+                total.firstsum[p] += acc.firstsum[p];
+            }
+
+            for (auto k = std::size_t(0); k < nwins; k++) {
+                total.wins[k] += acc.wins[k];
+            }
+        }
+
+        auto const trials = static_cast<double>(corpus.trials());
+
+        std::vector<simulator::Result> results;
+        for (auto s = 0U; s < setindex.size(); s++) {
+            auto const & index = setindex[s];
+            auto const * const wins = total.wins.data() + winoffset[s];
+
+            simulator::Result result;
+            result.trials = corpus.trials();
+
+            for (auto const p : index) {
+                result.firstsum.push_back(total.firstsum[p]);
+                result.waitingtime.push_back(static_cast<double>(total.firstsum[p]) / trials);
+            }
+
+            auto k = std::size_t(0);
+            for (auto i = 0U; i < index.size(); i++) {
+                for (auto j = 0U; j < index.size(); j++) {
+                    if (i != j) {
+                        auto const prob = static_cast<double>(wins[k]) / trials;
+                        result.pairs.push_back({ i, j, prob, std::sqrt(prob * (1.0 - prob) / trials), wins[k], wins[k + 1U] });
+                        k += 2U;
+                    }
+                }
+            }
+
+            results.push_back(std::move(result));
+        }
+
+        return results;
+    }
+
+    void write(std::string const & filename, std::uint32_t horizon, std::uint64_t trials, std::uint64_t seed)
+    {
+        if (!horizon || !trials) {
+            throw std::invalid_argument("UかDの文字列の長さと試行回数は1以上でなければなりません");
+        }
+
+        std::ofstream ofs(filename, std::ios::binary | std::ios::trunc);
+        if (!ofs) {
+            throw std::runtime_error("ファイルを開けませんでした: " + filename);
+        }
+
+        auto const wordspertrial = flips::wordsize(horizon);
+
+        // ヘッダ
+        unsigned char header[HEADERSIZE] = {};
+        std::memcpy(header, MAGIC, sizeof(MAGIC));
+        writevalue<std::uint32_t>(header + 8, VERSION);
+        writevalue<std::uint32_t>(header + 12, RNGID);
+        writevalue<std::uint64_t>(header + 16, seed);
+        writevalue<std::uint32_t>(header + 24, horizon);
+        writevalue<std::uint32_t>(header + 28, wordspertrial);
+        writevalue<std::uint64_t>(header + 32, trials);
+        ofs.write(reinterpret_cast<char const *>(header), HEADERSIZE);
+
+        // スレッド毎の自作乱数クラスのオブジェクト
+        tbb::enumerable_thread_specific<myrand> mrs(1, 6);
+
+        // 生成用と書き込み用のバッファ
+        auto const buffertrials = static_cast<std::uint64_t>(CHUNK) * CHUNKSPERBUFFER;
+        std::vector<std::uint64_t> buffers[2];
+        std::future<void> pending;
+
+        for (auto begin = UINT64_C(0), b = UINT64_C(0); begin < trials; begin += buffertrials, b++) {
+            auto const n = std::min(buffertrials, trials - begin);
+            auto & buffer = buffers[b & 1U];
+            buffer.resize(static_cast<std::size_t>(n * wordspertrial));
+
+            // 試行の塊毎に乱数エンジンを初期化して生成する
+            tbb::parallel_for(
+                tbb::blocked_range<std::uint64_t>(0U, (n + CHUNK - 1U) / CHUNK, 1U),
+                [&](auto const & range) {
+                auto & mr = mrs.local();
+                flips::packedflips words;
+
+                for (auto c = range.begin(); c != range.end(); ++c) {
+                    mr.seed(flips::chunkseed(seed, (begin / CHUNK) + c));
+
+                    auto const last = std::min(n, (c + 1U) * CHUNK);
+                    for (auto i = c * CHUNK; i < last; i++) {
+                        flips::makepackedflips(mr, horizon, words);
+                        std::copy(words.begin(), words.end(), buffer.begin() + static_cast<std::ptrdiff_t>(i * wordspertrial));
+                    }
+                }
+            });
+
+            // 前のバッファの書き込みが終わるのを待ってから、このバッファの書き込みを始める
+            if (pending.valid()) {
+                pending.get();
+            }
+
+            pending = std::async(std::launch::async, [&ofs, &buffer] {
+                ofs.write(reinterpret_cast<char const *>(buffer.data()), static_cast<std::streamsize>(buffer.size() * sizeof(std::uint64_t)));
+                if (!ofs) {
+                    throw std::runtime_error("ファイルに書き込めませんでした");
+                }
+            });
+        }
+
+        pending.get();
+    }
+
+    // #endregion 非メンバ関数
+}
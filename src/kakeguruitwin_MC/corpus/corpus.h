@@ -0,0 +1,210 @@
+﻿/*! \file corpus.h
+    \brief 生成済みのUとDのランダム列をファイルに保存し、複数の文字列の組で使い回すためのクラスと関数の宣言
+
+    Copyright © 2017 @dc1394 All Rights Reserved.
+    This software is released under the BSD 2-Clause License.
+*/
+
+#ifndef _CORPUS_H_
+#define _CORPUS_H_
+
+#pragma once
+
+#include "../simulator/simulator.h"
+#include <cstdint>                                  // for std::uint32_t, std::uint64_t
+#include <string>                                   // for std::string
+#include <vector>                                   // for std::vector
+#include <boost/interprocess/mapped_region.hpp>     // for boost::interprocess::mapped_region
+
+namespace corpus {
+    //! A class.
+    /*!
+        UとDのランダム列のファイル（コーパス）をメモリマップして読むクラス
+        ファイルは64バイトのヘッダ（識別子、バージョン、乱数エンジンの種類、乱数の種、UかDの文字列の長さ、
+        試行回数、一試行のワード数）に続いて、試行毎にUとDのランダム列を詰めたワードを並べたもの
+        ワードはflips::packedflipsと同じ並び（Uを1、Dを0とし、t番目をt / 64番目のワードのt % 64ビット目）とする
+    */
+    class Corpus final {
+        // #region コンストラクタ・デストラクタ
+
+    public:
+        //! A constructor.
+        /*!
+            唯一のコンストラクタ
+            \param filename ファイル名
+        */
+        explicit Corpus(std::string const & filename);
+
+        //! A destructor.
+        /*!
+            デフォルトデストラクタ
+        */
+        ~Corpus() = default;
+
+        // #endregion コンストラクタ・デストラクタ
+
+        // #region メンバ関数
+
+        //! A public member function.
+        /*!
+            試行のUとDのランダム列を返す
+            \param i 試行の添字
+            \return 試行のUとDのランダム列を詰めたワードの先頭へのポインタ（要素数はwordspertrial()）
+        */
+        std::uint64_t const * trial(std::uint64_t i) const
+        {
+            return data_ + i * wordspertrial_;
+        }
+
+        // #endregion メンバ関数
+
+        // #region プロパティ
+
+        //! A property.
+        /*!
+            UかDの文字列の長さを返す
+        */
+        std::uint32_t horizon() const
+        {
+            return horizon_;
+        }
+
+        //! A property.
+        /*!
+            生成に使った乱数エンジンの種類を返す
+        */
+        std::string const & rng() const
+        {
+            return rng_;
+        }
+
+        //! A property.
+        /*!
+            生成に使った乱数の種を返す
+        */
+        std::uint64_t seed() const
+        {
+            return seed_;
+        }
+
+        //! A property.
+        /*!
+            試行回数を返す
+        */
+        std::uint64_t trials() const
+        {
+            return trials_;
+        }
+
+        //! A property.
+        /*!
+            一試行のワード数を返す
+        */
+        std::uint32_t wordspertrial() const
+        {
+            return wordspertrial_;
+        }
+
+        // #endregion プロパティ
+
+        // #region メンバ変数
+
+    private:
+        //! A private member variable.
+        /*!
+            試行毎のUとDのランダム列の先頭へのポインタ
+        */
+        std::uint64_t const * data_;
+
+        //! A private member variable.
+        /*!
+            UかDの文字列の長さ
+        */
+        std::uint32_t horizon_;
+
+        //! A private member variable.
+        /*!
+            メモリマップされた領域
+        */
+        boost::interprocess::mapped_region region_;
+
+        //! A private member variable.
+        /*!
+            生成に使った乱数エンジンの種類
+        */
+        std::string rng_;
+
+        //! A private member variable.
+        /*!
+            生成に使った乱数の種
+        */
+        std::uint64_t seed_;
+
+        //! A private member variable.
+        /*!
+            試行回数
+        */
+        std::uint64_t trials_;
+
+        //! A private member variable.
+        /*!
+            一試行のワード数
+        */
+        std::uint32_t wordspertrial_;
+
+        // #endregion メンバ変数
+
+        // #region 禁止されたコンストラクタ・メンバ関数
+
+        //! A private constructor (deleted).
+        /*!
+            デフォルトコンストラクタ（禁止）
+        */
+        Corpus() = delete;
+
+        //! A private copy constructor (deleted).
+        /*!
+            コピーコンストラクタ（禁止）
+            \param dummy コピー元のオブジェクト（未使用）
+        */
+        Corpus(Corpus const & dummy) = delete;
+
+        //! A private member function (deleted).
+        /*!
+            operator=()の宣言（禁止）
+            \param dummy コピー元のオブジェクト（未使用）
+            \return コピー元のオブジェクト
+        */
+        Corpus & operator=(Corpus const & dummy) = delete;
+
+        // #endregion 禁止されたコンストラクタ・メンバ関数
+    };
+
+    // #region 非メンバ関数
+
+    //! A function.
+    /*!
+        コーパスの全ての試行について、文字列の組毎に各文字列の期待値と全ての順序付きのペアの勝率を求める
+        全ての組の文字列を一度の走査でまとめて探索するので、組の間の比較には同じ乱数列が使われる
+        \param corpus コーパス
+        \param sets 文字列の組の配列
+        \return 組毎の結果（pairsは全ての順序付きのペア）
+    */
+    std::vector<simulator::Result> evaluate(Corpus const & corpus, std::vector<std::vector<std::string>> const & sets);
+
+    //! A function.
+    /*!
+        UとDのランダム列を生成してコーパスのファイルに書き出す
+        生成とファイルへの書き込みは二つのバッファで交互に行い、書き込みの間に次のバッファを生成する
+        試行の塊毎に乱数の種から乱数エンジンを初期化するので、同じ種からは同じコーパスが作られる
+        \param filename ファイル名
+        \param horizon UかDの文字列の長さ
+        \param trials 試行回数
+        \param seed 乱数の種
+    */
+    void write(std::string const & filename, std::uint32_t horizon, std::uint64_t trials, std::uint64_t seed);
+
+    // #endregion 非メンバ関数
+}
+
+#endif  // _CORPUS_H_
@@ -0,0 +1,36 @@
+﻿/*! \file correlation.cpp
+    \brief 文字列の相関（Conwayの数）から、期待値と勝率を厳密に計算するクラスの実装
+
+    Copyright © 2017 @dc1394 All Rights Reserved.
+    This software is released under the BSD 2-Clause License.
+*/
+
+#include "correlation.h"
+#include "../pattern/pattern.h"
+#include <stdexcept>    // for std::invalid_argument
+
+namespace correlation {
+    // #region コンストラクタ
+
+    Correlation::Correlation(std::uint32_t len, double p)
+        : invp_(1.0 / p),
+          invq_(1.0 / (1.0 - p)),
+          len_(len),
+          p_(p)
+    {
+        if (len == 0U || len > pattern::MAXLENGTH) {
+            throw std::invalid_argument("文字列の長さが不正です");
+        }
+
+        if (!(p > 0.0 && p < 1.0)) {
+            throw std::invalid_argument("Uが出る確率は0より大きく1より小さくなければなりません");
+        }
+
+        self_.resize(npattern());
+        for (auto a = 0U; a < npattern(); a++) {
+            self_[a] = (*this)(a, a);
+        }
+    }
+
+    // #endregion コンストラクタ
+}
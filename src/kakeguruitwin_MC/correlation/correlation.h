@@ -0,0 +1,192 @@
+﻿/*! \file correlation.h
+    \brief 文字列の相関（Conwayの数）から、期待値と勝率を厳密に計算するクラスの宣言
+
+    Copyright © 2017 @dc1394 All Rights Reserved.
+    This software is released under the BSD 2-Clause License.
+*/
+
+#ifndef _CORRELATION_H_
+#define _CORRELATION_H_
+
+#pragma once
+
+#include <cstdint>  // for std::uint32_t
+#include <vector>   // for std::vector
+
+namespace correlation {
+    //! A class.
+    /*!
+        長さlenの文字列の相関から、期待値と勝率を厳密に計算するクラス
+        文字列aとbの相関ABは、aの長さkの接尾辞とbの長さkの接頭辞が一致する全てのkについての、
+        1 / (bの長さkの接頭辞が出現する確率)の和である
+        このとき、aが出現するまでの期待値はAAであり、aがbより先に出現するオッズは(BB - BA) : (AA - AB)である
+    */
+    class Correlation final {
+        // #region コンストラクタ・デストラクタ
+
+    public:
+        //! A constructor.
+        /*!
+            唯一のコンストラクタ
+            \param len 文字列の長さ
+            \param p Uが出る確率
+        */
+        Correlation(std::uint32_t len, double p);
+
+        //! A destructor.
+        /*!
+            デフォルトデストラクタ
+        */
+        ~Correlation() = default;
+
+        // #endregion コンストラクタ・デストラクタ
+
+        // #region メンバ関数
+
+        //! A public member function.
+        /*!
+            文字列aとbの相関ABを計算する
+            \param a 前者の文字列のビット列
+            \param b 後者の文字列のビット列
+            \return 相関AB
+        */
+        double operator()(std::uint32_t a, std::uint32_t b) const
+        {
+            auto sum = 0.0;
+            auto weight = 1.0;
+            for (auto k = 1U; k <= len_; k++) {
+                // bの長さkの接頭辞の最後の文字で重みを更新
+                auto const top = b >> (len_ - k);
+                weight *= (top & 1U) ? invp_ : invq_;
+
+                // aの長さkの接尾辞とbの長さkの接頭辞が一致するか
+                if (!((a ^ top) & ((1U << k) - 1U))) {
+                    sum += weight;
+                }
+            }
+
+            return sum;
+        }
+
+        //! A public member function.
+        /*!
+            文字列aが出現するまでの期待値を返す
+            \param a 文字列のビット列
+            \return 期待値
+        */
+        double waitingtime(std::uint32_t a) const
+        {
+            return self_[a];
+        }
+
+        //! A public member function.
+        /*!
+            文字列aが文字列bより先に出現する確率を計算する
+            \param a 前者の文字列のビット列
+            \param b 後者の文字列のビット列
+            \return 前者が先に出現する確率
+        */
+        double winprobability(std::uint32_t a, std::uint32_t b) const
+        {
+            auto const wina = self_[b] - (*this)(b, a);
+            auto const winb = self_[a] - (*this)(a, b);
+
+            return wina / (wina + winb);
+        }
+
+        // #endregion メンバ関数
+
+        // #region プロパティ
+
+        //! A property.
+        /*!
+            文字列の長さを返す
+        */
+        std::uint32_t len() const
+        {
+            return len_;
+        }
+
+        //! A property.
+        /*!
+            文字列の個数を返す
+        */
+        std::uint32_t npattern() const
+        {
+            return 1U << len_;
+        }
+
+        //! A property.
+        /*!
+            Uが出る確率を返す
+        */
+        double p() const
+        {
+            return p_;
+        }
+
+        // #endregion プロパティ
+
+        // #region メンバ変数
+
+    private:
+        //! A private member variable.
+        /*!
+            Uが出る確率の逆数
+        */
+        double invp_;
+
+        //! A private member variable.
+        /*!
+            Dが出る確率の逆数
+        */
+        double invq_;
+
+        //! A private member variable.
+        /*!
+            文字列の長さ
+        */
+        std::uint32_t len_;
+
+        //! A private member variable.
+        /*!
+            Uが出る確率
+        */
+        double p_;
+
+        //! A private member variable.
+        /*!
+            各文字列の自己相関（期待値）
+        */
+        std::vector<double> self_;
+
+        // #endregion メンバ変数
+
+        // #region 禁止されたコンストラクタ・メンバ関数
+
+        //! A private constructor (deleted).
+        /*!
+            デフォルトコンストラクタ（禁止）
+        */
+        Correlation() = delete;
+
+        //! A private copy constructor (deleted).
+        /*!
+            コピーコンストラクタ（禁止）
+            \param dummy コピー元のオブジェクト（未使用）
+        */
+        Correlation(Correlation const & dummy) = delete;
+
+        //! A private member function (deleted).
+        /*!
+            operator=()の宣言（禁止）
+            \param dummy コピー元のオブジェクト（未使用）
+            \return コピー元のオブジェクト
+        */
+        Correlation & operator=(Correlation const & dummy) = delete;
+
+        // #endregion 禁止されたコンストラクタ・メンバ関数
+    };
+}
+
+#endif  // _CORRELATION_H_
@@ -0,0 +1,86 @@
+﻿/*! \file counterpattern.cpp
+    \brief 後手の最善の対抗文字列を探索する関数の実装
+
+    Copyright © 2017 @dc1394 All Rights Reserved.
+    This software is released under the BSD 2-Clause License.
+*/
+
+#include "counterpattern.h"
+#include <algorithm>                // for std::find
+#include <tbb/blocked_range.h>      // for tbb::blocked_range
+#include <tbb/parallel_for.h>       // for tbb::parallel_for
+
+namespace counterpattern {
+    std::vector<Response> bestresponses(correlation::Correlation const & cor)
+    {
+        auto const npattern = cor.npattern();
+
+        std::vector<Response> responses(npattern);
+
+        tbb::parallel_for(
+            tbb::blocked_range<std::uint32_t>(0U, npattern, 16U),
+            [&cor, &responses, npattern](auto const & range) {
+            for (auto a = range.begin(); a != range.end(); ++a) {
+                // 先手の文字列の自己相関
+                auto const aa = cor.waitingtime(a);
+
+                Response best = { a, 0.0 };
+                for (auto b = 0U; b < npattern; b++) {
+                    if (a == b) {
+                        continue;
+                    }
+
+                    // bがaより先に出現する確率
+                    auto const winb = aa - cor(a, b);
+                    auto const wina = cor.waitingtime(b) - cor(b, a);
+                    auto const prob = winb / (wina + winb);
+
+                    if (prob > best.probability) {
+                        best = { b, prob };
+                    }
+                }
+
+                responses[a] = best;
+            }
+        });
+
+        return responses;
+    }
+
+    std::vector<std::vector<std::uint32_t>> findcycles(std::vector<Response> const & responses)
+    {
+        auto const n = static_cast<std::uint32_t>(responses.size());
+
+        // 各文字列の状態（0: 未訪問、1: 探索中、2: 探索済み）
+        std::vector<std::uint8_t> state(n, 0U);
+
+        std::vector<std::vector<std::uint32_t>> cycles;
+        std::vector<std::uint32_t> path;
+
+        for (auto start = 0U; start < n; start++) {
+            if (state[start]) {
+                continue;
+            }
+
+            // 最善の対抗文字列をたどる
+            path.clear();
+            auto v = start;
+            while (!state[v]) {
+                state[v] = 1U;
+                path.push_back(v);
+                v = responses[v].pattern;
+            }
+
+            // 今回の探索中の文字列に戻ってきた場合は閉路
+            if (state[v] == 1U) {
+                cycles.emplace_back(std::find(path.begin(), path.end(), v), path.end());
+            }
+
+            for (auto const u : path) {
+                state[u] = 2U;
+            }
+        }
+
+        return cycles;
+    }
+}
@@ -0,0 +1,54 @@
+﻿/*! \file counterpattern.h
+    \brief 後手の最善の対抗文字列を探索する関数の宣言
+
+    Copyright © 2017 @dc1394 All Rights Reserved.
+    This software is released under the BSD 2-Clause License.
+*/
+
+#ifndef _COUNTERPATTERN_H_
+#define _COUNTERPATTERN_H_
+
+#pragma once
+
+#include "../correlation/correlation.h"
+#include <cstdint>  // for std::uint32_t
+#include <vector>   // for std::vector
+
+namespace counterpattern {
+    //! A struct.
+    /*!
+        ある文字列に対する最善の対抗文字列とその勝率
+    */
+    struct Response final {
+        //! A public member variable.
+        /*!
+            最善の対抗文字列のビット列
+        */
+        std::uint32_t pattern;
+
+        //! A public member variable.
+        /*!
+            最善の対抗文字列が先に出現する確率
+        */
+        double probability;
+    };
+
+    //! A function.
+    /*!
+        全ての文字列について、最善の対抗文字列を全てのペアの探索でTBBで並列化して求める
+        勝率が等しい対抗文字列が複数ある場合は、ビット列が最小のものを選ぶ
+        \param cor 相関を計算するオブジェクト
+        \return 各文字列（添字はビット列）に対する最善の対抗文字列とその勝率
+    */
+    std::vector<Response> bestresponses(correlation::Correlation const & cor);
+
+    //! A function.
+    /*!
+        「文字列 → その最善の対抗文字列」のグラフの閉路（非推移的な循環）を全て求める
+        \param responses 各文字列に対する最善の対抗文字列
+        \return 閉路を構成する文字列のビット列の配列の配列
+    */
+    std::vector<std::vector<std::uint32_t>> findcycles(std::vector<Response> const & responses);
+}
+
+#endif  // _COUNTERPATTERN_H_
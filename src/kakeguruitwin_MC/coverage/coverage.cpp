@@ -0,0 +1,60 @@
+﻿/*! \file coverage.cpp
+    \brief 長さKの全ての文字列が少なくとも一度出現するまでの回数（被覆時間）を求める関数の実装
+
+    Copyright © 2017 @dc1394 All Rights Reserved.
+    This software is released under the BSD 2-Clause License.
+*/
+
+#include "coverage.h"
+#ifdef HAVE_SSE2
+    #include "../myrandom/myrandsfmt.h"
+#else
+    #include "../myrandom/myrand.h"
+#endif
+#include <stdexcept>                            // for std::invalid_argument
+#include <tbb/blocked_range.h>                  // for tbb::blocked_range
+#include <tbb/enumerable_thread_specific.h>     // for tbb::enumerable_thread_specific
+#include <tbb/parallel_for.h>                   // for tbb::parallel_for
+
+namespace coverage {
+    histogram::LogHistogram montecarlo(std::uint32_t len, std::uint64_t trials)
+    {
+        if (len == 0U || len > MAXLENGTH) {
+            throw std::invalid_argument("文字列の長さは1以上20以下でなければなりません");
+        }
+
+#ifdef HAVE_SSE2
+        using myrand = myrandom::MyRandSfmt;
+#else
+        using myrand = myrandom::MyRand;
+#endif
+        // スレッド毎の自作乱数クラスのオブジェクト
+        tbb::enumerable_thread_specific<myrand> mrs(1, 6);
+
+        // スレッド毎のビットマップ（試行毎に使い回す）
+        tbb::enumerable_thread_specific<std::vector<std::uint64_t>> seens(((1U << len) + 63U) / 64U);
+
+        // スレッド毎のヒストグラム
+        tbb::enumerable_thread_specific<histogram::LogHistogram> hists;
+
+        tbb::parallel_for(
+            tbb::blocked_range<std::uint64_t>(0U, trials, 1U),
+            [&](auto const & range) {
+            auto & mr = mrs.local();
+            auto & seen = seens.local();
+            auto & hist = hists.local();
+
+            for (auto i = range.begin(); i != range.end(); ++i) {
+                hist.record(coveragetime(mr, len, seen));
+            }
+        });
+
+        // スレッド毎のヒストグラムを足し合わせる
+        histogram::LogHistogram result;
+        for (auto const & hist : hists) {
+            result.merge(hist);
+        }
+
+        return result;
+    }
+}
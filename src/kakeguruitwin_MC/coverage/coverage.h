@@ -0,0 +1,82 @@
+﻿/*! \file coverage.h
+    \brief 長さKの全ての文字列が少なくとも一度出現するまでの回数（被覆時間）を求める関数の宣言
+
+    Copyright © 2017 @dc1394 All Rights Reserved.
+    This software is released under the BSD 2-Clause License.
+*/
+
+#ifndef _COVERAGE_H_
+#define _COVERAGE_H_
+
+#pragma once
+
+#include "../flips/packedflips.h"
+#include "../histogram/histogram.h"
+#include <algorithm>    // for std::fill
+#include <cstdint>      // for std::uint32_t, std::uint64_t
+#include <vector>       // for std::vector
+
+namespace coverage {
+    //! A global variable (constant expression).
+    /*!
+        扱うことのできる文字列の長さの最大値
+    */
+    static auto constexpr MAXLENGTH = 20U;
+
+    template <typename T>
+    //! A template function.
+    /*!
+        長さlenの全ての文字列が少なくとも一度出現するまで、UとDのランダム列を64個ずつ生成しながら走査する
+        既に出現した文字列の集合は2^lenビットのビットマップで持つ（len = 20で128kB）
+        \param mr 自作乱数クラスのオブジェクト
+        \param len 文字列の長さ
+        \param seen 既に出現した文字列の集合を格納するビットマップ（要素数は2^len / 64以上）
+        \return 全ての文字列が出現したときのUかDの個数
+    */
+    std::uint64_t coveragetime(T & mr, std::uint32_t len, std::vector<std::uint64_t> & seen)
+    {
+        auto const npattern = 1U << len;
+        auto const mask = npattern - 1U;
+
+        std::fill(seen.begin(), seen.end(), UINT64_C(0));
+
+        // 直近len個のUとDを表すビット列
+        auto window = 0U;
+
+        // 既に出現した文字列の個数（ビットマップのpopcountに等しい）
+        auto covered = 0U;
+
+        auto t = UINT64_C(0);
+        for (;;) {
+            auto bits = flips::makerandomword(mr);
+            for (auto b = 0U; b < flips::WORDBITS; b++) {
+                window = ((window << 1) | static_cast<std::uint32_t>(bits & 1U)) & mask;
+                bits >>= 1;
+
+                if (++t < len) {
+                    continue;
+                }
+
+                auto & w = seen[window >> 6];
+                auto const bit = UINT64_C(1) << (window & 63U);
+                if (!(w & bit)) {
+                    w |= bit;
+                    if (++covered == npattern) {
+                        return t;
+                    }
+                }
+            }
+        }
+    }
+
+    //! A function.
+    /*!
+        被覆時間のモンテカルロ・シミュレーションを、TBBで並列化して行う
+        \param len 文字列の長さ
+        \param trials 試行回数
+        \return 被覆時間のヒストグラム
+    */
+    histogram::LogHistogram montecarlo(std::uint32_t len, std::uint64_t trials);
+}
+
+#endif  // _COVERAGE_H_
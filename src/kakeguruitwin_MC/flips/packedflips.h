@@ -0,0 +1,252 @@
+﻿/*! \file packedflips.h
+    \brief UとDのランダム列を64ビットのワードに詰めて扱うための関数の宣言と実装
+
+    Copyright © 2017 @dc1394 All Rights Reserved.
+    This software is released under the BSD 2-Clause License.
+*/
+
+#ifndef _PACKEDFLIPS_H_
+#define _PACKEDFLIPS_H_
+
+#pragma once
+
+#include <algorithm>    // for std::fill
+#include <cstddef>      // for std::size_t
+#include <cstdint>      // for std::uint32_t, std::uint64_t
+#include <vector>       // for std::vector
+
+#ifdef _MSC_VER
+    #include <intrin.h> // for __popcnt64, _BitScanForward64
+#endif
+
+namespace flips {
+    //! A global variable (constant expression).
+    /*!
+        一つのワードに詰めるUかDの個数
+    */
+    static auto constexpr WORDBITS = 64U;
+
+    //! A typedef.
+    /*!
+        UとDのランダム列を詰めたワードの可変長配列
+        t番目（0始まり）のUかDは、t / 64番目のワードのt % 64ビット目に格納し、Uを1、Dを0とする
+    */
+    using packedflips = std::vector<std::uint64_t>;
+
+    //! A function.
+    /*!
+        UかDの個数から、それを格納するのに必要なワード数を求める
+        \param nflips UかDの個数
+        \return 必要なワード数
+    */
+    inline std::uint32_t wordsize(std::uint32_t nflips)
+    {
+        return (nflips + WORDBITS - 1U) / WORDBITS;
+    }
+
+    //! A function.
+    /*!
+        ワードの立っているビットの数を数える
+        \param x ワード
+        \return 立っているビットの数
+    */
+    inline std::uint32_t popcount(std::uint64_t x)
+    {
+#ifdef _MSC_VER
+        return static_cast<std::uint32_t>(__popcnt64(x));
+#else
+        return static_cast<std::uint32_t>(__builtin_popcountll(x));
+#endif
+    }
+
+    //! A function.
+    /*!
+        ワードの最下位の立っているビットの位置を求める
+        \param x ワード（0であってはならない）
+        \return 最下位の立っているビットの位置
+    */
+    inline std::uint32_t countrzero(std::uint64_t x)
+    {
+#ifdef _MSC_VER
+        unsigned long index;
+        _BitScanForward64(&index, x);
+        return static_cast<std::uint32_t>(index);
+#else
+        return static_cast<std::uint32_t>(__builtin_ctzll(x));
+#endif
+    }
+
+    template <typename T>
+    //! A template function.
+    /*!
+        一つのワード分のUとDのランダム列を生成する
+        \param mr 自作乱数クラスのオブジェクト
+        \return UとDのランダム列を詰めたワード
+    */
+    inline std::uint64_t makerandomword(T & mr)
+    {
+        auto const lo = static_cast<std::uint64_t>(mr.myrand32());
+        auto const hi = static_cast<std::uint64_t>(mr.myrand32());
+
+        return (hi << 32) | lo;
+    }
+
+    template <typename T>
+    //! A template function.
+    /*!
+        UとDのランダム列を、64ビットのワードに詰めて生成する
+        \param mr 自作乱数クラスのオブジェクト
+        \param nflips UかDの個数
+        \param words UとDのランダム列を格納するワードの可変長配列
+    */
+    void makepackedflips(T & mr, std::uint32_t nflips, packedflips & words)
+    {
+        words.resize(wordsize(nflips));
+
+        for (auto && w : words) {
+            w = makerandomword(mr);
+        }
+    }
+
+    //! A function.
+    /*!
+        t番目のUかDを取り出す
+        \param words UとDのランダム列を詰めたワードの可変長配列
+        \param t 取り出す位置（0始まり）
+        \return Uなら1、Dなら0
+    */
+    inline std::uint32_t getflip(packedflips const & words, std::uint32_t t)
+    {
+        return static_cast<std::uint32_t>(words[t / WORDBITS] >> (t % WORDBITS)) & 1U;
+    }
+
+    //! A function.
+    /*!
+        長いUとDの列の途中から、指定された個数のUかDを先頭に詰めて取り出す
+        \param stream 長いUとDの列を詰めたワードの可変長配列
+        \param begin 取り出す最初の位置（0始まり）
+        \param nflips 取り出すUかDの個数（begin + nflipsはstreamの長さ以下でなければならない）
+        \param words 取り出したUとDの列を格納するワードの可変長配列
+    */
+    inline void extractflips(packedflips const & stream, std::uint64_t begin, std::uint32_t nflips, packedflips & words)
+    {
+        words.resize(wordsize(nflips));
+
+        auto const index = static_cast<std::size_t>(begin / WORDBITS);
+        auto const shift = static_cast<std::uint32_t>(begin % WORDBITS);
+
+        for (auto i = std::size_t(0); i < words.size(); i++) {
+            auto w = stream[index + i] >> shift;
+            if (shift && index + i + 1U < stream.size()) {
+                w |= stream[index + i + 1U] << (WORDBITS - shift);
+            }
+
+            words[i] = w;
+        }
+    }
+
+    template <typename U>
+    //! A template function.
+    /*!
+        長さlenの全ての文字列について、最初に出現した位置（文字列の末尾の位置）を一度の走査で求める
+        見つからなかった文字列の位置はnflipsとする（myfindと同じ規約）
+        \param words UとDのランダム列を詰めたワードの可変長配列
+        \param nflips UかDの個数
+        \param len 文字列の長さ
+        \param first 各文字列の最初の出現位置を格納する配列（要素数は2^len、添字は文字列のビット列）
+        \return 見つかった文字列の個数
+    */
+    std::uint32_t firstoccurrence(packedflips const & words, std::uint32_t nflips, std::uint32_t len, U * first)
+    {
+        auto const npattern = 1U << len;
+        auto const mask = npattern - 1U;
+        auto const notfound = static_cast<U>(nflips);
+
+        std::fill(first, first + npattern, notfound);
+
+        // 直近len個のUとDを表すビット列
+        auto window = 0U;
+
+        // まだ見つかっていない文字列の個数
+        auto remain = npattern;
+
+        auto t = 0U;
+        for (auto const w : words) {
+            auto bits = w;
+            for (auto b = 0U; b < WORDBITS && t < nflips; b++, t++) {
+                window = ((window << 1) | static_cast<std::uint32_t>(bits & 1U)) & mask;
+                bits >>= 1;
+
+                if (t + 1U >= len && first[window] == notfound) {
+                    first[window] = static_cast<U>(t + 1U);
+                    if (--remain == 0U) {
+                        return npattern;
+                    }
+                }
+            }
+        }
+
+        return npattern - remain;
+    }
+
+    //! A function.
+    /*!
+        長さ1からmaxlenまでの全ての文字列を一つの配列に並べたときの、長さlenの文字列の先頭の添字を求める
+        長さlenでビット列がcodeの文字列の添字は、offset(len) + codeとなる
+        \param len 文字列の長さ
+        \return 長さlenの文字列の先頭の添字
+    */
+    inline std::uint32_t offset(std::uint32_t len)
+    {
+        return (1U << len) - 2U;
+    }
+
+    template <typename U>
+    //! A template function.
+    /*!
+        長さ1からmaxlenまでの全ての文字列について、最初に出現した位置を一度の走査で求める
+        直近maxlen個のUとDのビット列の下位lenビットが、その位置で終わる長さlenの文字列となる
+        \param words UとDのランダム列を詰めたワードの可変長配列
+        \param nflips UかDの個数
+        \param maxlen 文字列の長さの最大値
+        \param first 各文字列の最初の出現位置を格納する配列（要素数はoffset(maxlen + 1)、添字はoffset(len) + ビット列）
+        \return 見つかった文字列の個数
+    */
+    std::uint32_t firstoccurrenceupto(packedflips const & words, std::uint32_t nflips, std::uint32_t maxlen, U * first)
+    {
+        auto const total = offset(maxlen + 1U);
+        auto const notfound = static_cast<U>(nflips);
+
+        std::fill(first, first + total, notfound);
+
+        // 直近maxlen個のUとDを表すビット列
+        auto window = 0U;
+
+        // まだ見つかっていない文字列の個数
+        auto remain = total;
+
+        auto t = 0U;
+        for (auto const w : words) {
+            auto bits = w;
+            for (auto b = 0U; b < WORDBITS && t < nflips; b++, t++) {
+                window = ((window << 1) | static_cast<std::uint32_t>(bits & 1U)) & ((1U << maxlen) - 1U);
+                bits >>= 1;
+
+                auto const lmax = t + 1U < maxlen ? t + 1U : maxlen;
+                for (auto len = 1U; len <= lmax; len++) {
+                    auto & f = first[offset(len) + (window & ((1U << len) - 1U))];
+                    if (f == notfound) {
+                        f = static_cast<U>(t + 1U);
+                        if (--remain == 0U) {
+                            return total;
+                        }
+                    }
+                }
+            }
+        }
+
+        return total - remain;
+    }
+}
+
+#endif  // _PACKEDFLIPS_H_
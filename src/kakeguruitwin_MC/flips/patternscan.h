@@ -0,0 +1,362 @@
+﻿/*! \file patternscan.h
+    \brief 試行の塊毎の乱数の種、Uが出る確率に応じたUとDの生成、与えられた文字列の走査を
+           全てのモードで共通にするための関数とクラスの宣言と実装
+
+    Copyright © 2017 @dc1394 All Rights Reserved.
+    This software is released under the BSD 2-Clause License.
+*/
+
+#ifndef _PATTERNSCAN_H_
+#define _PATTERNSCAN_H_
+
+#pragma once
+
+#include "packedflips.h"
+#include "../pattern/pattern.h"
+#include <algorithm>    // for std::fill, std::max, std::min
+#include <cstdint>      // for std::uint32_t, std::uint64_t
+#include <iomanip>      // for std::setprecision
+#include <sstream>      // for std::ostringstream
+#include <string>       // for std::stod, std::string
+#include <utility>      // for std::forward
+#include <vector>       // for std::vector
+
+namespace flips {
+    //! A struct.
+    /*!
+        探索する文字列
+    */
+    struct Target final {
+        //! A public member variable.
+        /*!
+            文字列のビット列
+        */
+        std::uint32_t code;
+
+        //! A public member variable.
+        /*!
+            文字列の長さ
+        */
+        std::uint32_t len;
+
+        //! A public member variable.
+        /*!
+            直近のUとDのビット列から文字列の長さ分を取り出すマスク
+        */
+        std::uint32_t mask;
+    };
+
+    //! A function.
+    /*!
+        乱数の種と試行の塊の添字（または塊の先頭の試行の添字）から、その塊の乱数の種を作る（SplitMix64）
+        \param seed 乱数の種
+        \param chunk 試行の塊の添字
+        \return 試行の塊の乱数の種
+    */
+    inline std::uint64_t chunkseed(std::uint64_t seed, std::uint64_t chunk)
+    {
+        auto z = seed + chunk * UINT64_C(0x9E3779B97F4A7C15);
+        z = (z ^ (z >> 30)) * UINT64_C(0xBF58476D1CE4E5B9);
+        z = (z ^ (z >> 27)) * UINT64_C(0x94D049BB133111EB);
+
+        return z ^ (z >> 31);
+    }
+
+    //! A function.
+    /*!
+        Uが出る確率から、Uとする32ビットの一様乱数の上限を求める
+        0はUが出る確率が1/2の印なので、それ以外の確率は1以上2^32 - 1以下に丸める
+        （2^-32より小さい確率が1/2として扱われたり、1に近い確率で桁あふれしたりしないようにする）
+        \param bias Uが出る確率（0より大きく1より小さいこと）
+        \return Uとする32ビットの一様乱数の上限（Uが出る確率が1/2の場合は0）
+    */
+    inline std::uint32_t biasthreshold(double bias)
+    {
+        if (bias == 0.5) {
+            return 0U;
+        }
+
+        return static_cast<std::uint32_t>(std::min(std::max(bias * 4294967296.0, 1.0), 4294967295.0));
+    }
+
+    //! A function.
+    /*!
+        Uが出る確率を、読み込み直して同じ値になる最も短い表記の文字列にする（0.6が0.59999999999999998とならないように）
+        \param bias Uが出る確率
+        \return Uが出る確率の文字列
+    */
+    inline std::string biasstring(double bias)
+    {
+        std::ostringstream oss;
+        oss << std::setprecision(15) << bias;
+        if (std::stod(oss.str()) != bias) {
+            oss.str("");
+            oss << std::setprecision(17) << bias;
+        }
+
+        return oss.str();
+    }
+
+    template <typename T>
+    //! A template function.
+    /*!
+        一つのワード分のUとDのランダム列を、Uが出る確率に応じて生成する
+        \param mr 自作乱数クラスのオブジェクト
+        \param threshold Uとする32ビットの一様乱数の上限（0の場合はUが出る確率を1/2とする）
+        \return UとDのランダム列を詰めたワード
+    */
+    std::uint64_t makeword(T & mr, std::uint32_t threshold)
+    {
+        if (!threshold) {
+            return makerandomword(mr);
+        }
+
+        auto w = UINT64_C(0);
+        for (auto b = 0U; b < WORDBITS; b++) {
+            w |= static_cast<std::uint64_t>(mr.myrand32() < threshold) << b;
+        }
+
+        return w;
+    }
+
+    //! A function.
+    /*!
+        文字列から探索する文字列を作る
+        \param str 文字列
+        \return 探索する文字列
+    */
+    inline Target maketarget(std::string const & str)
+    {
+        auto const len = static_cast<std::uint32_t>(str.size());
+
+        return { pattern::tocode(str), len, (len < 32U ? (1U << len) : 0U) - 1U };
+    }
+
+    //! A function.
+    /*!
+        直近のUとDが探索する文字列で終わっているかどうかを返す
+        \param target 探索する文字列
+        \param window 直近のUとDのビット列
+        \param t これまでのUかDの個数
+        \return 文字列で終わっていればtrue
+    */
+    inline bool matches(Target const & target, std::uint32_t window, std::uint32_t t)
+    {
+        return t >= target.len && (window & target.mask) == target.code;
+    }
+
+    template <typename F, typename S>
+    //! A template function.
+    /*!
+        一試行のUとDのランダム列から、与えられた文字列の最初の出現位置を求める
+        全ての文字列が見つかった時点で打ち切り、それ以降のワードは求めない
+        \param nextword 次のワードを返す関数オブジェクト（乱数から生成しても、記録された列から読んでもよい）
+        \param stop 次のワードを求める前に呼ばれ、trueを返すとその試行を途中で止める関数オブジェクト
+        \param horizon UかDの文字列の長さ
+        \param targets 探索する文字列
+        \param first 各文字列の最初の出現位置（1始まり、見つからなかった場合は0）を格納するvector
+        \return 試行を最後まで行った場合はtrue、途中で止めた場合はfalse（firstは不完全）
+    */
+    bool firstoccurrence(
+        F && nextword,
+        S && stop,
+        std::uint32_t horizon,
+        std::vector<Target> const & targets,
+        std::vector<std::uint32_t> & first)
+    {
+        std::fill(first.begin(), first.end(), 0U);
+
+        // 直近のUとDを表すビット列
+        auto window = 0U;
+
+        // まだ見つかっていない文字列の個数
+        auto remain = static_cast<std::uint32_t>(targets.size());
+
+        for (auto t = 0U; t < horizon;) {
+            if (stop()) {
+                return false;
+            }
+
+            auto bits = nextword();
+            for (auto b = 0U; b < WORDBITS && t < horizon; b++) {
+                window = (window << 1) | static_cast<std::uint32_t>(bits & 1U);
+                bits >>= 1;
+                t++;
+
+                for (auto p = 0U; p < targets.size(); p++) {
+                    if (!first[p] && matches(targets[p], window, t)) {
+                        first[p] = t;
+                        if (--remain == 0U) {
+                            return true;
+                        }
+                    }
+                }
+            }
+        }
+
+        return true;
+    }
+
+    template <typename F>
+    //! A template function.
+    /*!
+        一試行のUとDのランダム列から、与えられた文字列の最初の出現位置を求める（途中で止めない）
+        \param nextword 次のワードを返す関数オブジェクト
+        \param horizon UかDの文字列の長さ
+        \param targets 探索する文字列
+        \param first 各文字列の最初の出現位置（1始まり、見つからなかった場合は0）を格納するvector
+    */
+    void firstoccurrence(
+        F && nextword,
+        std::uint32_t horizon,
+        std::vector<Target> const & targets,
+        std::vector<std::uint32_t> & first)
+    {
+        firstoccurrence(std::forward<F>(nextword), [] { return false; }, horizon, targets, first);
+    }
+
+    //! A function.
+    /*!
+        最初の出現位置から、ペアの前者と後者の勝利回数を数える
+        見つからなかった場合（0）は最も遅いものとして扱い、同時の場合はどちらの勝ちにもしない
+        \param firsta 前者の最初の出現位置（1始まり、見つからなかった場合は0）
+        \param firstb 後者の最初の出現位置（1始まり、見つからなかった場合は0）
+        \param wins 前者と後者の勝利回数（2要素）
+    */
+    inline void countwins(std::uint32_t firsta, std::uint32_t firstb, std::uint64_t * wins)
+    {
+        auto const fa = firsta - 1U;
+        auto const fb = firstb - 1U;
+        wins[0] += fa < fb;
+        wins[1] += fb < fa;
+    }
+
+    template <typename T>
+    //! A template class.
+    /*!
+        ワード単位で生成したUとDを一つずつ取り出すための乱数列
+        一つの競争や試行で使い残したUとDは次の競争や試行で使う
+    */
+    class FlipSource final {
+        // #region コンストラクタ・デストラクタ
+
+    public:
+        //! A constructor.
+        /*!
+            唯一のコンストラクタ
+            \param mr 自作乱数クラスのオブジェクト
+            \param threshold Uとする32ビットの一様乱数の上限（0の場合はUが出る確率を1/2とする）
+        */
+        FlipSource(T & mr, std::uint32_t threshold)
+            : bits_(0U), draws_(0U), left_(0U), mr_(mr), threshold_(threshold)
+        {
+        }
+
+        //! A destructor.
+        /*!
+            デフォルトデストラクタ
+        */
+        ~FlipSource() = default;
+
+        // #endregion コンストラクタ・デストラクタ
+
+        // #region メンバ関数
+
+        //! A public member function.
+        /*!
+            UかDを一つ取り出す
+            \return Uなら1、Dなら0
+        */
+        std::uint32_t next()
+        {
+            if (!left_) {
+                bits_ = makeword(mr_, threshold_);
+                draws_ += threshold_ ? WORDBITS : 2U;
+                left_ = WORDBITS;
+            }
+
+            auto const flip = static_cast<std::uint32_t>(bits_ & 1U);
+            bits_ >>= 1;
+            left_--;
+
+            return flip;
+        }
+
+        // #endregion メンバ関数
+
+        // #region プロパティ
+
+        //! A property.
+        /*!
+            生成した32ビットの乱数の個数を返す
+        */
+        std::uint64_t draws() const
+        {
+            return draws_;
+        }
+
+        // #endregion プロパティ
+
+    private:
+        // #region メンバ変数
+
+        //! A private member variable.
+        /*!
+            まだ取り出していないUとDのビット列
+        */
+        std::uint64_t bits_;
+
+        //! A private member variable.
+        /*!
+            生成した32ビットの乱数の個数
+        */
+        std::uint64_t draws_;
+
+        //! A private member variable.
+        /*!
+            まだ取り出していないUかDの個数
+        */
+        std::uint32_t left_;
+
+        //! A private member variable.
+        /*!
+            自作乱数クラスのオブジェクト
+        */
+        T & mr_;
+
+        //! A private member variable.
+        /*!
+            Uとする32ビットの一様乱数の上限
+        */
+        std::uint32_t const threshold_;
+
+        // #endregion メンバ変数
+
+        // #region 禁止されたコンストラクタ・メンバ関数
+
+        //! A private constructor (deleted).
+        /*!
+            デフォルトコンストラクタ（禁止）
+        */
+        FlipSource() = delete;
+
+        //! A private copy constructor (deleted).
+        /*!
+            コピーコンストラクタ（禁止）
+            \param dummy コピー元のオブジェクト（未使用）
+        */
+        FlipSource(FlipSource const & dummy) = delete;
+
+        //! A private member function (deleted).
+        /*!
+            operator=()の宣言（禁止）
+            \param dummy コピー元のオブジェクト（未使用）
+            \return コピー元のオブジェクト
+        */
+        FlipSource & operator=(FlipSource const & dummy) = delete;
+
+        // #endregion 禁止されたコンストラクタ・メンバ関数
+    };
+}
+
+#endif  // _PATTERNSCAN_H_
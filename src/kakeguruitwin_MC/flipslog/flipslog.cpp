@@ -0,0 +1,470 @@
+﻿/*! \file flipslog.cpp
+    \brief 記録されたUとDの列（またはサイコロの目の列）のファイルを読み込むクラスの実装
+
+    Copyright © 2017 @dc1394 All Rights Reserved.
+    This software is released under the BSD 2-Clause License.
+*/
+
+#include "flipslog.h"
+#include <algorithm>                                // for std::min
+#include <cstddef>                                  // for std::size_t
+#include <fstream>                                  // for std::ifstream
+#include <stdexcept>                                // for std::invalid_argument, std::runtime_error
+#include <utility>                                  // for std::make_pair, std::pair
+#include <vector>                                   // for std::vector
+#include <boost/interprocess/file_mapping.hpp>      // for boost::interprocess::file_mapping
+#include <boost/interprocess/mapped_region.hpp>     // for boost::interprocess::mapped_region
+#include <tbb/blocked_range.h>                      // for tbb::blocked_range
+#include <tbb/parallel_for.h>                       // for tbb::parallel_for
+
+#if defined(__AVX2__) || defined(__BMI2__)
+    #include <immintrin.h>                          // for _mm256_*, _pext_u32
+#elif defined(__SSE2__) || defined(_M_X64)
+    #include <emmintrin.h>                          // for _mm_*
+#endif
+
+namespace flipslog {
+    namespace {
+        //! A global variable (constant expression).
+        /*!
+            並列に読み込むブロックの大きさ（バイト）
+        */
+        static auto constexpr BLOCKSIZE = std::size_t(1) << 20;
+
+        //! A function.
+        /*!
+            一文字がUかDとして読み込む文字かどうかを判定する
+            \param c 文字
+            \param dice サイコロの目の列ならtrue、UとDの列ならfalse
+            \return UかDとして読み込む文字ならtrue
+        */
+        inline bool isflip(char c, bool dice)
+        {
+            return dice ? c >= '1' && c <= '6' : c == 'U' || c == 'D';
+        }
+
+        //! A function.
+        /*!
+            一文字がUとして読み込む文字かどうかを判定する
+            \param c 文字
+            \param dice サイコロの目の列ならtrue、UとDの列ならfalse
+            \return Uとして読み込む文字ならtrue
+        */
+        inline bool isup(char c, bool dice)
+        {
+            return dice ? c >= '4' && c <= '6' : c == 'U';
+        }
+
+#if defined(__AVX2__)
+        //! A global variable (constant expression).
+        /*!
+            SIMDレジスタ一つで判定する文字の数
+        */
+        static auto constexpr LANES = 32U;
+
+        //! A function.
+        /*!
+            LANES文字をまとめて判定する
+            \param p 文字列の先頭へのポインタ
+            \param dice サイコロの目の列ならtrue、UとDの列ならfalse
+            \param valid UかDとして読み込む文字の位置のビットマスク
+            \param up Uとして読み込む文字の位置のビットマスク
+        */
+        inline void classify(char const * p, bool dice, std::uint32_t & valid, std::uint32_t & up)
+        {
+            auto const x = _mm256_loadu_si256(reinterpret_cast<__m256i const *>(p));
+            __m256i upv, downv;
+            if (dice) {
+                upv = _mm256_and_si256(_mm256_cmpgt_epi8(x, _mm256_set1_epi8('3')), _mm256_cmpgt_epi8(_mm256_set1_epi8('7'), x));
+                downv = _mm256_and_si256(_mm256_cmpgt_epi8(x, _mm256_set1_epi8('0')), _mm256_cmpgt_epi8(_mm256_set1_epi8('4'), x));
+            }
+            else {
+                upv = _mm256_cmpeq_epi8(x, _mm256_set1_epi8('U'));
+                downv = _mm256_cmpeq_epi8(x, _mm256_set1_epi8('D'));
+            }
+
+            up = static_cast<std::uint32_t>(_mm256_movemask_epi8(upv));
+            valid = static_cast<std::uint32_t>(_mm256_movemask_epi8(_mm256_or_si256(upv, downv)));
+        }
+#elif defined(__SSE2__) || defined(_M_X64)
+        static auto constexpr LANES = 16U;
+
+        inline void classify(char const * p, bool dice, std::uint32_t & valid, std::uint32_t & up)
+        {
+            auto const x = _mm_loadu_si128(reinterpret_cast<__m128i const *>(p));
+            __m128i upv, downv;
+            if (dice) {
+                upv = _mm_and_si128(_mm_cmpgt_epi8(x, _mm_set1_epi8('3')), _mm_cmplt_epi8(x, _mm_set1_epi8('7')));
+                downv = _mm_and_si128(_mm_cmpgt_epi8(x, _mm_set1_epi8('0')), _mm_cmplt_epi8(x, _mm_set1_epi8('4')));
+            }
+            else {
+                upv = _mm_cmpeq_epi8(x, _mm_set1_epi8('U'));
+                downv = _mm_cmpeq_epi8(x, _mm_set1_epi8('D'));
+            }
+
+            up = static_cast<std::uint32_t>(_mm_movemask_epi8(upv));
+            valid = static_cast<std::uint32_t>(_mm_movemask_epi8(_mm_or_si128(upv, downv)));
+        }
+#else
+        static auto constexpr LANES = 1U;
+
+        inline void classify(char const * p, bool dice, std::uint32_t & valid, std::uint32_t & up)
+        {
+            valid = isflip(*p, dice) ? 1U : 0U;
+            up = isup(*p, dice) ? 1U : 0U;
+        }
+#endif
+
+        //! A global variable (constant expression).
+        /*!
+            LANES文字が全てUかDとして読み込む文字の場合のビットマスク
+        */
+        static auto constexpr ALLVALID = static_cast<std::uint32_t>((UINT64_C(1) << LANES) - 1U);
+
+        //! A function.
+        /*!
+            Uの位置のビットマスクから、UかDとして読み込む文字の位置のビットだけを下位に詰める
+            \param up Uとして読み込む文字の位置のビットマスク
+            \param valid UかDとして読み込む文字の位置のビットマスク
+            \return 詰めたビット列（ビット数はvalidの立っているビットの数）
+        */
+        inline std::uint32_t compress(std::uint32_t up, std::uint32_t valid)
+        {
+#ifdef __BMI2__
+            return _pext_u32(up, valid);
+#else
+            auto bits = 0U;
+            for (auto k = 0U; valid; k++, valid &= valid - 1U) {
+                bits |= ((up >> flips::countrzero(valid)) & 1U) << k;
+            }
+
+            return bits;
+#endif
+        }
+
+        //! A function.
+        /*!
+            ブロックに含まれるUかDとして読み込む文字の数を数える
+            \param p ブロックの先頭へのポインタ
+            \param n ブロックの大きさ（バイト）
+            \param dice サイコロの目の列ならtrue、UとDの列ならfalse
+            \return UかDとして読み込む文字の数
+        */
+        std::uint64_t countblock(char const * p, std::size_t n, bool dice)
+        {
+            auto count = UINT64_C(0);
+
+            auto i = std::size_t(0);
+            for (; i + LANES <= n; i += LANES) {
+                std::uint32_t valid, up;
+                classify(p + i, dice, valid, up);
+                count += flips::popcount(valid);
+            }
+
+            for (; i < n; i++) {
+                count += isflip(p[i], dice) ? 1U : 0U;
+            }
+
+            return count;
+        }
+
+        //! A class.
+        /*!
+            ブロックから読み込んだUとDを、ファイル全体のワードの配列の決められた位置から書き込むクラス
+            ワードの配列の先頭と末尾のワードは隣のブロックと共有するので、別に保持して後でまとめる
+        */
+        class BitWriter final {
+        public:
+            //! A constructor.
+            /*!
+                唯一のコンストラクタ
+                \param words ファイル全体のワードの配列
+                \param offset ブロックの最初のUかDの、ファイル全体での位置
+                \param count ブロックに含まれるUかDの数（1以上）
+                \param edges 先頭と末尾のワードを格納する組
+            */
+            BitWriter(flips::packedflips & words, std::uint64_t offset, std::uint64_t count, std::pair<std::uint64_t, std::uint64_t> & edges)
+                : cur_(0U),
+                  edges_(edges),
+                  fill_(static_cast<std::uint32_t>(offset % flips::WORDBITS)),
+                  first_(offset / flips::WORDBITS),
+                  index_(offset / flips::WORDBITS),
+                  last_((offset + count - 1U) / flips::WORDBITS),
+                  words_(words)
+            {
+            }
+
+            //! A destructor.
+            /*!
+                デフォルトデストラクタ
+            */
+            ~BitWriter() = default;
+
+            //! A public member function.
+            /*!
+                最後のワードを書き込む
+            */
+            void finish()
+            {
+                if (fill_) {
+                    emit(cur_);
+                }
+            }
+
+            //! A public member function.
+            /*!
+                UとDの列を書き込む
+                \param bits UとDの列（Uを1、Dを0とする）
+                \param k UかDの個数（32以下）
+            */
+            void put(std::uint32_t bits, std::uint32_t k)
+            {
+                cur_ |= static_cast<std::uint64_t>(bits) << fill_;
+                fill_ += k;
+
+                if (fill_ >= flips::WORDBITS) {
+                    emit(cur_);
+                    fill_ -= flips::WORDBITS;
+                    cur_ = fill_ ? static_cast<std::uint64_t>(bits) >> (k - fill_) : 0U;
+                }
+            }
+
+        private:
+            //! A private member function.
+            /*!
+                一つのワードを書き込み、次のワードに進む
+                \param w ワード
+            */
+            void emit(std::uint64_t w)
+            {
+                if (index_ == first_) {
+                    edges_.first = w;
+                }
+                else if (index_ == last_) {
+                    edges_.second = w;
+                }
+                else {
+                    words_[index_] = w;
+                }
+
+                index_++;
+            }
+
+            //! A private member variable.
+            /*!
+                書き込み中のワード
+            */
+            std::uint64_t cur_;
+
+            //! A private member variable.
+            /*!
+                先頭と末尾のワードを格納する組
+            */
+            std::pair<std::uint64_t, std::uint64_t> & edges_;
+
+            //! A private member variable.
+            /*!
+                書き込み中のワードに書き込んだビットの数
+            */
+            std::uint32_t fill_;
+
+            //! A private member variable.
+            /*!
+                ブロックの先頭のワードの添字
+            */
+            std::uint64_t const first_;
+
+            //! A private member variable.
+            /*!
+                書き込み中のワードの添字
+            */
+            std::uint64_t index_;
+
+            //! A private member variable.
+            /*!
+                ブロックの末尾のワードの添字
+            */
+            std::uint64_t const last_;
+
+            //! A private member variable.
+            /*!
+                ファイル全体のワードの配列
+            */
+            flips::packedflips & words_;
+
+            //! A private constructor (deleted).
+            /*!
+                デフォルトコンストラクタ（禁止）
+            */
+            BitWriter() = delete;
+
+            //! A private copy constructor (deleted).
+            /*!
+                コピーコンストラクタ（禁止）
+                \param dummy コピー元のオブジェクト（未使用）
+            */
+            BitWriter(BitWriter const & dummy) = delete;
+
+            //! A private member function (deleted).
+            /*!
+                operator=()の宣言（禁止）
+                \param dummy コピー元のオブジェクト（未使用）
+                \return コピー元のオブジェクト
+            */
+            BitWriter & operator=(BitWriter const & dummy) = delete;
+        };
+
+        //! A function.
+        /*!
+            ブロックのUとDを読み込んで書き込む
+            \param p ブロックの先頭へのポインタ
+            \param n ブロックの大きさ（バイト）
+            \param dice サイコロの目の列ならtrue、UとDの列ならfalse
+            \param writer 書き込むオブジェクト
+        */
+        void parseblock(char const * p, std::size_t n, bool dice, BitWriter & writer)
+        {
+            auto i = std::size_t(0);
+            for (; i + LANES <= n; i += LANES) {
+                std::uint32_t valid, up;
+                classify(p + i, dice, valid, up);
+
+                // 改行などを含まない場合はそのまま書き込む
+                if (valid == ALLVALID) {
+                    writer.put(up, LANES);
+                }
+                else if (valid) {
+                    writer.put(compress(up, valid), flips::popcount(valid));
+                }
+            }
+
+            for (; i < n; i++) {
+                if (isflip(p[i], dice)) {
+                    writer.put(isup(p[i], dice) ? 1U : 0U, 1U);
+                }
+            }
+
+            writer.finish();
+        }
+    }
+
+    // #region コンストラクタ
+
+    FlipsLog::FlipsLog(std::string const & filename, Format format)
+        : bytes_(0U),
+          format_(format),
+          nflips_(0U)
+    {
+        {
+            std::ifstream ifs(filename, std::ios::binary | std::ios::ate);
+            if (!ifs) {
+                throw std::runtime_error("ファイルを開けませんでした: " + filename);
+            }
+
+            bytes_ = static_cast<std::uint64_t>(ifs.tellg());
+        }
+
+        if (!bytes_) {
+            throw std::runtime_error("ファイルが空です: " + filename);
+        }
+
+        boost::interprocess::file_mapping const fm(filename.c_str(), boost::interprocess::read_only);
+        boost::interprocess::mapped_region region(fm, boost::interprocess::read_only, 0, static_cast<std::size_t>(bytes_));
+        region.advise(boost::interprocess::mapped_region::advice_sequential);
+
+        auto const data = static_cast<char const *>(region.get_address());
+        auto const nblock = static_cast<std::size_t>((bytes_ + BLOCKSIZE - 1U) / BLOCKSIZE);
+        auto const blocksize = [this](std::size_t b) {
+            return static_cast<std::size_t>(std::min<std::uint64_t>(BLOCKSIZE, bytes_ - b * BLOCKSIZE));
+        };
+
+        // 一回目の走査で各ブロックのUかDの数を数え、各ブロックの書き込み位置を求める
+        // 形式を自動で判定する場合は、まずUとDの列として数え、'U'も'D'もなければサイコロの目の列として数え直す
+        // （UとDの列に行番号や時刻の数字が混ざっていても、数字をUかDとして読まない）
+        std::vector<std::uint64_t> offsets(nblock + 1U, 0U);
+        auto const count = [&](bool dice) {
+            tbb::parallel_for(
+                tbb::blocked_range<std::size_t>(0U, nblock),
+                [&](auto const & range) {
+                for (auto b = range.begin(); b != range.end(); ++b) {
+                    offsets[b + 1U] = countblock(data + b * BLOCKSIZE, blocksize(b), dice);
+                }
+            });
+
+            for (auto b = std::size_t(0); b < nblock; b++) {
+                offsets[b + 1U] += offsets[b];
+            }
+        };
+
+        if (format_ == Format::AUTO) {
+            count(false);
+            if (!offsets[nblock]) {
+                format_ = Format::DICE;
+                count(true);
+            }
+            else {
+                format_ = Format::UD;
+            }
+        }
+        else {
+            count(format_ == Format::DICE);
+        }
+
+        auto const dice = format_ == Format::DICE;
+
+        nflips_ = offsets[nblock];
+        if (!nflips_) {
+            throw std::runtime_error("UかDとして読み込める文字がありません: " + filename);
+        }
+
+        words_.assign(static_cast<std::size_t>((nflips_ + flips::WORDBITS - 1U) / flips::WORDBITS), 0U);
+
+        // 二回目の走査で各ブロックを詰めて書き込む
+        std::vector<std::pair<std::uint64_t, std::uint64_t>> edges(nblock, std::make_pair(UINT64_C(0), UINT64_C(0)));
+        tbb::parallel_for(
+            tbb::blocked_range<std::size_t>(0U, nblock),
+            [&](auto const & range) {
+            for (auto b = range.begin(); b != range.end(); ++b) {
+                auto const count = offsets[b + 1U] - offsets[b];
+                if (count) {
+                    BitWriter writer(words_, offsets[b], count, edges[b]);
+                    parseblock(data + b * BLOCKSIZE, blocksize(b), dice, writer);
+                }
+            }
+        });
+
+        // ブロックの境界のワードをまとめる
+        for (auto b = std::size_t(0); b < nblock; b++) {
+            auto const count = offsets[b + 1U] - offsets[b];
+            if (count) {
+                auto const first = offsets[b] / flips::WORDBITS;
+                auto const last = (offsets[b] + count - 1U) / flips::WORDBITS;
+                words_[first] |= edges[b].first;
+                if (last != first) {
+                    words_[last] |= edges[b].second;
+                }
+            }
+        }
+    }
+
+    // #endregion コンストラクタ
+
+    // #region 非メンバ関数
+
+    Format toformat(std::string const & name)
+    {
+        if (name == "auto") {
+            return Format::AUTO;
+        }
+        else if (name == "ud") {
+            return Format::UD;
+        }
+        else if (name == "dice") {
+            return Format::DICE;
+        }
+
+        throw std::invalid_argument("不明な記録の形式です: " + name);
+    }
+
+    // #endregion 非メンバ関数
+}
@@ -0,0 +1,164 @@
+﻿/*! \file flipslog.h
+    \brief 記録されたUとDの列（またはサイコロの目の列）のファイルを読み込むクラスの宣言
+
+    Copyright © 2017 @dc1394 All Rights Reserved.
+    This software is released under the BSD 2-Clause License.
+*/
+
+#ifndef _FLIPSLOG_H_
+#define _FLIPSLOG_H_
+
+#pragma once
+
+#include "../flips/packedflips.h"
+#include <cstdint>  // for std::uint64_t
+#include <string>   // for std::string
+
+namespace flipslog {
+    //! An enumeration.
+    /*!
+        記録の形式
+    */
+    enum class Format {
+        //! ファイルに'U'か'D'が一つでもあればUD、なければDICE
+        AUTO,
+
+        //! 'U'と'D'の列（数字は行番号や時刻として読み飛ばす）
+        UD,
+
+        //! サイコロの目'1'～'6'の列（4以上をU、3以下をDとし、文字は読み飛ばす）
+        DICE
+    };
+
+    //! A class.
+    /*!
+        記録されたUとDの列のテキストファイルをメモリマップし、64ビットのワードに詰めて保持するクラス
+        'U'と'D'の列か、サイコロの目'1'～'6'の列（4以上をU、3以下をDとする）のどちらか一方の形式を読み込み、
+        もう一方の形式の文字を含むそれ以外の文字（行番号、時刻、改行、空白、区切り文字など）は読み飛ばす
+        ファイルを一定の大きさのブロックに分け、各ブロックをSIMD命令で並列に読み込む
+    */
+    class FlipsLog final {
+        // #region コンストラクタ・デストラクタ
+
+    public:
+        //! A constructor.
+        /*!
+            唯一のコンストラクタ
+            \param filename ファイル名
+            \param format 記録の形式
+        */
+        explicit FlipsLog(std::string const & filename, Format format = Format::AUTO);
+
+        //! A destructor.
+        /*!
+            デフォルトデストラクタ
+        */
+        ~FlipsLog() = default;
+
+        // #endregion コンストラクタ・デストラクタ
+
+        // #region プロパティ
+
+        //! A property.
+        /*!
+            ファイルの大きさ（バイト）を返す
+        */
+        std::uint64_t bytes() const
+        {
+            return bytes_;
+        }
+
+        //! A property.
+        /*!
+            読み込んだ記録の形式を返す（UDかDICE）
+        */
+        Format format() const
+        {
+            return format_;
+        }
+
+        //! A property.
+        /*!
+            読み込んだUかDの個数を返す
+        */
+        std::uint64_t nflips() const
+        {
+            return nflips_;
+        }
+
+        //! A property.
+        /*!
+            読み込んだUとDの列を詰めたワードの可変長配列を返す
+        */
+        flips::packedflips const & words() const
+        {
+            return words_;
+        }
+
+        // #endregion プロパティ
+
+        // #region メンバ変数
+
+    private:
+        //! A private member variable.
+        /*!
+            ファイルの大きさ（バイト）
+        */
+        std::uint64_t bytes_;
+
+        //! A private member variable.
+        /*!
+            読み込んだ記録の形式（UDかDICE）
+        */
+        Format format_;
+
+        //! A private member variable.
+        /*!
+            読み込んだUかDの個数
+        */
+        std::uint64_t nflips_;
+
+        //! A private member variable.
+        /*!
+            読み込んだUとDの列を詰めたワードの可変長配列
+        */
+        flips::packedflips words_;
+
+        // #endregion メンバ変数
+
+        // #region 禁止されたコンストラクタ・メンバ関数
+
+        //! A private constructor (deleted).
+        /*!
+            デフォルトコンストラクタ（禁止）
+        */
+        FlipsLog() = delete;
+
+        //! A private copy constructor (deleted).
+        /*!
+            コピーコンストラクタ（禁止）
+            \param dummy コピー元のオブジェクト（未使用）
+        */
+        FlipsLog(FlipsLog const & dummy) = delete;
+
+        //! A private member function (deleted).
+        /*!
+            operator=()の宣言（禁止）
+            \param dummy コピー元のオブジェクト（未使用）
+            \return コピー元のオブジェクト
+        */
+        FlipsLog & operator=(FlipsLog const & dummy) = delete;
+
+        // #endregion 禁止されたコンストラクタ・メンバ関数
+    };
+
+    //! A function.
+    /*!
+        記録の形式の名前を記録の形式に変換する
+        \param name 記録の形式の名前（auto, ud, dice）
+        \return 記録の形式
+    */
+    Format toformat(std::string const & name);
+}
+
+#endif  // _FLIPSLOG_H_
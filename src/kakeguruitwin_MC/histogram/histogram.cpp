@@ -0,0 +1,166 @@
+﻿/*! \file histogram.cpp
+    \brief 小さい値は正確に、大きい値は対数的な区間で数えるヒストグラムクラスの実装
+
+    Copyright © 2017 @dc1394 All Rights Reserved.
+    This software is released under the BSD 2-Clause License.
+*/
+
+#include "histogram.h"
+#include <cmath>    // for std::ceil, std::sqrt
+#include <limits>   // for std::numeric_limits
+
+#ifdef _MSC_VER
+    #include <intrin.h> // for _BitScanReverse64
+#endif
+
+namespace histogram {
+    namespace {
+        //! A function.
+        /*!
+            最上位の立っているビットの位置を求める
+            \param v 値（0であってはならない）
+            \return 最上位の立っているビットの位置
+        */
+        inline std::uint32_t highestbit(std::uint64_t v)
+        {
+#ifdef _MSC_VER
+            unsigned long index;
+            _BitScanReverse64(&index, v);
+            return static_cast<std::uint32_t>(index);
+#else
+            return 63U - static_cast<std::uint32_t>(__builtin_clzll(v));
+#endif
+        }
+
+        //! A global variable (constant expression).
+        /*!
+            一つの2のべきの範囲を分ける区間の数
+        */
+        static auto constexpr HALF = 1U << (LogHistogram::SUBBITS - 1U);
+    }
+
+    // #region コンストラクタ
+
+    LogHistogram::LogHistogram()
+        : count_(0U),
+          counts_(),
+          max_(0U),
+          min_(std::numeric_limits<std::uint64_t>::max()),
+          overflow_(0U),
+          sum_(0U),
+          sumsq_(0.0)
+    {
+    }
+
+    // #endregion コンストラクタ
+
+    // #region メンバ関数
+
+    void LogHistogram::merge(LogHistogram const & other)
+    {
+        if (other.counts_.size() > counts_.size()) {
+            counts_.resize(other.counts_.size(), 0U);
+        }
+
+        for (auto i = 0U; i < other.counts_.size(); i++) {
+            counts_[i] += other.counts_[i];
+        }
+
+        count_ += other.count_;
+        overflow_ += other.overflow_;
+        sum_ += other.sum_;
+        sumsq_ += other.sumsq_;
+
+        if (other.min_ < min_) {
+            min_ = other.min_;
+        }
+        if (other.max_ > max_) {
+            max_ = other.max_;
+        }
+    }
+
+    double LogHistogram::mean() const
+    {
+        return count_ ? static_cast<double>(sum_) / static_cast<double>(count_) : 0.0;
+    }
+
+    std::uint64_t LogHistogram::quantile(double q) const
+    {
+        if (!count_) {
+            return 0U;
+        }
+
+        // q * count_個目（1始まり）の値を含む区間を探す
+        auto rank = static_cast<std::uint64_t>(std::ceil(q * static_cast<double>(count_)));
+        if (rank == 0U) {
+            rank = 1U;
+        }
+
+        auto cum = UINT64_C(0);
+        for (auto i = 0U; i < counts_.size(); i++) {
+            cum += counts_[i];
+            if (cum >= rank) {
+                auto const ub = upperbound(i);
+                return ub < max_ ? ub : max_;
+            }
+        }
+
+        // 区間に入らない2^MAXBITS以上の値の中にある
+        return max_;
+    }
+
+    double LogHistogram::stddev() const
+    {
+        if (!count_) {
+            return 0.0;
+        }
+
+        auto const m = mean();
+        auto const var = sumsq_ / static_cast<double>(count_) - m * m;
+
+        return var > 0.0 ? std::sqrt(var) : 0.0;
+    }
+
+    std::uint32_t LogHistogram::bucketindex(std::uint64_t v)
+    {
+        if (v < (UINT64_C(1) << SUBBITS)) {
+            return static_cast<std::uint32_t>(v);
+        }
+
+        auto const msb = highestbit(v);
+        if (msb >= MAXBITS) {
+            return NBUCKET;
+        }
+
+        auto const shift = msb - SUBBITS + 1U;
+        auto const top = static_cast<std::uint32_t>(v >> shift);
+
+        return (1U << SUBBITS) + (shift - 1U) * HALF + (top - HALF);
+    }
+
+    std::uint64_t LogHistogram::lowerbound(std::uint32_t index)
+    {
+        if (index < (1U << SUBBITS)) {
+            return index;
+        }
+
+        auto const r = index - (1U << SUBBITS);
+        auto const shift = r / HALF + 1U;
+        auto const top = static_cast<std::uint64_t>(r % HALF + HALF);
+
+        return top << shift;
+    }
+
+    std::uint64_t LogHistogram::upperbound(std::uint32_t index)
+    {
+        if (index < (1U << SUBBITS)) {
+            return index;
+        }
+
+        auto const shift = (index - (1U << SUBBITS)) / HALF + 1U;
+
+        return lowerbound(index) + (UINT64_C(1) << shift) - 1U;
+    }
+
+    // #endregion メンバ関数
+}
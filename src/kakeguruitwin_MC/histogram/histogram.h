@@ -0,0 +1,250 @@
+﻿/*! \file histogram.h
+    \brief 小さい値は正確に、大きい値は対数的な区間で数えるヒストグラムクラスの宣言
+
+    Copyright © 2017 @dc1394 All Rights Reserved.
+    This software is released under the BSD 2-Clause License.
+*/
+
+#ifndef _HISTOGRAM_H_
+#define _HISTOGRAM_H_
+
+#pragma once
+
+#include <cstdint>  // for std::uint32_t, std::uint64_t
+#include <vector>   // for std::vector
+
+namespace histogram {
+    //! A class.
+    /*!
+        小さい値は正確に、大きい値は対数的な区間で数えるヒストグラムクラス（HDRヒストグラムと同様の区間）
+        2^SUBBITS未満の値は値毎に数え、それ以上の値は2のべき毎の範囲を2^(SUBBITS - 1)個の区間に分けて数えるので、
+        相対誤差は2^-(SUBBITS - 1)以下となる
+        区間毎の個数は記録された最大値の区間までしか持たないので、使用するメモリは試行回数によらず、
+        値の範囲が狭いときは小さい
+    */
+    class LogHistogram final {
+        // #region コンストラクタ・デストラクタ
+
+    public:
+        //! A constructor.
+        /*!
+            唯一のコンストラクタ
+        */
+        LogHistogram();
+
+        //! A destructor.
+        /*!
+            デフォルトデストラクタ
+        */
+        ~LogHistogram() = default;
+
+        // #endregion コンストラクタ・デストラクタ
+
+        // #region メンバ関数
+
+        //! A public member function.
+        /*!
+            値を記録する
+            \param v 記録する値
+        */
+        void record(std::uint64_t v)
+        {
+            // 2^MAXBITS以上の値は区間に入れず、別に数える
+            if (v >> MAXBITS) {
+                overflow_++;
+            }
+            else {
+                auto const index = bucketindex(v);
+                if (index >= counts_.size()) {
+                    counts_.resize(index + 1U, 0U);
+                }
+
+                counts_[index]++;
+            }
+
+            count_++;
+            sum_ += v;
+
+            auto const d = static_cast<double>(v);
+            sumsq_ += d * d;
+
+            if (v < min_) {
+                min_ = v;
+            }
+            if (v > max_) {
+                max_ = v;
+            }
+        }
+
+        //! A public member function.
+        /*!
+            別のヒストグラムを足し合わせる
+            \param other 足し合わせるヒストグラム
+        */
+        void merge(LogHistogram const & other);
+
+        //! A public member function.
+        /*!
+            平均値を返す
+            \return 平均値
+        */
+        double mean() const;
+
+        //! A public member function.
+        /*!
+            与えられた分位数に対応する値を返す（区間の中の値は区間の上端で代表する）
+            \param q 分位数（0以上1以下）
+            \return 分位数に対応する値
+        */
+        std::uint64_t quantile(double q) const;
+
+        //! A public member function.
+        /*!
+            標準偏差を返す
+            \return 標準偏差
+        */
+        double stddev() const;
+
+        //! A public static member function.
+        /*!
+            値に対応する区間の添字を返す
+            \param v 値
+            \return 区間の添字（2^MAXBITS以上の値はどの区間にも入らないのでNBUCKET）
+        */
+        static std::uint32_t bucketindex(std::uint64_t v);
+
+        //! A public static member function.
+        /*!
+            区間の下端の値を返す
+            \param index 区間の添字
+            \return 区間の下端の値
+        */
+        static std::uint64_t lowerbound(std::uint32_t index);
+
+        //! A public static member function.
+        /*!
+            区間の上端の値を返す
+            \param index 区間の添字
+            \return 区間の上端の値（区間に含まれる最大の値）
+        */
+        static std::uint64_t upperbound(std::uint32_t index);
+
+        // #endregion メンバ関数
+
+        // #region プロパティ
+
+        //! A property.
+        /*!
+            記録された値の個数を返す（2^MAXBITS以上の値を含む）
+        */
+        std::uint64_t count() const
+        {
+            return count_;
+        }
+
+        //! A property.
+        /*!
+            区間毎の個数を返す（要素数は記録された最大値の区間の添字 + 1）
+        */
+        std::vector<std::uint64_t> const & counts() const
+        {
+            return counts_;
+        }
+
+        //! A property.
+        /*!
+            記録された値の最大値を返す
+        */
+        std::uint64_t max() const
+        {
+            return max_;
+        }
+
+        //! A property.
+        /*!
+            記録された値の最小値を返す（値が記録されていない場合は0）
+        */
+        std::uint64_t min() const
+        {
+            return count_ ? min_ : 0U;
+        }
+
+        //! A property.
+        /*!
+            区間に入らない2^MAXBITS以上の値の個数を返す
+        */
+        std::uint64_t overflow() const
+        {
+            return overflow_;
+        }
+
+        // #endregion プロパティ
+
+        // #region メンバ変数
+
+        //! A public static member variable (constant expression).
+        /*!
+            区間の有効ビット数
+        */
+        static auto constexpr SUBBITS = 8U;
+
+        //! A public static member variable (constant expression).
+        /*!
+            扱う値のビット数（2^MAXBITS以上の値は区間に入れず、overflowに数える）
+        */
+        static auto constexpr MAXBITS = 48U;
+
+        //! A public static member variable (constant expression).
+        /*!
+            区間の数
+        */
+        static auto constexpr NBUCKET = (1U << SUBBITS) + (MAXBITS - SUBBITS) * (1U << (SUBBITS - 1U));
+
+    private:
+        //! A private member variable.
+        /*!
+            記録された値の個数
+        */
+        std::uint64_t count_;
+
+        //! A private member variable.
+        /*!
+            区間毎の個数
+        */
+        std::vector<std::uint64_t> counts_;
+
+        //! A private member variable.
+        /*!
+            記録された値の最大値
+        */
+        std::uint64_t max_;
+
+        //! A private member variable.
+        /*!
+            記録された値の最小値
+        */
+        std::uint64_t min_;
+
+        //! A private member variable.
+        /*!
+            区間に入らない2^MAXBITS以上の値の個数
+        */
+        std::uint64_t overflow_;
+
+        //! A private member variable.
+        /*!
+            記録された値の和
+        */
+        std::uint64_t sum_;
+
+        //! A private member variable.
+        /*!
+            記録された値の二乗の和
+        */
+        double sumsq_;
+
+        // #endregion メンバ変数
+    };
+}
+
+#endif  // _HISTOGRAM_H_
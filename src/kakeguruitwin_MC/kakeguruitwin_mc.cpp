@@ -1,24 +1,60 @@
 ﻿#include "../checkpoint/checkpoint.h"
+#include "batch/batch.h"
+#include "bootstrap/bootstrap.h"
+#include "columnar/columnarwriter.h"
+#include "conditional/conditional.h"
+#include "corpus/corpus.h"
+#include "correlation/correlation.h"
+#include "counterpattern/counterpattern.h"
+#include "coverage/coverage.h"
+#include "flips/packedflips.h"
+#include "flipslog/flipslog.h"
 #include "goexit/goexit.h"
+#include "match/match.h"
+#include "multilength/multilength.h"
+#include "occurrence/occurrence.h"
+#include "occurrenceindex/occurrenceindex.h"
+#include "ordering/ordering.h"
+#include "pattern/pattern.h"
+#include "perfledger/perfledger.h"
+#include "querydaemon/querydaemon.h"
+#include "resultstore/resultstore.h"
+#include "sampleprofiler/sampleprofiler.h"
+#include "simulator/simulator.h"
+#include "stageprobe/stageprobe.h"
+#include "trialstore/trialstore.h"
+#include "waitingtime/waitingtime.h"
+#include "winmatrix/winmatrix.h"
 #ifdef HAVE_SSE2
 	#include "myrandom/myrandsfmt.h"
 #else
 	#include "myrandom/myrand.h"
 #endif
+#include <algorithm>                    // for std::find, std::find_if, std::max, std::partial_sort
 #include <array>                       	// for std::array
-#include <cstdint>  	               	// for std::uint32_t
-#include <functional>                   // for std::hash
+#include <chrono>                       // for std::chrono
+#include <cmath>                        // for std::sqrt
+#include <cstdint>  	               	// for std::uint32_t, std::uint64_t
+#include <cstdlib>                      // for EXIT_FAILURE
+#include <exception>                    // for std::exception
+#include <functional>                   // for std::function, std::hash
+#include <fstream>                      // for std::ofstream
 #include <iomanip>		               	// for std::setiosflags, std::setprecision
-#include <iostream> 	               	// for std::cout
+#include <iostream> 	               	// for std::cerr, std::cout
+#include <limits>                       // for std::numeric_limits
+#include <memory>                       // for std::make_unique, std::unique_ptr
+#include <sstream>                      // for std::ostringstream
+#include <stdexcept>                    // for std::invalid_argument, std::runtime_error
 #include <string>                      	// for std::string
 #include <utility>                      // for std::move
-#ifdef _CHECK_PARALELL_PERFORM
-    #include <vector>   	            // for std::vector
-#endif
+#include <vector>                       // for std::vector
 #include <boost/container/flat_map.hpp>	// for boost::container::flat_map
+#include <boost/optional.hpp>           // for boost::optional
+#include <boost/program_options.hpp>    // for boost::program_options
 #include <tbb/concurrent_hash_map.h>    // for tbb::concurrent_hash_map
 #include <tbb/concurrent_vector.h>     	// for tbb::concurrent_vector
 #include <tbb/parallel_for.h>           // for tbb::parallel_for
+#include <tbb/task_arena.h>             // for tbb::task_arena
 
 namespace {
     //! A global variable (constant expression).
@@ -190,10 +226,280 @@ namespace {
     */
     template <typename T>
     mymap sumMontecarloAvg(T const & mcresultavg);
+
+    //! A function.
+    /*!
+        コマンドライン引数を解析する
+        \param argc コマンドライン引数の数
+        \param argv コマンドライン引数
+        \return コマンドライン引数の解析結果（ヘルプを表示した場合はboost::none）
+    */
+    boost::optional<boost::program_options::variables_map> parseoptions(int argc, char * argv[]);
+
+    //! A function.
+    /*!
+        --ledgerが指定された場合に、この実行の性能の記録をファイルに追記する（失敗しても実行は失敗としない）
+        \param vm コマンドライン引数の解析結果
+        \param trials 試行回数
+    */
+    void appendledger(boost::program_options::variables_map const & vm, std::uint64_t trials);
+
+    //! A function.
+    /*!
+        --profileが指定された場合に、プロファイラの結果を表示し、ファイルに書き出す（失敗しても実行は失敗としない）
+        \param profiler プロファイラ（指定されていない場合はnullptr）
+    */
+    void reportprofile(std::unique_ptr<sampleprofiler::Profiler> const & profiler);
+
+    //! A function.
+    /*!
+        実験の設定のファイル（--input）の全ての実験を、一つのスレッドのアリーナで乱数列を共有しながら実行し、
+        実験毎にファイルに書き出す
+        \param vm コマンドライン引数の解析結果
+        \return 実際に行った試行回数（試行を行わないモードは0）
+    */
+    std::uint64_t batchmode(boost::program_options::variables_map const & vm);
+
+    //! A function.
+    /*!
+        試行毎の出現位置を保持し、二つの文字列の勝率とその差の信頼区間をブートストラップ法で求める
+        \param vm コマンドライン引数の解析結果
+        \return 実際に行った試行回数（試行を行わないモードは0）
+    */
+    std::uint64_t bootstrapmode(boost::program_options::variables_map const & vm);
+
+    //! A function.
+    /*!
+        cutoff個までのUかDだけを生成し、残りを厳密な吸収確率で置き換える条件付きモンテカルロ法で、文字列のペアの勝率を求める
+        \param vm コマンドライン引数の解析結果
+        \return 実際に行った試行回数（試行を行わないモードは0）
+    */
+    std::uint64_t conditionalmode(boost::program_options::variables_map const & vm);
+
+    //! A function.
+    /*!
+        UとDのランダム列を生成してコーパスのファイルに書き出す
+        \param vm コマンドライン引数の解析結果
+        \return 実際に行った試行回数（試行を行わないモードは0）
+    */
+    std::uint64_t corpusmode(boost::program_options::variables_map const & vm);
+
+    //! A function.
+    /*!
+        コーパスのファイルを読み込み、複数の文字列の組について期待値と勝率を同じ乱数列で求める
+        \param vm コマンドライン引数の解析結果
+        \return 実際に行った試行回数（試行を行わないモードは0）
+    */
+    std::uint64_t corpusevalmode(boost::program_options::variables_map const & vm);
+
+    //! A function.
+    /*!
+        全ての文字列について最善の対抗文字列とその勝率を厳密に求め、非推移的な循環を検出する
+        \param vm コマンドライン引数の解析結果
+        \return 実際に行った試行回数（試行を行わないモードは0）
+    */
+    std::uint64_t countermode(boost::program_options::variables_map const & vm);
+
+    //! A function.
+    /*!
+        Unixドメインソケットで勝率の問い合わせに答え続ける
+        \param vm コマンドライン引数の解析結果
+        \return 実際に行った試行回数（試行を行わないモードは0）
+    */
+    std::uint64_t daemonmode(boost::program_options::variables_map const & vm);
+
+    //! A function.
+    /*!
+        制限時間内で可能な限りの試行を行い、文字列の期待値と全てのペアの勝率を求める
+        \param vm コマンドライン引数の解析結果
+        \return 実際に行った試行回数（試行を行わないモードは0）
+    */
+    std::uint64_t deadlinemode(boost::program_options::variables_map const & vm);
+
+    //! A function.
+    /*!
+        性能の記録のファイルを読み込み、同じ設定のそれまでの実行よりも遅い実行を表示する
+        \param vm コマンドライン引数の解析結果
+        \return 実際に行った試行回数（試行を行わないモードは0）
+    */
+    std::uint64_t ledgermode(boost::program_options::variables_map const & vm);
+
+    //! A function.
+    /*!
+        長さKの全ての文字列が少なくとも一度出現するまでの回数（被覆時間）の分布を求める
+        \param vm コマンドライン引数の解析結果
+        \return 実際に行った試行回数（試行を行わないモードは0）
+    */
+    std::uint64_t coveragemode(boost::program_options::variables_map const & vm);
+
+    //! A function.
+    /*!
+        全ての文字列が最初に出現する順序の分布と、各文字列の平均順位を求める
+        \param vm コマンドライン引数の解析結果
+        \return 実際に行った試行回数（試行を行わないモードは0）
+    */
+    std::uint64_t orderingmode(boost::program_options::variables_map const & vm);
+
+    //! A function.
+    /*!
+        長いUとDの列の出現位置の索引を作成し、重なり合う全ての開始位置からの競争の勝利回数を集計する
+        \param vm コマンドライン引数の解析結果
+        \return 実際に行った試行回数（試行を行わないモードは0）
+    */
+    std::uint64_t offsetracesmode(boost::program_options::variables_map const & vm);
+
+    //! A function.
+    /*!
+        決められた回数の中で各文字列が出現する回数の平均と分散、およびどちらの文字列が多く出現したかの割合を求める
+        \param vm コマンドライン引数の解析結果
+        \return 実際に行った試行回数（試行を行わないモードは0）
+    */
+    std::uint64_t occurrencemode(boost::program_options::variables_map const & vm);
+
+    //! A function.
+    /*!
+        長さ1からLまでの全ての文字列について、期待値と勝率を一度のシミュレーションで求める
+        \param vm コマンドライン引数の解析結果
+        \return 実際に行った試行回数（試行を行わないモードは0）
+    */
+    std::uint64_t multilengthmode(boost::program_options::variables_map const & vm);
+
+    //! A function.
+    /*!
+        全てのペアに対する勝率の表を表示する
+        \param wm 勝利回数の総和を保持するオブジェクト
+    */
+    void printwinmatrix(winmatrix::WinMatrix const & wm);
+
+    //! A function.
+    /*!
+        ヒストグラムの平均、標準偏差と分位数を表示する
+        \param hist ヒストグラム
+    */
+    void printquantiles(histogram::LogHistogram const & hist);
+
+    //! A function.
+    /*!
+        シミュレータの結果（文字列の期待値と全てのペアの勝率）を表示する
+        \param config 一回の実行の設定
+        \param result 一回の実行の結果
+    */
+    void printsimulation(simulator::RunConfig const & config, simulator::Result const & result);
+
+    //! A function.
+    /*!
+        指定されたモードを実行する
+        \param vm コマンドライン引数の解析結果
+        \return 実行したモードが実際に行った試行回数（試行を行わないモードは0）
+    */
+    std::uint64_t runmode(boost::program_options::variables_map const & vm);
+
+    //! A function.
+    /*!
+        複数の結果の保存ファイルを一つにまとめる
+        \param vm コマンドライン引数の解析結果
+        \return 実際に行った試行回数（試行を行わないモードは0）
+    */
+    std::uint64_t mergestoremode(boost::program_options::variables_map const & vm);
+
+    //! A function.
+    /*!
+        競争を繰り返して賭け金をやり取りする勝負を行い、破産確率、勝負の長さの分布と期待利益を求める
+        \param vm コマンドライン引数の解析結果
+        \return 実際に行った試行回数（試行を行わないモードは0）
+    */
+    std::uint64_t matchmode(boost::program_options::variables_map const & vm);
+
+    //! A function.
+    /*!
+        保存された結果に新しい試行を加えて、指定された文字列の期待値とペアの勝率の精度を上げる
+        \param vm コマンドライン引数の解析結果
+        \return 実際に行った試行回数（試行を行わないモードは0）
+    */
+    std::uint64_t refinemode(boost::program_options::variables_map const & vm);
+
+    //! A function.
+    /*!
+        記録されたUとDの列のファイルを読み込み、重ならない区間毎に全ての文字列のペアの勝利回数を集計する
+        \param vm コマンドライン引数の解析結果
+        \return 実際に行った試行回数（試行を行わないモードは0）
+    */
+    std::uint64_t replaymode(boost::program_options::variables_map const & vm);
+
+    //! A function.
+    /*!
+        シミュレータクラスを使って、指定された文字列の期待値とペアの勝率を求める
+        \param vm コマンドライン引数の解析結果
+        \return 実際に行った試行回数（試行を行わないモードは0）
+    */
+    std::uint64_t simulatemode(boost::program_options::variables_map const & vm);
+
+    //! A function.
+    /*!
+        各文字列の待ち時間とペアの決着までの回数の分布を、打ち切らずに求める
+        \param vm コマンドライン引数の解析結果
+        \return 実際に行った試行回数（試行を行わないモードは0）
+    */
+    std::uint64_t waitingtimemode(boost::program_options::variables_map const & vm);
+
+    //! A function.
+    /*!
+        長さKの全ての文字列のペアに対する勝利回数を集計し、バイナリファイルに書き出す
+        \param vm コマンドライン引数の解析結果
+        \return 実際に行った試行回数（試行を行わないモードは0）
+    */
+    std::uint64_t winmatrixmode(boost::program_options::variables_map const & vm);
+
+    //! A function.
+    /*!
+        シミュレータクラスの結果を、列指向のバイナリ形式でファイルに書き出す
+        \param filename ファイル名
+        \param config 実行の設定
+        \param result 実行の結果
+    */
+    void writesimulation(std::string const & filename, simulator::RunConfig const & config, simulator::Result const & result);
 }
 
-int main()
+int main(int argc, char * argv[])
 {
+    // 指定された場合はプログラムの終わりまで標本を取るプロファイラ
+    std::unique_ptr<sampleprofiler::Profiler> profiler;
+
+    // コマンドライン引数の解析結果（defaultモードの性能の記録でも使う）
+    boost::optional<boost::program_options::variables_map> vm;
+
+    try {
+        // コマンドライン引数を解析
+        vm = parseoptions(argc, argv);
+        if (!vm) {
+            return 0;
+        }
+
+        if (vm->count("profile")) {
+            profiler = std::make_unique<sampleprofiler::Profiler>(
+                (*vm)["profile-hz"].as<std::uint32_t>(),
+                (*vm)["profile-out"].as<std::string>());
+        }
+
+        // default以外のモードが指定された場合はそのモードを実行
+        if ((*vm)["mode"].as<std::string>() != "default") {
+            auto const trials = runmode(*vm);
+
+            appendledger(*vm, trials);
+
+            reportprofile(profiler);
+
+            goexit::goexit();
+
+            return 0;
+        }
+    }
+    catch (std::exception const & e) {
+        std::cerr << e.what() << std::endl;
+
+        return EXIT_FAILURE;
+    }
+
     checkpoint::CheckPoint cp;
 
     cp.checkpoint("処理開始", __LINE__);
@@ -258,6 +564,21 @@ int main()
 
     cp.checkpoint_print();
 
+#ifdef STAGEPROBE
+    // 段階毎・スレッド毎の試行のコストを表示
+    std::cout << '\n';
+    stageprobe::report(std::cout);
+#endif
+
+#ifdef _CHECK_PARALELL_PERFORM
+    // 記録する区間には、並列化しない場合と並列化した場合の両方の試行が含まれる
+    appendledger(*vm, 2U * MCMAX);
+#else
+    appendledger(*vm, MCMAX);
+#endif
+
+    reportprofile(profiler);
+
 	goexit::goexit();
 
     return 0;
@@ -352,6 +673,26 @@ namespace {
         // UDのランダム文字列を格納するstd::string
         std::string udstring(RANDNUMTABLELEN, '\0');
 
+#ifdef STAGEPROBE
+        // 計測する試行では、乱数の生成と文字列の構築を分けて計測する
+        if (stageprobe::sampling()) {
+            std::array<std::int32_t, RANDNUMTABLELEN> faces;
+            {
+                STAGEPROBE_SCOPE(RNG);
+                for (auto && f : faces) {
+                    f = mr.myrand();
+                }
+            }
+
+            STAGEPROBE_SCOPE(BUILD);
+            for (auto i = 0U; i < RANDNUMTABLELEN; i++) {
+                udstring[i] = faces[i] > 3 ? 'U' : 'D';
+            }
+
+            return udstring;
+        }
+#endif
+
         // UDのランダム文字列を格納
         for (auto && c : udstring) {
             c = mr.myrand() > 3 ? 'U' : 'D';
@@ -413,6 +754,8 @@ namespace {
             MCMAX,
             1U,
             [&](auto) {
+                // 一定の間隔で試行を段階毎に計測する（STAGEPROBEが未定義の場合は何もしない）
+                STAGEPROBE_TRIAL();
 
 #ifdef HAVE_SSE2
 		        // 自作乱数クラスを初期化
@@ -443,7 +786,10 @@ namespace {
 
         // 文字列が最初に出現するのは何文字目かを検索し結果を代入
         for (auto const & str : udarray) {
-            result.insert(std::make_pair(str, myfind(str, udstr)));
+            auto const pos = myfind(str, udstr);
+
+            STAGEPROBE_SCOPE(INSERT);
+            result.insert(std::make_pair(str, pos));
         }
 
         return result;
@@ -460,7 +806,10 @@ namespace {
 
         // どちらの文字列が先に出現したかの結果を代入
         for (auto const & sp : cbarray) {
-            result.insert(std::make_pair(sp, myfind(sp.first, udstr) < myfind(sp.second, udstr)));
+            auto const win = myfind(sp.first, udstr) < myfind(sp.second, udstr);
+
+            STAGEPROBE_SCOPE(INSERT);
+            result.insert(std::make_pair(sp, win));
         }
 
         // 検索結果を返す
@@ -469,6 +818,8 @@ namespace {
         
     std::uint32_t myfind(std::string const & str, std::string const & udstr)
     {
+        STAGEPROBE_SCOPE(SEARCH);
+
         // 文字列の位置を検索
         auto const pos = udstr.find(str);
         
@@ -497,5 +848,1474 @@ namespace {
 
         return trial;
     }
-}
 
+    void appendledger(boost::program_options::variables_map const & vm, std::uint64_t trials)
+    {
+        if (!vm.count("ledger") || vm["mode"].as<std::string>() == "ledger") {
+            return;
+        }
+
+        // 出力先などを除いた、既定値から変えたオプションを同じ実行の設定とする
+        static std::array<char const *, 14U> const ignored = {
+            "columnar", "db", "help", "ledger", "merge-from", "min-history", "mode",
+            "output", "profile", "profile-hz", "profile-out", "sigma", "socket", "store"
+        };
+
+        std::ostringstream config;
+        config.precision(17);
+        auto first = true;
+        for (auto const & opt : vm) {
+            if (opt.second.defaulted() || std::find(ignored.begin(), ignored.end(), opt.first) != ignored.end()) {
+                continue;
+            }
+
+            config << (first ? "" : ";") << opt.first << '=';
+            first = false;
+
+            auto const & value = opt.second.value();
+            if (auto const p = boost::any_cast<std::uint32_t>(&value)) {
+                config << *p;
+            }
+            else if (auto const p = boost::any_cast<std::uint64_t>(&value)) {
+                config << *p;
+            }
+            else if (auto const p = boost::any_cast<double>(&value)) {
+                config << *p;
+            }
+            else if (auto const p = boost::any_cast<std::string>(&value)) {
+                config << *p;
+            }
+            else if (auto const p = boost::any_cast<std::vector<std::string>>(&value)) {
+                for (auto i = 0U; i < p->size(); i++) {
+                    config << (i ? "," : "") << (*p)[i];
+                }
+            }
+        }
+
+        try {
+            perfledger::append(
+                vm["ledger"].as<std::string>(),
+                perfledger::makerecord(vm["mode"].as<std::string>(), vm["engine"].as<std::string>(), config.str(), trials));
+        }
+        catch (std::exception const & e) {
+            std::cerr << "性能の記録を追記できませんでした: " << e.what() << std::endl;
+        }
+    }
+
+    void reportprofile(std::unique_ptr<sampleprofiler::Profiler> const & profiler)
+    {
+        if (!profiler) {
+            return;
+        }
+
+        try {
+            profiler->report();
+        }
+        catch (std::exception const & e) {
+            std::cerr << "プロファイラの結果を書き出せませんでした: " << e.what() << std::endl;
+        }
+    }
+
+    std::uint64_t batchmode(boost::program_options::variables_map const & vm)
+    {
+        checkpoint::CheckPoint cp;
+
+        cp.checkpoint("処理開始", __LINE__);
+
+        if (!vm.count("input")) {
+            throw std::invalid_argument("--inputで実験の設定のファイルを指定してください");
+        }
+
+        // コマンドライン引数の値を、ファイルで省略された値とする
+        simulator::RunConfig defaults;
+        defaults.bias = vm["bias"].as<double>();
+        defaults.horizon = vm["horizon"].as<std::uint32_t>();
+        defaults.seed = vm["seed"].as<std::uint64_t>();
+        defaults.trials = vm["trials"].as<std::uint64_t>();
+
+        auto const experiments(batch::readexperiments(vm["input"].as<std::string>(), defaults));
+
+        cp.checkpoint("設定の読み込み", __LINE__);
+
+        auto const result(batch::run(experiments, tbb::task_arena::automatic));
+
+        cp.checkpoint("計算", __LINE__);
+
+        auto trials = UINT64_C(0);
+        for (auto e = 0U; e < experiments.size(); e++) {
+            trials += result.results[e].trials;
+            batch::writeresult(experiments[e], result.results[e]);
+            std::cout << experiments[e].name << ": " << experiments[e].config.trials << "回の試行の結果を "
+                      << experiments[e].output << " に書き出しました\n";
+        }
+
+        std::cout << experiments.size() << "個の実験で" << result.nsource << "個の乱数列を使い、"
+                  << result.generated << "ワードを生成しました（共有しない場合は" << result.unshared << "ワード）\n";
+
+        cp.checkpoint("それ以外の処理", __LINE__);
+
+        cp.checkpoint_print();
+
+        return trials;
+    }
+
+    std::uint64_t bootstrapmode(boost::program_options::variables_map const & vm)
+    {
+        checkpoint::CheckPoint cp;
+
+        cp.checkpoint("処理開始", __LINE__);
+
+        if (!vm.count("patterns") || vm["patterns"].as<std::vector<std::string>>().size() != 2U) {
+            throw std::invalid_argument("--patternsで二つの文字列を指定してください");
+        }
+
+        auto const & patterns = vm["patterns"].as<std::vector<std::string>>();
+        auto const len = static_cast<std::uint32_t>(patterns[0].size());
+        if (patterns[1].size() != len) {
+            throw std::invalid_argument("二つの文字列の長さが異なります");
+        }
+
+        auto const a = pattern::tocode(patterns[0]);
+        auto const b = pattern::tocode(patterns[1]);
+
+        auto const horizon = vm["horizon"].as<std::uint32_t>();
+        auto const trials = vm["trials"].as<std::uint64_t>();
+        auto const seed = vm["seed"].as<std::uint64_t>();
+
+        // 試行毎の出現位置を保持するオブジェクト
+        trialstore::TrialStore store(len, horizon, trials, vm.count("store") ? vm["store"].as<std::string>() : std::string());
+
+        // モンテカルロ・シミュレーションを行う
+        trialstore::montecarlo(store, seed);
+
+        cp.checkpoint("出現位置の格納", __LINE__);
+
+        // 試行毎の特徴量（Aの勝ち、Bの勝ち）を求めて再標本化する関数オブジェクト
+        auto const resample = [&](trialstore::TrialStore const & st) {
+            return bootstrap::resample(
+                st,
+                2U,
+                [a, b](trialstore::TrialStore const & s, std::uint64_t i, double * f) {
+                    // 見つからなかった場合（0）は最も遅いものとして扱う
+                    auto const fa = static_cast<std::uint8_t>(s.column(a)[i] - 1U);
+                    auto const fb = static_cast<std::uint8_t>(s.column(b)[i] - 1U);
+                    f[0] = fa < fb ? 1.0 : 0.0;
+                    f[1] = fb < fa ? 1.0 : 0.0;
+                },
+                vm["resamples"].as<std::uint32_t>(),
+                seed);
+        };
+
+        auto const resamples(resample(store));
+
+        cp.checkpoint("ブートストラップ", __LINE__);
+
+        // 1スレッドで試行と再標本化をやり直し、結果が一致することを確かめる
+        if (vm.count("check-threads")) {
+            if (!seed) {
+                throw std::invalid_argument("--check-threadsには0でない--seedが必要です");
+            }
+
+            tbb::task_arena single(1);
+            auto const serial = single.execute([&] {
+                trialstore::TrialStore st(len, horizon, trials, std::string());
+                trialstore::montecarlo(st, seed);
+                return resample(st);
+            });
+
+            if (serial.estimate != resamples.estimate || serial.means != resamples.means) {
+                throw std::runtime_error("1スレッドで求めた再標本の結果が一致しません");
+            }
+
+            std::cout << "1スレッドで求めた再標本の結果と一致しました\n";
+
+            cp.checkpoint("スレッド数による違いの確認", __LINE__);
+        }
+
+        // 信頼区間を表示する関数オブジェクト
+        auto const print = [&resamples](std::string const & title, std::function<double(double const *)> const & statistic) {
+            auto const ci = bootstrap::interval(resamples, statistic, 0.95);
+            std::cout << title << ": " << ci.estimate * 100.0 << "% (95%信頼区間: "
+                      << ci.lower * 100.0 << "% ～ " << ci.upper * 100.0 << "%, 標準誤差: "
+                      << ci.stderror * 100.0 << "%)\n";
+        };
+
+        std::cout << std::setprecision(3) << std::setiosflags(std::ios::fixed);
+        print(patterns[0] + " の勝率", [](double const * m) { return m[0]; });
+        print(patterns[1] + " の勝率", [](double const * m) { return m[1]; });
+        print("勝率の差", [](double const * m) { return m[0] - m[1]; });
+        print("決着がついた場合の " + patterns[0] + " の勝率", [](double const * m) {
+            return m[0] + m[1] > 0.0 ? m[0] / (m[0] + m[1]) : 0.0;
+        });
+
+        if (store.mapped()) {
+            std::cout << "試行毎の出現位置はファイルにメモリマップしました\n";
+        }
+
+        cp.checkpoint("それ以外の処理", __LINE__);
+
+        cp.checkpoint_print();
+
+        return trials;
+    }
+
+    std::uint64_t conditionalmode(boost::program_options::variables_map const & vm)
+    {
+        checkpoint::CheckPoint cp;
+
+        cp.checkpoint("処理開始", __LINE__);
+
+        // 文字列を指定しない場合は、defaultモードと同じ長さ3の全ての文字列を対象とする
+        conditional::ConditionalConfig config;
+        config.bias = vm["bias"].as<double>();
+        config.cutoff = vm["cutoff"].as<std::uint32_t>();
+        config.horizon = vm["horizon"].as<std::uint32_t>();
+        config.patterns = vm.count("patterns") ?
+            vm["patterns"].as<std::vector<std::string>>() :
+            std::vector<std::string>(udarray.begin(), udarray.end());
+        config.seed = vm["seed"].as<std::uint64_t>();
+        config.trials = vm["trials"].as<std::uint64_t>();
+
+        auto const result(conditional::montecarlo(config));
+
+        cp.checkpoint("条件付きモンテカルロ法", __LINE__);
+
+        // 推定値、標準誤差と、0か1を加える場合に対する分散の比を表示
+        auto ratio = 0.0;
+        std::cout << std::setprecision(3) << std::setiosflags(std::ios::fixed);
+        for (auto const & pair : result.pairs) {
+            std::cout << config.patterns[pair.a] << " が " << config.patterns[pair.b]
+                      << " より先に出る確率: " << pair.probability * 100.0 << "% (標準誤差: "
+                      << pair.stderror * 100.0 << "%, 厳密値: " << pair.exact * 100.0 << "%)\n";
+
+            if (pair.naivestderror > 0.0) {
+                ratio += (pair.stderror * pair.stderror) / (pair.naivestderror * pair.naivestderror);
+            }
+        }
+
+        auto const trials = static_cast<double>(result.trials);
+        std::cout << "\n打ち切らないモンテカルロ法に対する分散の比の平均: " << ratio / static_cast<double>(result.pairs.size())
+                  << "\n1試行当たりのUかDの数: " << static_cast<double>(result.flips) / trials
+                  << "（打ち切らない場合は" << config.horizon << "）"
+                  << "\n1試行当たりの32ビットの乱数の数: " << static_cast<double>(result.draws) / trials << '\n';
+
+        cp.checkpoint("それ以外の処理", __LINE__);
+
+        cp.checkpoint_print();
+
+        return result.trials;
+    }
+
+    std::uint64_t corpusmode(boost::program_options::variables_map const & vm)
+    {
+        checkpoint::CheckPoint cp;
+
+        cp.checkpoint("処理開始", __LINE__);
+
+        auto const filename = vm.count("output") ? vm["output"].as<std::string>() : std::string("flips.kcp");
+        auto const horizon = vm["horizon"].as<std::uint32_t>();
+        auto const trials = vm["trials"].as<std::uint64_t>();
+
+        auto const begin = std::chrono::steady_clock::now();
+        corpus::write(filename, horizon, trials, vm["seed"].as<std::uint64_t>());
+        auto const elapsed = std::chrono::duration<double>(std::chrono::steady_clock::now() - begin).count();
+
+        cp.checkpoint("コーパスの生成と書き込み", __LINE__);
+
+        auto const bytes = static_cast<double>(trials) * flips::wordsize(horizon) * sizeof(std::uint64_t);
+        std::cout << std::setprecision(3) << std::setiosflags(std::ios::fixed)
+                  << trials << "回の試行のUとDのランダム列を " << filename << " に書き出しました（"
+                  << bytes / elapsed / 1.0E+6 << "MB/s）\n";
+
+        cp.checkpoint("それ以外の処理", __LINE__);
+
+        cp.checkpoint_print();
+
+        return trials;
+    }
+
+    std::uint64_t corpusevalmode(boost::program_options::variables_map const & vm)
+    {
+        checkpoint::CheckPoint cp;
+
+        cp.checkpoint("処理開始", __LINE__);
+
+        if (!vm.count("input")) {
+            throw std::invalid_argument("--inputでコーパスのファイルを指定してください");
+        }
+
+        // 文字列の組（一つの組はカンマ区切り、指定されなければ--patternsを一つの組とする）
+        std::vector<std::vector<std::string>> sets;
+        if (vm.count("pattern-sets")) {
+            for (auto const & token : vm["pattern-sets"].as<std::vector<std::string>>()) {
+                std::vector<std::string> set;
+                std::string::size_type pos = 0U, next;
+                while ((next = token.find(',', pos)) != std::string::npos) {
+                    set.push_back(token.substr(pos, next - pos));
+                    pos = next + 1U;
+                }
+                set.push_back(token.substr(pos));
+                sets.push_back(std::move(set));
+            }
+        }
+        else if (vm.count("patterns")) {
+            sets.push_back(vm["patterns"].as<std::vector<std::string>>());
+        }
+        else {
+            throw std::invalid_argument("--pattern-setsか--patternsで文字列を指定してください");
+        }
+
+        corpus::Corpus const c(vm["input"].as<std::string>());
+
+        cp.checkpoint("コーパスの読み込み", __LINE__);
+
+        auto const results(corpus::evaluate(c, sets));
+
+        cp.checkpoint("計算", __LINE__);
+
+        std::cout << "コーパス: " << c.trials() << "回の試行、UかDの文字列の長さ" << c.horizon()
+                  << "、乱数エンジン" << c.rng() << "、乱数の種" << c.seed() << '\n';
+
+        for (auto s = 0U; s < sets.size(); s++) {
+            simulator::RunConfig config;
+            config.horizon = c.horizon();
+            config.patterns = sets[s];
+
+            std::cout << "\n組" << s + 1U << '\n';
+            printsimulation(config, results[s]);
+        }
+
+        cp.checkpoint("それ以外の処理", __LINE__);
+
+        cp.checkpoint_print();
+
+        return c.trials() * sets.size();
+    }
+
+    std::uint64_t countermode(boost::program_options::variables_map const & vm)
+    {
+        checkpoint::CheckPoint cp;
+
+        cp.checkpoint("処理開始", __LINE__);
+
+        auto const len = vm["length"].as<std::uint32_t>();
+
+        // 相関を計算するオブジェクト
+        correlation::Correlation const cor(len, vm["bias"].as<double>());
+
+        // 全ての文字列について最善の対抗文字列を探索
+        auto const responses(counterpattern::bestresponses(cor));
+
+        cp.checkpoint("最善の対抗文字列の探索", __LINE__);
+
+        // 非推移的な循環を検出
+        auto const cycles(counterpattern::findcycles(responses));
+
+        cp.checkpoint("循環の検出", __LINE__);
+
+        // 文字列の数が少ないときは全て表示
+        std::cout << std::setprecision(4) << std::setiosflags(std::ios::fixed);
+        if (cor.npattern() <= 64U) {
+            for (auto a = 0U; a < cor.npattern(); a++) {
+                std::cout << pattern::tostring(a, len)
+                          << " (期待値: " << cor.waitingtime(a) << "回) に対する最善の対抗: "
+                          << pattern::tostring(responses[a].pattern, len)
+                          << " 勝率: " << responses[a].probability * 100.0 << "%\n";
+            }
+        }
+
+        // 最善の対抗文字列の勝率の最小値（先手にとって最も有利な文字列）
+        auto minitr = responses.begin();
+        for (auto itr = responses.begin(); itr != responses.end(); ++itr) {
+            if (itr->probability < minitr->probability) {
+                minitr = itr;
+            }
+        }
+
+        auto const a = static_cast<std::uint32_t>(minitr - responses.begin());
+        std::cout << "先手にとって最善の文字列: " << pattern::tostring(a, len)
+                  << " (後手の最善の対抗: " << pattern::tostring(minitr->pattern, len)
+                  << " 勝率: " << minitr->probability * 100.0 << "%)\n";
+
+        std::cout << "非推移的な循環の数: " << cycles.size() << '\n';
+        for (auto const & cycle : cycles) {
+            for (auto const v : cycle) {
+                std::cout << pattern::tostring(v, len) << " <- ";
+            }
+            std::cout << pattern::tostring(cycle.front(), len) << '\n';
+        }
+
+        // CSVファイルに書き出す
+        if (vm.count("output")) {
+            auto const filename = vm["output"].as<std::string>();
+            std::ofstream ofs(filename);
+            if (!ofs) {
+                throw std::runtime_error("ファイルを開けませんでした: " + filename);
+            }
+
+            ofs << std::setprecision(10) << "pattern,waitingtime,response,probability\n";
+            for (auto b = 0U; b < cor.npattern(); b++) {
+                ofs << pattern::tostring(b, len) << ','
+                    << cor.waitingtime(b) << ','
+                    << pattern::tostring(responses[b].pattern, len) << ','
+                    << responses[b].probability << '\n';
+            }
+        }
+
+        cp.checkpoint("それ以外の処理", __LINE__);
+
+        cp.checkpoint_print();
+
+        return 0U;
+    }
+
+    std::uint64_t coveragemode(boost::program_options::variables_map const & vm)
+    {
+        checkpoint::CheckPoint cp;
+
+        cp.checkpoint("処理開始", __LINE__);
+
+        auto const len = vm["length"].as<std::uint32_t>();
+        auto const trials = vm["trials"].as<std::uint64_t>();
+
+        // モンテカルロ・シミュレーションを行う
+        auto const hist(coverage::montecarlo(len, trials));
+
+        cp.checkpoint("被覆時間の集計", __LINE__);
+
+        std::cout << "長さ" << len << "の全ての文字列が出現するまでの回数\n";
+        printquantiles(hist);
+
+        // CSVファイルに書き出す
+        if (vm.count("output")) {
+            auto const filename = vm["output"].as<std::string>();
+            std::ofstream ofs(filename);
+            if (!ofs) {
+                throw std::runtime_error("ファイルを開けませんでした: " + filename);
+            }
+
+            ofs << "lowerbound,upperbound,count\n";
+            auto const & counts = hist.counts();
+            for (auto i = 0U; i < counts.size(); i++) {
+                if (counts[i]) {
+                    ofs << histogram::LogHistogram::lowerbound(i) << ','
+                        << histogram::LogHistogram::upperbound(i) << ','
+                        << counts[i] << '\n';
+                }
+            }
+
+            // 区間に入らない値は、その下端から最大値までの一つの行にまとめる
+            if (hist.overflow()) {
+                ofs << (UINT64_C(1) << histogram::LogHistogram::MAXBITS) << ',' << hist.max() << ',' << hist.overflow() << '\n';
+            }
+        }
+
+        cp.checkpoint("それ以外の処理", __LINE__);
+
+        cp.checkpoint_print();
+
+        return trials;
+    }
+
+    std::uint64_t daemonmode(boost::program_options::variables_map const & vm)
+    {
+        auto const path = vm["socket"].as<std::string>();
+
+        auto const trials = vm["trials"].as<std::uint64_t>();
+        auto const cachesize = vm["cache-size"].as<std::size_t>();
+
+        auto const maxtrials = vm["max-trials"].as<std::uint64_t>();
+        auto const maxhorizon = vm["max-horizon"].as<std::uint32_t>();
+
+        querydaemon::QueryDaemon daemon(path, trials, cachesize, maxtrials, maxhorizon);
+
+        std::cout << path << " で問い合わせを待っています（試行回数を省略した問い合わせは" << trials
+                  << "回、キャッシュは" << cachesize << "件まで、試行回数は" << maxtrials
+                  << "回まで、UかDの文字列の長さは" << maxhorizon << "まで）" << std::endl;
+
+        daemon.run();
+
+        std::cout << "終了のシグナルを受け取りました。計算中の問い合わせに答えてから終了します" << std::endl;
+
+        return 0U;
+    }
+
+    std::uint64_t deadlinemode(boost::program_options::variables_map const & vm)
+    {
+        checkpoint::CheckPoint cp;
+
+        cp.checkpoint("処理開始", __LINE__);
+
+        if (!vm.count("patterns")) {
+            throw std::invalid_argument("--patternsで文字列を指定してください");
+        }
+
+        simulator::RunConfig config;
+        config.bias = vm["bias"].as<double>();
+        config.deadline = vm["deadline"].as<std::uint32_t>();
+        config.horizon = vm["horizon"].as<std::uint32_t>();
+        config.patterns = vm["patterns"].as<std::vector<std::string>>();
+        config.seed = vm["seed"].as<std::uint64_t>();
+
+        // 試行回数を指定しなければ、制限時間まで試行を続ける
+        config.trials = vm["trials"].defaulted() ? std::numeric_limits<std::uint64_t>::max() : vm["trials"].as<std::uint64_t>();
+
+        if (!config.deadline) {
+            throw std::invalid_argument("--deadlineは1以上でなければなりません");
+        }
+
+        simulator::Simulator sim(tbb::task_arena::automatic);
+
+        cp.checkpoint("シミュレータの初期化", __LINE__);
+
+        auto const begin = std::chrono::steady_clock::now();
+        auto const result(sim.run(config));
+        auto const elapsed = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - begin).count();
+
+        cp.checkpoint("計算", __LINE__);
+
+        std::cout << std::setprecision(3) << std::setiosflags(std::ios::fixed)
+                  << "試行回数: " << result.trials << "回, 経過時間: " << elapsed << "ms (制限時間: "
+                  << config.deadline << "ms, 超過: " << std::max(elapsed - config.deadline, 0.0) << "ms)\n";
+
+        printsimulation(config, result);
+
+        cp.checkpoint("それ以外の処理", __LINE__);
+
+        cp.checkpoint_print();
+
+        return result.trials;
+    }
+
+    std::uint64_t ledgermode(boost::program_options::variables_map const & vm)
+    {
+        checkpoint::CheckPoint cp;
+
+        cp.checkpoint("処理開始", __LINE__);
+
+        if (!vm.count("ledger")) {
+            throw std::invalid_argument("--ledgerで性能の記録のファイルを指定してください");
+        }
+
+        auto const records(perfledger::read(vm["ledger"].as<std::string>()));
+
+        cp.checkpoint("ファイルの読み込み", __LINE__);
+
+        auto const nsigma = vm["sigma"].as<double>();
+        auto const slow(perfledger::findslow(records, nsigma, vm["min-history"].as<std::uint64_t>()));
+
+        cp.checkpoint("遅い実行の検索", __LINE__);
+
+        std::cout << records.size() << "回の実行の記録のうち、同じ設定のそれまでの実行より標準偏差の"
+                  << nsigma << "倍以上遅いものが" << slow.size() << "回ありました\n";
+
+        std::cout << std::setprecision(1) << std::setiosflags(std::ios::fixed);
+        for (auto const & s : slow) {
+            auto const & r = s.record;
+            std::cout << '\n' << r.time << ' ' << r.host << " (" << r.cpu << ", " << r.threads << "スレッド)\n"
+                      << "  ビルド: " << r.build << '\n'
+                      << "  モード: " << r.mode << ", 計算の方法: " << r.engine << ", 設定: " << r.config << '\n'
+                      << "  経過時間: " << r.total << "ミリ秒、試行回数: " << r.trials << "回、"
+                      << r.trialspersec << "試行/秒、最大のメモリ使用量 " << r.peakrss << "kB\n";
+
+            // 試行を行うモードは1試行当たりの経過時間（ナノ秒）、行わないモードは経過時間（ミリ秒）で比べる
+            auto const scale = r.trials ? 1.0E+6 : 1.0;
+            auto const unit = r.trials ? "ナノ秒/試行" : "ミリ秒";
+            std::cout << "  " << s.mean * scale << unit << "（それまでの" << s.nhistory << "回の平均）より、"
+                      << "標準偏差 " << s.stddev * scale << unit << "の" << s.zscore << "倍遅い\n";
+
+            for (auto const & phase : r.phases) {
+                std::cout << "    " << phase.first << ": " << phase.second << "ミリ秒\n";
+            }
+        }
+
+        cp.checkpoint("それ以外の処理", __LINE__);
+
+        cp.checkpoint_print();
+
+        return 0U;
+    }
+
+    std::uint64_t matchmode(boost::program_options::variables_map const & vm)
+    {
+        checkpoint::CheckPoint cp;
+
+        cp.checkpoint("処理開始", __LINE__);
+
+        if (!vm.count("patterns") || vm["patterns"].as<std::vector<std::string>>().size() != 2U) {
+            throw std::invalid_argument("--patternsで二人のプレイヤーの文字列を指定してください");
+        }
+
+        auto const & patterns = vm["patterns"].as<std::vector<std::string>>();
+
+        match::MatchConfig config;
+        config.a = patterns[0];
+        config.b = patterns[1];
+        config.bankrolla = config.bankrollb = vm["bankroll"].as<double>();
+        config.bias = vm["bias"].as<double>();
+        config.fraction = vm["fraction"].as<double>();
+        config.maxrounds = vm["max-rounds"].as<std::uint32_t>();
+        config.seed = vm["seed"].as<std::uint64_t>();
+        config.stake = vm["stake"].as<double>();
+        config.trials = vm["trials"].as<std::uint64_t>();
+
+        auto const & rule = vm["rule"].as<std::string>();
+        if (rule == "proportional") {
+            config.rule = match::Rule::PROPORTIONAL;
+        }
+        else if (rule == "martingale") {
+            config.rule = match::Rule::MARTINGALE;
+        }
+        else if (rule != "fixed") {
+            throw std::invalid_argument("不明な賭け方です: " + rule);
+        }
+
+        auto const begin = std::chrono::steady_clock::now();
+        auto const result(match::simulate(config));
+        auto const elapsed = std::chrono::duration<double>(std::chrono::steady_clock::now() - begin).count();
+
+        cp.checkpoint("勝負のシミュレーション", __LINE__);
+
+        auto const trials = static_cast<double>(result.trials);
+
+        std::cout << std::setprecision(3) << std::setiosflags(std::ios::fixed)
+                  << result.trials << "回の勝負（競争" << result.totalrounds << "回、"
+                  << static_cast<double>(result.totalrounds) / elapsed / 1.0E+6 << "百万回/秒）\n"
+                  << config.a << "（A）が破産する確率: " << static_cast<double>(result.ruina) / trials * 100.0 << "%\n"
+                  << config.b << "（B）が破産する確率: " << static_cast<double>(result.ruinb) / trials * 100.0 << "%\n"
+                  << config.maxrounds << "回の競争で決着しない確率: "
+                  << static_cast<double>(result.trials - result.ruina - result.ruinb) / trials * 100.0 << "%\n"
+                  << "Aの期待利益: " << result.profit << " (標準誤差: " << result.profitstderror << ")\n\n"
+                  << "勝負の長さ（競争の回数）\n";
+        printquantiles(result.lengths);
+
+        // 2のべき乗回目の競争の後のAの手持ちの平均
+        std::cout << "\nAの手持ちの平均の推移\n" << std::setprecision(3);
+        for (auto k = 1U;; k *= 2U) {
+            auto const round = std::min(k, config.maxrounds);
+            std::cout << round << "回目: " << result.trajectory[round] << '\n';
+            if (round == config.maxrounds) {
+                break;
+            }
+        }
+
+        cp.checkpoint("それ以外の処理", __LINE__);
+
+        cp.checkpoint_print();
+
+        return result.trials;
+    }
+
+    std::uint64_t mergestoremode(boost::program_options::variables_map const & vm)
+    {
+        if (!vm.count("merge-from")) {
+            throw std::invalid_argument("--merge-fromでまとめるファイルを指定してください");
+        }
+
+        auto const & filename = vm["db"].as<std::string>();
+        resultstore::ResultStore store(filename);
+
+        for (auto const & from : vm["merge-from"].as<std::vector<std::string>>()) {
+            auto const duplicates = store.merge(resultstore::ResultStore(from));
+            std::cout << from << " をまとめました（重複していた実行: " << duplicates << "個）\n";
+        }
+
+        store.write();
+
+        for (auto const & kv : store.entries()) {
+            std::cout << kv.second.config << ": " << kv.second.runs.size() << "回の実行, "
+                      << kv.second.trials() << "回の試行\n";
+        }
+
+        return 0U;
+    }
+
+    std::uint64_t multilengthmode(boost::program_options::variables_map const & vm)
+    {
+        checkpoint::CheckPoint cp;
+
+        cp.checkpoint("処理開始", __LINE__);
+
+        // モンテカルロ・シミュレーションを行う
+        auto const result(multilength::montecarlo(
+            vm["length"].as<std::uint32_t>(),
+            vm["horizon"].as<std::uint32_t>(),
+            vm["trials"].as<std::uint64_t>()));
+
+        cp.checkpoint("全ての長さの集計", __LINE__);
+
+        // 各文字列に対する期待値の表示
+        std::cout << std::setprecision(1) << std::setiosflags(std::ios::fixed);
+        for (auto len = 1U; len <= result.maxlen && len <= 4U; len++) {
+            for (auto code = 0U; code < (1U << len); code++) {
+                std::cout << pattern::tostring(code, len)
+                          << " が出るまでの期待値: "
+                          << static_cast<double>(result.firstsum[flips::offset(len) + code]) / static_cast<double>(result.trials)
+                          << "回\n";
+            }
+            std::cout << '\n';
+        }
+
+        // 各文字列のペアに対する勝率の表示
+        for (auto && wm : result.winmatrices) {
+            if (wm->len() > 3U) {
+                break;
+            }
+
+            printwinmatrix(*wm);
+            std::cout << '\n';
+        }
+
+        cp.checkpoint("それ以外の処理", __LINE__);
+
+        cp.checkpoint_print();
+
+        return result.trials;
+    }
+
+    std::uint64_t occurrencemode(boost::program_options::variables_map const & vm)
+    {
+        checkpoint::CheckPoint cp;
+
+        cp.checkpoint("処理開始", __LINE__);
+
+        auto const len = vm["length"].as<std::uint32_t>();
+        auto const horizon = vm["horizon"].as<std::uint32_t>();
+
+        // モンテカルロ・シミュレーションを行う
+        auto const result(occurrence::montecarlo(len, horizon, vm["trials"].as<std::uint64_t>()));
+
+        cp.checkpoint("出現回数の集計", __LINE__);
+
+        auto const npattern = 1U << len;
+        auto const trials = static_cast<double>(result.trials);
+
+        // 出現回数の統計を表示する関数オブジェクト
+        auto const print = [len, npattern, trials, &result](char const * title, occurrence::Statistics const & st) {
+            std::cout << title << '\n';
+            for (auto i = 0U; i < npattern; i++) {
+                std::cout << pattern::tostring(i, len)
+                          << " の出現回数の平均: " << st.mean(i, result.trials)
+                          << "回, 分散: " << st.variance(i, result.trials) << '\n';
+            }
+
+            if (npattern > 16U) {
+                return;
+            }
+
+            std::cout << "\n" << std::string(len + 1U, ' ');
+            for (auto j = 0U; j < npattern; j++) {
+                std::cout << pattern::tostring(j, len) << "  ";
+            }
+            std::cout << '\n';
+
+            for (auto i = 0U; i < npattern; i++) {
+                std::cout << pattern::tostring(i, len) << ' ';
+                for (auto j = 0U; j < npattern; j++) {
+                    if (i == j) {
+                        std::cout << std::string(len + 2U, ' ');
+                    }
+                    else {
+                        std::cout << static_cast<double>(st.morewins[i * npattern + j]) / trials * 100.0 << ' ';
+                    }
+                }
+                std::cout << '\n';
+            }
+            std::cout << '\n';
+        };
+
+        std::cout << horizon << "回の中での出現回数\n" << std::setprecision(3) << std::setiosflags(std::ios::fixed);
+        print("重なりを許して数えた場合", result.overlapping);
+        print("重なりを許さずに数えた場合", result.nonoverlapping);
+
+        cp.checkpoint("それ以外の処理", __LINE__);
+
+        cp.checkpoint_print();
+
+        return result.trials;
+    }
+
+    std::uint64_t offsetracesmode(boost::program_options::variables_map const & vm)
+    {
+        checkpoint::CheckPoint cp;
+
+        cp.checkpoint("処理開始", __LINE__);
+
+        auto const len = vm["length"].as<std::uint32_t>();
+        auto const horizon = vm["horizon"].as<std::uint32_t>();
+
+        // 記録されたUとDの列を読み込むか、乱数の種から生成する
+        flips::packedflips stream;
+        std::uint64_t nflips;
+        if (vm.count("input")) {
+            flipslog::FlipsLog const log(vm["input"].as<std::string>(), flipslog::toformat(vm["log-format"].as<std::string>()));
+            stream = log.words();
+            nflips = log.nflips();
+        }
+        else {
+            nflips = vm["stream-length"].as<std::uint64_t>();
+            stream.resize(static_cast<std::size_t>((nflips + flips::WORDBITS - 1U) / flips::WORDBITS));
+
+#ifdef HAVE_SSE2
+            myrandom::MyRandSfmt mr(1, 6);
+#else
+            myrandom::MyRand mr(1, 6);
+#endif
+            mr.seed(vm["seed"].as<std::uint64_t>());
+            for (auto && w : stream) {
+                w = flips::makerandomword(mr);
+            }
+        }
+
+        cp.checkpoint("UとDの列の準備", __LINE__);
+
+        occurrenceindex::OccurrenceIndex const index(stream, nflips, len);
+
+        cp.checkpoint("索引の作成", __LINE__);
+
+        winmatrix::WinMatrix wm(len, horizon);
+        auto const nrace = occurrenceindex::races(wm, index, vm["stride"].as<std::uint64_t>());
+
+        cp.checkpoint("競争の集計", __LINE__);
+
+        std::cout << std::setprecision(3) << std::setiosflags(std::ios::fixed)
+                  << nflips << "個のUかDの索引（1位置・1文字列当たり" << index.bitsperposition() << "ビット）から、"
+                  << nrace << "回の競争を集計しました\n";
+
+        // 文字列の数が少ないときは勝率を表示
+        if (len <= 3U) {
+            printwinmatrix(wm);
+        }
+
+        if (vm.count("output")) {
+            auto const filename = vm["output"].as<std::string>();
+            wm.write(filename);
+            std::cout << wm.trials() << "回の試行の結果を " << filename << " に書き出しました\n";
+        }
+
+        if (vm.count("columnar")) {
+            auto const filename = vm["columnar"].as<std::string>();
+            wm.writecolumnar(filename);
+            std::cout << wm.trials() << "回の試行の結果を列指向の形式で " << filename << " に書き出しました\n";
+        }
+
+        cp.checkpoint("それ以外の処理", __LINE__);
+
+        cp.checkpoint_print();
+
+        return nrace;
+    }
+
+    std::uint64_t orderingmode(boost::program_options::variables_map const & vm)
+    {
+        checkpoint::CheckPoint cp;
+
+        cp.checkpoint("処理開始", __LINE__);
+
+        auto const len = vm["length"].as<std::uint32_t>();
+
+        // モンテカルロ・シミュレーションを行う
+        auto const result(ordering::montecarlo(len, vm["horizon"].as<std::uint32_t>(), vm["trials"].as<std::uint64_t>()));
+
+        cp.checkpoint("出現順の集計", __LINE__);
+
+        auto const npattern = static_cast<std::uint32_t>(result.ranksum.size());
+        auto const trials = static_cast<double>(result.trials);
+
+        // 出現順の順列を表示する関数オブジェクト
+        auto const tostring = [len, npattern](std::uint32_t rank) {
+            std::string str;
+            for (auto const v : ordering::unrank(rank, npattern)) {
+                str += (str.empty() ? "" : " ") + pattern::tostring(v, len);
+            }
+
+            return str;
+        };
+
+        // 出現順の順列のうち、頻度の高いものを表示
+        std::cout << std::setprecision(4) << std::setiosflags(std::ios::fixed);
+        if (!result.histogram.empty()) {
+            std::vector<std::uint32_t> ranks(result.histogram.size());
+            for (auto k = 0U; k < ranks.size(); k++) {
+                ranks[k] = k;
+            }
+
+            auto const ntop = std::min<std::size_t>(10U, ranks.size());
+            std::partial_sort(ranks.begin(), ranks.begin() + ntop, ranks.end(), [&result](auto l, auto r) {
+                return result.histogram[l] > result.histogram[r];
+            });
+
+            std::cout << "出現順の順列の種類: " << ranks.size() << '\n';
+            for (auto k = 0U; k < ntop; k++) {
+                std::cout << tostring(ranks[k]) << ": "
+                          << static_cast<double>(result.histogram[ranks[k]]) / trials * 100.0 << "%\n";
+            }
+            std::cout << '\n';
+        }
+
+        // 各文字列の平均順位を表示
+        if (npattern <= 64U) {
+            for (auto i = 0U; i < npattern; i++) {
+                std::cout << pattern::tostring(i, len) << " の平均順位: "
+                          << static_cast<double>(result.ranksum[i]) / trials + 1.0 << '\n';
+            }
+        }
+
+        // CSVファイルに書き出す
+        if (vm.count("output")) {
+            auto const filename = vm["output"].as<std::string>();
+            std::ofstream ofs(filename);
+            if (!ofs) {
+                throw std::runtime_error("ファイルを開けませんでした: " + filename);
+            }
+
+            ofs << std::setprecision(10);
+            if (!result.histogram.empty()) {
+                ofs << "rank,permutation,count\n";
+                for (auto k = 0U; k < result.histogram.size(); k++) {
+                    ofs << k << ',' << tostring(k) << ',' << result.histogram[k] << '\n';
+                }
+            }
+            else {
+                ofs << "pattern,meanrank\n";
+                for (auto i = 0U; i < npattern; i++) {
+                    ofs << pattern::tostring(i, len) << ','
+                        << static_cast<double>(result.ranksum[i]) / trials + 1.0 << '\n';
+                }
+            }
+        }
+
+        cp.checkpoint("それ以外の処理", __LINE__);
+
+        cp.checkpoint_print();
+
+        return result.trials;
+    }
+
+    void printwinmatrix(winmatrix::WinMatrix const & wm)
+    {
+        auto const len = wm.len();
+
+        std::cout << std::setprecision(1) << std::setiosflags(std::ios::fixed) << std::string(len + 1U, ' ');
+        for (auto j = 0U; j < wm.npattern(); j++) {
+            std::cout << pattern::tostring(j, len) << "  ";
+        }
+        std::cout << '\n';
+
+        for (auto i = 0U; i < wm.npattern(); i++) {
+            std::cout << pattern::tostring(i, len) << ' ';
+            for (auto j = 0U; j < wm.npattern(); j++) {
+                if (i == j) {
+                    std::cout << std::string(len + 2U, ' ');
+                }
+                else {
+                    std::cout << static_cast<double>(wm.count(i, j)) / static_cast<double>(wm.trials()) * 100.0
+                              << ' ';
+                }
+            }
+            std::cout << '\n';
+        }
+    }
+
+    void printquantiles(histogram::LogHistogram const & hist)
+    {
+        std::cout << std::setprecision(1) << std::setiosflags(std::ios::fixed)
+                  << "平均: " << hist.mean() << "回, 標準偏差: " << hist.stddev()
+                  << ", 最小: " << hist.min() << "回, 最大: " << hist.max() << "回\n"
+                  << "p50: " << hist.quantile(0.5) << "回, p90: " << hist.quantile(0.9)
+                  << "回, p99: " << hist.quantile(0.99) << "回, p99.9: " << hist.quantile(0.999) << "回\n";
+
+        if (hist.overflow()) {
+            std::cout << "2^" << histogram::LogHistogram::MAXBITS << "回以上で区間に入らなかった値: " << hist.overflow() << "個\n";
+        }
+    }
+
+    void printsimulation(simulator::RunConfig const & config, simulator::Result const & result)
+    {
+        std::cout << std::setprecision(3) << std::setiosflags(std::ios::fixed);
+        for (auto p = 0U; p < config.patterns.size(); p++) {
+            std::cout << config.patterns[p] << " が出るまでの期待値: " << result.waitingtime[p] << "回\n";
+        }
+
+        for (auto const & pair : result.pairs) {
+            std::cout << config.patterns[pair.a] << " が " << config.patterns[pair.b]
+                      << " より先に出る確率: " << pair.probability * 100.0 << "%";
+            if (result.trials) {
+                std::cout << " (標準誤差: " << pair.stderror * 100.0 << "%)";
+            }
+            std::cout << '\n';
+        }
+    }
+
+    boost::optional<boost::program_options::variables_map> parseoptions(int argc, char * argv[])
+    {
+        namespace po = boost::program_options;
+
+        po::options_description desc("オプション");
+        desc.add_options()
+            ("help,h", "ヘルプを表示する")
+            ("mode,m", po::value<std::string>()->default_value("default"), "実行するモード（default, winmatrix, counter, ordering, occurrence, multilength, coverage, waitingtime, bootstrap, simulate, daemon, deadline, refine, mergestore, replay, corpus, corpuseval, offsetraces, match, batch, conditional, ledger）")
+            ("length,k", po::value<std::uint32_t>()->default_value(3U), "文字列の長さ")
+            ("bias", po::value<double>()->default_value(0.5), "Uが出る確率（simulate, deadline, refine, batch, conditional, match, counterモードで使う。それ以外のモードは常に1/2で、0.5以外を指定するとエラー）")
+            ("horizon", po::value<std::uint32_t>()->default_value(RANDNUMTABLELEN), "UかDの文字列の長さ")
+            ("trials,n", po::value<std::uint64_t>()->default_value(MCMAX), "モンテカルロ・シミュレーションの試行回数（defaultモードは常に既定値で、指定するとエラー）")
+            ("sample-pairs", po::value<std::uint64_t>()->default_value(0U), "集計する文字列のペアの数（0の場合は全てのペア）")
+            ("patterns", po::value<std::vector<std::string>>()->multitoken(), "対象とする文字列（例: --patterns DUU UUU）")
+            ("resamples", po::value<std::uint32_t>()->default_value(1000U), "ブートストラップ法の再標本の数")
+            ("check-threads", "bootstrapモードで、1スレッドで試行と再標本化をやり直し、結果が一致することを確かめる")
+            ("seed", po::value<std::uint64_t>()->default_value(1U), "乱数の種（bootstrap, simulate, deadline, corpus, offsetraces, match, conditionalモードと、--sample-pairsのペアの抽出で使う）")
+            ("deadline", po::value<std::uint32_t>()->default_value(200U), "deadlineモードの制限時間（ミリ秒）")
+            ("engine", po::value<std::string>()->default_value("montecarlo"), "計算の方法（montecarlo, exact）")
+            ("input,i", po::value<std::string>(), "replayモードで読み込む記録されたUとDの列（またはサイコロの目の列）のファイル、またはcorpusevalモードで読み込むコーパスのファイル、またはbatchモードで読み込む実験の設定のファイル")
+            ("log-format", po::value<std::string>()->default_value("auto"), "--inputの記録の形式（auto: 'U'か'D'があればud、なければdice, ud: 'U'と'D'の列で数字は読み飛ばす, dice: サイコロの目の列で文字は読み飛ばす）")
+            ("pattern-sets", po::value<std::vector<std::string>>()->multitoken(), "corpusevalモードの文字列の組（例: --pattern-sets DUU,UUU UDU,DDU）")
+            ("stream-length", po::value<std::uint64_t>()->default_value(10000000U), "offsetracesモードで生成するUとDの列の長さ（--inputを指定しない場合）")
+            ("stride", po::value<std::uint64_t>()->default_value(1U), "offsetracesモードで競争を始める位置の間隔")
+            ("cutoff", po::value<std::uint32_t>()->default_value(4U), "conditionalモードで実際に生成するUかDの個数の上限（残りは厳密な吸収確率で置き換える）")
+            ("bankroll", po::value<double>()->default_value(100.0), "matchモードの各プレイヤーの最初の手持ち")
+            ("stake", po::value<double>()->default_value(1.0), "matchモードの基本の賭け金")
+            ("rule", po::value<std::string>()->default_value("fixed"), "matchモードのAの賭け方（fixed, proportional, martingale）")
+            ("fraction", po::value<double>()->default_value(0.1), "matchモードでproportionalの場合の手持ちに対する賭け金の割合")
+            ("max-rounds", po::value<std::uint32_t>()->default_value(1000U), "matchモードの一回の勝負の競争の回数の上限")
+            ("store", po::value<std::string>(), "試行毎の出現位置をメモリマップするファイル名")
+            ("db", po::value<std::string>()->default_value("results.kmc"), "refineモードとmergestoreモードの結果の保存ファイル")
+            ("merge-from", po::value<std::vector<std::string>>()->multitoken(), "mergestoreモードでまとめるファイル")
+            ("socket", po::value<std::string>()->default_value("/tmp/kakeguruitwin.sock"), "daemonモードのソケットのパス")
+            ("cache-size", po::value<std::size_t>()->default_value(100000U), "daemonモードでキャッシュする結果の件数の上限（超えたら最も長く使われていないものから捨てる）")
+            ("max-trials", po::value<std::uint64_t>()->default_value(100000000U), "daemonモードで問い合わせに指定できる試行回数の上限")
+            ("max-horizon", po::value<std::uint32_t>()->default_value(10000U), "daemonモードで問い合わせに指定できるUかDの文字列の長さの上限")
+            ("output,o", po::value<std::string>(), "出力ファイル名")
+            ("columnar", po::value<std::string>(), "メモリマップしてそのまま読める列指向のバイナリ形式で結果を書き出すファイル名（winmatrix, replay, offsetraces, simulateモードで使う）")
+            ("ledger", po::value<std::string>(), "実行の終わりに性能の記録（ホスト、CPU、スレッド数、区間毎の時間、最大のメモリ使用量など）を追記するファイル、またはledgerモードで読み込むファイル")
+            ("sigma", po::value<double>()->default_value(3.0), "ledgerモードで、同じ設定のそれまでの実行の平均より標準偏差の何倍以上遅い実行を表示するか")
+            ("min-history", po::value<std::uint64_t>()->default_value(5U), "ledgerモードで比較に必要な、同じ設定のそれまでの実行の最小の数")
+            ("profile", "スレッド毎のCPU時間で標本を取り、チェックポイントの区間毎と関数毎の時間を終了時に表示する（Linuxのみ）")
+            ("profile-hz", po::value<std::uint32_t>()->default_value(250U), "--profileで各スレッドの1CPU秒当たりに取る標本の数（カーネルのタイマ割り込みの頻度が上限）")
+            ("profile-out", po::value<std::string>()->default_value("profile.folded"), "--profileでフレームグラフのための折りたたまれたスタックを書き出すファイル名");
+
+        po::variables_map vm;
+        po::store(po::parse_command_line(argc, argv, desc), vm);
+        po::notify(vm);
+
+        if (vm.count("help")) {
+            std::cout << desc << std::endl;
+            return boost::none;
+        }
+
+        // Uが出る確率を1/2に固定して生成するモードで、--biasが黙って無視されないようにする
+        static std::array<char const *, 7U> const biased = {
+            "batch", "conditional", "counter", "deadline", "match", "refine", "simulate"
+        };
+
+        auto const & mode = vm["mode"].as<std::string>();
+        if (vm["bias"].as<double>() != 0.5 &&
+            std::find_if(biased.begin(), biased.end(), [&mode](auto const m) { return mode == m; }) == biased.end()) {
+            throw std::invalid_argument(mode + "モードはUが出る確率が常に1/2なので、--biasは指定できません");
+        }
+
+        // defaultモードの試行回数はMCMAXに固定されているので、--trialsが黙って無視され、性能の記録と食い違わないようにする
+        if (mode == "default" && !vm["trials"].defaulted()) {
+            throw std::invalid_argument("defaultモードは試行回数が常に" + std::to_string(MCMAX) + "回なので、--trialsは指定できません");
+        }
+
+        return vm;
+    }
+
+    std::uint64_t refinemode(boost::program_options::variables_map const & vm)
+    {
+        checkpoint::CheckPoint cp;
+
+        cp.checkpoint("処理開始", __LINE__);
+
+        if (!vm.count("patterns")) {
+            throw std::invalid_argument("--patternsで文字列を指定してください");
+        }
+
+        simulator::RunConfig config;
+        config.bias = vm["bias"].as<double>();
+        config.horizon = vm["horizon"].as<std::uint32_t>();
+        config.patterns = vm["patterns"].as<std::vector<std::string>>();
+        config.trials = vm["trials"].as<std::uint64_t>();
+
+        auto const & filename = vm["db"].as<std::string>();
+        resultstore::ResultStore store(filename);
+        auto & entry = store.entry(resultstore::ResultStore::configstring(config));
+
+        cp.checkpoint("保存された結果の読み込み", __LINE__);
+
+        // 新しい試行を加える
+        simulator::Simulator sim(tbb::task_arena::automatic);
+        auto const added = resultstore::refine(sim, config, entry).trials;
+
+        cp.checkpoint("計算", __LINE__);
+
+        store.write();
+
+        auto const trials = static_cast<double>(entry.trials());
+        std::cout << entry.config << '\n'
+                  << entry.runs.size() << "回の実行, " << entry.trials() << "回の試行\n"
+                  << std::setprecision(3) << std::setiosflags(std::ios::fixed);
+
+        for (auto p = 0U; p < config.patterns.size(); p++) {
+            std::cout << config.patterns[p] << " が出るまでの期待値: "
+                      << static_cast<double>(entry.firstsum(p)) / trials << "回\n";
+        }
+
+        // 全ての順序付きのペア（Simulatorと同じ順）
+        auto k = 0U;
+        for (auto i = 0U; i < config.patterns.size(); i++) {
+            for (auto j = 0U; j < config.patterns.size(); j++) {
+                if (i == j) {
+                    continue;
+                }
+
+                auto const prob = static_cast<double>(entry.wins(2U * k)) / trials;
+                std::cout << config.patterns[i] << " が " << config.patterns[j]
+                          << " より先に出る確率: " << prob * 100.0 << "% (標準誤差: "
+                          << std::sqrt(prob * (1.0 - prob) / trials) * 100.0 << "%)\n";
+                k++;
+            }
+        }
+
+        cp.checkpoint("それ以外の処理", __LINE__);
+
+        cp.checkpoint_print();
+
+        return added;
+    }
+
+    std::uint64_t replaymode(boost::program_options::variables_map const & vm)
+    {
+        checkpoint::CheckPoint cp;
+
+        cp.checkpoint("処理開始", __LINE__);
+
+        if (!vm.count("input")) {
+            throw std::invalid_argument("--inputで記録されたUとDの列のファイルを指定してください");
+        }
+
+        auto const len = vm["length"].as<std::uint32_t>();
+        auto const horizon = vm["horizon"].as<std::uint32_t>();
+        auto const nsample = vm["sample-pairs"].as<std::uint64_t>();
+
+        // 勝利回数の総和を保持するオブジェクト
+        auto const wm = nsample ?
+            std::make_unique<winmatrix::WinMatrix>(len, horizon, winmatrix::samplepairs(len, nsample, vm["seed"].as<std::uint64_t>())) :
+            std::make_unique<winmatrix::WinMatrix>(len, horizon);
+
+        cp.checkpoint("初期化", __LINE__);
+
+        auto const begin = std::chrono::steady_clock::now();
+        flipslog::FlipsLog const log(vm["input"].as<std::string>(), flipslog::toformat(vm["log-format"].as<std::string>()));
+        auto const elapsed = std::chrono::duration<double>(std::chrono::steady_clock::now() - begin).count();
+
+        cp.checkpoint("ファイルの読み込み", __LINE__);
+
+        auto const nsegment = winmatrix::replay(*wm, log.words(), log.nflips());
+        if (!nsegment) {
+            throw std::runtime_error("UかDの数がUかDの文字列の長さより少ないため、集計できません");
+        }
+
+        cp.checkpoint("勝利回数の集計", __LINE__);
+
+        std::cout << std::setprecision(3) << std::setiosflags(std::ios::fixed)
+                  << log.bytes() << "バイトから" << log.nflips() << "個のUかDを"
+                  << (log.format() == flipslog::Format::DICE ? "サイコロの目として" : "")
+                  << "読み込みました（"
+                  << static_cast<double>(log.bytes()) / elapsed / 1.0E+9 << "GB/s）\n"
+                  << horizon << "回ずつの" << nsegment << "区間を集計しました\n";
+
+        // 文字列の数が少ないときは勝率を表示
+        if (wm->pairs().empty() && len <= 3U) {
+            printwinmatrix(*wm);
+        }
+
+        // 指定された場合はバイナリファイルに書き出す
+        if (vm.count("output")) {
+            auto const filename = vm["output"].as<std::string>();
+            wm->write(filename);
+            std::cout << wm->trials() << "回の試行の結果を " << filename << " に書き出しました\n";
+        }
+
+        if (vm.count("columnar")) {
+            auto const filename = vm["columnar"].as<std::string>();
+            wm->writecolumnar(filename);
+            std::cout << wm->trials() << "回の試行の結果を列指向の形式で " << filename << " に書き出しました\n";
+        }
+
+        cp.checkpoint("それ以外の処理", __LINE__);
+
+        cp.checkpoint_print();
+
+        return wm->trials();
+    }
+
+    std::uint64_t runmode(boost::program_options::variables_map const & vm)
+    {
+        auto const & mode = vm["mode"].as<std::string>();
+
+        if (mode == "winmatrix") {
+            return winmatrixmode(vm);
+        }
+        else if (mode == "batch") {
+            return batchmode(vm);
+        }
+        else if (mode == "bootstrap") {
+            return bootstrapmode(vm);
+        }
+        else if (mode == "conditional") {
+            return conditionalmode(vm);
+        }
+        else if (mode == "corpus") {
+            return corpusmode(vm);
+        }
+        else if (mode == "corpuseval") {
+            return corpusevalmode(vm);
+        }
+        else if (mode == "counter") {
+            return countermode(vm);
+        }
+        else if (mode == "offsetraces") {
+            return offsetracesmode(vm);
+        }
+        else if (mode == "ordering") {
+            return orderingmode(vm);
+        }
+        else if (mode == "occurrence") {
+            return occurrencemode(vm);
+        }
+        else if (mode == "daemon") {
+            return daemonmode(vm);
+        }
+        else if (mode == "deadline") {
+            return deadlinemode(vm);
+        }
+        else if (mode == "ledger") {
+            return ledgermode(vm);
+        }
+        else if (mode == "match") {
+            return matchmode(vm);
+        }
+        else if (mode == "mergestore") {
+            return mergestoremode(vm);
+        }
+        else if (mode == "multilength") {
+            return multilengthmode(vm);
+        }
+        else if (mode == "coverage") {
+            return coveragemode(vm);
+        }
+        else if (mode == "refine") {
+            return refinemode(vm);
+        }
+        else if (mode == "replay") {
+            return replaymode(vm);
+        }
+        else if (mode == "simulate") {
+            return simulatemode(vm);
+        }
+        else if (mode == "waitingtime") {
+            return waitingtimemode(vm);
+        }
+        else {
+            throw std::invalid_argument("不明なモードです: " + mode);
+        }
+    }
+
+    std::uint64_t simulatemode(boost::program_options::variables_map const & vm)
+    {
+        checkpoint::CheckPoint cp;
+
+        cp.checkpoint("処理開始", __LINE__);
+
+        if (!vm.count("patterns")) {
+            throw std::invalid_argument("--patternsで文字列を指定してください");
+        }
+
+        simulator::RunConfig config;
+        config.bias = vm["bias"].as<double>();
+        config.horizon = vm["horizon"].as<std::uint32_t>();
+        config.patterns = vm["patterns"].as<std::vector<std::string>>();
+        config.seed = vm["seed"].as<std::uint64_t>();
+        config.trials = vm["trials"].as<std::uint64_t>();
+
+        auto const & engine = vm["engine"].as<std::string>();
+        if (engine == "exact") {
+            config.engine = simulator::Engine::EXACT;
+        }
+        else if (engine != "montecarlo") {
+            throw std::invalid_argument("不明な計算の方法です: " + engine);
+        }
+
+        simulator::Simulator sim(tbb::task_arena::automatic);
+
+        cp.checkpoint("シミュレータの初期化", __LINE__);
+
+        auto const result(sim.run(config));
+
+        cp.checkpoint("計算", __LINE__);
+
+        printsimulation(config, result);
+
+        if (vm.count("columnar")) {
+            auto const filename = vm["columnar"].as<std::string>();
+            writesimulation(filename, config, result);
+            std::cout << "結果を列指向の形式で " << filename << " に書き出しました\n";
+        }
+
+        cp.checkpoint("それ以外の処理", __LINE__);
+
+        cp.checkpoint_print();
+
+        return result.trials;
+    }
+
+    std::uint64_t waitingtimemode(boost::program_options::variables_map const & vm)
+    {
+        checkpoint::CheckPoint cp;
+
+        cp.checkpoint("処理開始", __LINE__);
+
+        auto const len = vm["length"].as<std::uint32_t>();
+        auto const trials = vm["trials"].as<std::uint64_t>();
+
+        // モンテカルロ・シミュレーションを行う
+        auto const result(waitingtime::montecarlo(len, trials));
+
+        cp.checkpoint("待ち時間の集計", __LINE__);
+
+        auto const npattern = static_cast<std::uint32_t>(result.patterns.size());
+
+        // 文字列の数が少ないときは全て表示
+        if (npattern <= 16U) {
+            for (auto i = 0U; i < npattern; i++) {
+                std::cout << pattern::tostring(i, len) << " が出るまでの回数\n";
+                printquantiles(result.patterns[i]);
+            }
+            std::cout << '\n';
+        }
+
+        if (npattern <= 8U) {
+            auto k = 0U;
+            for (auto i = 0U; i < npattern; i++) {
+                for (auto j = i + 1U; j < npattern; j++) {
+                    std::cout << pattern::tostring(i, len) << " と " << pattern::tostring(j, len)
+                              << " の決着までの回数\n";
+                    printquantiles(result.pairs[k++]);
+                }
+            }
+        }
+
+        // CSVファイルに書き出す
+        if (vm.count("output")) {
+            auto const filename = vm["output"].as<std::string>();
+            std::ofstream ofs(filename);
+            if (!ofs) {
+                throw std::runtime_error("ファイルを開けませんでした: " + filename);
+            }
+
+            // 一つのヒストグラムを書き出す関数オブジェクト
+            auto const write = [&ofs](std::string const & a, std::string const & b, histogram::LogHistogram const & hist) {
+                ofs << a << ',' << b << ','
+                    << hist.mean() << ',' << hist.stddev() << ',' << hist.min() << ',' << hist.max() << ','
+                    << hist.quantile(0.5) << ',' << hist.quantile(0.9) << ','
+                    << hist.quantile(0.99) << ',' << hist.quantile(0.999) << '\n';
+            };
+
+            ofs << std::setprecision(10) << "a,b,mean,stddev,min,max,p50,p90,p99,p99.9\n";
+            for (auto i = 0U; i < npattern; i++) {
+                write(pattern::tostring(i, len), "", result.patterns[i]);
+            }
+
+            auto k = 0U;
+            for (auto i = 0U; i < npattern && !result.pairs.empty(); i++) {
+                for (auto j = i + 1U; j < npattern; j++) {
+                    write(pattern::tostring(i, len), pattern::tostring(j, len), result.pairs[k++]);
+                }
+            }
+        }
+
+        cp.checkpoint("それ以外の処理", __LINE__);
+
+        cp.checkpoint_print();
+
+        return trials;
+    }
+
+    std::uint64_t winmatrixmode(boost::program_options::variables_map const & vm)
+    {
+        checkpoint::CheckPoint cp;
+
+        cp.checkpoint("処理開始", __LINE__);
+
+        auto const len = vm["length"].as<std::uint32_t>();
+        auto const horizon = vm["horizon"].as<std::uint32_t>();
+        auto const nsample = vm["sample-pairs"].as<std::uint64_t>();
+        auto const filename = vm.count("output") ? vm["output"].as<std::string>() : std::string("winmatrix.bin");
+
+        // 勝利回数の総和を保持するオブジェクト
+        auto const wm = nsample ?
+            std::make_unique<winmatrix::WinMatrix>(len, horizon, winmatrix::samplepairs(len, nsample, vm["seed"].as<std::uint64_t>())) :
+            std::make_unique<winmatrix::WinMatrix>(len, horizon);
+
+        // モンテカルロ・シミュレーションを行う
+        winmatrix::montecarlo(*wm, vm["trials"].as<std::uint64_t>());
+
+        cp.checkpoint("勝利回数の集計", __LINE__);
+
+        // 文字列の数が少ないときは勝率を表示
+        if (wm->pairs().empty() && len <= 3U) {
+            printwinmatrix(*wm);
+        }
+
+        // バイナリファイルに書き出す
+        wm->write(filename);
+        std::cout << wm->trials() << "回の試行の結果を " << filename << " に書き出しました\n";
+
+        if (vm.count("columnar")) {
+            auto const columnarfile = vm["columnar"].as<std::string>();
+            wm->writecolumnar(columnarfile);
+            std::cout << wm->trials() << "回の試行の結果を列指向の形式で " << columnarfile << " に書き出しました\n";
+        }
+
+        cp.checkpoint("それ以外の処理", __LINE__);
+
+        cp.checkpoint_print();
+
+        return wm->trials();
+    }
+
+    void writesimulation(std::string const & filename, simulator::RunConfig const & config, simulator::Result const & result)
+    {
+        columnar::Writer writer;
+
+        writer.add<double>("bias", { config.bias });
+        writer.add<std::uint32_t>("horizon", { config.horizon });
+        writer.add<std::uint64_t>("trials", { result.trials });
+        writer.add("pattern", config.patterns);
+        writer.add("waitingtime", result.waitingtime);
+
+        // ペア毎の結果
+        auto const npair = result.pairs.size();
+        std::vector<std::uint32_t> a(npair), b(npair);
+        std::vector<double> probability(npair), stderror(npair);
+        std::vector<std::uint64_t> winsa(npair), winsb(npair);
+        for (auto k = 0U; k < npair; k++) {
+            a[k] = result.pairs[k].a;
+            b[k] = result.pairs[k].b;
+            probability[k] = result.pairs[k].probability;
+            stderror[k] = result.pairs[k].stderror;
+            winsa[k] = result.pairs[k].winsa;
+            winsb[k] = result.pairs[k].winsb;
+        }
+
+        writer.add("a", a);
+        writer.add("b", b);
+        writer.add("probability", probability);
+        writer.add("stderror", stderror);
+        writer.add("winsa", winsa);
+        writer.add("winsb", winsb);
+
+        writer.write(filename);
+    }
+}
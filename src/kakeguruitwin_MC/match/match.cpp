@@ -0,0 +1,302 @@
+﻿/*! \file match.cpp
+    \brief 競争を何回も繰り返し、賭け金の増減を追う勝負全体のシミュレーションの実装
+
+    Copyright © 2017 @dc1394 All Rights Reserved.
+    This software is released under the BSD 2-Clause License.
+*/
+
+#include "match.h"
+#include "../flips/patternscan.h"
+#ifdef HAVE_SSE2
+    #include "../myrandom/myrandsfmt.h"
+#else
+    #include "../myrandom/myrand.h"
+#endif
+#include <algorithm>                            // for std::max, std::min
+#include <cmath>                                // for std::sqrt
+#include <stdexcept>                            // for std::invalid_argument
+#include <tbb/blocked_range.h>                  // for tbb::blocked_range
+#include <tbb/enumerable_thread_specific.h>     // for tbb::enumerable_thread_specific
+#include <tbb/parallel_for.h>                   // for tbb::parallel_for
+#include <tbb/partitioner.h>                    // for tbb::simple_partitioner
+
+namespace match {
+    namespace {
+#ifdef HAVE_SSE2
+        using myrand = myrandom::MyRandSfmt;
+#else
+        using myrand = myrandom::MyRand;
+#endif
+
+        //! A global variable (constant expression).
+        /*!
+            乱数の種を指定した場合に、同じ種から乱数列を作り直す勝負の数
+        */
+        static auto constexpr CHUNK = 1024U;
+
+        //! An enumeration.
+        /*!
+            一回の競争の結果
+        */
+        enum class Outcome {
+            //! プレイヤーAの勝ち
+            AWIN,
+
+            //! プレイヤーBの勝ち
+            BWIN,
+
+            //! 引き分け（二つの文字列が同時に出現した）
+            TIE
+        };
+
+        //! A struct.
+        /*!
+            スレッド毎の集計結果
+        */
+        struct Accumulator final {
+            //! A constructor.
+            /*!
+                唯一のコンストラクタ
+                \param maxrounds 一回の勝負の競争の回数の上限
+            */
+            explicit Accumulator(std::uint32_t maxrounds)
+                : activesum(maxrounds + 1U, 0.0),
+                  endsum(maxrounds + 1U, 0.0),
+                  profitsq(0.0),
+                  profitsum(0.0),
+                  rounds(0U),
+                  ruina(0U),
+                  ruinb(0U)
+            {
+            }
+
+            //! A public member variable.
+            /*!
+                k回目の競争の後に続いている勝負の、プレイヤーAの手持ちの和
+            */
+            std::vector<double> activesum;
+
+            //! A public member variable.
+            /*!
+                k回目の競争で終わった勝負の、プレイヤーAの最後の手持ちの和
+            */
+            std::vector<double> endsum;
+
+            //! A public member variable.
+            /*!
+                勝負の長さの分布
+            */
+            histogram::LogHistogram lengths;
+
+            //! A public member variable.
+            /*!
+                プレイヤーAの利益の2乗の和
+            */
+            double profitsq;
+
+            //! A public member variable.
+            /*!
+                プレイヤーAの利益の和
+            */
+            double profitsum;
+
+            //! A public member variable.
+            /*!
+                競争の回数の合計
+            */
+            std::uint64_t rounds;
+
+            //! A public member variable.
+            /*!
+                プレイヤーAが破産した勝負の数
+            */
+            std::uint64_t ruina;
+
+            //! A public member variable.
+            /*!
+                プレイヤーBが破産した勝負の数
+            */
+            std::uint64_t ruinb;
+        };
+
+        //! A function.
+        /*!
+            二つの文字列のどちらが先に出現するかの競争を一回行う（打ち切らない）
+            \param src UとDの乱数列
+            \param a プレイヤーAの文字列
+            \param b プレイヤーBの文字列
+            \return 競争の結果
+        */
+        inline Outcome race(flips::FlipSource<myrand> & src, flips::Target const & a, flips::Target const & b)
+        {
+            // 直近のUとDを表すビット列
+            auto window = 0U;
+
+            for (auto t = 1U;; t++) {
+                window = (window << 1) | src.next();
+
+                auto const wa = flips::matches(a, window, t);
+                auto const wb = flips::matches(b, window, t);
+                if (wa || wb) {
+                    return wa && wb ? Outcome::TIE : (wa ? Outcome::AWIN : Outcome::BWIN);
+                }
+            }
+        }
+    }
+
+    // #region 非メンバ関数
+
+    MatchResult simulate(MatchConfig const & config)
+    {
+        auto const a = flips::maketarget(config.a);
+        auto const b = flips::maketarget(config.b);
+
+        if (config.a == config.b) {
+            throw std::invalid_argument("同じ文字列同士では勝負できません");
+        }
+
+        if (!(config.bias > 0.0 && config.bias < 1.0)) {
+            throw std::invalid_argument("Uが出る確率は0より大きく1より小さくなければなりません");
+        }
+
+        if (!(config.stake > 0.0) || config.bankrolla < config.stake || config.bankrollb < config.stake) {
+            throw std::invalid_argument("賭け金は正で、最初の手持ちは賭け金以上でなければなりません");
+        }
+
+        if (config.rule == Rule::PROPORTIONAL && !(config.fraction > 0.0 && config.fraction <= 1.0)) {
+            throw std::invalid_argument("手持ちに対する賭け金の割合は0より大きく1以下でなければなりません");
+        }
+
+        if (!config.maxrounds || !config.trials) {
+            throw std::invalid_argument("競争の回数の上限と勝負の回数は1以上でなければなりません");
+        }
+
+        auto const threshold = flips::biasthreshold(config.bias);
+
+        // スレッド毎の自作乱数クラスのオブジェクト
+        tbb::enumerable_thread_specific<myrand> mrs(1, 6);
+
+        // スレッド毎の集計結果
+        tbb::enumerable_thread_specific<Accumulator> accs(config.maxrounds);
+
+        auto const body = [&](tbb::blocked_range<std::uint64_t> const & range) {
+            auto & mr = mrs.local();
+            auto & acc = accs.local();
+
+            if (config.seed) {
+                mr.seed(flips::chunkseed(config.seed, range.begin()));
+            }
+
+            flips::FlipSource<myrand> src(mr, threshold);
+
+            for (auto n = range.begin(); n != range.end(); ++n) {
+                auto ba = config.bankrolla;
+                auto bb = config.bankrollb;
+                auto martingale = config.stake;
+
+                acc.activesum[0] += ba;
+
+                auto r = 0U;
+                while (r < config.maxrounds && ba >= config.stake && bb >= config.stake) {
+                    double bet;
+                    switch (config.rule) {
+                    case Rule::FIXED:
+                        bet = config.stake;
+                        break;
+
+                    case Rule::PROPORTIONAL:
+                        bet = std::max(config.fraction * ba, config.stake);
+                        break;
+
+                    default:
+                        bet = martingale;
+                        break;
+                    }
+
+                    // 賭け金は二人の手持ちを超えない
+                    bet = std::min(bet, std::min(ba, bb));
+
+                    switch (race(src, a, b)) {
+                    case Outcome::AWIN:
+                        ba += bet;
+                        bb -= bet;
+                        martingale = config.stake;
+                        break;
+
+                    case Outcome::BWIN:
+                        ba -= bet;
+                        bb += bet;
+                        martingale *= 2.0;
+                        break;
+
+                    default:
+                        break;
+                    }
+
+                    acc.activesum[++r] += ba;
+                }
+
+                acc.endsum[r] += ba;
+                acc.lengths.record(r);
+                acc.rounds += r;
+
+                if (ba < config.stake) {
+                    acc.ruina++;
+                }
+                else if (bb < config.stake) {
+                    acc.ruinb++;
+                }
+
+                auto const profit = ba - config.bankrolla;
+                acc.profitsum += profit;
+                acc.profitsq += profit * profit;
+            }
+        };
+
+        if (config.seed) {
+            // 勝負の塊の分け方をスレッドの割り当てによらず一定にし、結果を再現できるようにする
+            tbb::parallel_for(tbb::blocked_range<std::uint64_t>(0U, config.trials, CHUNK), body, tbb::simple_partitioner());
+        }
+        else {
+            tbb::parallel_for(tbb::blocked_range<std::uint64_t>(0U, config.trials, 256U), body);
+        }
+
+        // スレッド毎の集計結果を足し合わせる
+        Accumulator total(config.maxrounds);
+        for (auto const & acc : accs) {
+            for (auto k = 0U; k <= config.maxrounds; k++) {
+                total.activesum[k] += acc.activesum[k];
+                total.endsum[k] += acc.endsum[k];
+            }
+
+            total.lengths.merge(acc.lengths);
+            total.profitsq += acc.profitsq;
+            total.profitsum += acc.profitsum;
+            total.rounds += acc.rounds;
+            total.ruina += acc.ruina;
+            total.ruinb += acc.ruinb;
+        }
+
+        auto const trials = static_cast<double>(config.trials);
+
+        MatchResult result;
+        result.lengths = total.lengths;
+        result.profit = total.profitsum / trials;
+        result.profitstderror = std::sqrt(std::max(total.profitsq / trials - result.profit * result.profit, 0.0) / trials);
+        result.ruina = total.ruina;
+        result.ruinb = total.ruinb;
+        result.totalrounds = total.rounds;
+        result.trials = config.trials;
+
+        // 終わった勝負は最後の手持ちのまま残るものとして、k回目の競争の後の平均を求める
+        auto ended = 0.0;
+        for (auto k = 0U; k <= config.maxrounds; k++) {
+            result.trajectory.push_back((total.activesum[k] + ended) / trials);
+            ended += total.endsum[k];
+        }
+
+        return result;
+    }
+
+    // #endregion 非メンバ関数
+}
@@ -0,0 +1,174 @@
+﻿/*! \file match.h
+    \brief 競争を何回も繰り返し、賭け金の増減を追う勝負全体のシミュレーションの宣言
+
+    Copyright © 2017 @dc1394 All Rights Reserved.
+    This software is released under the BSD 2-Clause License.
+*/
+
+#ifndef _MATCH_H_
+#define _MATCH_H_
+
+#pragma once
+
+#include "../histogram/histogram.h"
+#include <cstdint>  // for std::uint32_t, std::uint64_t
+#include <string>   // for std::string
+#include <vector>   // for std::vector
+
+namespace match {
+    //! An enumeration.
+    /*!
+        プレイヤーAの賭け方（プレイヤーBは同じ額を受ける）
+    */
+    enum class Rule {
+        //! 毎回stakeを賭ける
+        FIXED,
+
+        //! 毎回手持ちのfraction倍を賭ける
+        PROPORTIONAL,
+
+        //! 負ける度に賭け金を2倍にし、勝ったらstakeに戻す
+        MARTINGALE
+    };
+
+    //! A struct.
+    /*!
+        勝負の設定
+    */
+    struct MatchConfig final {
+        //! A public member variable.
+        /*!
+            プレイヤーAの文字列
+        */
+        std::string a;
+
+        //! A public member variable.
+        /*!
+            プレイヤーBの文字列
+        */
+        std::string b;
+
+        //! A public member variable.
+        /*!
+            プレイヤーAの最初の手持ち
+        */
+        double bankrolla = 100.0;
+
+        //! A public member variable.
+        /*!
+            プレイヤーBの最初の手持ち
+        */
+        double bankrollb = 100.0;
+
+        //! A public member variable.
+        /*!
+            Uが出る確率
+        */
+        double bias = 0.5;
+
+        //! A public member variable.
+        /*!
+            PROPORTIONALの場合の、手持ちに対する賭け金の割合
+        */
+        double fraction = 0.1;
+
+        //! A public member variable.
+        /*!
+            一回の勝負の競争の回数の上限
+        */
+        std::uint32_t maxrounds = 1000U;
+
+        //! A public member variable.
+        /*!
+            プレイヤーAの賭け方
+        */
+        Rule rule = Rule::FIXED;
+
+        //! A public member variable.
+        /*!
+            乱数の種（0の場合は種を指定しない）
+        */
+        std::uint64_t seed = 0U;
+
+        //! A public member variable.
+        /*!
+            基本の賭け金（手持ちがこれを下回ったプレイヤーは破産とする）
+        */
+        double stake = 1.0;
+
+        //! A public member variable.
+        /*!
+            勝負の回数
+        */
+        std::uint64_t trials = 1000000U;
+    };
+
+    //! A struct.
+    /*!
+        勝負全体のシミュレーションの結果
+    */
+    struct MatchResult final {
+        //! A public member variable.
+        /*!
+            勝負の長さ（競争の回数）の分布
+        */
+        histogram::LogHistogram lengths;
+
+        //! A public member variable.
+        /*!
+            プレイヤーAの利益の平均
+        */
+        double profit;
+
+        //! A public member variable.
+        /*!
+            プレイヤーAの利益の平均の標準誤差
+        */
+        double profitstderror;
+
+        //! A public member variable.
+        /*!
+            プレイヤーAが破産した勝負の数
+        */
+        std::uint64_t ruina;
+
+        //! A public member variable.
+        /*!
+            プレイヤーBが破産した勝負の数
+        */
+        std::uint64_t ruinb;
+
+        //! A public member variable.
+        /*!
+            全ての勝負の競争の回数の合計
+        */
+        std::uint64_t totalrounds;
+
+        //! A public member variable.
+        /*!
+            プレイヤーAの手持ちの、k回目の競争の後の平均（0回目は最初の手持ち、終わった勝負は最後の手持ちのまま）
+        */
+        std::vector<double> trajectory;
+
+        //! A public member variable.
+        /*!
+            勝負の回数
+        */
+        std::uint64_t trials;
+    };
+
+    // #region 非メンバ関数
+
+    //! A function.
+    /*!
+        どちらかのプレイヤーが破産するか、競争の回数が上限に達するまで競争を繰り返す勝負を、TBBで並列に行う
+        競争は毎回新しいUとDの列で行い、先に文字列が出現したプレイヤーが賭け金を受け取る（同時の場合は引き分け）
+        \param config 勝負の設定
+        \return 勝負全体のシミュレーションの結果
+    */
+    MatchResult simulate(MatchConfig const & config);
+
+    // #endregion 非メンバ関数
+}
+
+#endif  // _MATCH_H_
@@ -0,0 +1,129 @@
+﻿/*! \file multilength.cpp
+    \brief 長さ1からLまでの全ての文字列を一度のシミュレーションで扱う関数の実装
+
+    Copyright © 2017 @dc1394 All Rights Reserved.
+    This software is released under the BSD 2-Clause License.
+*/
+
+#include "multilength.h"
+#include "../flips/packedflips.h"
+#ifdef HAVE_SSE2
+    #include "../myrandom/myrandsfmt.h"
+#else
+    #include "../myrandom/myrand.h"
+#endif
+#include <algorithm>                            // for std::min
+#include <functional>                           // for std::ref
+#include <limits>                               // for std::numeric_limits
+#include <memory>                               // for std::make_unique
+#include <stdexcept>                            // for std::invalid_argument
+#include <tbb/blocked_range.h>                  // for tbb::blocked_range
+#include <tbb/enumerable_thread_specific.h>     // for tbb::enumerable_thread_specific
+#include <tbb/parallel_for.h>                   // for tbb::parallel_for
+
+namespace multilength {
+    namespace {
+        //! A struct.
+        /*!
+            スレッド毎の集計結果
+        */
+        struct Accumulator final {
+            //! A constructor.
+            /*!
+                唯一のコンストラクタ
+                \param result 長さ毎の勝利回数を保持する集計結果
+            */
+            explicit Accumulator(Result & result)
+                : firstsum(result.firstsum.size(), 0U)
+            {
+                counters.reserve(result.winmatrices.size());
+                for (auto && wm : result.winmatrices) {
+                    counters.emplace_back(*wm);
+                }
+            }
+
+            //! A public member variable.
+            /*!
+                長さ毎の16ビットのカウンタ
+            */
+            std::vector<winmatrix::WinCounter> counters;
+
+            //! A public member variable.
+            /*!
+                各文字列の最初の出現位置の和
+            */
+            std::vector<std::uint64_t> firstsum;
+        };
+    }
+
+    Result montecarlo(std::uint32_t maxlen, std::uint32_t horizon, std::uint64_t trials)
+    {
+        if (maxlen == 0U || maxlen > MAXLENGTH) {
+            throw std::invalid_argument("文字列の長さは1以上12以下でなければなりません");
+        }
+
+        if (horizon < maxlen || horizon > std::numeric_limits<std::uint16_t>::max()) {
+            throw std::invalid_argument("UかDの文字列の長さは文字列の長さ以上65535以下でなければなりません");
+        }
+
+#ifdef HAVE_SSE2
+        using myrand = myrandom::MyRandSfmt;
+#else
+        using myrand = myrandom::MyRand;
+#endif
+        Result result;
+        result.maxlen = maxlen;
+        result.firstsum.assign(flips::offset(maxlen + 1U), 0U);
+
+        // 長さ毎の勝利回数
+        for (auto len = 1U; len <= std::min(maxlen, WINMAXLENGTH); len++) {
+            result.winmatrices.push_back(std::make_unique<winmatrix::WinMatrix>(len, horizon));
+        }
+
+        // スレッド毎の自作乱数クラスのオブジェクト
+        tbb::enumerable_thread_specific<myrand> mrs(1, 6);
+
+        // スレッド毎の集計結果
+        tbb::enumerable_thread_specific<Accumulator> accs(std::ref(result));
+
+        tbb::parallel_for(
+            tbb::blocked_range<std::uint64_t>(0U, trials, 1024U),
+            [&](auto const & range) {
+            auto & mr = mrs.local();
+            auto & acc = accs.local();
+
+            flips::packedflips words;
+            std::vector<std::uint16_t> first(result.firstsum.size());
+
+            for (auto i = range.begin(); i != range.end(); ++i) {
+                flips::makepackedflips(mr, horizon, words);
+
+                // 一度の走査で全ての長さの文字列の最初の出現位置を求める
+                flips::firstoccurrenceupto(words, horizon, maxlen, first.data());
+
+                for (auto k = 0U; k < first.size(); k++) {
+                    acc.firstsum[k] += first[k];
+                }
+
+                for (auto len = 1U; len <= acc.counters.size(); len++) {
+                    acc.counters[len - 1U].accumulate(first.data() + flips::offset(len));
+                }
+            }
+        });
+
+        // スレッド毎の集計結果を足し合わせる
+        for (auto && acc : accs) {
+            for (auto && counter : acc.counters) {
+                counter.flush();
+            }
+
+            for (auto k = 0U; k < acc.firstsum.size(); k++) {
+                result.firstsum[k] += acc.firstsum[k];
+            }
+        }
+
+        result.trials = trials;
+
+        return result;
+    }
+}
@@ -0,0 +1,73 @@
+﻿/*! \file multilength.h
+    \brief 長さ1からLまでの全ての文字列を一度のシミュレーションで扱う関数の宣言
+
+    Copyright © 2017 @dc1394 All Rights Reserved.
+    This software is released under the BSD 2-Clause License.
+*/
+
+#ifndef _MULTILENGTH_H_
+#define _MULTILENGTH_H_
+
+#pragma once
+
+#include "../winmatrix/winmatrix.h"
+#include <cstdint>  // for std::uint32_t, std::uint64_t
+#include <memory>   // for std::unique_ptr
+#include <vector>   // for std::vector
+
+namespace multilength {
+    //! A global variable (constant expression).
+    /*!
+        扱うことのできる文字列の長さの最大値
+    */
+    static auto constexpr MAXLENGTH = 12U;
+
+    //! A global variable (constant expression).
+    /*!
+        勝利回数を集計する文字列の長さの最大値
+    */
+    static auto constexpr WINMAXLENGTH = 8U;
+
+    //! A struct.
+    /*!
+        長さ1からLまでの全ての文字列に対するモンテカルロ・シミュレーションの結果
+    */
+    struct Result final {
+        //! A public member variable.
+        /*!
+            各文字列の最初の出現位置の和（添字はflips::offset(len) + ビット列）
+        */
+        std::vector<std::uint64_t> firstsum;
+
+        //! A public member variable.
+        /*!
+            文字列の長さの最大値
+        */
+        std::uint32_t maxlen = 0U;
+
+        //! A public member variable.
+        /*!
+            試行回数
+        */
+        std::uint64_t trials = 0U;
+
+        //! A public member variable.
+        /*!
+            長さ毎の勝利回数（添字は長さ - 1、WINMAXLENGTHまで）
+        */
+        std::vector<std::unique_ptr<winmatrix::WinMatrix>> winmatrices;
+    };
+
+    //! A function.
+    /*!
+        長さ1からmaxlenまでの全ての文字列について、最初の出現位置と勝利回数を一度のモンテカルロ・シミュレーションで
+        集計する（TBBで並列化して行う）
+        \param maxlen 文字列の長さの最大値
+        \param horizon UかDの文字列の長さ
+        \param trials 試行回数
+        \return 長さ毎に集計した結果
+    */
+    Result montecarlo(std::uint32_t maxlen, std::uint32_t horizon, std::uint64_t trials);
+}
+
+#endif  // _MULTILENGTH_H_
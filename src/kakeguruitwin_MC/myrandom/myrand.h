@@ -10,8 +10,8 @@
 
 #pragma once
 
-#include <cstdint>  // for std::int32_t
-#include <random>   // for std::mt19937
+#include <cstdint>  // for std::int32_t, std::uint32_t, std::uint64_t
+#include <random>   // for std::mt19937, std::seed_seq
 
 namespace myrandom {
     //! A class.
@@ -24,12 +24,21 @@ namespace myrandom {
     public:
         //! A constructor.
         /*!
-            唯一のコンストラクタ
+            乱数の種をランダムデバイスから得るコンストラクタ
             \param min 乱数分布の最小値
             \param max 乱数分布の最大値
         */
         MyRand(std::int32_t min, std::int32_t max);
 
+        //! A constructor.
+        /*!
+            乱数の種を指定するコンストラクタ（再現性のある乱数列が必要な場合に使う）
+            \param min 乱数分布の最小値
+            \param max 乱数分布の最大値
+            \param s 乱数の種
+        */
+        MyRand(std::int32_t min, std::int32_t max, std::uint32_t s);
+
         //! A destructor.
         /*!
             デフォルトデストラクタ
@@ -49,6 +58,26 @@ namespace myrandom {
             return distribution_(randengine_);
         }
 
+        //!  A public member function.
+        /*!
+            32ビットの一様乱数を生成する
+        */
+        std::uint32_t myrand32()
+        {
+            return static_cast<std::uint32_t>(randengine_());
+        }
+
+        //!  A public member function.
+        /*!
+            乱数エンジンを与えられた64ビットの種で初期化し直す
+            \param s 乱数の種
+        */
+        void seed(std::uint64_t s)
+        {
+            std::seed_seq seq{ static_cast<std::uint32_t>(s), static_cast<std::uint32_t>(s >> 32) };
+            randengine_.seed(seq);
+        }
+
         // #endregion メンバ関数
 
         // #region メンバ変数
@@ -92,7 +121,7 @@ namespace myrandom {
         // #endregion 禁止されたコンストラクタ・メンバ関数
     };
 
-    MyRand::MyRand(std::int32_t min, std::int32_t max) :
+    inline MyRand::MyRand(std::int32_t min, std::int32_t max) :
         distribution_(min, max)
     {
         // ランダムデバイス
@@ -101,6 +130,12 @@ namespace myrandom {
         // 乱数エンジン
         randengine_ = std::mt19937(rnd());
     }
+
+    inline MyRand::MyRand(std::int32_t min, std::int32_t max, std::uint32_t s) :
+        distribution_(min, max),
+        randengine_(s)
+    {
+    }
 }
 
 #endif  // _MYRAND_H_
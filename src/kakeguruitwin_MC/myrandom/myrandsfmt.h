@@ -11,7 +11,7 @@
 #pragma once
 
 #include "../../SFMT-src-1.5.1/SFMT.h"
-#include <cstdint>						// for std::int32_t
+#include <cstdint>						// for std::int32_t, std::uint32_t, std::uint64_t
 #include <random>                       // for std::random_device
 
 namespace myrandom {
@@ -25,12 +25,21 @@ namespace myrandom {
     public:
 		//! A constructor.
 		/*!
-			唯一のコンストラクタ
+			乱数の種をランダムデバイスから得るコンストラクタ
 			\param min 乱数分布の最小値
 			\param max 乱数分布の最大値
 		*/
         MyRandSfmt(std::int32_t min, std::int32_t max);
 
+		//! A constructor.
+		/*!
+			乱数の種を指定するコンストラクタ（再現性のある乱数列が必要な場合に使う）
+			\param min 乱数分布の最小値
+			\param max 乱数分布の最大値
+			\param s 乱数の種
+		*/
+        MyRandSfmt(std::int32_t min, std::int32_t max, std::uint32_t s);
+
         //! A destructor.
         /*!
             デフォルトデストラクタ
@@ -50,6 +59,26 @@ namespace myrandom {
 			return static_cast<std::int32_t>(sfmt_genrand_uint32(&sfmt) % (max_ - min_ + 1)) + min_;
         }
 
+        //!  A public member function.
+        /*!
+            32ビットの一様乱数を生成する
+        */
+        std::uint32_t myrand32()
+        {
+            return sfmt_genrand_uint32(&sfmt);
+        }
+
+        //!  A public member function.
+        /*!
+            乱数エンジンを与えられた64ビットの種で初期化し直す
+            \param s 乱数の種
+        */
+        void seed(std::uint64_t s)
+        {
+            std::uint32_t key[] = { static_cast<std::uint32_t>(s), static_cast<std::uint32_t>(s >> 32) };
+            sfmt_init_by_array(&sfmt, key, 2);
+        }
+
         // #endregion メンバ関数
 
         // #region メンバ変数
@@ -109,6 +138,13 @@ namespace myrandom {
         // 乱数エンジン
 		sfmt_init_gen_rand(&sfmt, rnd());
     }
+
+    inline MyRandSfmt::MyRandSfmt(std::int32_t min, std::int32_t max, std::uint32_t s)
+		: max_(max),
+		  min_(min)
+    {
+		sfmt_init_gen_rand(&sfmt, s);
+    }
 }
 
 #endif  // _MYRANDSFMT_H_
@@ -0,0 +1,194 @@
+﻿/*! \file occurrence.cpp
+    \brief 決められた回数の中で各文字列が出現する回数を数える関数の実装
+
+    Copyright © 2017 @dc1394 All Rights Reserved.
+    This software is released under the BSD 2-Clause License.
+*/
+
+#include "occurrence.h"
+#ifdef HAVE_SSE2
+    #include "../myrandom/myrandsfmt.h"
+#else
+    #include "../myrandom/myrand.h"
+#endif
+#include <stdexcept>                            // for std::invalid_argument
+#include <tbb/blocked_range.h>                  // for tbb::blocked_range
+#include <tbb/enumerable_thread_specific.h>     // for tbb::enumerable_thread_specific
+#include <tbb/parallel_for.h>                   // for tbb::parallel_for
+
+namespace occurrence {
+    namespace {
+        //! A function.
+        /*!
+            出現回数の統計を初期化する
+            \param npattern 文字列の個数
+            \return 初期化された出現回数の統計
+        */
+        Statistics makestatistics(std::uint32_t npattern)
+        {
+            Statistics st;
+            st.sum.assign(npattern, 0U);
+            st.sumsq.assign(npattern, 0U);
+            st.morewins.assign(static_cast<std::size_t>(npattern) * npattern, 0U);
+
+            return st;
+        }
+
+        //! A function.
+        /*!
+            一回の試行の出現回数を統計に加える
+            \param counts 各文字列の出現回数
+            \param st 出現回数の統計
+        */
+        void accumulate(std::vector<std::uint32_t> const & counts, Statistics & st)
+        {
+            auto const npattern = static_cast<std::uint32_t>(counts.size());
+
+            for (auto i = 0U; i < npattern; i++) {
+                auto const c = static_cast<std::uint64_t>(counts[i]);
+                st.sum[i] += c;
+                st.sumsq[i] += c * c;
+
+                auto * row = st.morewins.data() + static_cast<std::size_t>(i) * npattern;
+                for (auto j = 0U; j < npattern; j++) {
+                    row[j] += counts[i] > counts[j] ? 1U : 0U;
+                }
+            }
+        }
+
+        //! A function.
+        /*!
+            出現回数の統計を足し合わせる
+            \param src 加える統計
+            \param dst 加えられる統計
+        */
+        void merge(Statistics const & src, Statistics & dst)
+        {
+            for (auto i = 0U; i < src.sum.size(); i++) {
+                dst.sum[i] += src.sum[i];
+                dst.sumsq[i] += src.sumsq[i];
+            }
+
+            for (auto k = 0U; k < src.morewins.size(); k++) {
+                dst.morewins[k] += src.morewins[k];
+            }
+        }
+    }
+
+    void countoccurrence(
+        flips::packedflips const & words,
+        std::uint32_t nflips,
+        std::uint32_t code,
+        std::uint32_t len,
+        std::uint32_t & overlapping,
+        std::uint32_t & nonoverlapping)
+    {
+        overlapping = 0U;
+        nonoverlapping = 0U;
+
+        // 重なりを許さない場合に、次の出現として数えられる末尾の位置の最小値
+        auto next = len - 1U;
+
+        auto const nword = flips::wordsize(nflips);
+        for (auto w = 0U; w < nword; w++) {
+            auto const cur = words[w];
+            auto const prev = w ? words[w - 1U] : UINT64_C(0);
+
+            // 末尾の位置がtの出現を、t % 64ビット目に立てたビットマスク
+            // t - j番目のUかDが、文字列の末尾からj番目の文字と一致するかを全てのjについて調べる
+            auto mask = ~UINT64_C(0);
+            for (auto j = 0U; j < len; j++) {
+                auto const shifted = j ? (cur << j) | (prev >> (flips::WORDBITS - j)) : cur;
+                mask &= ((code >> j) & 1U) ? shifted : ~shifted;
+            }
+
+            // 範囲外の位置を除く
+            auto const base = w * flips::WORDBITS;
+            if (base < len - 1U) {
+                mask &= ~UINT64_C(0) << (len - 1U - base);
+            }
+            if (nflips - base < flips::WORDBITS) {
+                mask &= (UINT64_C(1) << (nflips - base)) - 1U;
+            }
+
+            overlapping += flips::popcount(mask);
+
+            // 重なりを許さない場合は、先頭から貪欲に数える
+            auto m = next > base ? (next - base < flips::WORDBITS ? mask & (~UINT64_C(0) << (next - base)) : 0U) : mask;
+            while (m) {
+                auto const b = flips::countrzero(m);
+                nonoverlapping++;
+
+                auto const allowed = b + len;
+                next = base + allowed;
+                m = allowed < flips::WORDBITS ? m & (~UINT64_C(0) << allowed) : 0U;
+            }
+        }
+    }
+
+    Result montecarlo(std::uint32_t len, std::uint32_t horizon, std::uint64_t trials)
+    {
+        if (len == 0U || len > 10U) {
+            throw std::invalid_argument("文字列の長さは1以上10以下でなければなりません");
+        }
+
+        if (horizon < len) {
+            throw std::invalid_argument("UかDの文字列の長さは文字列の長さ以上でなければなりません");
+        }
+
+#ifdef HAVE_SSE2
+        using myrand = myrandom::MyRandSfmt;
+#else
+        using myrand = myrandom::MyRand;
+#endif
+        auto const npattern = 1U << len;
+
+        // スレッド毎の自作乱数クラスのオブジェクト
+        tbb::enumerable_thread_specific<myrand> mrs(1, 6);
+
+        // スレッド毎の集計結果
+        tbb::enumerable_thread_specific<Result> results([npattern] {
+            Result r;
+            r.overlapping = makestatistics(npattern);
+            r.nonoverlapping = makestatistics(npattern);
+            return r;
+        });
+
+        tbb::parallel_for(
+            tbb::blocked_range<std::uint64_t>(0U, trials, 1024U),
+            [&](auto const & range) {
+            auto & mr = mrs.local();
+            auto & res = results.local();
+
+            flips::packedflips words;
+            std::vector<std::uint32_t> overlapping(npattern);
+            std::vector<std::uint32_t> nonoverlapping(npattern);
+
+            for (auto i = range.begin(); i != range.end(); ++i) {
+                flips::makepackedflips(mr, horizon, words);
+
+                for (auto code = 0U; code < npattern; code++) {
+                    countoccurrence(words, horizon, code, len, overlapping[code], nonoverlapping[code]);
+                }
+
+                accumulate(overlapping, res.overlapping);
+                accumulate(nonoverlapping, res.nonoverlapping);
+            }
+
+            res.trials += range.size();
+        });
+
+        // スレッド毎の集計結果を足し合わせる
+        Result result;
+        result.overlapping = makestatistics(npattern);
+        result.nonoverlapping = makestatistics(npattern);
+
+        for (auto const & res : results) {
+            merge(res.overlapping, result.overlapping);
+            merge(res.nonoverlapping, result.nonoverlapping);
+            result.trials += res.trials;
+        }
+
+        return result;
+    }
+}
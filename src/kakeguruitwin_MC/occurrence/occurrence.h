@@ -0,0 +1,120 @@
+﻿/*! \file occurrence.h
+    \brief 決められた回数の中で各文字列が出現する回数を数える関数の宣言
+
+    Copyright © 2017 @dc1394 All Rights Reserved.
+    This software is released under the BSD 2-Clause License.
+*/
+
+#ifndef _OCCURRENCE_H_
+#define _OCCURRENCE_H_
+
+#pragma once
+
+#include "../flips/packedflips.h"
+#include <cstdint>  // for std::uint32_t, std::uint64_t
+#include <vector>   // for std::vector
+
+namespace occurrence {
+    //! A struct.
+    /*!
+        出現回数の統計
+    */
+    struct Statistics final {
+        //! A public member function.
+        /*!
+            文字列iの出現回数の平均を返す
+            \param i 文字列のビット列
+            \param trials 試行回数
+            \return 出現回数の平均
+        */
+        double mean(std::uint32_t i, std::uint64_t trials) const
+        {
+            return static_cast<double>(sum[i]) / static_cast<double>(trials);
+        }
+
+        //! A public member function.
+        /*!
+            文字列iの出現回数の分散を返す
+            \param i 文字列のビット列
+            \param trials 試行回数
+            \return 出現回数の分散
+        */
+        double variance(std::uint32_t i, std::uint64_t trials) const
+        {
+            auto const m = mean(i, trials);
+            return static_cast<double>(sumsq[i]) / static_cast<double>(trials) - m * m;
+        }
+
+        //! A public member variable.
+        /*!
+            各文字列の出現回数の和
+        */
+        std::vector<std::uint64_t> sum;
+
+        //! A public member variable.
+        /*!
+            各文字列の出現回数の二乗の和
+        */
+        std::vector<std::uint64_t> sumsq;
+
+        //! A public member variable.
+        /*!
+            i行j列目に、文字列iの出現回数が文字列jより多かった試行の回数を格納する
+        */
+        std::vector<std::uint64_t> morewins;
+    };
+
+    //! A struct.
+    /*!
+        出現回数を数えるモンテカルロ・シミュレーションの結果
+    */
+    struct Result final {
+        //! A public member variable.
+        /*!
+            重なりを許して数えた出現回数の統計
+        */
+        Statistics overlapping;
+
+        //! A public member variable.
+        /*!
+            重なりを許さずに（先頭から貪欲に）数えた出現回数の統計
+        */
+        Statistics nonoverlapping;
+
+        //! A public member variable.
+        /*!
+            試行回数
+        */
+        std::uint64_t trials = 0U;
+    };
+
+    //! A function.
+    /*!
+        UとDのランダム列の中で文字列が出現する回数を、64個ずつのビットマスクとpopcountで数える
+        \param words UとDのランダム列を詰めたワードの可変長配列
+        \param nflips UかDの個数
+        \param code 文字列のビット列
+        \param len 文字列の長さ
+        \param overlapping 重なりを許して数えた出現回数
+        \param nonoverlapping 重なりを許さずに数えた出現回数
+    */
+    void countoccurrence(
+        flips::packedflips const & words,
+        std::uint32_t nflips,
+        std::uint32_t code,
+        std::uint32_t len,
+        std::uint32_t & overlapping,
+        std::uint32_t & nonoverlapping);
+
+    //! A function.
+    /*!
+        長さlenの全ての文字列の出現回数のモンテカルロ・シミュレーションを、TBBで並列化して行う
+        \param len 文字列の長さ
+        \param horizon UかDの文字列の長さ
+        \param trials 試行回数
+        \return 出現回数の統計
+    */
+    Result montecarlo(std::uint32_t len, std::uint32_t horizon, std::uint64_t trials);
+}
+
+#endif  // _OCCURRENCE_H_
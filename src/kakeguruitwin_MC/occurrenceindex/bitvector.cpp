@@ -0,0 +1,221 @@
+﻿/*! \file bitvector.cpp
+    \brief rankを定数時間で、selectを有界の時間で求められる簡潔ビットベクトルクラスの実装
+
+    Copyright © 2017 @dc1394 All Rights Reserved.
+    This software is released under the BSD 2-Clause License.
+*/
+
+#include "bitvector.h"
+#include "../flips/packedflips.h"
+#include <algorithm>        // for std::min, std::upper_bound
+#include <cstddef>          // for std::size_t
+#include <utility>          // for std::move
+
+#ifdef __BMI2__
+    #include <immintrin.h>  // for _pdep_u64
+#endif
+
+namespace occurrenceindex {
+    namespace {
+        //! A global variable (constant expression).
+        /*!
+            64ビットの累積数を持つ区間のワード数（4096ビット）
+        */
+        static auto constexpr SUPERWORDS = 64U;
+
+        //! A global variable (constant expression).
+        /*!
+            16ビットの相対累積数を持つ区間のワード数（512ビット）
+        */
+        static auto constexpr BLOCKWORDS = 8U;
+
+        //! A global variable (constant expression).
+        /*!
+            selectのために位置を記録する、立っているビットの間隔
+        */
+        static auto constexpr SELECTSAMPLE = 4096U;
+
+        //! A global variable (constant expression).
+        /*!
+            全ての立っているビットの位置を記録する、疎な区間の幅の下限（ビット）
+            記録する位置は区間の1ビット当たり高々64 × 4096 / 2^22 = 1/16ビット
+        */
+        static auto constexpr SPARSESPAN = UINT64_C(1) << 22;
+
+        //! A global variable (constant expression).
+        /*!
+            密な区間であることを表すselectblocks_の値
+        */
+        static auto constexpr DENSE = ~UINT64_C(0);
+
+        //! A function.
+        /*!
+            ワードのk番目（0始まり）に立っているビットの位置を求める
+            \param w ワード
+            \param k 添字（wの立っているビットの数未満）
+            \return ビットの位置
+        */
+        inline std::uint32_t selectinword(std::uint64_t w, std::uint32_t k)
+        {
+#ifdef __BMI2__
+            return flips::countrzero(_pdep_u64(UINT64_C(1) << k, w));
+#else
+            for (; k; k--) {
+                w &= w - 1U;
+            }
+
+            return flips::countrzero(w);
+#endif
+        }
+    }
+
+    // #region コンストラクタ
+
+    BitVector::BitVector(std::vector<std::uint64_t> && words, std::uint64_t nbits)
+        : nbits_(nbits),
+          ones_(0U),
+          words_(std::move(words))
+    {
+        auto const nwords = words_.size();
+
+        superranks_.reserve(nwords / SUPERWORDS + 1U);
+        blockranks_.reserve(nwords / BLOCKWORDS + 1U);
+
+        auto relative = 0U;
+        for (auto i = std::size_t(0); i < nwords; i++) {
+            if (!(i % SUPERWORDS)) {
+                superranks_.push_back(ones_);
+                relative = 0U;
+            }
+
+            if (!(i % BLOCKWORDS)) {
+                blockranks_.push_back(static_cast<std::uint16_t>(relative));
+            }
+
+            auto const pc = flips::popcount(words_[i]);
+
+            // SELECTSAMPLEの倍数番目に立っているビットの位置を記録する
+            for (auto k = (ones_ + SELECTSAMPLE - 1U) / SELECTSAMPLE * SELECTSAMPLE; k < ones_ + pc; k += SELECTSAMPLE) {
+                selectsamples_.push_back(i * flips::WORDBITS + selectinword(words_[i], static_cast<std::uint32_t>(k - ones_)));
+            }
+
+            ones_ += pc;
+            relative += pc;
+        }
+
+        // 番兵
+        superranks_.push_back(ones_);
+
+        // 疎な区間では、区間の全ての立っているビットの位置を記録する
+        selectblocks_.assign(selectsamples_.size(), DENSE);
+        for (auto j = std::size_t(0); j < selectsamples_.size(); j++) {
+            auto const begin = selectsamples_[j];
+            auto const end = j + 1U < selectsamples_.size() ? selectsamples_[j + 1U] : nbits_;
+            if (end - begin < SPARSESPAN) {
+                continue;
+            }
+
+            selectblocks_[j] = sparsepositions_.size();
+
+            auto const count = std::min<std::uint64_t>(SELECTSAMPLE, ones_ - j * SELECTSAMPLE);
+            auto i = begin / flips::WORDBITS;
+            auto w = words_[i] & (~UINT64_C(0) << (begin % flips::WORDBITS));
+            for (auto n = UINT64_C(0); n < count; n++) {
+                while (!w) {
+                    w = words_[++i];
+                }
+
+                sparsepositions_.push_back(i * flips::WORDBITS + flips::countrzero(w));
+                w &= w - 1U;
+            }
+        }
+    }
+
+    // #endregion コンストラクタ
+
+    // #region publicメンバ関数
+
+    std::uint64_t BitVector::nextone(std::uint64_t x) const
+    {
+        if (x >= nbits_) {
+            return nbits_;
+        }
+
+        // 同じワードにあればrankとselectを使わない
+        auto const w = words_[x / flips::WORDBITS] >> (x % flips::WORDBITS);
+        if (w) {
+            return x + flips::countrzero(w);
+        }
+
+        auto const r = rank1(x);
+
+        return r < ones_ ? select1(r) : nbits_;
+    }
+
+    std::uint64_t BitVector::rank1(std::uint64_t x) const
+    {
+        if (x >= nbits_) {
+            return ones_;
+        }
+
+        auto const i = x / flips::WORDBITS;
+        auto r = superranks_[i / SUPERWORDS] + blockranks_[i / BLOCKWORDS];
+
+        for (auto j = i / BLOCKWORDS * BLOCKWORDS; j < i; j++) {
+            r += flips::popcount(words_[j]);
+        }
+
+        if (x % flips::WORDBITS) {
+            r += flips::popcount(words_[i] & ((UINT64_C(1) << (x % flips::WORDBITS)) - 1U));
+        }
+
+        return r;
+    }
+
+    std::uint64_t BitVector::select1(std::uint64_t k) const
+    {
+        auto const j = k / SELECTSAMPLE;
+
+        // 疎な区間では記録した位置を返す
+        if (selectblocks_[j] != DENSE) {
+            return sparsepositions_[selectblocks_[j] + k % SELECTSAMPLE];
+        }
+
+        // 密な区間（2^22ビット未満）に掛かる、高々1025個の4096ビットの区間を二分探索する
+        auto const begin = selectsamples_[j] / flips::WORDBITS / SUPERWORDS;
+        auto const end = ((j + 1U < selectsamples_.size() ? selectsamples_[j + 1U] : nbits_) - 1U) / flips::WORDBITS / SUPERWORDS;
+        auto const s = static_cast<std::uint64_t>(
+            std::upper_bound(superranks_.begin() + begin + 1U, superranks_.begin() + end + 1U, k) - superranks_.begin()) - 1U;
+
+        auto r = static_cast<std::uint32_t>(k - superranks_[s]);
+
+        // 512ビットの区間を探す
+        auto b = s * (SUPERWORDS / BLOCKWORDS);
+        auto const bend = std::min<std::uint64_t>((s + 1U) * (SUPERWORDS / BLOCKWORDS), blockranks_.size());
+        while (b + 1U < bend && blockranks_[b + 1U] <= r) {
+            b++;
+        }
+
+        r -= blockranks_[b];
+
+        // ワードを探す
+        auto i = b * BLOCKWORDS;
+        for (auto pc = flips::popcount(words_[i]); pc <= r; pc = flips::popcount(words_[++i])) {
+            r -= pc;
+        }
+
+        return i * flips::WORDBITS + selectinword(words_[i], r);
+    }
+
+    std::uint64_t BitVector::sizeinbytes() const
+    {
+        return words_.size() * sizeof(std::uint64_t) +
+               superranks_.size() * sizeof(std::uint64_t) +
+               blockranks_.size() * sizeof(std::uint16_t) +
+               selectsamples_.size() * sizeof(std::uint64_t) +
+               selectblocks_.size() * sizeof(std::uint64_t) +
+               sparsepositions_.size() * sizeof(std::uint64_t);
+    }
+
+    // #endregion publicメンバ関数
+}
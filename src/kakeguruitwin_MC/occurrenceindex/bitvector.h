@@ -0,0 +1,182 @@
+﻿/*! \file bitvector.h
+    \brief rankを定数時間で、selectを有界の時間で求められる簡潔ビットベクトルクラスの宣言
+
+    Copyright © 2017 @dc1394 All Rights Reserved.
+    This software is released under the BSD 2-Clause License.
+*/
+
+#ifndef _BITVECTOR_H_
+#define _BITVECTOR_H_
+
+#pragma once
+
+#include <cstdint>  // for std::uint16_t, std::uint64_t
+#include <vector>   // for std::vector
+
+namespace occurrenceindex {
+    //! A class.
+    /*!
+        rankを定数時間で、selectを有界の時間で求められる簡潔ビットベクトルクラス
+        4096ビット毎の64ビットの累積数と512ビット毎の16ビットの相対累積数を持つ（1ビット当たり約0.047ビット）
+        selectのために4096個毎の1の位置を記録し、その間隔が2^22ビット以上の疎な区間では区間の全ての1の位置を
+        記録して（1ビット当たり高々1/16ビット）表を引くだけで求め、密な区間では区間に掛かる高々1025個の
+        4096ビットの区間を二分探索する（高々11回）ので、1の密度によらず1の間隔に比例する走査はしない
+    */
+    class BitVector final {
+        // #region コンストラクタ・デストラクタ
+
+    public:
+        //! A constructor.
+        /*!
+            唯一のコンストラクタ
+            \param words ビット列を詰めたワードの可変長配列（t番目のビットはt / 64番目のワードのt % 64ビット目）
+            \param nbits ビット列の長さ
+        */
+        BitVector(std::vector<std::uint64_t> && words, std::uint64_t nbits);
+
+        //! A destructor.
+        /*!
+            デフォルトデストラクタ
+        */
+        ~BitVector() = default;
+
+        // #endregion コンストラクタ・デストラクタ
+
+        // #region メンバ関数
+
+        //! A public member function.
+        /*!
+            位置x以降で最初に立っているビットの位置を求める
+            \param x 位置
+            \return 最初に立っているビットの位置（存在しなければnbits()）
+        */
+        std::uint64_t nextone(std::uint64_t x) const;
+
+        //! A public member function.
+        /*!
+            位置xより前に立っているビットの数を求める
+            \param x 位置（nbits()以下）
+            \return 立っているビットの数
+        */
+        std::uint64_t rank1(std::uint64_t x) const;
+
+        //! A public member function.
+        /*!
+            k番目（0始まり）に立っているビットの位置を求める
+            \param k 添字（ones()未満）
+            \return ビットの位置
+        */
+        std::uint64_t select1(std::uint64_t k) const;
+
+        //! A public member function.
+        /*!
+            使用しているメモリの大きさ（バイト）を返す
+            \return メモリの大きさ
+        */
+        std::uint64_t sizeinbytes() const;
+
+        // #endregion メンバ関数
+
+        // #region プロパティ
+
+        //! A property.
+        /*!
+            ビット列の長さを返す
+        */
+        std::uint64_t nbits() const
+        {
+            return nbits_;
+        }
+
+        //! A property.
+        /*!
+            立っているビットの数を返す
+        */
+        std::uint64_t ones() const
+        {
+            return ones_;
+        }
+
+        // #endregion プロパティ
+
+        // #region メンバ変数
+
+    private:
+        //! A private member variable.
+        /*!
+            512ビット毎の、4096ビットの区間の先頭からの立っているビットの数
+        */
+        std::vector<std::uint16_t> blockranks_;
+
+        //! A private member variable.
+        /*!
+            ビット列の長さ
+        */
+        std::uint64_t const nbits_;
+
+        //! A private member variable.
+        /*!
+            立っているビットの数
+        */
+        std::uint64_t ones_;
+
+        //! A private member variable.
+        /*!
+            4096個毎の立っているビットの位置
+        */
+        std::vector<std::uint64_t> selectsamples_;
+
+        //! A private member variable.
+        /*!
+            4096個毎の立っているビットの区間が疎な場合はsparsepositions_の中の先頭の添字、密な場合は~0
+        */
+        std::vector<std::uint64_t> selectblocks_;
+
+        //! A private member variable.
+        /*!
+            疎な区間の全ての立っているビットの位置
+        */
+        std::vector<std::uint64_t> sparsepositions_;
+
+        //! A private member variable.
+        /*!
+            4096ビット毎の、先頭からの立っているビットの数
+        */
+        std::vector<std::uint64_t> superranks_;
+
+        //! A private member variable.
+        /*!
+            ビット列を詰めたワードの可変長配列
+        */
+        std::vector<std::uint64_t> const words_;
+
+        // #endregion メンバ変数
+
+        // #region 禁止されたコンストラクタ・メンバ関数
+
+        //! A private constructor (deleted).
+        /*!
+            デフォルトコンストラクタ（禁止）
+        */
+        BitVector() = delete;
+
+        //! A private copy constructor (deleted).
+        /*!
+            コピーコンストラクタ（禁止）
+            \param dummy コピー元のオブジェクト（未使用）
+        */
+        BitVector(BitVector const & dummy) = delete;
+
+        //! A private member function (deleted).
+        /*!
+            operator=()の宣言（禁止）
+            \param dummy コピー元のオブジェクト（未使用）
+            \return コピー元のオブジェクト
+        */
+        BitVector & operator=(BitVector const & dummy) = delete;
+
+        // #endregion 禁止されたコンストラクタ・メンバ関数
+    };
+}
+
+#endif  // _BITVECTOR_H_
@@ -0,0 +1,159 @@
+﻿/*! \file occurrenceindex.cpp
+    \brief 長いUとDの列の任意の位置から始まる競争に答えるための、文字列毎の出現位置の索引クラスの実装
+
+    Copyright © 2017 @dc1394 All Rights Reserved.
+    This software is released under the BSD 2-Clause License.
+*/
+
+#include "occurrenceindex.h"
+#include <cstddef>                              // for std::size_t
+#include <functional>                           // for std::ref
+#include <stdexcept>                            // for std::invalid_argument
+#include <utility>                              // for std::move
+#include <tbb/blocked_range.h>                  // for tbb::blocked_range
+#include <tbb/enumerable_thread_specific.h>     // for tbb::enumerable_thread_specific
+#include <tbb/parallel_for.h>                   // for tbb::parallel_for
+
+namespace occurrenceindex {
+    namespace {
+        //! A global variable (constant expression).
+        /*!
+            索引を作成できる文字列の長さの上限
+        */
+        static auto constexpr MAXLENGTH = 12U;
+    }
+
+    // #region コンストラクタ
+
+    OccurrenceIndex::OccurrenceIndex(flips::packedflips const & stream, std::uint64_t nflips, std::uint32_t len)
+        : len_(len),
+          nflips_(nflips)
+    {
+        if (len == 0U || len > MAXLENGTH) {
+            throw std::invalid_argument("文字列の長さは1以上12以下でなければなりません");
+        }
+
+        if (!nflips || stream.size() * flips::WORDBITS < nflips) {
+            throw std::invalid_argument("UかDの個数が不正です");
+        }
+
+        auto const npattern = 1U << len;
+        auto const nwords = static_cast<std::size_t>((nflips + flips::WORDBITS - 1U) / flips::WORDBITS);
+
+        std::vector<flips::packedflips> raw(npattern);
+        tbb::parallel_for(0U, npattern, [&](std::uint32_t p) { raw[p].resize(nwords); });
+
+        // ワード毎に、全ての文字列の出現の末尾の位置のビットを求める
+        tbb::parallel_for(
+            tbb::blocked_range<std::size_t>(0U, nwords, 1024U),
+            [&](auto const & range) {
+            // 直近k番目のUかDのビット列
+            std::uint64_t x[MAXLENGTH];
+
+            // 文字列の下位kビットが一致する位置のビット列
+            std::vector<std::uint64_t> match(npattern);
+
+            for (auto i = range.begin(); i != range.end(); ++i) {
+                auto const cur = stream[i];
+                auto const prev = i ? stream[i - 1U] : UINT64_C(0);
+
+                for (auto k = 0U; k < len; k++) {
+                    x[k] = k ? (cur << k) | (prev >> (flips::WORDBITS - k)) : cur;
+                }
+
+                // 文字列全体が含まれる位置のみ
+                auto valid = ~UINT64_C(0);
+                if (!i) {
+                    valid &= ~((UINT64_C(1) << (len - 1U)) - 1U);
+                }
+                if (i + 1U == nwords && nflips % flips::WORDBITS) {
+                    valid &= (UINT64_C(1) << (nflips % flips::WORDBITS)) - 1U;
+                }
+
+                // 下位ビットから一ビットずつ条件を加えて、全ての文字列を2^(len + 1)回の演算で求める
+                match[0] = valid;
+                for (auto k = 0U; k < len; k++) {
+                    for (auto c = (1U << k); c-- > 0U;) {
+                        match[c | (1U << k)] = match[c] & x[k];
+                        match[c] &= ~x[k];
+                    }
+                }
+
+                for (auto p = 0U; p < npattern; p++) {
+                    raw[p][i] = match[p];
+                }
+            }
+        });
+
+        bitvectors_.resize(npattern);
+        tbb::parallel_for(0U, npattern, [&](std::uint32_t p) {
+            bitvectors_[p] = std::make_unique<BitVector>(std::move(raw[p]), nflips);
+        });
+    }
+
+    // #endregion コンストラクタ
+
+    // #region publicメンバ関数
+
+    double OccurrenceIndex::bitsperposition() const
+    {
+        auto bytes = UINT64_C(0);
+        for (auto const & bv : bitvectors_) {
+            bytes += bv->sizeinbytes();
+        }
+
+        return static_cast<double>(bytes) * 8.0 / (static_cast<double>(nflips_) * static_cast<double>(bitvectors_.size()));
+    }
+
+    // #endregion publicメンバ関数
+
+    // #region 非メンバ関数
+
+    std::uint64_t races(winmatrix::WinMatrix & wm, OccurrenceIndex const & index, std::uint64_t stride)
+    {
+        if (wm.len() != index.len()) {
+            throw std::invalid_argument("文字列の長さが索引と異なります");
+        }
+
+        if (!stride) {
+            throw std::invalid_argument("競争を始める位置の間隔は1以上でなければなりません");
+        }
+
+        auto const horizon = wm.horizon();
+        if (index.nflips() < horizon) {
+            return 0U;
+        }
+
+        auto const nrace = (index.nflips() - horizon) / stride + 1U;
+
+        // スレッド毎の16ビットのカウンタ
+        tbb::enumerable_thread_specific<winmatrix::WinCounter> counters(std::ref(wm));
+
+        tbb::parallel_for(
+            tbb::blocked_range<std::uint64_t>(0U, nrace, 1024U),
+            [&](auto const & range) {
+            auto & counter = counters.local();
+
+            // 各文字列の競争を始めた位置からの最初の出現位置（見つからなかった場合はhorizon）
+            std::vector<std::uint16_t> first(wm.npattern());
+
+            for (auto r = range.begin(); r != range.end(); ++r) {
+                auto const t = r * stride;
+                for (auto p = 0U; p < wm.npattern(); p++) {
+                    auto const e = index.first(p, t);
+                    first[p] = static_cast<std::uint16_t>(e < t + horizon ? e - t + 1U : horizon);
+                }
+
+                counter.accumulate(first.data());
+            }
+        });
+
+        for (auto && counter : counters) {
+            counter.flush();
+        }
+
+        return nrace;
+    }
+
+    // #endregion 非メンバ関数
+}
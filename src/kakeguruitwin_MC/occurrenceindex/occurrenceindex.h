@@ -0,0 +1,159 @@
+﻿/*! \file occurrenceindex.h
+    \brief 長いUとDの列の任意の位置から始まる競争に答えるための、文字列毎の出現位置の索引クラスの宣言
+
+    Copyright © 2017 @dc1394 All Rights Reserved.
+    This software is released under the BSD 2-Clause License.
+*/
+
+#ifndef _OCCURRENCEINDEX_H_
+#define _OCCURRENCEINDEX_H_
+
+#pragma once
+
+#include "bitvector.h"
+#include "../flips/packedflips.h"
+#include "../winmatrix/winmatrix.h"
+#include <cstdint>  // for std::uint32_t, std::uint64_t
+#include <memory>   // for std::unique_ptr
+#include <vector>   // for std::vector
+
+namespace occurrenceindex {
+    //! A class.
+    /*!
+        長いUとDの列について、長さKの文字列毎に出現の末尾の位置を簡潔ビットベクトルで保持する索引クラス
+        「位置t以降で最初に文字列が出現する位置」をrankとselectで出現の間隔によらない有界の時間で求められるので、
+        列を走査し直さずに任意の位置から始まる任意の文字列のペアの競争に答えられる
+    */
+    class OccurrenceIndex final {
+        // #region コンストラクタ・デストラクタ
+
+    public:
+        //! A constructor.
+        /*!
+            唯一のコンストラクタ
+            索引はUとDの列のワード毎に並列に作成する
+            \param stream UとDの列を詰めたワードの可変長配列
+            \param nflips UかDの個数
+            \param len 文字列の長さ
+        */
+        OccurrenceIndex(flips::packedflips const & stream, std::uint64_t nflips, std::uint32_t len);
+
+        //! A destructor.
+        /*!
+            デフォルトデストラクタ
+        */
+        ~OccurrenceIndex() = default;
+
+        // #endregion コンストラクタ・デストラクタ
+
+        // #region メンバ関数
+
+        //! A public member function.
+        /*!
+            位置t以降に全体が含まれる、最初の文字列の出現の末尾の位置を求める
+            \param code 文字列のビット列
+            \param t 競争を始める位置（0始まり）
+            \return 出現の末尾の位置（0始まり、出現しなければnflips()）
+        */
+        std::uint64_t first(std::uint32_t code, std::uint64_t t) const
+        {
+            return t + len_ - 1U < nflips_ ? bitvectors_[code]->nextone(t + len_ - 1U) : nflips_;
+        }
+
+        //! A public member function.
+        /*!
+            索引の一つの位置、一つの文字列当たりのビット数を求める
+            \return ビット数
+        */
+        double bitsperposition() const;
+
+        // #endregion メンバ関数
+
+        // #region プロパティ
+
+        //! A property.
+        /*!
+            文字列の長さを返す
+        */
+        std::uint32_t len() const
+        {
+            return len_;
+        }
+
+        //! A property.
+        /*!
+            UかDの個数を返す
+        */
+        std::uint64_t nflips() const
+        {
+            return nflips_;
+        }
+
+        // #endregion プロパティ
+
+        // #region メンバ変数
+
+    private:
+        //! A private member variable.
+        /*!
+            文字列毎の出現の末尾の位置の簡潔ビットベクトル（添字は文字列のビット列）
+        */
+        std::vector<std::unique_ptr<BitVector>> bitvectors_;
+
+        //! A private member variable.
+        /*!
+            文字列の長さ
+        */
+        std::uint32_t const len_;
+
+        //! A private member variable.
+        /*!
+            UかDの個数
+        */
+        std::uint64_t const nflips_;
+
+        // #endregion メンバ変数
+
+        // #region 禁止されたコンストラクタ・メンバ関数
+
+        //! A private constructor (deleted).
+        /*!
+            デフォルトコンストラクタ（禁止）
+        */
+        OccurrenceIndex() = delete;
+
+        //! A private copy constructor (deleted).
+        /*!
+            コピーコンストラクタ（禁止）
+            \param dummy コピー元のオブジェクト（未使用）
+        */
+        OccurrenceIndex(OccurrenceIndex const & dummy) = delete;
+
+        //! A private member function (deleted).
+        /*!
+            operator=()の宣言（禁止）
+            \param dummy コピー元のオブジェクト（未使用）
+            \return コピー元のオブジェクト
+        */
+        OccurrenceIndex & operator=(OccurrenceIndex const & dummy) = delete;
+
+        // #endregion 禁止されたコンストラクタ・メンバ関数
+    };
+
+    // #region 非メンバ関数
+
+    //! A function.
+    /*!
+        位置0からstride毎の全ての位置から始まる、UかDの文字列の長さ（wm.horizon()）の競争を索引で評価し、
+        長さKの文字列のペアの勝利回数を集計する
+        \param wm 勝利回数の総和を保持するオブジェクト（文字列の長さは索引と等しくなければならない）
+        \param index 索引
+        \param stride 競争を始める位置の間隔
+        \return 集計した競争の数
+    */
+    std::uint64_t races(winmatrix::WinMatrix & wm, OccurrenceIndex const & index, std::uint64_t stride);
+
+    // #endregion 非メンバ関数
+}
+
+#endif  // _OCCURRENCEINDEX_H_
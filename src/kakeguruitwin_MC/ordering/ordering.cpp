@@ -0,0 +1,211 @@
+﻿/*! \file ordering.cpp
+    \brief 全ての文字列が最初に出現する順序の統計を計算する関数の実装
+
+    Copyright © 2017 @dc1394 All Rights Reserved.
+    This software is released under the BSD 2-Clause License.
+*/
+
+#include "ordering.h"
+#include "../flips/packedflips.h"
+#ifdef HAVE_SSE2
+    #include "../myrandom/myrandsfmt.h"
+#else
+    #include "../myrandom/myrand.h"
+#endif
+#include <algorithm>                            // for std::sort
+#include <array>                                // for std::array
+#include <stdexcept>                            // for std::invalid_argument
+#include <utility>                              // for std::pair
+#include <tbb/blocked_range.h>                  // for tbb::blocked_range
+#include <tbb/enumerable_thread_specific.h>     // for tbb::enumerable_thread_specific
+#include <tbb/parallel_for.h>                   // for tbb::parallel_for
+
+namespace ordering {
+    namespace {
+        //! A global variable (constant expression).
+        /*!
+            8要素のソーティングネットワーク（19個の比較交換器）
+        */
+        static std::array<std::pair<std::uint32_t, std::uint32_t>, 19U> const NETWORK = {{
+            { 0, 2 }, { 1, 3 }, { 4, 6 }, { 5, 7 },
+            { 0, 4 }, { 1, 5 }, { 2, 6 }, { 3, 7 },
+            { 0, 1 }, { 2, 3 }, { 4, 5 }, { 6, 7 },
+            { 2, 4 }, { 3, 5 },
+            { 1, 4 }, { 3, 6 },
+            { 1, 2 }, { 3, 4 }, { 5, 6 }
+        }};
+
+        //! A global variable (constant expression).
+        /*!
+            0!から7!までの階乗
+        */
+        static std::array<std::uint32_t, MAXPERMUTATION> const FACTORIAL = {{ 1, 1, 2, 6, 24, 120, 720, 5040 }};
+
+        //! A struct.
+        /*!
+            スレッド毎の集計結果
+        */
+        struct Accumulator final {
+            //! A constructor.
+            /*!
+                唯一のコンストラクタ
+                \param npattern 文字列の個数
+            */
+            explicit Accumulator(std::uint32_t npattern)
+                : histogram(npattern <= MAXPERMUTATION ? FACTORIAL[npattern - 1U] * npattern : 0U, 0U),
+                  ranksum(npattern, 0U)
+            {
+            }
+
+            //! A public member variable.
+            /*!
+                順列のヒストグラム
+            */
+            std::vector<std::uint64_t> histogram;
+
+            //! A public member variable.
+            /*!
+                各文字列の順位の和
+            */
+            std::vector<std::uint64_t> ranksum;
+
+            //! A public member variable.
+            /*!
+                試行回数
+            */
+            std::uint64_t trials = 0U;
+        };
+    }
+
+    std::uint32_t permutationrank(std::uint32_t const * first, std::uint32_t n, std::uint32_t * order)
+    {
+        // 上位ビットに出現位置、下位3ビットに文字列のビット列を詰めたキー
+        // 余った要素は最後に並ぶようにする
+        std::array<std::uint64_t, MAXPERMUTATION> key;
+        for (auto i = 0U; i < MAXPERMUTATION; i++) {
+            key[i] = ((i < n ? static_cast<std::uint64_t>(first[i]) : UINT64_C(0xFFFFFFFF) + 1U) << 3) | i;
+        }
+
+        // ソーティングネットワークで並べ替える（分岐なし）
+        for (auto const & ce : NETWORK) {
+            auto const a = key[ce.first];
+            auto const b = key[ce.second];
+            key[ce.first] = a < b ? a : b;
+            key[ce.second] = a < b ? b : a;
+        }
+
+        // Lehmer符号：各要素について、それより後ろにあるより小さい要素の数を数える
+        auto rank = 0U;
+        auto remain = (1U << n) - 1U;
+        for (auto r = 0U; r < n; r++) {
+            auto const v = static_cast<std::uint32_t>(key[r] & 7U);
+            order[r] = v;
+
+            remain &= ~(1U << v);
+            rank += flips::popcount(remain & ((1U << v) - 1U)) * FACTORIAL[n - 1U - r];
+        }
+
+        return rank;
+    }
+
+    std::vector<std::uint32_t> unrank(std::uint32_t rank, std::uint32_t n)
+    {
+        std::vector<std::uint32_t> remain;
+        for (auto i = 0U; i < n; i++) {
+            remain.push_back(i);
+        }
+
+        std::vector<std::uint32_t> order;
+        for (auto r = 0U; r < n; r++) {
+            auto const f = FACTORIAL[n - 1U - r];
+            auto const d = rank / f;
+            rank %= f;
+
+            order.push_back(remain[d]);
+            remain.erase(remain.begin() + d);
+        }
+
+        return order;
+    }
+
+    Result montecarlo(std::uint32_t len, std::uint32_t horizon, std::uint64_t trials)
+    {
+        if (len == 0U || len > 16U) {
+            throw std::invalid_argument("文字列の長さは1以上16以下でなければなりません");
+        }
+
+        if (horizon < len) {
+            throw std::invalid_argument("UかDの文字列の長さは文字列の長さ以上でなければなりません");
+        }
+
+#ifdef HAVE_SSE2
+        using myrand = myrandom::MyRandSfmt;
+#else
+        using myrand = myrandom::MyRand;
+#endif
+        auto const npattern = 1U << len;
+
+        // スレッド毎の自作乱数クラスのオブジェクト
+        tbb::enumerable_thread_specific<myrand> mrs(1, 6);
+
+        // スレッド毎の集計結果
+        tbb::enumerable_thread_specific<Accumulator> accs(npattern);
+
+        tbb::parallel_for(
+            tbb::blocked_range<std::uint64_t>(0U, trials, 1024U),
+            [&](auto const & range) {
+            auto & mr = mrs.local();
+            auto & acc = accs.local();
+
+            flips::packedflips words;
+            std::vector<std::uint32_t> first(npattern);
+            std::vector<std::uint32_t> order(npattern);
+            std::vector<std::uint64_t> key(npattern);
+
+            for (auto i = range.begin(); i != range.end(); ++i) {
+                flips::makepackedflips(mr, horizon, words);
+                flips::firstoccurrence(words, horizon, len, first.data());
+
+                if (npattern <= MAXPERMUTATION) {
+                    acc.histogram[permutationrank(first.data(), npattern, order.data())]++;
+                }
+                else {
+                    for (auto j = 0U; j < npattern; j++) {
+                        key[j] = (static_cast<std::uint64_t>(first[j]) << len) | j;
+                    }
+
+                    std::sort(key.begin(), key.end());
+
+                    for (auto r = 0U; r < npattern; r++) {
+                        order[r] = static_cast<std::uint32_t>(key[r] & (npattern - 1U));
+                    }
+                }
+
+                for (auto r = 0U; r < npattern; r++) {
+                    acc.ranksum[order[r]] += r;
+                }
+            }
+
+            acc.trials += range.size();
+        });
+
+        // スレッド毎のヒストグラムを足し合わせる
+        Result result;
+        result.histogram.assign(npattern <= MAXPERMUTATION ? FACTORIAL[npattern - 1U] * npattern : 0U, 0U);
+        result.ranksum.assign(npattern, 0U);
+
+        for (auto const & acc : accs) {
+            for (auto k = 0U; k < acc.histogram.size(); k++) {
+                result.histogram[k] += acc.histogram[k];
+            }
+
+            for (auto k = 0U; k < npattern; k++) {
+                result.ranksum[k] += acc.ranksum[k];
+            }
+
+            result.trials += acc.trials;
+        }
+
+        return result;
+    }
+}
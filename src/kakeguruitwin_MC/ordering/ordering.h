@@ -0,0 +1,79 @@
+﻿/*! \file ordering.h
+    \brief 全ての文字列が最初に出現する順序の統計を計算する関数の宣言
+
+    Copyright © 2017 @dc1394 All Rights Reserved.
+    This software is released under the BSD 2-Clause License.
+*/
+
+#ifndef _ORDERING_H_
+#define _ORDERING_H_
+
+#pragma once
+
+#include <cstdint>  // for std::uint32_t, std::uint64_t
+#include <vector>   // for std::vector
+
+namespace ordering {
+    //! A global variable (constant expression).
+    /*!
+        順列のヒストグラムを作る文字列の個数の最大値
+    */
+    static auto constexpr MAXPERMUTATION = 8U;
+
+    //! A struct.
+    /*!
+        最初に出現する順序の統計
+    */
+    struct Result final {
+        //! A public member variable.
+        /*!
+            出現順の順列（Lehmer符号による順位）毎の回数（文字列が8個以下の場合のみ）
+        */
+        std::vector<std::uint64_t> histogram;
+
+        //! A public member variable.
+        /*!
+            各文字列の出現順の順位（0始まり）の和
+        */
+        std::vector<std::uint64_t> ranksum;
+
+        //! A public member variable.
+        /*!
+            試行回数
+        */
+        std::uint64_t trials = 0U;
+    };
+
+    //! A function.
+    /*!
+        最初の出現位置の配列から、出現順の順列のLehmer符号による順位を計算する
+        出現位置が等しい（見つからなかった場合を含む）文字列は、ビット列の昇順に並べる
+        \param first 各文字列の最初の出現位置の配列（要素数はn）
+        \param n 文字列の個数（MAXPERMUTATION以下）
+        \param order 出現順に並べた文字列のビット列を格納する配列（要素数はn）
+        \return 順列の順位（0以上n!未満）
+    */
+    std::uint32_t permutationrank(std::uint32_t const * first, std::uint32_t n, std::uint32_t * order);
+
+    //! A function.
+    /*!
+        Lehmer符号による順位から、出現順の順列を復元する
+        \param rank 順列の順位
+        \param n 文字列の個数
+        \return 出現順に並べた文字列のビット列
+    */
+    std::vector<std::uint32_t> unrank(std::uint32_t rank, std::uint32_t n);
+
+    //! A function.
+    /*!
+        全ての文字列が最初に出現する順序のモンテカルロ・シミュレーションを、TBBで並列化して行う
+        試行毎の結果は保存せず、スレッド毎のヒストグラムに集計して最後に足し合わせる
+        \param len 文字列の長さ
+        \param horizon UかDの文字列の長さ
+        \param trials 試行回数
+        \return 最初に出現する順序の統計
+    */
+    Result montecarlo(std::uint32_t len, std::uint32_t horizon, std::uint64_t trials);
+}
+
+#endif  // _ORDERING_H_
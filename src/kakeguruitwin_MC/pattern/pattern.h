@@ -0,0 +1,87 @@
+﻿/*! \file pattern.h
+    \brief UとDの文字列をビット列として扱うための関数の宣言と実装
+
+    Copyright © 2017 @dc1394 All Rights Reserved.
+    This software is released under the BSD 2-Clause License.
+*/
+
+#ifndef _PATTERN_H_
+#define _PATTERN_H_
+
+#pragma once
+
+#include <cstdint>      // for std::uint32_t
+#include <stdexcept>    // for std::invalid_argument
+#include <string>       // for std::string
+#include <vector>       // for std::vector
+
+namespace pattern {
+    //! A global variable (constant expression).
+    /*!
+        扱うことのできるUとDの文字列の長さの最大値
+    */
+    static auto constexpr MAXLENGTH = 24U;
+
+    //! A function.
+    /*!
+        UとDの文字列をビット列に変換する（Uが1、Dが0で、先頭の文字が最上位ビット）
+        \param str UとDの文字列
+        \return 文字列に対応するビット列
+    */
+    inline std::uint32_t tocode(std::string const & str)
+    {
+        if (str.empty() || str.size() > MAXLENGTH) {
+            throw std::invalid_argument("文字列の長さが不正です: " + str);
+        }
+
+        auto code = 0U;
+        for (auto const c : str) {
+            if (c != 'U' && c != 'D') {
+                throw std::invalid_argument("UとD以外の文字が含まれています: " + str);
+            }
+
+            code = (code << 1) | (c == 'U' ? 1U : 0U);
+        }
+
+        return code;
+    }
+
+    //! A function.
+    /*!
+        ビット列をUとDの文字列に変換する
+        \param code ビット列
+        \param len 文字列の長さ
+        \return ビット列に対応するUとDの文字列
+    */
+    inline std::string tostring(std::uint32_t code, std::uint32_t len)
+    {
+        std::string str(len, 'D');
+        for (auto i = 0U; i < len; i++) {
+            if ((code >> (len - 1U - i)) & 1U) {
+                str[i] = 'U';
+            }
+        }
+
+        return str;
+    }
+
+    //! A function.
+    /*!
+        長さlenのUとDの文字列の可能な集合を、ビット列の昇順に列挙する
+        \param len 文字列の長さ
+        \return UとDの文字列の可能な集合を格納したstd::vector
+    */
+    inline std::vector<std::string> allpatterns(std::uint32_t len)
+    {
+        std::vector<std::string> patterns;
+        patterns.reserve(1U << len);
+
+        for (auto code = 0U; code < (1U << len); code++) {
+            patterns.push_back(tostring(code, len));
+        }
+
+        return patterns;
+    }
+}
+
+#endif  // _PATTERN_H_
@@ -0,0 +1,446 @@
+﻿/*! \file perfledger.cpp
+    \brief 実行毎の性能の記録をファイルに追記し、遅い実行を探す関数の実装
+
+    Copyright © 2017 @dc1394 All Rights Reserved.
+    This software is released under the BSD 2-Clause License.
+*/
+
+#include "perfledger.h"
+#include "../../checkpoint/checkpoint.h"
+#include <cmath>                // for std::sqrt
+#include <ctime>                // for std::gmtime, std::strftime, std::time
+#include <fstream>              // for std::ifstream
+#include <iostream>             // for std::cerr
+#include <map>                  // for std::map
+#include <sstream>              // for std::istringstream, std::ostringstream
+#include <stdexcept>            // for std::logic_error, std::runtime_error
+#include <tbb/task_arena.h>     // for tbb::this_task_arena
+
+#ifdef _WIN32
+    #include <Windows.h>        // for CreateFileA, GetComputerNameA, LockFileEx
+    #include <intrin.h>         // for __cpuid
+    #include <sys/stat.h>       // for _stat64
+#else
+    #include <fcntl.h>          // for open
+    #include <sys/file.h>       // for flock
+    #include <sys/stat.h>       // for stat
+    #include <unistd.h>         // for close, gethostname, read, write
+#endif
+
+namespace perfledger {
+    namespace {
+        //! A global variable (constant expression).
+        /*!
+            チェックポイントの区間の名称と経過時間の区切り
+        */
+        static char constexpr PHASESEP = ';';
+
+        //! A function.
+        /*!
+            実行の重さを返す（試行回数が実行毎に異なる制限時間付きの実行も比べられるようにする）
+            \param record 実行の記録
+            \return 1試行当たりの経過時間（試行を行わない実行は経過時間、ミリ秒）
+        */
+        double cost(Record const & record)
+        {
+            return record.trials ? record.total / static_cast<double>(record.trials) : record.total;
+        }
+
+        //! A function.
+        /*!
+            値の中で区切りとして使う文字を空白に置き換える
+            \param str 文字列
+            \param extra 空白に置き換える追加の文字（0の場合はなし）
+            \return 置き換えた文字列
+        */
+        std::string sanitize(std::string str, char extra = '\0')
+        {
+            for (auto && c : str) {
+                if (c == '\t' || c == '\n' || c == '\r' || (extra && (c == extra || c == ':'))) {
+                    c = ' ';
+                }
+            }
+
+            return str;
+        }
+
+        //! A function.
+        /*!
+            時刻をUTCのISO 8601の文字列に変換する
+            \param t 時刻
+            \return ISO 8601の文字列
+        */
+        std::string isotime(std::time_t t)
+        {
+            std::tm tm;
+#ifdef _WIN32
+            ::gmtime_s(&tm, &t);
+#else
+            ::gmtime_r(&t, &tm);
+#endif
+            char buf[32];
+            std::strftime(buf, sizeof(buf), "%Y-%m-%dT%H:%M:%SZ", &tm);
+
+            return buf;
+        }
+
+        //! A function.
+        /*!
+            ホスト名を返す
+            \return ホスト名
+        */
+        std::string hostname()
+        {
+#ifdef _WIN32
+            char buf[MAX_COMPUTERNAME_LENGTH + 1];
+            DWORD size = sizeof(buf);
+            return ::GetComputerNameA(buf, &size) ? std::string(buf, size) : std::string("unknown");
+#else
+            char buf[256] = {};
+            return ::gethostname(buf, sizeof(buf) - 1U) ? std::string("unknown") : std::string(buf);
+#endif
+        }
+
+        //! A function.
+        /*!
+            CPUの名称を返す
+            \return CPUの名称
+        */
+        std::string cpumodel()
+        {
+#ifdef _WIN32
+            int regs[4];
+            char brand[49] = {};
+            ::__cpuid(regs, 0x80000000);
+            if (static_cast<unsigned int>(regs[0]) < 0x80000004U) {
+                return "unknown";
+            }
+
+            for (auto i = 0; i < 3; i++) {
+                ::__cpuid(reinterpret_cast<int *>(brand + 16 * i), 0x80000002 + i);
+            }
+
+            return brand;
+#else
+            std::ifstream ifs("/proc/cpuinfo");
+            std::string line;
+            while (std::getline(ifs, line)) {
+                if (line.compare(0U, 10U, "model name") == 0) {
+                    auto const pos = line.find(':');
+                    if (pos != std::string::npos && pos + 2U <= line.size()) {
+                        return line.substr(pos + 2U);
+                    }
+                }
+            }
+
+            return "unknown";
+#endif
+        }
+
+        //! A function.
+        /*!
+            ビルドの識別子（コンパイラと、実行ファイルの更新日時）を返す
+            \return ビルドの識別子
+        */
+        std::string buildid()
+        {
+#if defined(_MSC_VER)
+            std::string compiler = "MSVC " + std::to_string(_MSC_FULL_VER);
+            char path[MAX_PATH];
+            struct _stat64 st;
+            auto const ok = ::GetModuleFileNameA(nullptr, path, MAX_PATH) && !::_stat64(path, &st);
+#else
+            std::string compiler = __VERSION__;
+            struct stat st;
+            auto const ok = !::stat("/proc/self/exe", &st);
+#endif
+            return compiler + " " + (ok ? isotime(st.st_mtime) : std::string("unknown"));
+        }
+
+        //! A function.
+        /*!
+            実行の記録を一行の文字列に変換する
+            \param record 実行の記録
+            \return 改行を含む一行の文字列
+        */
+        std::string format(Record const & record)
+        {
+            std::ostringstream oss;
+            oss << "time=" << record.time
+                << "\thost=" << sanitize(record.host)
+                << "\tcpu=" << sanitize(record.cpu)
+                << "\tthreads=" << record.threads
+                << "\tbuild=" << sanitize(record.build)
+                << "\tmode=" << sanitize(record.mode)
+                << "\tengine=" << sanitize(record.engine)
+                << "\tconfig=" << sanitize(record.config)
+                << "\ttrials=" << record.trials
+                << "\tpeakrss=" << record.peakrss;
+
+            oss.setf(std::ios::fixed);
+            oss.precision(4);
+            oss << "\ttotal=" << record.total;
+
+            oss.precision(1);
+            oss << "\ttrialspersec=" << record.trialspersec;
+
+            oss.precision(4);
+            oss << "\tphases=";
+            for (auto i = 0U; i < record.phases.size(); i++) {
+                oss << (i ? std::string(1, PHASESEP) : std::string())
+                    << sanitize(record.phases[i].first, PHASESEP) << ':' << record.phases[i].second;
+            }
+
+            oss << '\n';
+
+            return oss.str();
+        }
+
+        //! A function.
+        /*!
+            一行の文字列を実行の記録に変換する
+            \param line 一行の文字列
+            \return 実行の記録
+            \throw std::logic_error 数値の値が読めない場合（std::invalid_argumentかstd::out_of_range）
+        */
+        Record parse(std::string const & line)
+        {
+            Record record;
+
+            std::istringstream iss(line);
+            std::string field;
+            while (std::getline(iss, field, '\t')) {
+                auto const eq = field.find('=');
+                if (eq == std::string::npos) {
+                    continue;
+                }
+
+                auto const key = field.substr(0U, eq);
+                auto const value = field.substr(eq + 1U);
+
+                if (key == "time") {
+                    record.time = value;
+                }
+                else if (key == "host") {
+                    record.host = value;
+                }
+                else if (key == "cpu") {
+                    record.cpu = value;
+                }
+                else if (key == "threads") {
+                    record.threads = static_cast<std::uint32_t>(std::stoul(value));
+                }
+                else if (key == "build") {
+                    record.build = value;
+                }
+                else if (key == "mode") {
+                    record.mode = value;
+                }
+                else if (key == "engine") {
+                    record.engine = value;
+                }
+                else if (key == "config") {
+                    record.config = value;
+                }
+                else if (key == "trials") {
+                    record.trials = std::stoull(value);
+                }
+                else if (key == "peakrss") {
+                    record.peakrss = std::stoull(value);
+                }
+                else if (key == "total") {
+                    record.total = std::stod(value);
+                }
+                else if (key == "trialspersec") {
+                    record.trialspersec = std::stod(value);
+                }
+                else if (key == "phases") {
+                    std::istringstream phases(value);
+                    std::string phase;
+                    while (std::getline(phases, phase, PHASESEP)) {
+                        auto const colon = phase.rfind(':');
+                        if (colon != std::string::npos) {
+                            record.phases.emplace_back(phase.substr(0U, colon), std::stod(phase.substr(colon + 1U)));
+                        }
+                    }
+                }
+            }
+
+            return record;
+        }
+    }
+
+    // #region 非メンバ関数
+
+    void append(std::string const & filename, Record const & record)
+    {
+        auto const line = format(record);
+
+#ifdef _WIN32
+        auto const file = ::CreateFileA(
+            filename.c_str(), FILE_APPEND_DATA, FILE_SHARE_READ | FILE_SHARE_WRITE, nullptr, OPEN_ALWAYS, FILE_ATTRIBUTE_NORMAL, nullptr);
+        if (file == INVALID_HANDLE_VALUE) {
+            throw std::runtime_error("ファイルを開けませんでした: " + filename);
+        }
+
+        // 他のプロセスの追記と混ざらないように、ファイル全体を排他ロックしてから書き込む
+        OVERLAPPED ov = {};
+        DWORD written = 0;
+        auto const ok = ::LockFileEx(file, LOCKFILE_EXCLUSIVE_LOCK, 0, MAXDWORD, MAXDWORD, &ov) &&
+            ::WriteFile(file, line.data(), static_cast<DWORD>(line.size()), &written, nullptr) &&
+            written == line.size();
+        ::UnlockFileEx(file, 0, MAXDWORD, MAXDWORD, &ov);
+        ::CloseHandle(file);
+#else
+        auto const fd = ::open(filename.c_str(), O_WRONLY | O_APPEND | O_CREAT, 0644);
+        if (fd < 0) {
+            throw std::runtime_error("ファイルを開けませんでした: " + filename);
+        }
+
+        // 他のプロセスの追記と混ざらないように、ファイル全体を排他ロックしてから書き込む
+        auto ok = !::flock(fd, LOCK_EX);
+        for (std::size_t done = 0U; ok && done < line.size();) {
+            auto const n = ::write(fd, line.data() + done, line.size() - done);
+            ok = n > 0;
+            done += ok ? static_cast<std::size_t>(n) : 0U;
+        }
+        ::flock(fd, LOCK_UN);
+        ::close(fd);
+#endif
+
+        if (!ok) {
+            throw std::runtime_error("ファイルに書き込めませんでした: " + filename);
+        }
+    }
+
+    std::vector<SlowRun> findslow(std::vector<Record> const & records, double nsigma, std::uint64_t minhistory)
+    {
+        //! A struct.
+        /*!
+            同じ設定のそれまでの実行の重さの平均と分散（Welfordの方法）
+        */
+        struct History final {
+            //! 平均からの偏差の2乗の和
+            double m2 = 0.0;
+
+            //! 平均
+            double mean = 0.0;
+
+            //! 実行の数
+            std::uint64_t n = 0U;
+        };
+
+        std::map<std::string, History> histories;
+        std::vector<SlowRun> slow;
+
+        for (auto const & record : records) {
+            // 指定した試行回数はconfigに含まれるので、実際の試行回数はキーにせず1試行当たりの経過時間で比べる
+            auto & h = histories[
+                record.host + '\t' + record.cpu + '\t' + std::to_string(record.threads) + '\t' +
+                record.mode + '\t' + record.engine + '\t' + record.config];
+
+            auto const c = cost(record);
+            if (h.n >= minhistory && h.n > 1U) {
+                auto const stddev = std::sqrt(h.m2 / static_cast<double>(h.n - 1U));
+                if (stddev > 0.0 && c - h.mean >= nsigma * stddev) {
+                    slow.push_back({ record, h.mean, h.n, stddev, (c - h.mean) / stddev });
+                }
+            }
+
+            h.n++;
+            auto const delta = c - h.mean;
+            h.mean += delta / static_cast<double>(h.n);
+            h.m2 += delta * (c - h.mean);
+        }
+
+        return slow;
+    }
+
+    Record makerecord(std::string const & mode, std::string const & engine, std::string const & config, std::uint64_t trials)
+    {
+        Record record;
+        record.build = buildid();
+        record.config = config;
+        record.cpu = cpumodel();
+        record.engine = engine;
+        record.host = hostname();
+        record.mode = mode;
+        record.peakrss = checkpoint::peakmemory();
+        record.threads = static_cast<std::uint32_t>(tbb::this_task_arena::max_concurrency());
+        record.time = isotime(std::time(nullptr));
+        record.trials = trials;
+
+        // 各CheckPointの最初のチェックポイントを除く、全ての区間の経過時間
+        for (auto n = 0; n < checkpoint::currentphase(); n++) {
+            auto const name = checkpoint::phasename(n);
+            auto const elapsed = checkpoint::phaseelapsed(n);
+            if (name && elapsed >= 0.0) {
+                record.phases.emplace_back(name, elapsed);
+                record.total += elapsed;
+            }
+        }
+
+        record.trialspersec = record.total > 0.0 ? static_cast<double>(trials) / (record.total / 1000.0) : 0.0;
+
+        return record;
+    }
+
+    std::vector<Record> read(std::string const & filename)
+    {
+        std::string data;
+
+#ifdef _WIN32
+        auto const file = ::CreateFileA(
+            filename.c_str(), GENERIC_READ, FILE_SHARE_READ | FILE_SHARE_WRITE, nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr);
+        if (file == INVALID_HANDLE_VALUE) {
+            throw std::runtime_error("ファイルを開けませんでした: " + filename);
+        }
+
+        // 追記の途中の行を読まないように、共有ロックしてから読み込む
+        OVERLAPPED ov = {};
+        ::LockFileEx(file, 0, 0, MAXDWORD, MAXDWORD, &ov);
+        char buf[65536];
+        DWORD n = 0;
+        while (::ReadFile(file, buf, sizeof(buf), &n, nullptr) && n) {
+            data.append(buf, n);
+        }
+        ::UnlockFileEx(file, 0, MAXDWORD, MAXDWORD, &ov);
+        ::CloseHandle(file);
+#else
+        auto const fd = ::open(filename.c_str(), O_RDONLY);
+        if (fd < 0) {
+            throw std::runtime_error("ファイルを開けませんでした: " + filename);
+        }
+
+        // 追記の途中の行を読まないように、共有ロックしてから読み込む
+        ::flock(fd, LOCK_SH);
+        char buf[65536];
+        for (auto n = ::read(fd, buf, sizeof(buf)); n > 0; n = ::read(fd, buf, sizeof(buf))) {
+            data.append(buf, static_cast<std::size_t>(n));
+        }
+        ::flock(fd, LOCK_UN);
+        ::close(fd);
+#endif
+
+        std::vector<Record> records;
+        std::istringstream iss(data);
+        std::string line;
+        for (auto n = 1U; std::getline(iss, line); n++) {
+            if (line.empty()) {
+                continue;
+            }
+
+            // 壊れた行は飛ばして、残りの記録を読み込む
+            try {
+                records.push_back(parse(line));
+            }
+            catch (std::logic_error const & e) {
+                std::cerr << filename << "の" << n << "行目の値を読めないので飛ばします: " << e.what() << std::endl;
+            }
+        }
+
+        return records;
+    }
+
+    // #endregion 非メンバ関数
+}
@@ -0,0 +1,186 @@
+﻿/*! \file perfledger.h
+    \brief 実行毎の性能の記録をファイルに追記し、遅い実行を探す関数の宣言
+
+    Copyright © 2017 @dc1394 All Rights Reserved.
+    This software is released under the BSD 2-Clause License.
+*/
+
+#ifndef _PERFLEDGER_H_
+#define _PERFLEDGER_H_
+
+#pragma once
+
+#include <cstdint>  // for std::uint32_t, std::uint64_t
+#include <string>   // for std::string
+#include <utility>  // for std::pair
+#include <vector>   // for std::vector
+
+namespace perfledger {
+    //! A struct.
+    /*!
+        一回の実行の性能の記録（ファイルでは一行の「キー=値」のタブ区切り）
+    */
+    struct Record final {
+        //! A public member variable.
+        /*!
+            ビルドの識別子（コンパイラとビルドの日時）
+        */
+        std::string build;
+
+        //! A public member variable.
+        /*!
+            既定値から変えたオプション（ホスト、CPU、スレッド数、モード、計算の方法とともに、同じ設定の実行同士を比較する）
+        */
+        std::string config;
+
+        //! A public member variable.
+        /*!
+            CPUの名称
+        */
+        std::string cpu;
+
+        //! A public member variable.
+        /*!
+            計算の方法
+        */
+        std::string engine;
+
+        //! A public member variable.
+        /*!
+            ホスト名
+        */
+        std::string host;
+
+        //! A public member variable.
+        /*!
+            実行したモード
+        */
+        std::string mode;
+
+        //! A public member variable.
+        /*!
+            チェックポイントの区間毎の名称と経過時間（ミリ秒）
+        */
+        std::vector<std::pair<std::string, double>> phases;
+
+        //! A public member variable.
+        /*!
+            最大のメモリ使用量（kB）
+        */
+        std::uint64_t peakrss = 0U;
+
+        //! A public member variable.
+        /*!
+            スレッド数
+        */
+        std::uint32_t threads = 0U;
+
+        //! A public member variable.
+        /*!
+            記録した日時（UTC、ISO 8601）
+        */
+        std::string time;
+
+        //! A public member variable.
+        /*!
+            区間の経過時間の合計（ミリ秒）
+        */
+        double total = 0.0;
+
+        //! A public member variable.
+        /*!
+            実際に行った試行回数（制限時間付きの実行では完了した試行のみ）
+        */
+        std::uint64_t trials = 0U;
+
+        //! A public member variable.
+        /*!
+            1秒当たりの試行回数
+        */
+        double trialspersec = 0.0;
+    };
+
+    //! A struct.
+    /*!
+        同じ設定のそれまでの実行より遅い実行
+    */
+    struct SlowRun final {
+        //! A public member variable.
+        /*!
+            遅い実行の記録
+        */
+        Record record;
+
+        //! A public member variable.
+        /*!
+            同じ設定のそれまでの実行の、1試行当たりの経過時間（試行を行わない実行は経過時間）の平均（ミリ秒）
+        */
+        double mean;
+
+        //! A public member variable.
+        /*!
+            同じ設定のそれまでの実行の数
+        */
+        std::uint64_t nhistory;
+
+        //! A public member variable.
+        /*!
+            同じ設定のそれまでの実行の、1試行当たりの経過時間（試行を行わない実行は経過時間）の標準偏差（ミリ秒）
+        */
+        double stddev;
+
+        //! A public member variable.
+        /*!
+            平均からの隔たり（標準偏差の何倍か）
+        */
+        double zscore;
+    };
+
+    // #region 非メンバ関数
+
+    //! A function.
+    /*!
+        実行の記録をファイルの末尾に一行で追記する
+        複数のプロセスから同時に追記しても、ファイルを排他ロックするので行は混ざらない
+        \param filename ファイル名
+        \param record 実行の記録
+    */
+    void append(std::string const & filename, Record const & record);
+
+    //! A function.
+    /*!
+        現在のプロセスの実行の記録を作る
+        ホスト名、CPUの名称、スレッド数、ビルドの識別子、チェックポイントの区間毎の経過時間と
+        最大のメモリ使用量は、この関数が集める
+        \param mode 実行したモード
+        \param engine 計算の方法
+        \param config 実行の設定
+        \param trials 実際に行った試行回数
+        \return 実行の記録
+    */
+    Record makerecord(std::string const & mode, std::string const & engine, std::string const & config, std::uint64_t trials);
+
+    //! A function.
+    /*!
+        ファイルから全ての実行の記録を読み込む（読み込む間は共有ロックする）
+        値を読めない行は、警告を表示して飛ばす
+        \param filename ファイル名
+        \return 記録された順の実行の記録
+    */
+    std::vector<Record> read(std::string const & filename);
+
+    //! A function.
+    /*!
+        同じホスト、CPU、スレッド数、モード、計算の方法と設定のそれまでの実行の1試行当たりの経過時間
+        （試行を行わない実行は経過時間）の平均より、標準偏差のnsigma倍以上遅い実行を探す
+        \param records 記録された順の実行の記録
+        \param nsigma 標準偏差の倍数
+        \param minhistory 比較に必要な、同じ設定のそれまでの実行の最小の数
+        \return 遅い実行
+    */
+    std::vector<SlowRun> findslow(std::vector<Record> const & records, double nsigma, std::uint64_t minhistory);
+
+    // #endregion 非メンバ関数
+}
+
+#endif  // _PERFLEDGER_H_
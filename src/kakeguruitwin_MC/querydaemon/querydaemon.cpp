@@ -0,0 +1,542 @@
+﻿/*! \file querydaemon.cpp
+    \brief Unixドメインソケットで勝率の問い合わせに答えるデーモンクラスの実装
+
+    Copyright © 2017 @dc1394 All Rights Reserved.
+    This software is released under the BSD 2-Clause License.
+*/
+
+#include "querydaemon.h"
+#include "../pattern/pattern.h"
+#include <cstdio>           // for std::snprintf
+#include <cstring>          // for std::strncpy
+#include <exception>        // for std::current_exception, std::exception
+#include <memory>           // for std::make_shared
+#include <sstream>          // for std::istringstream
+#include <string>           // for std::to_string
+#include <stdexcept>        // for std::invalid_argument, std::runtime_error
+#include <tuple>            // for std::get, std::make_tuple
+#include <utility>          // for std::make_pair
+#include <tbb/task_arena.h> // for tbb::task_arena
+
+#ifndef _WIN32
+    #include <cerrno>       // for errno, EINTR
+    #include <fcntl.h>      // for fcntl
+    #include <poll.h>       // for poll
+    #include <signal.h>     // for sigaction
+    #include <sys/socket.h> // for accept, bind, listen, recv, send, shutdown, socket
+    #include <sys/stat.h>   // for lstat, S_ISSOCK
+    #include <sys/un.h>     // for sockaddr_un
+    #include <unistd.h>     // for close, pipe, unlink, write
+#endif
+
+namespace querydaemon {
+#ifndef _WIN32
+    namespace {
+        //! A global variable.
+        /*!
+            runを実行しているデーモンの、終了を知らせるパイプの書き込み側（実行していない場合は-1）
+        */
+        volatile sig_atomic_t stopfd = -1;
+
+        //! A function.
+        /*!
+            SIGINTとSIGTERMのシグナルハンドラ
+            終了を知らせるパイプに書き込む（非同期シグナル安全な関数だけを呼ぶ）
+        */
+        void stophandler(int)
+        {
+            auto const saved = errno;
+            if (stopfd >= 0) {
+                char const c = 0;
+                static_cast<void>(::write(stopfd, &c, 1U));
+            }
+            errno = saved;
+        }
+    }
+#endif
+
+    // #region コンストラクタ・デストラクタ
+
+    QueryDaemon::QueryDaemon(
+        std::string const & path,
+        std::uint64_t trials,
+        std::size_t cachesize,
+        std::uint64_t maxtrials,
+        std::uint32_t maxhorizon)
+        : cachesize_(cachesize),
+          connstop_(false),
+          listenfd_(-1),
+          maxhorizon_(maxhorizon),
+          maxtrials_(maxtrials),
+          path_(path),
+          pipefd_{ -1, -1 },
+          sim_(tbb::task_arena::automatic),
+          stop_(false),
+          trials_(trials)
+    {
+#ifdef _WIN32
+        throw std::runtime_error("Windowsではデーモンモードに対応していません");
+#else
+        if (!trials_ || !cachesize_ || !maxhorizon_) {
+            throw std::invalid_argument("試行回数、キャッシュの件数の上限とUかDの文字列の長さの上限は1以上でなければなりません");
+        }
+
+        if (trials_ > maxtrials_) {
+            throw std::invalid_argument("試行回数が問い合わせの試行回数の上限を超えています");
+        }
+
+        sockaddr_un addr = {};
+        if (path_.size() >= sizeof(addr.sun_path)) {
+            throw std::invalid_argument("ソケットのパスが長すぎます: " + path_);
+        }
+
+        addr.sun_family = AF_UNIX;
+        std::strncpy(addr.sun_path, path_.c_str(), sizeof(addr.sun_path) - 1U);
+
+        // 前回のソケットのファイルが残っていれば削除する（パスの誤りで他のファイルを消さないよう、ソケット以外は削除しない）
+        struct stat st;
+        if (!::lstat(path_.c_str(), &st)) {
+            if (!S_ISSOCK(st.st_mode)) {
+                throw std::invalid_argument("ソケット以外のファイルが既に存在します: " + path_);
+            }
+
+            ::unlink(path_.c_str());
+        }
+
+        listenfd_ = ::socket(AF_UNIX, SOCK_STREAM, 0);
+        if (listenfd_ < 0) {
+            throw std::runtime_error("ソケットを作成できませんでした");
+        }
+
+        if (::bind(listenfd_, reinterpret_cast<sockaddr const *>(&addr), sizeof(addr)) < 0 ||
+            ::listen(listenfd_, SOMAXCONN) < 0) {
+            ::close(listenfd_);
+            throw std::runtime_error("ソケットを開けませんでした: " + path_);
+        }
+
+        // シグナルハンドラが書き込むときに待たないよう、書き込み側は非ブロッキングにする
+        if (::pipe(pipefd_) || ::fcntl(pipefd_[1], F_SETFL, O_NONBLOCK)) {
+            ::close(listenfd_);
+            ::unlink(path_.c_str());
+            throw std::runtime_error("パイプを作成できませんでした");
+        }
+
+        worker_ = std::thread(&QueryDaemon::batchloop, this);
+
+        for (auto i = 0U; i < MAXCONNECTION; i++) {
+            servers_.emplace_back(&QueryDaemon::serveloop, this);
+        }
+#endif
+    }
+
+    QueryDaemon::~QueryDaemon()
+    {
+#ifndef _WIN32
+        // 先に接続を処理するスレッドを終了する（計算を待っている問い合わせには計算用のスレッドが答える）
+        {
+            std::lock_guard<std::mutex> lock(connmtx_);
+            connstop_ = true;
+
+            // 処理している接続は、recvから戻るよう読み込みだけを止める（計算中の問い合わせの答えは送る、閉じるのは処理しているスレッド）
+            for (auto const fd : active_) {
+                ::shutdown(fd, SHUT_RD);
+            }
+
+            for (auto const fd : accepted_) {
+                ::close(fd);
+            }
+
+            accepted_.clear();
+        }
+        conncv_.notify_all();
+
+        for (auto & server : servers_) {
+            server.join();
+        }
+
+        // 条件の確認と待機の間に通知を失わないよう、pendingmtx_をロックして書き込む
+        {
+            std::lock_guard<std::mutex> lock(pendingmtx_);
+            stop_ = true;
+        }
+        cv_.notify_all();
+
+        if (worker_.joinable()) {
+            worker_.join();
+        }
+
+        if (listenfd_ >= 0) {
+            ::close(listenfd_);
+            ::unlink(path_.c_str());
+        }
+
+        for (auto const fd : pipefd_) {
+            if (fd >= 0) {
+                ::close(fd);
+            }
+        }
+#endif
+    }
+
+    // #endregion コンストラクタ・デストラクタ
+
+    // #region publicメンバ関数
+
+    std::string QueryDaemon::query(std::string const & line)
+    {
+        try {
+            std::istringstream iss(line);
+            std::string a, b;
+            std::uint32_t horizon;
+            double bias;
+            if (!(iss >> a >> b >> horizon >> bias)) {
+                throw std::invalid_argument("問い合わせの形式は「A B horizon bias [trials]」でなければなりません");
+            }
+
+            // 試行回数は省略できる（厳密に計算する場合は使わない）
+            auto trials = trials_;
+            std::string str;
+            if (iss >> str) {
+                if (str.find_first_not_of("0123456789") != std::string::npos || !(std::istringstream(str) >> trials) || !trials || iss >> str) {
+                    throw std::invalid_argument("問い合わせの試行回数は1以上の整数でなければなりません");
+                }
+            }
+
+            if (!(bias > 0.0 && bias < 1.0)) {
+                throw std::invalid_argument("Uが出る確率は0より大きく1より小さくなければなりません");
+            }
+
+            // 一つの問い合わせが計算用のスレッドを占有し続けないよう、上限を超えるものは計算しない
+            if (horizon > maxhorizon_) {
+                throw std::invalid_argument("UかDの文字列の長さは" + std::to_string(maxhorizon_) + "以下でなければなりません");
+            }
+
+            if (trials > maxtrials_) {
+                throw std::invalid_argument("試行回数は" + std::to_string(maxtrials_) + "以下でなければなりません");
+            }
+
+            if (!horizon) {
+                trials = 0U;
+            }
+
+            pattern::tocode(a);
+            pattern::tocode(b);
+            if (a == b) {
+                throw std::invalid_argument("同じ文字列同士の確率は求められません");
+            }
+
+            key const k(a, b, horizon, bias, trials);
+            simulator::PairResult result;
+
+            auto found = false;
+            {
+                std::lock_guard<std::mutex> lock(cachemtx_);
+                found = cachefind(k, result);
+            }
+
+            if (!found && !horizon) {
+                // UかDの文字列の長さが無限大の場合は厳密に計算する（計算用のスレッドのシミュレーションの終了は待たない）
+                simulator::RunConfig config;
+                config.bias = bias;
+                config.engine = simulator::Engine::EXACT;
+                config.patterns = { a, b };
+                config.pairs = { std::make_pair(0U, 1U) };
+
+                result = sim_.run(config).pairs.front();
+
+                std::lock_guard<std::mutex> lock(cachemtx_);
+                cacheput(k, result);
+            }
+            else if (!found) {
+                // 計算用のスレッドにまとめて計算させる
+                auto const p = std::make_shared<Pending>();
+                p->k = k;
+                auto future = p->promise.get_future();
+
+                {
+                    std::lock_guard<std::mutex> lock(pendingmtx_);
+                    pending_.push_back(p);
+                }
+                cv_.notify_one();
+
+                result = future.get();
+            }
+
+            char buf[128];
+            std::snprintf(
+                buf,
+                sizeof(buf),
+                "ok %.10g %.10g %llu",
+                result.probability,
+                result.stderror,
+                static_cast<unsigned long long>(trials));
+
+            return buf;
+        }
+        catch (std::exception const & e) {
+            return std::string("error ") + e.what();
+        }
+    }
+
+    void QueryDaemon::run()
+    {
+#ifndef _WIN32
+        // SIGINTとSIGTERMを受け取ったら、パイプを通じてこのループを終える
+        struct sigaction sa = {};
+        sa.sa_handler = stophandler;
+        ::sigemptyset(&sa.sa_mask);
+
+        struct sigaction oldint, oldterm;
+        stopfd = pipefd_[1];
+        ::sigaction(SIGINT, &sa, &oldint);
+        ::sigaction(SIGTERM, &sa, &oldterm);
+
+        // 元のシグナルハンドラに戻す
+        auto const restore = [&] {
+            ::sigaction(SIGINT, &oldint, nullptr);
+            ::sigaction(SIGTERM, &oldterm, nullptr);
+            stopfd = -1;
+        };
+
+        for (;;) {
+            pollfd fds[2] = { { listenfd_, POLLIN, 0 }, { pipefd_[0], POLLIN, 0 } };
+            if (::poll(fds, 2U, -1) < 0) {
+                if (errno == EINTR) {
+                    continue;
+                }
+
+                restore();
+                throw std::runtime_error("接続を待てませんでした");
+            }
+
+            if (fds[1].revents) {
+                restore();
+                return;
+            }
+
+            if (!fds[0].revents) {
+                continue;
+            }
+
+            auto const fd = ::accept(listenfd_, nullptr, nullptr);
+            if (fd < 0) {
+                if (errno == EINTR || errno == ECONNABORTED) {
+                    continue;
+                }
+
+                restore();
+                throw std::runtime_error("接続を受け付けられませんでした");
+            }
+
+            {
+                std::lock_guard<std::mutex> lock(connmtx_);
+                if (accepted_.size() < MAXCONNECTION) {
+                    accepted_.push_back(fd);
+                    conncv_.notify_one();
+                    continue;
+                }
+            }
+
+            // 待っている接続が多すぎる場合は、エラーを答えて閉じる
+            static char const busy[] = "error 接続が多すぎます\n";
+            ::send(fd, busy, sizeof(busy) - 1U, MSG_NOSIGNAL);
+            ::close(fd);
+        }
+#endif
+    }
+
+    // #endregion publicメンバ関数
+
+    // #region privateメンバ関数
+
+    void QueryDaemon::batchloop()
+    {
+        for (;;) {
+            std::vector<std::shared_ptr<Pending>> batch;
+            {
+                std::unique_lock<std::mutex> lock(pendingmtx_);
+                cv_.wait(lock, [this] { return stop_ || !pending_.empty(); });
+                if (stop_ && pending_.empty()) {
+                    return;
+                }
+
+                batch.swap(pending_);
+            }
+
+            // UかDの文字列の長さとUが出る確率と試行回数毎にまとめる（前の計算でキャッシュに入ったものはそのまま返す）
+            std::map<std::tuple<std::uint32_t, double, std::uint64_t>, std::vector<std::shared_ptr<Pending>>> groups;
+            {
+                std::lock_guard<std::mutex> lock(cachemtx_);
+                for (auto const & p : batch) {
+                    simulator::PairResult result;
+                    if (cachefind(p->k, result)) {
+                        p->promise.set_value(result);
+                    }
+                    else {
+                        groups[std::make_tuple(std::get<2>(p->k), std::get<3>(p->k), std::get<4>(p->k))].push_back(p);
+                    }
+                }
+            }
+
+            for (auto const & group : groups) {
+                simulator::RunConfig config;
+                config.bias = std::get<1>(group.first);
+                config.horizon = std::get<0>(group.first);
+                config.trials = std::get<2>(group.first);
+
+                // 文字列とペアの重複を除いて、一度のシミュレーションで全てのペアを計算する
+                std::map<std::string, std::uint32_t> patternindex;
+                std::map<simulator::indexpair, std::size_t> pairindex;
+                auto const index = [&](std::string const & str) {
+                    auto const itr = patternindex.emplace(str, static_cast<std::uint32_t>(config.patterns.size()));
+                    if (itr.second) {
+                        config.patterns.push_back(str);
+                    }
+
+                    return itr.first->second;
+                };
+
+                for (auto const & p : group.second) {
+                    auto const pair = std::make_pair(index(std::get<0>(p->k)), index(std::get<1>(p->k)));
+                    if (pairindex.emplace(pair, config.pairs.size()).second) {
+                        config.pairs.push_back(pair);
+                    }
+                }
+
+                try {
+                    auto const result(sim_.run(config));
+
+                    std::lock_guard<std::mutex> lock(cachemtx_);
+                    for (auto const & p : group.second) {
+                        auto const & pr = result.pairs[pairindex[std::make_pair(
+                            patternindex[std::get<0>(p->k)], patternindex[std::get<1>(p->k)])]];
+                        cacheput(p->k, pr);
+                        p->promise.set_value(pr);
+                    }
+                }
+                catch (...) {
+                    for (auto const & p : group.second) {
+                        p->promise.set_exception(std::current_exception());
+                    }
+                }
+            }
+        }
+    }
+
+    bool QueryDaemon::cachefind(key const & k, simulator::PairResult & result)
+    {
+        auto const itr = cache_.find(k);
+        if (itr == cache_.end()) {
+            return false;
+        }
+
+        // 最近使ったものとしてリストの先頭に移す
+        lru_.splice(lru_.begin(), lru_, itr->second.second);
+        result = itr->second.first;
+
+        return true;
+    }
+
+    void QueryDaemon::cacheput(key const & k, simulator::PairResult const & result)
+    {
+        auto const itr = cache_.find(k);
+        if (itr != cache_.end()) {
+            itr->second.first = result;
+            lru_.splice(lru_.begin(), lru_, itr->second.second);
+            return;
+        }
+
+        lru_.push_front(k);
+        cache_.emplace(k, std::make_pair(result, lru_.begin()));
+
+        // 上限を超えたら、最も長く使われていないものを捨てる
+        if (cache_.size() > cachesize_) {
+            cache_.erase(lru_.back());
+            lru_.pop_back();
+        }
+    }
+
+    void QueryDaemon::serve(int fd)
+    {
+#ifndef _WIN32
+        std::string buffer;
+        char chunk[4096];
+
+        for (;;) {
+            auto const n = ::recv(fd, chunk, sizeof(chunk), 0);
+            if (n < 0 && errno == EINTR) {
+                continue;
+            }
+            if (n <= 0) {
+                break;
+            }
+
+            buffer.append(chunk, static_cast<std::size_t>(n));
+
+            // 改行までを一つの問い合わせとして答える
+            std::string::size_type pos;
+            std::string response;
+            while ((pos = buffer.find('\n')) != std::string::npos) {
+                response += query(buffer.substr(0U, pos)) + '\n';
+                buffer.erase(0U, pos + 1U);
+            }
+
+            // 改行が来ないまま長くなり続ける問い合わせは、エラーを答えて接続を閉じる
+            auto const overflow = buffer.size() > MAXLINE;
+            if (overflow) {
+                response += "error 問い合わせが" + std::to_string(MAXLINE) + "バイトを超えています\n";
+            }
+
+            for (std::size_t sent = 0U; sent < response.size();) {
+                auto const m = ::send(fd, response.data() + sent, response.size() - sent, MSG_NOSIGNAL);
+                if (m < 0 && errno == EINTR) {
+                    continue;
+                }
+                if (m <= 0) {
+                    return;
+                }
+
+                sent += static_cast<std::size_t>(m);
+            }
+
+            if (overflow) {
+                return;
+            }
+        }
+#else
+        static_cast<void>(fd);
+#endif
+    }
+
+    void QueryDaemon::serveloop()
+    {
+#ifndef _WIN32
+        for (;;) {
+            int fd;
+            {
+                std::unique_lock<std::mutex> lock(connmtx_);
+                conncv_.wait(lock, [this] { return connstop_ || !accepted_.empty(); });
+                if (connstop_) {
+                    return;
+                }
+
+                fd = accepted_.front();
+                accepted_.pop_front();
+                active_.insert(fd);
+            }
+
+            serve(fd);
+
+            // 閉じた後にデストラクタがshutdownしないよう、active_から除いてから閉じる
+            {
+                std::lock_guard<std::mutex> lock(connmtx_);
+                active_.erase(fd);
+            }
+
+            ::close(fd);
+        }
+#endif
+    }
+
+    // #endregion privateメンバ関数
+}
@@ -0,0 +1,334 @@
+﻿/*! \file querydaemon.h
+    \brief Unixドメインソケットで勝率の問い合わせに答えるデーモンクラスの宣言
+
+    Copyright © 2017 @dc1394 All Rights Reserved.
+    This software is released under the BSD 2-Clause License.
+*/
+
+#ifndef _QUERYDAEMON_H_
+#define _QUERYDAEMON_H_
+
+#pragma once
+
+#include "../simulator/simulator.h"
+#include <atomic>               // for std::atomic
+#include <condition_variable>   // for std::condition_variable
+#include <cstddef>              // for std::size_t
+#include <cstdint>              // for std::uint32_t, std::uint64_t
+#include <deque>                // for std::deque
+#include <future>               // for std::promise
+#include <list>                 // for std::list
+#include <map>                  // for std::map
+#include <memory>               // for std::shared_ptr
+#include <mutex>                // for std::mutex
+#include <set>                  // for std::set
+#include <string>               // for std::string
+#include <thread>               // for std::thread
+#include <tuple>                // for std::tuple
+#include <utility>              // for std::pair
+#include <vector>               // for std::vector
+
+namespace querydaemon {
+    //! A class.
+    /*!
+        Unixドメインソケットで「文字列Aが文字列Bより先に出現する確率」の問い合わせに答えるデーモンクラス
+        一行の問い合わせは「A B horizon bias [trials]」で、horizonが0の場合は無限大とし相関から厳密に計算する
+        trialsを省略した場合は、コンストラクタで指定した試行回数でシミュレーションする
+        trialsとhorizonが上限を超える問い合わせと、biasが0より大きく1より小さくない問い合わせは計算せずにエラーとする
+        答えは「ok probability stderror trials」か「error メッセージ」の一行
+        計算した結果は最近使った順に上限の件数までキャッシュし、
+        キャッシュにない問い合わせは同時に来たものをまとめて一度のシミュレーションで計算する
+        接続はMAXCONNECTION個のスレッドで処理し、待っている接続がMAXCONNECTION個を超えたものと、
+        改行を含まずにMAXLINEバイトを超える問い合わせには、エラーを答えて接続を閉じる
+    */
+    class QueryDaemon final {
+        // #region コンストラクタ・デストラクタ
+
+    public:
+        //! A constructor.
+        /*!
+            唯一のコンストラクタ
+            \param path ソケットのパス
+            \param trials 問い合わせで試行回数を省略した場合のモンテカルロ・シミュレーションの試行回数
+            \param cachesize キャッシュする結果の件数の上限
+            \param maxtrials 問い合わせで指定できる試行回数の上限
+            \param maxhorizon 問い合わせで指定できるUかDの文字列の長さの上限
+        */
+        QueryDaemon(
+            std::string const & path,
+            std::uint64_t trials,
+            std::size_t cachesize,
+            std::uint64_t maxtrials,
+            std::uint32_t maxhorizon);
+
+        //! A destructor.
+        /*!
+            デストラクタ
+            接続を処理するスレッドと計算用のスレッドを終了し、ソケットを閉じる
+        */
+        ~QueryDaemon();
+
+        // #endregion コンストラクタ・デストラクタ
+
+        // #region メンバ関数
+
+        //! A public member function.
+        /*!
+            一行の問い合わせに答える
+            \param line 問い合わせ
+            \return 答え（改行を含まない）
+        */
+        std::string query(std::string const & line);
+
+        //! A public member function.
+        /*!
+            接続を受け付け、SIGINTかSIGTERMを受け取るまで問い合わせに答え続ける
+            シグナルを受け取ると接続の受け付けをやめて戻る（計算中の問い合わせはデストラクタが答え終えるまで待つ）
+        */
+        void run();
+
+    private:
+        //! A typedef.
+        /*!
+            キャッシュのキー（文字列A、文字列B、UかDの文字列の長さ、Uが出る確率、試行回数）
+        */
+        using key = std::tuple<std::string, std::string, std::uint32_t, double, std::uint64_t>;
+
+        //! A typedef.
+        /*!
+            最近使った順のキャッシュのキーのリスト
+        */
+        using lrulist = std::list<key>;
+
+        //! A struct.
+        /*!
+            計算を待っている問い合わせ
+        */
+        struct Pending final {
+            //! A public member variable.
+            /*!
+                キャッシュのキー
+            */
+            key k;
+
+            //! A public member variable.
+            /*!
+                計算結果を受け取るためのpromise
+            */
+            std::promise<simulator::PairResult> promise;
+        };
+
+        //! A private member function.
+        /*!
+            計算を待っている問い合わせを、UかDの文字列の長さとUが出る確率と試行回数毎にまとめて計算する
+        */
+        void batchloop();
+
+        //! A private member function.
+        /*!
+            キャッシュから計算結果を探し、見つかれば最近使ったものにする（cachemtx_をロックして呼ぶ）
+            \param k キャッシュのキー
+            \param result 見つかった計算結果
+            \return 見つかればtrue
+        */
+        bool cachefind(key const & k, simulator::PairResult & result);
+
+        //! A private member function.
+        /*!
+            計算結果をキャッシュに入れ、上限を超えれば最も長く使われていないものを捨てる（cachemtx_をロックして呼ぶ）
+            \param k キャッシュのキー
+            \param result 計算結果
+        */
+        void cacheput(key const & k, simulator::PairResult const & result);
+
+        //! A private member function.
+        /*!
+            一つの接続の問い合わせに答える（接続は閉じない）
+            \param fd 接続のファイルディスクリプタ
+        */
+        void serve(int fd);
+
+        //! A private member function.
+        /*!
+            受け付けた接続を順に取り出して問い合わせに答える（接続を処理するスレッドの本体）
+        */
+        void serveloop();
+
+        // #endregion メンバ関数
+
+        // #region メンバ変数
+
+        //! A private member variable.
+        /*!
+            受け付けて、処理を待っている接続のファイルディスクリプタ
+        */
+        std::deque<int> accepted_;
+
+        //! A private member variable.
+        /*!
+            処理している接続のファイルディスクリプタ
+        */
+        std::set<int> active_;
+
+        //! A private member variable.
+        /*!
+            計算結果と、最近使った順のリストでのキーの位置のキャッシュ
+        */
+        std::map<key, std::pair<simulator::PairResult, lrulist::iterator>> cache_;
+
+        //! A private member variable.
+        /*!
+            キャッシュする結果の件数の上限
+        */
+        std::size_t const cachesize_;
+
+        //! A private member variable.
+        /*!
+            キャッシュを保護するミューテックス
+        */
+        std::mutex cachemtx_;
+
+        //! A private member variable.
+        /*!
+            受け付けた接続と処理している接続を保護するミューテックス
+        */
+        std::mutex connmtx_;
+
+        //! A private member variable.
+        /*!
+            処理を待っている接続があることを知らせる条件変数
+        */
+        std::condition_variable conncv_;
+
+        //! A private member variable.
+        /*!
+            接続を処理するスレッドを終了するかどうか（connmtx_をロックして読み書きする）
+        */
+        bool connstop_;
+
+        //! A private member variable.
+        /*!
+            計算を待っている問い合わせがあることを知らせる条件変数
+        */
+        std::condition_variable cv_;
+
+        //! A private member variable.
+        /*!
+            ソケットのファイルディスクリプタ
+        */
+        int listenfd_;
+
+        //! A private member variable.
+        /*!
+            キャッシュのキーの、最近使った順のリスト（先頭が最も最近）
+        */
+        lrulist lru_;
+
+        //! A private static member variable (constant expression).
+        /*!
+            接続を処理するスレッドの数と、処理を待っている接続の数の上限
+        */
+        static auto constexpr MAXCONNECTION = 32U;
+
+        //! A private static member variable (constant expression).
+        /*!
+            一行の問い合わせの長さの上限（バイト）
+        */
+        static auto constexpr MAXLINE = 4096U;
+
+        //! A private member variable.
+        /*!
+            問い合わせで指定できるUかDの文字列の長さの上限
+        */
+        std::uint32_t const maxhorizon_;
+
+        //! A private member variable.
+        /*!
+            問い合わせで指定できる試行回数の上限
+        */
+        std::uint64_t const maxtrials_;
+
+        //! A private member variable.
+        /*!
+            ソケットのパス
+        */
+        std::string path_;
+
+        //! A private member variable.
+        /*!
+            シグナルハンドラがrunに終了を知らせるパイプ（[0]が読み出し側、[1]が書き込み側）
+        */
+        int pipefd_[2];
+
+        //! A private member variable.
+        /*!
+            計算を待っている問い合わせ
+        */
+        std::vector<std::shared_ptr<Pending>> pending_;
+
+        //! A private member variable.
+        /*!
+            計算を待っている問い合わせを保護するミューテックス
+        */
+        std::mutex pendingmtx_;
+
+        //! A private member variable.
+        /*!
+            接続を処理するスレッド
+        */
+        std::vector<std::thread> servers_;
+
+        //! A private member variable.
+        /*!
+            シミュレータクラスのオブジェクト
+        */
+        simulator::Simulator sim_;
+
+        //! A private member variable.
+        /*!
+            計算用のスレッドを終了するかどうか（pendingmtx_をロックして書き込む）
+        */
+        std::atomic<bool> stop_;
+
+        //! A private member variable.
+        /*!
+            問い合わせで試行回数を省略した場合のモンテカルロ・シミュレーションの試行回数
+        */
+        std::uint64_t const trials_;
+
+        //! A private member variable.
+        /*!
+            計算用のスレッド
+        */
+        std::thread worker_;
+
+        // #endregion メンバ変数
+
+        // #region 禁止されたコンストラクタ・メンバ関数
+
+        //! A private constructor (deleted).
+        /*!
+            デフォルトコンストラクタ（禁止）
+        */
+        QueryDaemon() = delete;
+
+        //! A private copy constructor (deleted).
+        /*!
+            コピーコンストラクタ（禁止）
+            \param dummy コピー元のオブジェクト（未使用）
+        */
+        QueryDaemon(QueryDaemon const & dummy) = delete;
+
+        //! A private member function (deleted).
+        /*!
+            operator=()の宣言（禁止）
+            \param dummy コピー元のオブジェクト（未使用）
+            \return コピー元のオブジェクト
+        */
+        QueryDaemon & operator=(QueryDaemon const & dummy) = delete;
+
+        // #endregion 禁止されたコンストラクタ・メンバ関数
+    };
+}
+
+#endif  // _QUERYDAEMON_H_
@@ -0,0 +1,438 @@
+﻿/*! \file resultstore.cpp
+    \brief 設定毎のシミュレーションの結果を保存し、実行を重ねて精度を上げるためのクラスの実装
+
+    Copyright © 2017 @dc1394 All Rights Reserved.
+    This software is released under the BSD 2-Clause License.
+*/
+
+#include "resultstore.h"
+#include "../flips/patternscan.h"
+#include <cstdio>       // for std::rename
+#include <cstring>      // for std::memcmp
+#include <fstream>      // for std::ifstream, std::ofstream
+#include <random>       // for std::random_device
+#include <set>          // for std::set
+#include <sstream>      // for std::ostringstream
+#include <stdexcept>    // for std::invalid_argument, std::runtime_error
+#include <utility>      // for std::move
+
+#ifdef _WIN32
+    #include <Windows.h>    // for CreateFileA, LockFileEx
+#else
+    #include <fcntl.h>      // for open
+    #include <sys/file.h>   // for flock
+    #include <unistd.h>     // for close
+#endif
+
+namespace resultstore {
+    namespace {
+        //! A global variable (constant expression).
+        /*!
+            バイナリファイルの識別子
+        */
+        static char const MAGIC[8] = { 'K', 'M', 'C', 'R', 'S', 'T', 'R', '\0' };
+
+        //! A global variable (constant expression).
+        /*!
+            バイナリファイルのバージョン
+        */
+        static auto constexpr VERSION = 1U;
+
+        //! A class.
+        /*!
+            ロックファイルを排他ロックし、破棄する時に解放するクラス
+            保存ファイルは置き換えるので、保存ファイル自体ではなく別のロックファイルをロックする
+        */
+        class FileLock final {
+        public:
+            //! A constructor.
+            /*!
+                唯一のコンストラクタ
+                ロックファイルを開き（なければ作成し）、排他ロックできるまで待つ
+                \param filename ロックファイルのファイル名
+            */
+            explicit FileLock(std::string const & filename)
+            {
+#ifdef _WIN32
+                file_ = ::CreateFileA(
+                    filename.c_str(), GENERIC_READ | GENERIC_WRITE, FILE_SHARE_READ | FILE_SHARE_WRITE, nullptr, OPEN_ALWAYS, FILE_ATTRIBUTE_NORMAL, nullptr);
+                if (file_ == INVALID_HANDLE_VALUE) {
+                    throw std::runtime_error("ロックファイルを開けませんでした: " + filename);
+                }
+
+                OVERLAPPED ov = {};
+                if (!::LockFileEx(file_, LOCKFILE_EXCLUSIVE_LOCK, 0, MAXDWORD, MAXDWORD, &ov)) {
+                    ::CloseHandle(file_);
+                    throw std::runtime_error("ロックファイルをロックできませんでした: " + filename);
+                }
+#else
+                fd_ = ::open(filename.c_str(), O_RDWR | O_CREAT, 0644);
+                if (fd_ < 0) {
+                    throw std::runtime_error("ロックファイルを開けませんでした: " + filename);
+                }
+
+                if (::flock(fd_, LOCK_EX)) {
+                    ::close(fd_);
+                    throw std::runtime_error("ロックファイルをロックできませんでした: " + filename);
+                }
+#endif
+            }
+
+            //! A destructor.
+            /*!
+                デストラクタ
+                ロックを解放し、ロックファイルを閉じる（ロックファイルは削除しない）
+            */
+            ~FileLock()
+            {
+#ifdef _WIN32
+                OVERLAPPED ov = {};
+                ::UnlockFileEx(file_, 0, MAXDWORD, MAXDWORD, &ov);
+                ::CloseHandle(file_);
+#else
+                ::flock(fd_, LOCK_UN);
+                ::close(fd_);
+#endif
+            }
+
+        private:
+#ifdef _WIN32
+            //! A private member variable.
+            /*!
+                ロックファイルのハンドル
+            */
+            HANDLE file_;
+#else
+            //! A private member variable.
+            /*!
+                ロックファイルのファイルディスクリプタ
+            */
+            int fd_;
+#endif
+
+            //! A private copy constructor (deleted).
+            /*!
+                コピーコンストラクタ（禁止）
+                \param dummy コピー元のオブジェクト（未使用）
+            */
+            FileLock(FileLock const & dummy) = delete;
+
+            //! A private member function (deleted).
+            /*!
+                operator=()の宣言（禁止）
+                \param dummy コピー元のオブジェクト（未使用）
+                \return コピー元のオブジェクト
+            */
+            FileLock & operator=(FileLock const & dummy) = delete;
+        };
+
+        //! A function.
+        /*!
+            リトルエンディアンのバイト列を値としてファイルから読み込む
+            \param ifs 入力ファイルストリーム
+            \return 読み込んだ値
+        */
+        template <typename T>
+        T readvalue(std::ifstream & ifs)
+        {
+            unsigned char buf[sizeof(T)];
+            if (!ifs.read(reinterpret_cast<char *>(buf), sizeof(T))) {
+                throw std::runtime_error("ファイルが壊れています");
+            }
+
+            auto val = UINT64_C(0);
+            for (auto i = 0U; i < sizeof(T); i++) {
+                val |= static_cast<std::uint64_t>(buf[i]) << (8U * i);
+            }
+
+            return static_cast<T>(val);
+        }
+
+        //! A function.
+        /*!
+            値をリトルエンディアンのバイト列としてファイルに書き出す
+            \param ofs 出力ファイルストリーム
+            \param val 書き出す値
+        */
+        template <typename T>
+        void writevalue(std::ofstream & ofs, T val)
+        {
+            char buf[sizeof(T)];
+            for (auto i = 0U; i < sizeof(T); i++) {
+                buf[i] = static_cast<char>((static_cast<std::uint64_t>(val) >> (8U * i)) & 0xFFU);
+            }
+
+            ofs.write(buf, sizeof(T));
+        }
+
+        //! A function.
+        /*!
+            64ビット整数の配列をファイルから読み込む
+            \param ifs 入力ファイルストリーム
+            \return 読み込んだ配列
+        */
+        std::vector<std::uint64_t> readarray(std::ifstream & ifs)
+        {
+            std::vector<std::uint64_t> v(readvalue<std::uint32_t>(ifs));
+            for (auto & x : v) {
+                x = readvalue<std::uint64_t>(ifs);
+            }
+
+            return v;
+        }
+
+        //! A function.
+        /*!
+            64ビット整数の配列をファイルに書き出す
+            \param ofs 出力ファイルストリーム
+            \param v 書き出す配列
+        */
+        void writearray(std::ofstream & ofs, std::vector<std::uint64_t> const & v)
+        {
+            writevalue<std::uint32_t>(ofs, static_cast<std::uint32_t>(v.size()));
+            for (auto const x : v) {
+                writevalue<std::uint64_t>(ofs, x);
+            }
+        }
+    }
+
+    // #region Entryのメンバ関数
+
+    std::uint64_t Entry::firstsum(std::uint32_t p) const
+    {
+        auto sum = UINT64_C(0);
+        for (auto const & run : runs) {
+            sum += run.firstsum[p];
+        }
+
+        return sum;
+    }
+
+    std::uint64_t Entry::trials() const
+    {
+        auto sum = UINT64_C(0);
+        for (auto const & run : runs) {
+            sum += run.trials;
+        }
+
+        return sum;
+    }
+
+    std::uint64_t Entry::wins(std::uint32_t k) const
+    {
+        auto sum = UINT64_C(0);
+        for (auto const & run : runs) {
+            sum += run.wins[k];
+        }
+
+        return sum;
+    }
+
+    // #endregion Entryのメンバ関数
+
+    // #region コンストラクタ
+
+    ResultStore::ResultStore(std::string const & filename)
+        : filename_(filename)
+    {
+        std::ifstream ifs(filename_, std::ios::binary);
+        if (!ifs) {
+            return;
+        }
+
+        char magic[sizeof(MAGIC)];
+        if (!ifs.read(magic, sizeof(magic)) || std::memcmp(magic, MAGIC, sizeof(MAGIC))) {
+            throw std::runtime_error("結果の保存ファイルではありません: " + filename_);
+        }
+
+        if (readvalue<std::uint32_t>(ifs) != VERSION) {
+            throw std::runtime_error("結果の保存ファイルのバージョンが異なります: " + filename_);
+        }
+
+        auto const nentry = readvalue<std::uint32_t>(ifs);
+        for (auto e = 0U; e < nentry; e++) {
+            auto const h = readvalue<std::uint64_t>(ifs);
+
+            Entry entry;
+            entry.config.resize(readvalue<std::uint32_t>(ifs));
+            if (!ifs.read(&entry.config[0], static_cast<std::streamsize>(entry.config.size()))) {
+                throw std::runtime_error("ファイルが壊れています");
+            }
+
+            auto const nrun = readvalue<std::uint32_t>(ifs);
+            for (auto r = 0U; r < nrun; r++) {
+                Run run;
+                run.id = readvalue<std::uint64_t>(ifs);
+                run.trials = readvalue<std::uint64_t>(ifs);
+                run.firstsum = readarray(ifs);
+                run.wins = readarray(ifs);
+                entry.runs.push_back(std::move(run));
+            }
+
+            entries_.emplace(h, std::move(entry));
+        }
+    }
+
+    // #endregion コンストラクタ
+
+    // #region publicメンバ関数
+
+    Entry & ResultStore::entry(std::string const & config)
+    {
+        auto & e = entries_[hash(config)];
+        if (e.config.empty()) {
+            e.config = config;
+        }
+        else if (e.config != config) {
+            throw std::runtime_error("設定のハッシュが衝突しました: " + config + ", " + e.config);
+        }
+
+        return e;
+    }
+
+    std::uint32_t ResultStore::merge(ResultStore const & other)
+    {
+        auto duplicates = 0U;
+        for (auto const & kv : other.entries_) {
+            auto & e = entry(kv.second.config);
+
+            std::set<std::uint64_t> ids;
+            for (auto const & run : e.runs) {
+                ids.insert(run.id);
+            }
+
+            for (auto const & run : kv.second.runs) {
+                if (ids.insert(run.id).second) {
+                    e.runs.push_back(run);
+                }
+                else {
+                    duplicates++;
+                }
+            }
+        }
+
+        return duplicates;
+    }
+
+    void ResultStore::write()
+    {
+        // 他のプロセスが同じファイルを読み込んでから置き換えるまでの間は待たせる
+        FileLock const lock(filename_ + ".lock");
+
+        // 読み込んだ後に他のプロセスが加えた実行を失わないよう、ロックしてから読み込み直してまとめる
+        merge(ResultStore(filename_));
+
+        auto const tmpname = filename_ + ".tmp";
+
+        {
+            std::ofstream ofs(tmpname, std::ios::binary | std::ios::trunc);
+            if (!ofs) {
+                throw std::runtime_error("ファイルを開けませんでした: " + tmpname);
+            }
+
+            // ヘッダ
+            ofs.write(MAGIC, sizeof(MAGIC));
+            writevalue<std::uint32_t>(ofs, VERSION);
+            writevalue<std::uint32_t>(ofs, static_cast<std::uint32_t>(entries_.size()));
+
+            // (ハッシュ, 設定, 実行の配列)の組の配列
+            for (auto const & kv : entries_) {
+                writevalue<std::uint64_t>(ofs, kv.first);
+                writevalue<std::uint32_t>(ofs, static_cast<std::uint32_t>(kv.second.config.size()));
+                ofs.write(kv.second.config.data(), static_cast<std::streamsize>(kv.second.config.size()));
+
+                writevalue<std::uint32_t>(ofs, static_cast<std::uint32_t>(kv.second.runs.size()));
+                for (auto const & run : kv.second.runs) {
+                    writevalue<std::uint64_t>(ofs, run.id);
+                    writevalue<std::uint64_t>(ofs, run.trials);
+                    writearray(ofs, run.firstsum);
+                    writearray(ofs, run.wins);
+                }
+            }
+
+            if (!ofs) {
+                throw std::runtime_error("ファイルに書き込めませんでした: " + tmpname);
+            }
+        }
+
+        // 書き込みの途中で終了しても元のファイルが壊れないように置き換える
+        if (std::rename(tmpname.c_str(), filename_.c_str())) {
+            throw std::runtime_error("ファイルを置き換えられませんでした: " + filename_);
+        }
+    }
+
+    std::string ResultStore::configstring(simulator::RunConfig const & config)
+    {
+        std::ostringstream oss;
+        oss << "patterns=";
+        for (auto i = 0U; i < config.patterns.size(); i++) {
+            oss << (i ? "," : "") << config.patterns[i];
+        }
+
+        oss << ";horizon=" << config.horizon
+            << ";bias=" << flips::biasstring(config.bias)
+            << ";engine=" << (config.engine == simulator::Engine::EXACT ? "exact" : "montecarlo")
+#ifdef HAVE_SSE2
+            << ";rng=sfmt19937";
+#else
+            << ";rng=mt19937";
+#endif
+
+        return oss.str();
+    }
+
+    std::uint64_t ResultStore::hash(std::string const & config)
+    {
+        auto h = UINT64_C(14695981039346656037);
+        for (auto const c : config) {
+            h ^= static_cast<unsigned char>(c);
+            h *= UINT64_C(1099511628211);
+        }
+
+        return h;
+    }
+
+    // #endregion publicメンバ関数
+
+    // #region 非メンバ関数
+
+    Run const & refine(simulator::Simulator & sim, simulator::RunConfig config, Entry & entry)
+    {
+        if (config.engine != simulator::Engine::MONTECARLO) {
+            throw std::invalid_argument("実行を重ねられるのはモンテカルロ・シミュレーションのみです");
+        }
+
+        // 既存の実行と重ならない識別子を選ぶ
+        std::set<std::uint64_t> ids;
+        for (auto const & run : entry.runs) {
+            ids.insert(run.id);
+        }
+
+        std::random_device rnd;
+        auto id = UINT64_C(0);
+        while (!id || ids.count(id)) {
+            id = (static_cast<std::uint64_t>(rnd()) << 32) | rnd();
+        }
+
+        config.pairs.clear();
+        config.seed = id;
+
+        auto const result(sim.run(config));
+
+        Run run;
+        run.id = id;
+        run.firstsum = result.firstsum;
+        run.trials = result.trials;
+
+        for (auto const & pair : result.pairs) {
+            run.wins.push_back(pair.winsa);
+            run.wins.push_back(pair.winsb);
+        }
+
+        entry.runs.push_back(std::move(run));
+
+        return entry.runs.back();
+    }
+
+    // #endregion 非メンバ関数
+}
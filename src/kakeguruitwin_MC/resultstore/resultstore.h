@@ -0,0 +1,232 @@
+﻿/*! \file resultstore.h
+    \brief 設定毎のシミュレーションの結果を保存し、実行を重ねて精度を上げるためのクラスの宣言
+
+    Copyright © 2017 @dc1394 All Rights Reserved.
+    This software is released under the BSD 2-Clause License.
+*/
+
+#ifndef _RESULTSTORE_H_
+#define _RESULTSTORE_H_
+
+#pragma once
+
+#include "../simulator/simulator.h"
+#include <cstdint>  // for std::uint32_t, std::uint64_t
+#include <map>      // for std::map
+#include <string>   // for std::string
+#include <vector>   // for std::vector
+
+namespace resultstore {
+    //! A struct.
+    /*!
+        一回の実行の集計結果
+    */
+    struct Run final {
+        //! A public member variable.
+        /*!
+            各文字列の最初の出現位置の和
+        */
+        std::vector<std::uint64_t> firstsum;
+
+        //! A public member variable.
+        /*!
+            実行の識別子（乱数の種を兼ねる）
+        */
+        std::uint64_t id;
+
+        //! A public member variable.
+        /*!
+            試行回数
+        */
+        std::uint64_t trials;
+
+        //! A public member variable.
+        /*!
+            ペア毎の前者と後者の勝利回数
+        */
+        std::vector<std::uint64_t> wins;
+    };
+
+    //! A struct.
+    /*!
+        一つの設定に対する全ての実行の集計結果
+    */
+    struct Entry final {
+        //! A public member function.
+        /*!
+            全ての実行の各文字列の最初の出現位置の和を返す
+            \param p 文字列の添字
+            \return 最初の出現位置の和
+        */
+        std::uint64_t firstsum(std::uint32_t p) const;
+
+        //! A public member function.
+        /*!
+            全ての実行の試行回数を返す
+            \return 試行回数
+        */
+        std::uint64_t trials() const;
+
+        //! A public member function.
+        /*!
+            全ての実行の勝利回数を返す
+            \param k 勝利回数の添字（ペアkの前者の勝利回数は2k、後者の勝利回数は2k + 1）
+            \return 勝利回数
+        */
+        std::uint64_t wins(std::uint32_t k) const;
+
+        //! A public member variable.
+        /*!
+            設定を表す文字列
+        */
+        std::string config;
+
+        //! A public member variable.
+        /*!
+            各実行の集計結果
+        */
+        std::vector<Run> runs;
+    };
+
+    //! A class.
+    /*!
+        設定を表す文字列のハッシュをキーとして、実行毎の集計結果をファイルに保存するクラス
+        実行毎に別々の識別子を乱数の種とするので、同じ設定で実行を重ねると重複のない試行が加わる
+    */
+    class ResultStore final {
+        // #region コンストラクタ・デストラクタ
+
+    public:
+        //! A constructor.
+        /*!
+            唯一のコンストラクタ
+            ファイルが存在すれば読み込む
+            \param filename ファイル名
+        */
+        explicit ResultStore(std::string const & filename);
+
+        //! A destructor.
+        /*!
+            デフォルトデストラクタ
+        */
+        ~ResultStore() = default;
+
+        // #endregion コンストラクタ・デストラクタ
+
+        // #region メンバ関数
+
+        //! A public member function.
+        /*!
+            設定に対する集計結果を返す（存在しなければ作成する）
+            \param config 設定を表す文字列
+            \return 集計結果
+        */
+        Entry & entry(std::string const & config);
+
+        //! A public member function.
+        /*!
+            別のファイルの集計結果を加える
+            同じ識別子の実行は既に含まれているので加えない
+            \param other 別のファイルの集計結果
+            \return 重複していたために加えなかった実行の数
+        */
+        std::uint32_t merge(ResultStore const & other);
+
+        //! A public member function.
+        /*!
+            ファイルに書き出す（一時ファイルに書き出してから置き換える）
+            ロックファイル（ファイル名に「.lock」を付けたもの）を排他ロックしている間に、
+            読み込んだ後に他のプロセスが書き出した実行をファイルから読み込み直して加えてから置き換える
+        */
+        void write();
+
+        //! A public static member function.
+        /*!
+            シミュレーションの設定を表す文字列を作る
+            \param config 一回の実行の設定
+            \return 設定を表す文字列（文字列、UかDの文字列の長さ、Uが出る確率、計算の方法、乱数エンジンの種類）
+        */
+        static std::string configstring(simulator::RunConfig const & config);
+
+        //! A public static member function.
+        /*!
+            設定を表す文字列のハッシュ（FNV-1a）を求める
+            \param config 設定を表す文字列
+            \return ハッシュ
+        */
+        static std::uint64_t hash(std::string const & config);
+
+        // #endregion メンバ関数
+
+        // #region プロパティ
+
+        //! A property.
+        /*!
+            全ての集計結果を返す
+        */
+        std::map<std::uint64_t, Entry> const & entries() const
+        {
+            return entries_;
+        }
+
+        // #endregion プロパティ
+
+        // #region メンバ変数
+
+    private:
+        //! A private member variable.
+        /*!
+            設定を表す文字列のハッシュをキーとする集計結果
+        */
+        std::map<std::uint64_t, Entry> entries_;
+
+        //! A private member variable.
+        /*!
+            ファイル名
+        */
+        std::string const filename_;
+
+        // #endregion メンバ変数
+
+        // #region 禁止されたコンストラクタ・メンバ関数
+
+        //! A private constructor (deleted).
+        /*!
+            デフォルトコンストラクタ（禁止）
+        */
+        ResultStore() = delete;
+
+        //! A private copy constructor (deleted).
+        /*!
+            コピーコンストラクタ（禁止）
+            \param dummy コピー元のオブジェクト（未使用）
+        */
+        ResultStore(ResultStore const & dummy) = delete;
+
+        //! A private member function (deleted).
+        /*!
+            operator=()の宣言（禁止）
+            \param dummy コピー元のオブジェクト（未使用）
+            \return コピー元のオブジェクト
+        */
+        ResultStore & operator=(ResultStore const & dummy) = delete;
+
+        // #endregion 禁止されたコンストラクタ・メンバ関数
+    };
+
+    // #region 非メンバ関数
+
+    //! A function.
+    /*!
+        新しい識別子を乱数の種としてシミュレーションを行い、集計結果に加える
+        \param sim シミュレータクラスのオブジェクト
+        \param config 一回の実行の設定（seedとpairsは無視する）
+        \param entry 集計結果
+        \return 加えた実行の集計結果
+    */
+    Run const & refine(simulator::Simulator & sim, simulator::RunConfig config, Entry & entry);
+
+    // #endregion 非メンバ関数
+}
+
+#endif  // _RESULTSTORE_H_
@@ -0,0 +1,848 @@
+﻿/*! \file sampleprofiler.cpp
+    \brief スレッド毎のCPU時間で標本を取り、チェックポイントの区間毎に集計するプロファイラの実装
+
+    Copyright © 2017 @dc1394 All Rights Reserved.
+    This software is released under the BSD 2-Clause License.
+*/
+
+#include "sampleprofiler.h"
+#include "../../checkpoint/checkpoint.h"
+#include <stdexcept>                    // for std::logic_error, std::runtime_error
+
+#ifdef __linux__
+    #include <algorithm>                // for std::sort, std::min, std::upper_bound
+    #include <array>                    // for std::array
+    #include <atomic>                   // for std::atomic
+    #include <cerrno>                   // for errno
+    #include <chrono>                   // for std::chrono
+    #include <cstdlib>                  // for std::free
+    #include <cstring>                  // for std::memcpy
+    #include <fstream>                  // for std::ifstream, std::ofstream
+    #include <iomanip>                  // for std::setw, std::setprecision
+    #include <iostream>                 // for std::cout
+    #include <iterator>                 // for std::istreambuf_iterator
+    #include <map>                      // for std::map
+    #include <set>                      // for std::set
+    #include <thread>                   // for std::this_thread
+    #include <unordered_map>            // for std::unordered_map
+    #include <utility>                  // for std::pair
+    #include <vector>                   // for std::vector
+    #include <cxxabi.h>                 // for abi::__cxa_demangle
+    #include <dlfcn.h>                  // for dladdr
+    #include <elf.h>                    // for Elf64_Ehdr, Elf64_Shdr, Elf64_Sym
+    #include <execinfo.h>               // for backtrace
+    #include <link.h>                   // for dl_iterate_phdr
+    #include <signal.h>                 // for sigaction, sigevent
+    #include <sys/syscall.h>            // for SYS_gettid
+    #include <time.h>                   // for clock_gettime, timer_create, timer_delete, timer_settime
+    #include <ucontext.h>               // for ucontext_t
+    #include <unistd.h>                 // for syscall
+    #include <tbb/parallel_for.h>       // for tbb::parallel_for
+    #include <tbb/partitioner.h>        // for tbb::simple_partitioner
+    #include <tbb/task_arena.h>         // for tbb::this_task_arena
+
+    #ifndef sigev_notify_thread_id
+        #define sigev_notify_thread_id _sigev_un._tid
+    #endif
+#endif
+
+namespace sampleprofiler {
+    // #region 無名名前空間
+
+    namespace {
+        //! A global variable.
+        /*!
+            Profilerが既に作成されたかどうか
+        */
+        std::atomic<bool> created(false);
+    }
+
+    // #endregion 無名名前空間
+
+#ifdef __linux__
+    // #region 無名名前空間
+
+    namespace {
+        //! A global variable (constant expression).
+        /*!
+            一つの標本に記録するスタックの最大の深さ
+        */
+        static auto constexpr MAXDEPTH = 16U;
+
+        //! A global variable (constant expression).
+        /*!
+            スレッド毎に記録できる標本の数
+        */
+        static auto constexpr BUFFERSIZE = 1U << 15;
+
+        //! A global variable (constant expression).
+        /*!
+            標本を取ることができるスレッドの最大の数
+        */
+        static auto constexpr MAXTHREAD = 256U;
+
+        //! A global variable (constant expression).
+        /*!
+            フラットなプロファイルに表示する関数の数
+        */
+        static auto constexpr NTOP = 20U;
+
+        //! A struct.
+        /*!
+            一つの標本
+        */
+        struct Sample final {
+            //! A public member variable.
+            /*!
+                標本を取った時点のチェックポイントの数
+            */
+            std::int32_t phase;
+
+            //! A public member variable.
+            /*!
+                記録したスタックの深さ
+            */
+            std::uint32_t depth;
+
+            //! A public member variable.
+            /*!
+                プログラムカウンタ（[0]が実行中の位置、以降は呼び出し元の戻りアドレス）
+            */
+            std::array<std::uintptr_t, MAXDEPTH> pcs;
+        };
+
+        //! A struct.
+        /*!
+            一つのスレッドの標本のバッファ
+            書き込むのはそのスレッドのシグナルハンドラだけで、読むのはタイマを止めて実行中のハンドラが
+            全て戻った後だけなので、ロックは要らない
+        */
+        struct Buffer final {
+            //! A public member variable.
+            /*!
+                標本の配列
+            */
+            std::unique_ptr<Sample[]> samples = std::make_unique<Sample[]>(BUFFERSIZE);
+
+            //! A public member variable.
+            /*!
+                記録した標本の数
+            */
+            std::atomic<std::uint32_t> head = { 0U };
+
+            //! A public member variable.
+            /*!
+                バッファが一杯で捨てた標本の数
+            */
+            std::atomic<std::uint64_t> dropped = { 0U };
+
+            //! A public member variable.
+            /*!
+                このスレッドのCPU時間のタイマ
+            */
+            timer_t timer = timer_t();
+        };
+
+        //! A global variable.
+        /*!
+            標本を取っているかどうか
+        */
+        std::atomic<bool> enabled(false);
+
+        //! A global variable.
+        /*!
+            実行中のシグナルハンドラの数（0になるまで待ってからバッファを読み、解放する）
+        */
+        std::atomic<std::uint32_t> inflight(0U);
+
+        //! A global variable.
+        /*!
+            標本を取るのを止めたかどうか
+        */
+        std::atomic<bool> stopped(false);
+
+        //! A global variable.
+        /*!
+            登録された全てのスレッドのバッファ
+        */
+        std::array<std::atomic<Buffer *>, MAXTHREAD> buffers;
+
+        //! A global variable.
+        /*!
+            登録されたスレッドの数
+        */
+        std::atomic<std::uint32_t> nbuffer(0U);
+
+        //! A global variable.
+        /*!
+            タイマの間隔
+        */
+        itimerspec interval;
+
+        //! A global variable.
+        /*!
+            標本を取り始めた時点のプロセスのCPU時間
+        */
+        double cpubegin = 0.0;
+
+        //! A function.
+        /*!
+            プロセスのCPU時間を返す
+            \return プロセスのCPU時間（ミリ秒）
+        */
+        double processcputime()
+        {
+            timespec ts;
+            ::clock_gettime(CLOCK_PROCESS_CPUTIME_ID, &ts);
+
+            return static_cast<double>(ts.tv_sec) * 1000.0 + static_cast<double>(ts.tv_nsec) / 1.0E+6;
+        }
+
+        //! A thread-local variable.
+        /*!
+            現在のスレッドのバッファ
+        */
+        thread_local Buffer * mybuffer = nullptr;
+
+        //! A function.
+        /*!
+            シグナルが届いた時点のプログラムカウンタを返す
+            \param context シグナルハンドラに渡されたucontext_t
+            \return プログラムカウンタ（取得できない場合は0）
+        */
+        inline std::uintptr_t programcounter(void * context)
+        {
+            auto const uc = static_cast<ucontext_t const *>(context);
+#if defined(__x86_64__)
+            return static_cast<std::uintptr_t>(uc->uc_mcontext.gregs[REG_RIP]);
+#elif defined(__aarch64__)
+            return static_cast<std::uintptr_t>(uc->uc_mcontext.pc);
+#else
+            static_cast<void>(uc);
+            return 0U;
+#endif
+        }
+
+        //! A function.
+        /*!
+            SIGPROFのシグナルハンドラ
+            現在のスレッドのバッファに一つの標本を書き込む
+            \param context シグナルが届いた時点のucontext_t
+        */
+        void handler(int, siginfo_t *, void * context)
+        {
+            auto const buffer = mybuffer;
+            if (!buffer) {
+                return;
+            }
+
+            // enabledを確かめる前に数えるので、Profiler::stopがenabledを下ろした後に0を見れば、以後のハンドラはバッファに触れない
+            inflight.fetch_add(1U);
+            if (!enabled.load()) {
+                inflight.fetch_sub(1U, std::memory_order_release);
+                return;
+            }
+
+            auto const saved = errno;
+            auto const h = buffer->head.load(std::memory_order_relaxed);
+            if (h >= BUFFERSIZE) {
+                buffer->dropped.fetch_add(1U, std::memory_order_relaxed);
+                errno = saved;
+                inflight.fetch_sub(1U, std::memory_order_release);
+                return;
+            }
+
+            auto & s = buffer->samples[h];
+            s.phase = checkpoint::currentphase();
+
+            auto const pc = programcounter(context);
+            s.pcs[0] = pc;
+            s.depth = 1U;
+
+            // バックトレースには、シグナルハンドラとシグナルのフレームの後に中断された位置が現れる
+            // そこから先を呼び出し元として記録する
+            std::array<void *, MAXDEPTH + 8U> frames;
+            auto const n = ::backtrace(frames.data(), static_cast<int>(frames.size()));
+            for (auto i = 0; i < n; i++) {
+                if (reinterpret_cast<std::uintptr_t>(frames[i]) == pc) {
+                    for (auto j = i + 1; j < n && s.depth < MAXDEPTH; j++) {
+                        s.pcs[s.depth++] = reinterpret_cast<std::uintptr_t>(frames[j]);
+                    }
+                    break;
+                }
+            }
+
+            buffer->head.store(h + 1U, std::memory_order_release);
+            errno = saved;
+            inflight.fetch_sub(1U, std::memory_order_release);
+        }
+
+        //! A function.
+        /*!
+            現在のスレッドのバッファを作り、CPU時間のタイマを開始する
+            既に登録されている場合は何もしない
+        */
+        void registerthread()
+        {
+            if (mybuffer || !enabled.load(std::memory_order_acquire)) {
+                return;
+            }
+
+            auto const idx = nbuffer.fetch_add(1U);
+            if (idx >= MAXTHREAD) {
+                return;
+            }
+
+            auto const buffer = new Buffer;
+
+            sigevent sev = {};
+            sev.sigev_notify = SIGEV_THREAD_ID;
+            sev.sigev_signo = SIGPROF;
+            sev.sigev_notify_thread_id = static_cast<pid_t>(::syscall(SYS_gettid));
+            if (::timer_create(CLOCK_THREAD_CPUTIME_ID, &sev, &buffer->timer)) {
+                delete buffer;
+                return;
+            }
+
+            buffers[idx].store(buffer, std::memory_order_release);
+            mybuffer = buffer;
+            ::timer_settime(buffer->timer, 0, &interval, nullptr);
+        }
+
+        //! A class.
+        /*!
+            TBBのタスクを実行し始めたスレッドを登録するオブザーバ
+        */
+        class ThreadObserver final : public tbb::task_scheduler_observer {
+        public:
+            //! A constructor.
+            /*!
+                唯一のコンストラクタ
+            */
+            ThreadObserver()
+            {
+                observe(true);
+            }
+
+            //! A destructor.
+            /*!
+                デストラクタ
+            */
+            ~ThreadObserver() override
+            {
+                observe(false);
+            }
+
+            //! A public member function.
+            /*!
+                スレッドがタスクを実行し始めたときに呼ばれる
+            */
+            void on_scheduler_entry(bool) override
+            {
+                registerthread();
+            }
+        };
+
+        //! A struct.
+        /*!
+            メインの実行ファイルの関数のシンボル
+        */
+        struct Symbol final {
+            //! A public member variable.
+            /*!
+                ファイルの中のアドレス
+            */
+            std::uintptr_t addr;
+
+            //! A public member variable.
+            /*!
+                関数の大きさ
+            */
+            std::uintptr_t size;
+
+            //! A public member variable.
+            /*!
+                マングルされた名前
+            */
+            std::string name;
+        };
+
+        //! A function.
+        /*!
+            マングルされた名前を復元し、引数のリストを取り除く
+            \param name マングルされた名前
+            \return 関数名
+        */
+        std::string demangle(char const * name)
+        {
+            auto status = 0;
+            auto const p = abi::__cxa_demangle(name, nullptr, nullptr, &status);
+            std::string s(status == 0 && p ? p : name);
+            std::free(p);
+
+            // GCCが作った複製（" [clone .isra.0]"など）は元の関数にまとめる
+            for (auto pos = s.rfind(" [clone "); pos != std::string::npos && s.back() == ']'; pos = s.rfind(" [clone ")) {
+                s.erase(pos);
+            }
+
+            // 末尾の修飾子と引数のリストを取り除く
+            for (auto const qualifier : { " const", " volatile", " &&", " &", " noexcept" }) {
+                std::string const q(qualifier);
+                if (s.size() > q.size() && !s.compare(s.size() - q.size(), q.size(), q)) {
+                    s.erase(s.size() - q.size());
+                }
+            }
+
+            if (!s.empty() && s.back() == ')') {
+                auto depth = 0;
+                for (auto i = s.size(); i-- > 0;) {
+                    if (s[i] == ')') {
+                        depth++;
+                    }
+                    else if (s[i] == '(' && --depth == 0) {
+                        if (i > 0) {
+                            s.erase(i);
+                        }
+                        break;
+                    }
+                }
+            }
+
+            // 折りたたまれたスタックの区切り文字を置き換える
+            for (auto && c : s) {
+                if (c == ';') {
+                    c = ':';
+                }
+            }
+
+            return s;
+        }
+
+        //! A function.
+        /*!
+            /proc/self/exeのシンボルテーブルから関数のシンボルを読み込む
+            \return アドレスの昇順に並べた関数のシンボル
+        */
+        std::vector<Symbol> loadsymbols()
+        {
+            std::vector<Symbol> symbols;
+
+            std::ifstream ifs("/proc/self/exe", std::ios::binary);
+            std::vector<char> const image((std::istreambuf_iterator<char>(ifs)), std::istreambuf_iterator<char>());
+            if (image.size() < sizeof(Elf64_Ehdr)) {
+                return symbols;
+            }
+
+            Elf64_Ehdr ehdr;
+            std::memcpy(&ehdr, image.data(), sizeof(ehdr));
+            if (std::memcmp(ehdr.e_ident, ELFMAG, SELFMAG) || ehdr.e_ident[EI_CLASS] != ELFCLASS64 ||
+                ehdr.e_shoff + static_cast<std::uint64_t>(ehdr.e_shnum) * sizeof(Elf64_Shdr) > image.size()) {
+                return symbols;
+            }
+
+            std::vector<Elf64_Shdr> shdrs(ehdr.e_shnum);
+            std::memcpy(shdrs.data(), image.data() + ehdr.e_shoff, shdrs.size() * sizeof(Elf64_Shdr));
+
+            // .symtabがなければ.dynsymを使う
+            for (auto const type : { SHT_SYMTAB, SHT_DYNSYM }) {
+                for (auto const & sh : shdrs) {
+                    if (sh.sh_type != static_cast<Elf64_Word>(type) || sh.sh_link >= shdrs.size() ||
+                        sh.sh_offset + sh.sh_size > image.size()) {
+                        continue;
+                    }
+
+                    auto const & strtab = shdrs[sh.sh_link];
+                    auto const n = sh.sh_size / sizeof(Elf64_Sym);
+                    for (auto i = 0U; i < n; i++) {
+                        Elf64_Sym sym;
+                        std::memcpy(&sym, image.data() + sh.sh_offset + i * sizeof(Elf64_Sym), sizeof(sym));
+                        if (ELF64_ST_TYPE(sym.st_info) != STT_FUNC || !sym.st_value || !sym.st_size || sym.st_name >= strtab.sh_size) {
+                            continue;
+                        }
+
+                        symbols.push_back({ sym.st_value, sym.st_size, std::string(image.data() + strtab.sh_offset + sym.st_name) });
+                    }
+                }
+
+                if (!symbols.empty()) {
+                    break;
+                }
+            }
+
+            std::sort(symbols.begin(), symbols.end(), [](auto const & a, auto const & b) { return a.addr < b.addr; });
+
+            return symbols;
+        }
+
+        //! A function.
+        /*!
+            dl_iterate_phdrのコールバック
+            最初に渡されるメインの実行ファイルのロードされたアドレスのずれを記録する
+            \param info 共有オブジェクトの情報
+            \param data ずれを書き込む先
+            \return 1（最初の一つで打ち切る）
+        */
+        int mainbias(dl_phdr_info * info, std::size_t, void * data)
+        {
+            *static_cast<std::uintptr_t *>(data) = static_cast<std::uintptr_t>(info->dlpi_addr);
+            return 1;
+        }
+
+        //! A class.
+        /*!
+            プログラムカウンタを関数名に変換するクラス
+        */
+        class Symbolizer final {
+        public:
+            //! A constructor.
+            /*!
+                唯一のコンストラクタ
+            */
+            Symbolizer()
+                : bias_(0U), mainbase_(nullptr), symbols_(loadsymbols())
+            {
+                ::dl_iterate_phdr(mainbias, &bias_);
+
+                Dl_info self;
+                if (::dladdr(reinterpret_cast<void *>(&handler), &self)) {
+                    mainbase_ = self.dli_fbase;
+                }
+            }
+
+            //! A public member function.
+            /*!
+                プログラムカウンタを関数名に変換する
+                \param pc プログラムカウンタ
+                \param leaf 実行中の位置ならtrue、戻りアドレスならfalse
+                \return 関数名
+            */
+            std::string const & operator()(std::uintptr_t pc, bool leaf)
+            {
+                // 戻りアドレスは呼び出し命令の次を指すので、一つ戻して呼び出し元の関数に含める
+                auto const addr = leaf ? pc : pc - 1U;
+
+                auto const itr = cache_.find(addr);
+                if (itr != cache_.end()) {
+                    return itr->second;
+                }
+
+                return cache_.emplace(addr, lookup(addr)).first->second;
+            }
+
+        private:
+            //! A private member function.
+            /*!
+                アドレスを関数名に変換する
+                \param addr アドレス
+                \return 関数名
+            */
+            std::string lookup(std::uintptr_t addr) const
+            {
+                Dl_info info;
+                auto const found = ::dladdr(reinterpret_cast<void *>(addr), &info) != 0;
+
+                if (!found || info.dli_fbase == mainbase_) {
+                    auto const a = addr - bias_;
+                    auto itr = std::upper_bound(
+                        symbols_.begin(),
+                        symbols_.end(),
+                        a,
+                        [](std::uintptr_t v, Symbol const & s) { return v < s.addr; });
+                    if (itr != symbols_.begin()) {
+                        --itr;
+                        if (a < itr->addr + itr->size) {
+                            return demangle(itr->name.c_str());
+                        }
+                    }
+                }
+
+                if (found && info.dli_sname) {
+                    return demangle(info.dli_sname);
+                }
+
+                if (found && info.dli_fname) {
+                    std::string const path(info.dli_fname);
+                    return "[" + path.substr(path.find_last_of('/') + 1U) + "]";
+                }
+
+                return "[unknown]";
+            }
+
+            //! A private member variable.
+            /*!
+                メインの実行ファイルのロードされたアドレスのずれ
+            */
+            std::uintptr_t bias_;
+
+            //! A private member variable.
+            /*!
+                変換したアドレスのキャッシュ
+            */
+            std::unordered_map<std::uintptr_t, std::string> cache_;
+
+            //! A private member variable.
+            /*!
+                メインの実行ファイルのロードされた先頭のアドレス
+            */
+            void * mainbase_;
+
+            //! A private member variable (constant).
+            /*!
+                メインの実行ファイルの関数のシンボル
+            */
+            std::vector<Symbol> const symbols_;
+        };
+
+        //! A function.
+        /*!
+            標本を取った時点のチェックポイントの数から、区間の名前を返す
+            区間の名前は、checkpoint_printと同じく区間の終わりのチェックポイントの名称とする
+            \param phase チェックポイントの数
+            \return 区間の名前
+        */
+        std::string phasename(std::int32_t phase)
+        {
+            if (!phase) {
+                return "(最初のチェックポイントより前)";
+            }
+
+            auto const name = checkpoint::phasename(phase);
+
+            return name ? name : "(最後のチェックポイントより後)";
+        }
+    }
+
+    // #endregion 無名名前空間
+
+    // #region コンストラクタ・デストラクタ
+
+    Profiler::Profiler(std::uint32_t hz, std::string const & filename)
+        : filename_(filename),
+          hz_(hz)
+    {
+        if (!hz_ || hz_ > 100000U) {
+            throw std::invalid_argument("標本の数は1以上100000以下で指定してください");
+        }
+
+        if (created.exchange(true)) {
+            throw std::logic_error("プロファイラは一度だけ作成できます");
+        }
+
+        // バックトレースに必要なライブラリを、シグナルハンドラの外で先に読み込んでおく
+        std::array<void *, 4> dummy;
+        ::backtrace(dummy.data(), static_cast<int>(dummy.size()));
+
+        auto const ns = 1000000000ULL / hz_;
+        interval.it_interval.tv_sec = static_cast<time_t>(ns / 1000000000ULL);
+        interval.it_interval.tv_nsec = static_cast<long>(ns % 1000000000ULL);
+        interval.it_value = interval.it_interval;
+
+        struct sigaction sa = {};
+        sa.sa_sigaction = handler;
+        sa.sa_flags = SA_SIGINFO | SA_RESTART;
+        ::sigemptyset(&sa.sa_mask);
+        if (::sigaction(SIGPROF, &sa, nullptr)) {
+            throw std::runtime_error("SIGPROFのシグナルハンドラを設定できませんでした");
+        }
+
+        cpubegin = processcputime();
+        enabled.store(true, std::memory_order_release);
+        registerthread();
+        observer_ = std::make_unique<ThreadObserver>();
+
+        // 全てのワーカースレッドに一度タスクを実行させ、登録させる
+        // TBBのワーカースレッドは全てのtask_arenaで共有されるので、後で作られるtask_arenaの中でも標本を取れる
+        auto const nthread = tbb::this_task_arena::max_concurrency();
+        std::atomic<int> arrived(0);
+        tbb::parallel_for(
+            0,
+            nthread,
+            1,
+            [&](int) {
+                arrived++;
+                auto const begin = std::chrono::steady_clock::now();
+                while (arrived.load() < nthread && std::chrono::steady_clock::now() - begin < std::chrono::milliseconds(100)) {
+                }
+            },
+            tbb::simple_partitioner());
+    }
+
+    Profiler::~Profiler()
+    {
+        stop();
+
+        auto const nthread = std::min(nbuffer.load(), MAXTHREAD);
+        for (auto i = 0U; i < nthread; i++) {
+            delete buffers[i].exchange(nullptr);
+        }
+    }
+
+    // #endregion コンストラクタ・デストラクタ
+
+    // #region publicメンバ関数
+
+    void Profiler::report()
+    {
+        stop();
+
+        auto const nthread = std::min(nbuffer.load(), MAXTHREAD);
+
+        Symbolizer symbolize;
+
+        // 区間毎の標本の数、関数毎の自身の標本の数と呼び出し先を含めた標本の数、折りたたまれたスタック
+        std::map<std::int32_t, std::uint64_t> phases;
+        std::unordered_map<std::string, std::pair<std::uint64_t, std::uint64_t>> functions;
+        std::map<std::string, std::uint64_t> folded;
+        std::uint64_t total = 0U, dropped = 0U;
+
+        // 二度目の呼び出しでは、バッファは既に解放されている
+        for (auto i = 0U; i < nthread; i++) {
+            std::unique_ptr<Buffer> const buffer(buffers[i].exchange(nullptr));
+            if (!buffer) {
+                continue;
+            }
+
+            auto const n = buffer->head.load(std::memory_order_acquire);
+            for (auto j = 0U; j < n; j++) {
+                auto const & s = buffer->samples[j];
+                phases[s.phase]++;
+                total++;
+
+                std::set<std::string> seen;
+                std::string stack(phasename(s.phase));
+                for (auto k = s.depth; k-- > 0;) {
+                    auto const & name = symbolize(s.pcs[k], k == 0);
+                    stack += ';';
+                    stack += name;
+
+                    if (seen.insert(name).second) {
+                        functions[name].second++;
+                    }
+                }
+                functions[symbolize(s.pcs[0], true)].first++;
+                folded[stack]++;
+            }
+
+            dropped += buffer->dropped.load();
+        }
+
+        if (!total) {
+            std::cout << "\nプロファイラ: 標本はありません\n";
+            return;
+        }
+
+        auto const flags = std::cout.flags();
+        auto const precision = std::cout.precision();
+        // CPU時間のタイマはカーネルのタイマ割り込み毎にしか進まないので、実際の標本の数とCPU時間から1標本当たりの時間を求める
+        auto const cputime = processcputime() - cpubegin;
+        auto const ms = cputime / static_cast<double>(total);
+        std::cout << std::setiosflags(std::ios::fixed) << std::setprecision(1)
+                  << "\nプロファイラ: " << std::min(nbuffer.load(), MAXTHREAD) << "スレッド、"
+                  << total << "個の標本（" << hz_ << "Hz、CPU時間" << cputime << "ms）";
+        if (dropped) {
+            std::cout << "、バッファが一杯で" << dropped << "個を捨てました";
+        }
+        std::cout << "\n\nチェックポイントの区間毎のCPU時間\n";
+        for (auto const & p : phases) {
+            std::cout << std::setw(10) << static_cast<double>(p.second) * ms << "ms "
+                      << std::setw(6) << 100.0 * static_cast<double>(p.second) / static_cast<double>(total) << "%  "
+                      << phasename(p.first) << '\n';
+        }
+
+        std::vector<std::pair<std::string, std::pair<std::uint64_t, std::uint64_t>>> flat(functions.begin(), functions.end());
+        auto const ntop = std::min(static_cast<std::size_t>(NTOP), flat.size());
+        std::partial_sort(
+            flat.begin(),
+            flat.begin() + ntop,
+            flat.end(),
+            [](auto const & a, auto const & b) { return a.second.first != b.second.first ? a.second.first > b.second.first : a.first < b.first; });
+
+        std::cout << "\nフラットなプロファイル（自身の標本の数の上位" << ntop << "個）\n"
+                  << "   self%      self  total%     total  関数\n";
+        for (auto i = 0U; i < ntop; i++) {
+            auto const & f = flat[i];
+            std::cout << std::setw(7) << 100.0 * static_cast<double>(f.second.first) / static_cast<double>(total) << '%'
+                      << std::setw(10) << f.second.first
+                      << std::setw(7) << 100.0 * static_cast<double>(f.second.second) / static_cast<double>(total) << '%'
+                      << std::setw(10) << f.second.second
+                      << "  " << f.first << '\n';
+        }
+
+        std::ofstream ofs(filename_);
+        for (auto const & f : folded) {
+            ofs << f.first << ' ' << f.second << '\n';
+        }
+
+        if (ofs) {
+            std::cout << "\n折りたたまれたスタックを " << filename_ << " に書き出しました\n";
+        }
+        else {
+            std::cerr << "折りたたまれたスタックを " << filename_ << " に書き出せませんでした\n";
+        }
+
+        std::cout.flags(flags);
+        std::cout.precision(precision);
+    }
+
+    void Profiler::stop() noexcept
+    {
+        if (stopped.exchange(true)) {
+            return;
+        }
+
+        enabled.store(false);
+        observer_.reset();
+
+        auto const nthread = std::min(nbuffer.load(), MAXTHREAD);
+        for (auto i = 0U; i < nthread; i++) {
+            if (auto const buffer = buffers[i].load(std::memory_order_acquire)) {
+                ::timer_delete(buffer->timer);
+            }
+        }
+
+        // 遅れて届いたシグナルは無視する
+        struct sigaction sa = {};
+        sa.sa_handler = SIG_IGN;
+        ::sigemptyset(&sa.sa_mask);
+        ::sigaction(SIGPROF, &sa, nullptr);
+
+        // enabledを下ろす前に始まったハンドラがバッファに書き終えるまで待つ
+        while (inflight.load()) {
+            std::this_thread::yield();
+        }
+    }
+
+    // #endregion publicメンバ関数
+#else
+    // #region コンストラクタ・デストラクタ
+
+    Profiler::Profiler(std::uint32_t hz, std::string const & filename)
+        : filename_(filename),
+          hz_(hz)
+    {
+        if (created.exchange(true)) {
+            throw std::logic_error("プロファイラは一度だけ作成できます");
+        }
+
+        throw std::runtime_error("プロファイラはLinuxでのみ使えます");
+    }
+
+    Profiler::~Profiler()
+    {
+    }
+
+    // #endregion コンストラクタ・デストラクタ
+
+    // #region publicメンバ関数
+
+    void Profiler::report()
+    {
+    }
+
+    void Profiler::stop() noexcept
+    {
+    }
+
+    // #endregion publicメンバ関数
+#endif
+}
@@ -0,0 +1,116 @@
+﻿/*! \file sampleprofiler.h
+    \brief スレッド毎のCPU時間で標本を取り、チェックポイントの区間毎に集計するプロファイラの宣言
+
+    Copyright © 2017 @dc1394 All Rights Reserved.
+    This software is released under the BSD 2-Clause License.
+*/
+
+#ifndef _SAMPLEPROFILER_H_
+#define _SAMPLEPROFILER_H_
+
+#pragma once
+
+#include <cstdint>                          // for std::uint32_t
+#include <memory>                           // for std::unique_ptr
+#include <string>                           // for std::string
+#include <tbb/task_scheduler_observer.h>    // for tbb::task_scheduler_observer
+
+namespace sampleprofiler {
+    //! A class.
+    /*!
+        スレッド毎のCPU時間のインターバルタイマ（CLOCK_THREAD_CPUTIME_ID）で標本を取るプロファイラ
+        各スレッドのシグナルハンドラはプログラムカウンタと短いバックトレースをスレッド毎の
+        ロックのないバッファに書き込み、標本を取った時点のcheckpointの区間に割り当てる
+        reportで全てのタイマを止め、シンボルを解決してフラットなプロファイルを表示し、
+        フレームグラフのための折りたたまれたスタックのファイルを書き出す
+        プロセスの中で一度だけ作成でき、Linux以外ではコンストラクタが例外を投げる
+    */
+    class Profiler final {
+        // #region コンストラクタ・デストラクタ
+
+    public:
+        //! A constructor.
+        /*!
+            唯一のコンストラクタ
+            呼び出したスレッドと、以後TBBのタスクを実行する全てのスレッドで標本を取り始める
+            \param hz 各スレッドの1CPU秒当たりの標本の数
+            \param filename 折りたたまれたスタックを書き出すファイル名
+        */
+        Profiler(std::uint32_t hz, std::string const & filename);
+
+        //! A destructor.
+        /*!
+            デストラクタ
+            標本を取るのを止め、バッファを解放する（結果は表示しない）
+        */
+        ~Profiler();
+
+        // #endregion コンストラクタ・デストラクタ
+
+        // #region メンバ関数
+
+        //! A public member function.
+        /*!
+            標本を取るのを止め、結果を表示し、ファイルに書き出す（一度だけ表示する）
+        */
+        void report();
+
+        //! A public member function.
+        /*!
+            全てのタイマを止め、実行中のシグナルハンドラが全て戻るまで待つ（二度目以降は何もしない）
+        */
+        void stop() noexcept;
+
+        // #endregion メンバ関数
+
+        // #region メンバ変数
+
+    private:
+        //! A private member variable (constant).
+        /*!
+            折りたたまれたスタックを書き出すファイル名
+        */
+        std::string const filename_;
+
+        //! A private member variable (constant).
+        /*!
+            各スレッドの1CPU秒当たりの標本の数
+        */
+        std::uint32_t const hz_;
+
+        //! A private member variable.
+        /*!
+            TBBのタスクを実行し始めたスレッドを登録するオブザーバ
+        */
+        std::unique_ptr<tbb::task_scheduler_observer> observer_;
+
+        // #endregion メンバ変数
+
+        // #region 禁止されたコンストラクタ・メンバ関数
+
+        //! A private constructor (deleted).
+        /*!
+            デフォルトコンストラクタ（禁止）
+        */
+        Profiler() = delete;
+
+        //! A private copy constructor (deleted).
+        /*!
+            コピーコンストラクタ（禁止）
+            \param dummy コピー元のオブジェクト（未使用）
+        */
+        Profiler(Profiler const & dummy) = delete;
+
+        //! A private member function (deleted).
+        /*!
+            operator=()の宣言（禁止）
+            \param dummy コピー元のオブジェクト（未使用）
+            \return コピー元のオブジェクト
+        */
+        Profiler & operator=(Profiler const & dummy) = delete;
+
+        // #endregion 禁止されたコンストラクタ・メンバ関数
+    };
+}
+
+#endif  // _SAMPLEPROFILER_H_
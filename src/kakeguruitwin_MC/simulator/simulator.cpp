@@ -0,0 +1,379 @@
+﻿/*! \file simulator.cpp
+    \brief 他のプログラムから呼び出すためのシミュレータクラスの実装
+
+    Copyright © 2017 @dc1394 All Rights Reserved.
+    This software is released under the BSD 2-Clause License.
+*/
+
+#include "simulator.h"
+#include "../flips/patternscan.h"
+#include "../pattern/pattern.h"
+#ifdef HAVE_SSE2
+    #include "../myrandom/myrandsfmt.h"
+#else
+    #include "../myrandom/myrand.h"
+#endif
+#include <algorithm>                    // for std::fill, std::max, std::min
+#include <chrono>                       // for std::chrono
+#include <cmath>                        // for std::sqrt
+#include <stdexcept>                    // for std::invalid_argument, std::runtime_error
+#include <tbb/blocked_range.h>          // for tbb::blocked_range
+#include <tbb/enumerable_thread_specific.h> // for tbb::enumerable_thread_specific
+#include <tbb/parallel_for.h>           // for tbb::parallel_for
+#include <tbb/partitioner.h>            // for tbb::simple_partitioner
+#include <tbb/task_group.h>             // for tbb::task_group_context
+#include <utility>                      // for std::make_pair, std::move
+
+namespace simulator {
+    namespace {
+#ifdef HAVE_SSE2
+        using myrand = myrandom::MyRandSfmt;
+#else
+        using myrand = myrandom::MyRand;
+#endif
+
+        //! A struct.
+        /*!
+            スレッド毎の集計結果
+        */
+        struct Accumulator final {
+            //! A constructor.
+            /*!
+                唯一のコンストラクタ
+                \param npattern 文字列の数
+                \param npair ペアの数
+            */
+            Accumulator(std::uint32_t npattern, std::uint32_t npair)
+                : first(npattern), firstsum(npattern, 0U), trials(0U), wins(npair * 2U, 0U)
+            {
+            }
+
+            //! A public member function.
+            /*!
+                別の集計結果を足し合わせ、足し合わせた集計結果を0に戻す
+                \param other 別の集計結果
+            */
+            void add(Accumulator & other)
+            {
+                for (auto p = 0U; p < firstsum.size(); p++) {
+                    firstsum[p] += other.firstsum[p];
+                }
+
+                for (auto k = 0U; k < wins.size(); k++) {
+                    wins[k] += other.wins[k];
+                }
+
+                trials += other.trials;
+
+                other.clear();
+            }
+
+            //! A public member function.
+            /*!
+                集計結果を0に戻す
+            */
+            void clear()
+            {
+                std::fill(firstsum.begin(), firstsum.end(), 0U);
+                std::fill(wins.begin(), wins.end(), 0U);
+                trials = 0U;
+            }
+
+            //! A public member variable.
+            /*!
+                各文字列の最初の出現位置（試行毎に使い回す）
+            */
+            std::vector<std::uint32_t> first;
+
+            //! A public member variable.
+            /*!
+                各文字列の最初の出現位置の和
+            */
+            std::vector<std::uint64_t> firstsum;
+
+            //! A public member variable.
+            /*!
+                試行回数
+            */
+            std::uint64_t trials;
+
+            //! A public member variable.
+            /*!
+                ペア毎の前者と後者の勝利回数
+            */
+            std::vector<std::uint64_t> wins;
+        };
+
+        //! A global variable (constant expression).
+        /*!
+            乱数の種を指定した場合に、同じ種から乱数列を作り直す試行の数
+        */
+        static auto constexpr CHUNK = 4096U;
+
+        //! A global variable (constant expression).
+        /*!
+            制限時間がある場合の、一つの試行の塊のUかDの個数の目安
+            （UかDの文字列の長さで割って塊の試行の数とし、長い試行でも塊が制限時間より十分短くなるようにする）
+        */
+        static auto constexpr DEADLINEFLIPS = UINT64_C(1) << 20;
+
+        //! A global variable (constant expression).
+        /*!
+            制限時間がある場合に、時刻を確認する生成したワードの数の間隔（2のべき乗）
+        */
+        static auto constexpr DEADLINECHECK = 256U;
+    }
+
+    // #region 型の定義
+
+    struct Simulator::ThreadRandoms final {
+        //! A public member variable.
+        /*!
+            スレッド毎の自作乱数クラスのオブジェクト
+        */
+        tbb::enumerable_thread_specific<myrand> mrs{ 1, 6 };
+    };
+
+    // #endregion 型の定義
+
+    // #region コンストラクタ・デストラクタ
+
+    Simulator::Simulator(int nthread)
+        : arena_(nthread),
+          correlationsize_(0U),
+          mrs_(std::make_unique<ThreadRandoms>())
+    {
+        arena_.initialize();
+    }
+
+    Simulator::~Simulator() = default;
+
+    // #endregion コンストラクタ・デストラクタ
+
+    // #region publicメンバ関数
+
+    Result Simulator::run(RunConfig const & config)
+    {
+        if (config.patterns.empty()) {
+            throw std::invalid_argument("文字列が指定されていません");
+        }
+
+        for (auto const & str : config.patterns) {
+            pattern::tocode(str);
+        }
+
+        if (!(config.bias > 0.0 && config.bias < 1.0)) {
+            throw std::invalid_argument("Uが出る確率は0より大きく1より小さくなければなりません");
+        }
+
+        auto const npattern = static_cast<std::uint32_t>(config.patterns.size());
+
+        // ペアが指定されていない場合は全ての順序付きのペア
+        auto pairs(config.pairs);
+        if (pairs.empty()) {
+            for (auto i = 0U; i < npattern; i++) {
+                for (auto j = 0U; j < npattern; j++) {
+                    if (i != j) {
+                        pairs.emplace_back(i, j);
+                    }
+                }
+            }
+        }
+
+        for (auto const & pair : pairs) {
+            if (pair.first >= npattern || pair.second >= npattern || pair.first == pair.second) {
+                throw std::invalid_argument("文字列のペアの添字が不正です");
+            }
+        }
+
+        // 厳密な計算はアリーナを使わないので、モンテカルロ・シミュレーションとは別のミューテックスで保護する
+        if (config.engine == Engine::EXACT) {
+            std::lock_guard<std::mutex> lock(cormtx_);
+            return exact(config, pairs);
+        }
+
+        std::lock_guard<std::mutex> lock(mtx_);
+        return montecarlo(config, pairs);
+    }
+
+    // #endregion publicメンバ関数
+
+    // #region privateメンバ関数
+
+    correlation::Correlation const & Simulator::correlation(std::uint32_t len, double bias)
+    {
+        auto const k = std::make_pair(len, bias);
+        auto const itr = correlations_.find(k);
+        if (itr != correlations_.end()) {
+            // 最近使ったものとしてリストの先頭に移す
+            corlru_.splice(corlru_.begin(), corlru_, itr->second.second);
+            return *itr->second.first;
+        }
+
+        auto cor = std::make_unique<correlation::Correlation>(len, bias);
+        correlationsize_ += cor->npattern();
+
+        corlru_.push_front(k);
+        auto const & entry = correlations_.emplace(k, std::make_pair(std::move(cor), corlru_.begin())).first->second;
+
+        // 上限を超えたら、今作成したもの以外で最も長く使われていないものから捨てる
+        while (correlationsize_ > CORRELATIONLIMIT && corlru_.size() > 1U) {
+            auto const last = correlations_.find(corlru_.back());
+            correlationsize_ -= last->second.first->npattern();
+            correlations_.erase(last);
+            corlru_.pop_back();
+        }
+
+        return *entry.first;
+    }
+
+    Result Simulator::exact(RunConfig const & config, std::vector<indexpair> const & pairs)
+    {
+        auto const len = static_cast<std::uint32_t>(config.patterns.front().size());
+        for (auto const & str : config.patterns) {
+            if (str.size() != len) {
+                throw std::invalid_argument("厳密な計算では文字列の長さが全て等しくなければなりません");
+            }
+        }
+
+        // 相関を計算するオブジェクトは呼び出しの間で使い回す
+        auto const & cor = correlation(len, config.bias);
+
+        Result result;
+        result.trials = 0U;
+
+        for (auto const & str : config.patterns) {
+            result.waitingtime.push_back(cor.waitingtime(pattern::tocode(str)));
+        }
+
+        for (auto const & pair : pairs) {
+            auto const a = pattern::tocode(config.patterns[pair.first]);
+            auto const b = pattern::tocode(config.patterns[pair.second]);
+            result.pairs.push_back({ pair.first, pair.second, cor.winprobability(a, b), 0.0, 0U, 0U });
+        }
+
+        return result;
+    }
+
+    Result Simulator::montecarlo(RunConfig const & config, std::vector<indexpair> const & pairs)
+    {
+        if (!config.horizon || !config.trials) {
+            throw std::invalid_argument("UかDの文字列の長さと試行回数は1以上でなければなりません");
+        }
+
+        std::vector<flips::Target> targets;
+        for (auto const & str : config.patterns) {
+            targets.push_back(flips::maketarget(str));
+        }
+
+        auto const npattern = static_cast<std::uint32_t>(targets.size());
+        auto const npair = static_cast<std::uint32_t>(pairs.size());
+        auto const threshold = flips::biasthreshold(config.bias);
+
+        // スレッド毎の集計結果
+        tbb::enumerable_thread_specific<Accumulator> accs(npattern, npair);
+
+        // 制限時間を過ぎたら、このコンテキストを取り消して残りの試行の塊を実行させない
+        tbb::task_group_context ctx;
+        auto const deadline = std::chrono::steady_clock::now() + std::chrono::milliseconds(config.deadline);
+
+        auto const body = [&](tbb::blocked_range<std::uint64_t> const & range) {
+            auto & mr = mrs_->mrs.local();
+            auto & acc = accs.local();
+
+            if (config.seed) {
+                mr.seed(flips::chunkseed(config.seed, range.begin()));
+            }
+
+            // 制限時間がある場合は、試行の途中でもDEADLINECHECKワード毎に時刻を確認する
+            auto words = 0U;
+            auto const expired = [&] {
+                if (!config.deadline || (++words & (DEADLINECHECK - 1U))) {
+                    return false;
+                }
+
+                if (ctx.is_group_execution_cancelled() || std::chrono::steady_clock::now() >= deadline) {
+                    ctx.cancel_group_execution();
+                    return true;
+                }
+
+                return false;
+            };
+
+            for (auto n = range.begin(); n != range.end(); ++n) {
+                // 制限時間を過ぎた場合は、完了していないこの試行だけを捨てる
+                if (!flips::firstoccurrence([&] { return flips::makeword(mr, threshold); }, expired, config.horizon, targets, acc.first)) {
+                    return;
+                }
+
+                for (auto p = 0U; p < npattern; p++) {
+                    acc.firstsum[p] += acc.first[p] ? acc.first[p] : config.horizon;
+                }
+
+                for (auto k = 0U; k < npair; k++) {
+                    flips::countwins(acc.first[pairs[k].first], acc.first[pairs[k].second], acc.wins.data() + 2U * k);
+                }
+
+                acc.trials++;
+            }
+        };
+
+        arena_.execute([&] {
+            if (config.deadline) {
+                // 制限時間がある場合は、一つの塊のUかDの個数がおよそ一定になるよう、塊の試行の数をUかDの文字列の長さに応じて決める
+                auto const grain = std::max<std::uint64_t>(1U, std::min<std::uint64_t>(CHUNK, DEADLINEFLIPS / config.horizon));
+                tbb::parallel_for(
+                    tbb::blocked_range<std::uint64_t>(0U, config.trials, grain),
+                    body,
+                    tbb::simple_partitioner(),
+                    ctx);
+            }
+            else if (config.seed) {
+                // 試行の塊の分け方をスレッドの割り当てによらず一定にし、結果を再現できるようにする
+                tbb::parallel_for(
+                    tbb::blocked_range<std::uint64_t>(0U, config.trials, CHUNK),
+                    body,
+                    tbb::simple_partitioner(),
+                    ctx);
+            }
+            else {
+                tbb::parallel_for(tbb::blocked_range<std::uint64_t>(0U, config.trials, 1024U), body, ctx);
+            }
+        });
+
+        // スレッド毎の集計結果を足し合わせる
+        Accumulator total(npattern, npair);
+        for (auto & acc : accs) {
+            total.add(acc);
+        }
+
+        if (!total.trials) {
+            throw std::runtime_error("制限時間内に完了した試行がありません");
+        }
+
+        auto const trials = static_cast<double>(total.trials);
+
+        Result result;
+        result.firstsum = total.firstsum;
+        result.trials = total.trials;
+
+        for (auto p = 0U; p < npattern; p++) {
+            result.waitingtime.push_back(static_cast<double>(total.firstsum[p]) / trials);
+        }
+
+        for (auto k = 0U; k < npair; k++) {
+            auto const prob = static_cast<double>(total.wins[2U * k]) / trials;
+            result.pairs.push_back({
+                pairs[k].first,
+                pairs[k].second,
+                prob,
+                std::sqrt(prob * (1.0 - prob) / trials),
+                total.wins[2U * k],
+                total.wins[2U * k + 1U] });
+        }
+
+        return result;
+    }
+
+    // #endregion privateメンバ関数
+}
@@ -0,0 +1,341 @@
+﻿/*! \file simulator.h
+    \brief 他のプログラムから呼び出すためのシミュレータクラスの宣言
+
+    Copyright © 2017 @dc1394 All Rights Reserved.
+    This software is released under the BSD 2-Clause License.
+*/
+
+#ifndef _SIMULATOR_H_
+#define _SIMULATOR_H_
+
+#pragma once
+
+#include "../correlation/correlation.h"
+#include <cstdint>                              // for std::uint32_t, std::uint64_t
+#include <list>                                 // for std::list
+#include <map>                                  // for std::map
+#include <memory>                               // for std::unique_ptr
+#include <mutex>                                // for std::mutex
+#include <string>                               // for std::string
+#include <utility>                              // for std::pair
+#include <vector>                               // for std::vector
+#include <tbb/task_arena.h>                     // for tbb::task_arena
+
+namespace simulator {
+    //! An enumeration.
+    /*!
+        計算の方法
+    */
+    enum class Engine {
+        //! 相関（Conwayの数）による厳密な計算（UかDの文字列の長さは無限大とする）
+        EXACT,
+
+        //! モンテカルロ・シミュレーション
+        MONTECARLO
+    };
+
+    //! A typedef.
+    /*!
+        文字列のペアの添字（RunConfig::patternsの添字）
+    */
+    using indexpair = std::pair<std::uint32_t, std::uint32_t>;
+
+    //! A struct.
+    /*!
+        一回の実行の設定
+    */
+    struct RunConfig final {
+        //! A public member variable.
+        /*!
+            Uが出る確率
+        */
+        double bias = 0.5;
+
+        //! A public member variable.
+        /*!
+            制限時間（ミリ秒、モンテカルロ・シミュレーションの場合のみ）
+            0でない場合は制限時間まで試行を続け、完了した試行のみを集計する（trialsは試行回数の上限、結果は再現されない）
+        */
+        std::uint32_t deadline = 0U;
+
+        //! A public member variable.
+        /*!
+            計算の方法
+        */
+        Engine engine = Engine::MONTECARLO;
+
+        //! A public member variable.
+        /*!
+            UかDの文字列の長さ（モンテカルロ・シミュレーションの場合のみ）
+        */
+        std::uint32_t horizon = 100U;
+
+        //! A public member variable.
+        /*!
+            勝率を求める文字列のペア（空の場合は全ての順序付きのペア）
+        */
+        std::vector<indexpair> pairs;
+
+        //! A public member variable.
+        /*!
+            対象とするUとDの文字列（長さは異なっていてもよい）
+        */
+        std::vector<std::string> patterns;
+
+        //! A public member variable.
+        /*!
+            乱数の種（0の場合は、前回の呼び出しから続く乱数列を使う）
+        */
+        std::uint64_t seed = 0U;
+
+        //! A public member variable.
+        /*!
+            試行回数（モンテカルロ・シミュレーションの場合のみ）
+        */
+        std::uint64_t trials = 1000000U;
+    };
+
+    //! A struct.
+    /*!
+        文字列のペアに対する結果
+    */
+    struct PairResult final {
+        //! A public member variable.
+        /*!
+            前者の文字列の添字
+        */
+        std::uint32_t a;
+
+        //! A public member variable.
+        /*!
+            後者の文字列の添字
+        */
+        std::uint32_t b;
+
+        //! A public member variable.
+        /*!
+            前者が先に出現する確率
+        */
+        double probability;
+
+        //! A public member variable.
+        /*!
+            確率の標準誤差（厳密な計算の場合は0）
+        */
+        double stderror;
+
+        //! A public member variable.
+        /*!
+            前者が先に出現した回数（厳密な計算の場合は0）
+        */
+        std::uint64_t winsa;
+
+        //! A public member variable.
+        /*!
+            後者が先に出現した回数（厳密な計算の場合は0）
+        */
+        std::uint64_t winsb;
+    };
+
+    //! A struct.
+    /*!
+        一回の実行の結果
+    */
+    struct Result final {
+        //! A public member variable.
+        /*!
+            各文字列の最初の出現位置の和（見つからなかった場合はhorizonとする、厳密な計算の場合は空）
+            waitingtimeは丸めた値なので、実行の結果を重ねる場合はこちらを使う
+        */
+        std::vector<std::uint64_t> firstsum;
+
+        //! A public member variable.
+        /*!
+            文字列のペアに対する結果（RunConfig::pairsの順）
+        */
+        std::vector<PairResult> pairs;
+
+        //! A public member variable.
+        /*!
+            実際に行った試行回数（厳密な計算の場合は0）
+        */
+        std::uint64_t trials;
+
+        //! A public member variable.
+        /*!
+            各文字列が出現するまでの期待値（モンテカルロ・シミュレーションで見つからなかった場合はhorizonとする）
+        */
+        std::vector<double> waitingtime;
+    };
+
+    //! A class.
+    /*!
+        他のプログラムから繰り返し呼び出すためのシミュレータクラス
+        TBBのスレッドのアリーナとスレッド毎の乱数エンジンを呼び出しの間で保持するので、
+        小さな計算を何度も行う場合にプロセスの起動やスレッドの生成の時間がかからない
+        runは複数のスレッドから同時に呼び出してもよいが、モンテカルロ・シミュレーションはアリーナを共有するので一つずつ実行される
+        厳密な計算は別のミューテックスで保護するので、モンテカルロ・シミュレーションの終了を待たない
+    */
+    class Simulator final {
+        // #region 型の前方宣言
+
+        //! A struct.
+        /*!
+            スレッド毎の自作乱数クラスのオブジェクト
+            乱数エンジンの選択はライブラリのビルドの設定によるので、呼び出し側にレイアウトを見せない
+        */
+        struct ThreadRandoms;
+
+        // #endregion 型の前方宣言
+
+        // #region コンストラクタ・デストラクタ
+
+    public:
+        //! A constructor.
+        /*!
+            唯一のコンストラクタ
+            \param nthread 使用するスレッドの数（tbb::task_arena::automaticの場合は全てのコア）
+        */
+        explicit Simulator(int nthread);
+
+        //! A destructor.
+        /*!
+            デストラクタ（ThreadRandomsの定義が見えるsimulator.cppで定義する）
+        */
+        ~Simulator();
+
+        // #endregion コンストラクタ・デストラクタ
+
+        // #region メンバ関数
+
+        //! A public member function.
+        /*!
+            設定に従って計算を行う
+            \param config 一回の実行の設定
+            \return 一回の実行の結果
+        */
+        Result run(RunConfig const & config);
+
+    private:
+        //! A typedef.
+        /*!
+            相関を計算するオブジェクトのキャッシュのキー（文字列の長さ、Uが出る確率）
+        */
+        using corkey = std::pair<std::uint32_t, double>;
+
+        //! A typedef.
+        /*!
+            最近使った順の相関を計算するオブジェクトのキャッシュのキーのリスト
+        */
+        using corlrulist = std::list<corkey>;
+
+        //! A private member function.
+        /*!
+            相関を計算するオブジェクトをキャッシュから返す（なければ作成する）
+            キャッシュの各文字列の自己相関の数の合計がCORRELATIONLIMITを超えれば、最も長く使われていないものから捨てる
+            \param len 文字列の長さ
+            \param bias Uが出る確率
+            \return 相関を計算するオブジェクト（次の呼び出しまで有効）
+        */
+        correlation::Correlation const & correlation(std::uint32_t len, double bias);
+
+        //! A private member function.
+        /*!
+            相関によって厳密に計算する
+            \param config 一回の実行の設定
+            \param pairs 勝率を求める文字列のペア
+            \return 一回の実行の結果
+        */
+        Result exact(RunConfig const & config, std::vector<indexpair> const & pairs);
+
+        //! A private member function.
+        /*!
+            モンテカルロ・シミュレーションで計算する
+            \param config 一回の実行の設定
+            \param pairs 勝率を求める文字列のペア
+            \return 一回の実行の結果
+        */
+        Result montecarlo(RunConfig const & config, std::vector<indexpair> const & pairs);
+
+        // #endregion メンバ関数
+
+        // #region メンバ変数
+
+        //! A private member variable.
+        /*!
+            TBBのスレッドのアリーナ
+        */
+        tbb::task_arena arena_;
+
+        //! A private static member variable (constant expression).
+        /*!
+            キャッシュする各文字列の自己相関の数の合計の上限（倍精度浮動小数点数で256MB）
+        */
+        static auto constexpr CORRELATIONLIMIT = UINT64_C(1) << 25;
+
+        //! A private member variable.
+        /*!
+            文字列の長さとUが出る確率をキーとする、相関を計算するオブジェクトと、最近使った順のリストでのキーの位置のキャッシュ
+        */
+        std::map<corkey, std::pair<std::unique_ptr<correlation::Correlation>, corlrulist::iterator>> correlations_;
+
+        //! A private member variable.
+        /*!
+            キャッシュした各文字列の自己相関の数の合計
+        */
+        std::uint64_t correlationsize_;
+
+        //! A private member variable.
+        /*!
+            相関を計算するオブジェクトのキャッシュのキーの、最近使った順のリスト（先頭が最も最近）
+        */
+        corlrulist corlru_;
+
+        //! A private member variable.
+        /*!
+            相関を計算するオブジェクトのキャッシュを保護し、厳密な計算を一つずつ実行するためのミューテックス
+        */
+        std::mutex cormtx_;
+
+        //! A private member variable.
+        /*!
+            スレッド毎の自作乱数クラスのオブジェクト
+        */
+        std::unique_ptr<ThreadRandoms> const mrs_;
+
+        //! A private member variable.
+        /*!
+            モンテカルロ・シミュレーションを一つずつ実行するためのミューテックス
+        */
+        std::mutex mtx_;
+
+        // #endregion メンバ変数
+
+        // #region 禁止されたコンストラクタ・メンバ関数
+
+        //! A private constructor (deleted).
+        /*!
+            デフォルトコンストラクタ（禁止）
+        */
+        Simulator() = delete;
+
+        //! A private copy constructor (deleted).
+        /*!
+            コピーコンストラクタ（禁止）
+            \param dummy コピー元のオブジェクト（未使用）
+        */
+        Simulator(Simulator const & dummy) = delete;
+
+        //! A private member function (deleted).
+        /*!
+            operator=()の宣言（禁止）
+            \param dummy コピー元のオブジェクト（未使用）
+            \return コピー元のオブジェクト
+        */
+        Simulator & operator=(Simulator const & dummy) = delete;
+
+        // #endregion 禁止されたコンストラクタ・メンバ関数
+    };
+}
+
+#endif  // _SIMULATOR_H_
@@ -0,0 +1,188 @@
+﻿/*! \file stageprobe.cpp
+    \brief 一回の試行の中の段階毎のサイクル数を計測するためのプローブの実装
+
+    Copyright © 2017 @dc1394 All Rights Reserved.
+    This software is released under the BSD 2-Clause License.
+*/
+
+#include "stageprobe.h"
+#include <array>                                // for std::array
+#include <iomanip>                              // for std::setw
+#include <string>                               // for std::to_string
+#include <tbb/enumerable_thread_specific.h>     // for tbb::enumerable_thread_specific
+
+namespace stageprobe {
+    // #region 無名名前空間
+
+    namespace {
+        //! A struct.
+        /*!
+            スレッド毎のカウンタ
+        */
+        struct Counters final {
+            //! A public member variable.
+            /*!
+                試行の回数
+            */
+            std::uint64_t trials = 0U;
+
+            //! A public member variable.
+            /*!
+                計測した試行の回数
+            */
+            std::uint64_t sampled = 0U;
+
+            //! A public member variable.
+            /*!
+                計測した試行の全体のサイクル数
+            */
+            std::uint64_t total = 0U;
+
+            //! A public member variable.
+            /*!
+                計測した試行の段階毎のサイクル数
+            */
+            std::array<std::uint64_t, static_cast<std::size_t>(Stage::NSTAGE)> stage = {};
+
+            //! A public member variable.
+            /*!
+                現在の試行を計測中かどうか
+            */
+            bool active = false;
+        };
+
+        //! A global variable (constant expression).
+        /*!
+            段階の名前
+        */
+        static constexpr char const * STAGENAME[] = { "rng", "build", "search", "insert" };
+
+        //! A global variable.
+        /*!
+            スレッド毎のカウンタ
+        */
+        tbb::enumerable_thread_specific<Counters> counters;
+
+        //! A thread-local variable.
+        /*!
+            現在のスレッドのカウンタへのポインタのキャッシュ
+        */
+        thread_local Counters * local = nullptr;
+
+        //! A function.
+        /*!
+            現在のスレッドのカウンタを返す
+            \return 現在のスレッドのカウンタ
+        */
+        inline Counters & mycounters()
+        {
+            if (!local) {
+                local = &counters.local();
+            }
+
+            return *local;
+        }
+
+        //! A function.
+        /*!
+            1試行当たりのサイクル数の表を表示する
+            \param os 出力ストリーム
+            \param label 行の名前
+            \param c カウンタ
+        */
+        void printrow(std::ostream & os, char const * label, Counters const & c)
+        {
+            auto const n = static_cast<double>(c.sampled);
+            std::uint64_t staged = 0U;
+            
+            os << std::setw(8) << label;
+            for (auto const s : c.stage) {
+                staged += s;
+                os << std::setw(12) << static_cast<double>(s) / n;
+            }
+
+            auto const other = c.total > staged ? c.total - staged : 0U;
+            os << std::setw(12) << static_cast<double>(other) / n
+               << std::setw(12) << static_cast<double>(c.total) / n
+               << std::setw(12) << c.sampled << '/' << c.trials << '\n';
+        }
+    }
+
+    // #endregion 無名名前空間
+
+    bool sampling()
+    {
+        return mycounters().active;
+    }
+
+    void addstage(Stage stage, std::uint64_t c)
+    {
+        mycounters().stage[static_cast<std::size_t>(stage)] += c;
+    }
+
+    bool begintrial()
+    {
+        auto & c = mycounters();
+        c.active = c.trials++ % STAGEPROBE_INTERVAL == 0U;
+        
+        return c.active;
+    }
+
+    void endtrial(std::uint64_t c)
+    {
+        auto & cs = mycounters();
+        cs.total += c;
+        cs.sampled++;
+        cs.active = false;
+    }
+
+    void report(std::ostream & os)
+    {
+        Counters sum;
+        for (auto const & c : counters) {
+            sum.trials += c.trials;
+            sum.sampled += c.sampled;
+            sum.total += c.total;
+            for (auto i = 0U; i < sum.stage.size(); i++) {
+                sum.stage[i] += c.stage[i];
+            }
+        }
+
+        if (!sum.sampled) {
+            os << "計測された試行はありません\n";
+            return;
+        }
+
+        auto const flags = os.flags();
+        auto const precision = os.precision();
+        os << std::fixed << std::setprecision(1);
+
+        os << "1試行当たりの段階毎のサイクル数（" << STAGEPROBE_INTERVAL << "試行毎に計測）\n"
+           << std::setw(8) << "thread";
+        for (auto const name : STAGENAME) {
+            os << std::setw(12) << name;
+        }
+        os << std::setw(12) << "other" << std::setw(12) << "total" << std::setw(12) << "sampled" << '\n';
+
+        auto i = 0;
+        for (auto const & c : counters) {
+            if (c.sampled) {
+                printrow(os, std::to_string(i).c_str(), c);
+            }
+            i++;
+        }
+        printrow(os, "all", sum);
+
+        os << std::setw(8) << "share";
+        std::uint64_t staged = 0U;
+        for (auto const s : sum.stage) {
+            staged += s;
+            os << std::setw(11) << 100.0 * static_cast<double>(s) / static_cast<double>(sum.total) << '%';
+        }
+        auto const other = sum.total > staged ? sum.total - staged : 0U;
+        os << std::setw(11) << 100.0 * static_cast<double>(other) / static_cast<double>(sum.total) << "%\n";
+
+        os.flags(flags);
+        os.precision(precision);
+    }
+}
@@ -0,0 +1,263 @@
+﻿/*! \file stageprobe.h
+    \brief 一回の試行の中の段階毎のサイクル数を計測するためのプローブの宣言
+
+    Copyright © 2017 @dc1394 All Rights Reserved.
+    This software is released under the BSD 2-Clause License.
+*/
+
+#ifndef _STAGEPROBE_H_
+#define _STAGEPROBE_H_
+
+#pragma once
+
+#include <cstdint>  // for std::uint32_t, std::uint64_t
+#include <ostream>  // for std::ostream
+
+#ifdef _MSC_VER
+    #include <intrin.h>     // for __rdtsc
+#elif defined(__x86_64__) || defined(__i386__)
+    #include <x86intrin.h>  // for __rdtsc
+#else
+    #include <chrono>       // for std::chrono
+#endif
+
+//! A macro.
+/*!
+    計測する試行の間隔（この回数の試行毎に一回計測する）
+*/
+#ifndef STAGEPROBE_INTERVAL
+    #define STAGEPROBE_INTERVAL 64U
+#endif
+
+//! A macro.
+/*!
+    STAGEPROBEが定義されている場合のみ、一回の試行の全体を計測する（定義されていない場合は何もしない）
+*/
+#ifdef STAGEPROBE
+    #define STAGEPROBE_TRIAL() stageprobe::Trial const stageprobetrial_
+#else
+    #define STAGEPROBE_TRIAL()
+#endif
+
+//! A macro.
+/*!
+    STAGEPROBEが定義されている場合のみ、スコープの終わりまでを段階stageとして計測する（定義されていない場合は何もしない）
+*/
+#ifdef STAGEPROBE
+    #define STAGEPROBE_SCOPE(stage) stageprobe::Probe const stageprobe##stage##_(stageprobe::Stage::stage)
+#else
+    #define STAGEPROBE_SCOPE(stage)
+#endif
+
+namespace stageprobe {
+    //! An enumeration.
+    /*!
+        一回の試行の中の段階
+    */
+    enum class Stage : std::uint32_t {
+        //! 乱数の生成
+        RNG,
+
+        //! UDのランダム文字列の構築
+        BUILD,
+
+        //! 文字列の検索
+        SEARCH,
+
+        //! 結果の連想配列への挿入
+        INSERT,
+
+        //! 段階の数
+        NSTAGE
+    };
+
+    //! A function.
+    /*!
+        サイクル数（x86以外ではナノ秒）を読む
+        \return サイクル数
+    */
+    inline std::uint64_t cycles()
+    {
+#if defined(_MSC_VER) || defined(__x86_64__) || defined(__i386__)
+        return __rdtsc();
+#else
+        return static_cast<std::uint64_t>(
+            std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch()).count());
+#endif
+    }
+
+    //! A function.
+    /*!
+        現在のスレッドで計測中の試行かどうかを返す
+        \return 計測中ならtrue
+    */
+    bool sampling();
+
+    //! A function.
+    /*!
+        現在のスレッドの段階のサイクル数を加える
+        \param stage 段階
+        \param c サイクル数
+    */
+    void addstage(Stage stage, std::uint64_t c);
+
+    //! A function.
+    /*!
+        現在のスレッドで試行を始め、計測するかどうかを決める
+        \return 計測する場合はtrue
+    */
+    bool begintrial();
+
+    //! A function.
+    /*!
+        現在のスレッドで計測した試行の全体のサイクル数を加える
+        \param c サイクル数
+    */
+    void endtrial(std::uint64_t c);
+
+    //! A function.
+    /*!
+        段階毎・スレッド毎の1試行当たりのサイクル数を表示する
+        \param os 出力ストリーム
+    */
+    void report(std::ostream & os);
+
+    //! A class.
+    /*!
+        一回の試行の全体を計測するクラス
+        コンストラクタで計測するかどうかを決め、計測する場合はデストラクタで全体のサイクル数を加える
+    */
+    class Trial final {
+        // #region コンストラクタ・デストラクタ
+
+    public:
+        //! A constructor.
+        /*!
+            唯一のコンストラクタ
+        */
+        Trial()
+            : begin_(begintrial() ? cycles() : 0U)
+        {
+        }
+
+        //! A destructor.
+        /*!
+            デストラクタ
+        */
+        ~Trial()
+        {
+            if (begin_) {
+                endtrial(cycles() - begin_);
+            }
+        }
+
+        // #endregion コンストラクタ・デストラクタ
+
+        // #region メンバ変数
+
+    private:
+        //! A private member variable.
+        /*!
+            試行の開始時のサイクル数（計測しない場合は0）
+        */
+        std::uint64_t const begin_;
+
+        // #endregion メンバ変数
+
+        // #region 禁止されたコンストラクタ・メンバ関数
+
+        //! A private copy constructor (deleted).
+        /*!
+            コピーコンストラクタ（禁止）
+            \param dummy コピー元のオブジェクト（未使用）
+        */
+        Trial(Trial const & dummy) = delete;
+
+        //! A private member function (deleted).
+        /*!
+            operator=()の宣言（禁止）
+            \param dummy コピー元のオブジェクト（未使用）
+            \return コピー元のオブジェクト
+        */
+        Trial & operator=(Trial const & dummy) = delete;
+
+        // #endregion 禁止されたコンストラクタ・メンバ関数
+    };
+
+    //! A class.
+    /*!
+        スコープの終わりまでを一つの段階として計測するクラス
+    */
+    class Probe final {
+        // #region コンストラクタ・デストラクタ
+
+    public:
+        //! A constructor.
+        /*!
+            唯一のコンストラクタ
+            \param stage 段階
+        */
+        explicit Probe(Stage stage)
+            : begin_(sampling() ? cycles() : 0U),
+              stage_(stage)
+        {
+        }
+
+        //! A destructor.
+        /*!
+            デストラクタ
+        */
+        ~Probe()
+        {
+            if (begin_) {
+                addstage(stage_, cycles() - begin_);
+            }
+        }
+
+        // #endregion コンストラクタ・デストラクタ
+
+        // #region メンバ変数
+
+    private:
+        //! A private member variable.
+        /*!
+            段階の開始時のサイクル数（計測しない場合は0）
+        */
+        std::uint64_t const begin_;
+
+        //! A private member variable.
+        /*!
+            段階
+        */
+        Stage const stage_;
+
+        // #endregion メンバ変数
+
+        // #region 禁止されたコンストラクタ・メンバ関数
+
+        //! A private constructor (deleted).
+        /*!
+            デフォルトコンストラクタ（禁止）
+        */
+        Probe() = delete;
+
+        //! A private copy constructor (deleted).
+        /*!
+            コピーコンストラクタ（禁止）
+            \param dummy コピー元のオブジェクト（未使用）
+        */
+        Probe(Probe const & dummy) = delete;
+
+        //! A private member function (deleted).
+        /*!
+            operator=()の宣言（禁止）
+            \param dummy コピー元のオブジェクト（未使用）
+            \return コピー元のオブジェクト
+        */
+        Probe & operator=(Probe const & dummy) = delete;
+
+        // #endregion 禁止されたコンストラクタ・メンバ関数
+    };
+}
+
+#endif  // _STAGEPROBE_H_
@@ -0,0 +1,204 @@
+﻿/*! \file trialstore.cpp
+    \brief 試行毎の各文字列の最初の出現位置を1バイトずつ保持するクラスの実装
+
+    Copyright © 2017 @dc1394 All Rights Reserved.
+    This software is released under the BSD 2-Clause License.
+*/
+
+#include "trialstore.h"
+#include "../flips/patternscan.h"
+#ifdef HAVE_SSE2
+    #include "../myrandom/myrandsfmt.h"
+#else
+    #include "../myrandom/myrand.h"
+#endif
+#include <cstdio>                                   // for std::remove
+#include <cstdlib>                                  // for std::getenv
+#include <fstream>                                  // for std::ofstream
+#include <limits>                                   // for std::numeric_limits
+#include <stdexcept>                                // for std::invalid_argument, std::runtime_error
+#include <vector>                                   // for std::vector
+#include <boost/interprocess/file_mapping.hpp>      // for boost::interprocess::file_mapping
+#include <tbb/blocked_range.h>                      // for tbb::blocked_range
+#include <tbb/enumerable_thread_specific.h>         // for tbb::enumerable_thread_specific
+#include <tbb/parallel_for.h>                       // for tbb::parallel_for
+#include <tbb/partitioner.h>                        // for tbb::simple_partitioner
+
+#ifdef _WIN32
+    #include <Windows.h>                            // for GetTempFileNameA, GetTempPathA
+#else
+    #include <unistd.h>                             // for close, mkstemp
+#endif
+
+namespace trialstore {
+    namespace {
+        //! A global variable (constant expression).
+        /*!
+            乱数の種を指定した場合に、同じ種から乱数列を作り直す試行の数
+        */
+        static auto constexpr CHUNK = 4096U;
+
+        //! A function.
+        /*!
+            一時ディレクトリに、他のプロセスと重ならない名前の空のファイルを作成する
+            \return 作成したファイル名
+        */
+        std::string maketempfile()
+        {
+#ifdef _WIN32
+            char dir[MAX_PATH + 1];
+            char path[MAX_PATH + 1];
+            if (!::GetTempPathA(sizeof(dir), dir) || !::GetTempFileNameA(dir, "kmc", 0, path)) {
+                throw std::runtime_error("一時ファイルを作成できませんでした");
+            }
+
+            return path;
+#else
+            auto const * const tmpdir = std::getenv("TMPDIR");
+            auto const name = std::string(tmpdir && *tmpdir ? tmpdir : "/tmp") + "/kakeguruitwin_trialstore.XXXXXX";
+
+            std::vector<char> path(name.begin(), name.end());
+            path.push_back('\0');
+
+            auto const fd = ::mkstemp(path.data());
+            if (fd < 0) {
+                throw std::runtime_error("一時ファイルを作成できませんでした: " + name);
+            }
+
+            ::close(fd);
+
+            return path.data();
+#endif
+        }
+    }
+
+    // #region コンストラクタ・デストラクタ
+
+    TrialStore::TrialStore(std::uint32_t len, std::uint32_t horizon, std::uint64_t trials, std::string const & filename)
+        : data_(nullptr),
+          filename_(filename),
+          horizon_(horizon),
+          len_(len),
+          removefile_(false),
+          trials_(trials)
+    {
+        if (len == 0U || len > MAXLENGTH) {
+            throw std::invalid_argument("文字列の長さは1以上10以下でなければなりません");
+        }
+
+        if (horizon < len || horizon > std::numeric_limits<std::uint8_t>::max()) {
+            throw std::invalid_argument("UかDの文字列の長さは文字列の長さ以上255以下でなければなりません");
+        }
+
+        if (!trials) {
+            throw std::invalid_argument("試行回数は1以上でなければなりません");
+        }
+
+        auto const size = static_cast<std::size_t>(trials) << len;
+
+        if (filename_.empty() && size <= MEMORYLIMIT) {
+            buffer_.resize(size);
+            data_ = buffer_.data();
+            return;
+        }
+
+        // ファイル名が指定されていなければ、一時ディレクトリに重ならない名前で作成する
+        if (filename_.empty()) {
+            filename_ = maketempfile();
+            removefile_ = true;
+        }
+
+        try {
+            // ファイルを必要な大きさで作成する
+            {
+                std::ofstream ofs(filename_, std::ios::binary | std::ios::trunc);
+                if (!ofs || !ofs.seekp(static_cast<std::streamoff>(size - 1U)) || !ofs.put('\0')) {
+                    throw std::runtime_error("ファイルを作成できませんでした: " + filename_);
+                }
+            }
+
+            boost::interprocess::file_mapping const fm(filename_.c_str(), boost::interprocess::read_write);
+            region_ = std::make_unique<boost::interprocess::mapped_region>(fm, boost::interprocess::read_write, 0, size);
+            data_ = static_cast<std::uint8_t *>(region_->get_address());
+        }
+        catch (...) {
+            // コンストラクタが失敗した場合はデストラクタが呼ばれないので、ここで削除する
+            if (removefile_) {
+                std::remove(filename_.c_str());
+            }
+
+            throw;
+        }
+    }
+
+    TrialStore::~TrialStore()
+    {
+        region_.reset();
+
+        if (removefile_) {
+            std::remove(filename_.c_str());
+        }
+    }
+
+    // #endregion コンストラクタ・デストラクタ
+
+    // #region 非メンバ関数
+
+    void montecarlo(TrialStore & store, std::uint64_t seed)
+    {
+#ifdef HAVE_SSE2
+        using myrand = myrandom::MyRandSfmt;
+#else
+        using myrand = myrandom::MyRand;
+#endif
+        auto const horizon = store.horizon();
+        auto const len = store.len();
+        auto const npattern = store.npattern();
+
+        // スレッド毎の自作乱数クラスのオブジェクト
+        tbb::enumerable_thread_specific<myrand> mrs(1, 6);
+
+        auto const body = [&](tbb::blocked_range<std::uint64_t> const & range) {
+            auto & mr = mrs.local();
+
+            if (seed) {
+                mr.seed(flips::chunkseed(seed, range.begin()));
+            }
+
+            flips::packedflips words;
+            std::vector<std::uint8_t> first(npattern);
+
+            for (auto i = range.begin(); i != range.end(); ++i) {
+                flips::makepackedflips(mr, horizon, words);
+
+                if (flips::firstoccurrence(words, horizon, len, first.data()) < npattern) {
+                    // 位置horizonは「見つからなかった」と区別できないので、最後のlen個の文字列以外は0にする
+                    auto last = 0U;
+                    for (auto t = horizon - len; t < horizon; t++) {
+                        last = (last << 1) | flips::getflip(words, t);
+                    }
+
+                    for (auto code = 0U; code < npattern; code++) {
+                        if (first[code] == horizon && code != last) {
+                            first[code] = 0U;
+                        }
+                    }
+                }
+
+                for (auto code = 0U; code < npattern; code++) {
+                    store.column(code)[i] = first[code];
+                }
+            }
+        };
+
+        if (seed) {
+            // 試行の塊の分け方をスレッドの割り当てによらず一定にし、結果を再現できるようにする
+            tbb::parallel_for(tbb::blocked_range<std::uint64_t>(0U, store.trials(), CHUNK), body, tbb::simple_partitioner());
+        }
+        else {
+            tbb::parallel_for(tbb::blocked_range<std::uint64_t>(0U, store.trials(), CHUNK), body);
+        }
+    }
+
+    // #endregion 非メンバ関数
+}
@@ -0,0 +1,232 @@
+﻿/*! \file trialstore.h
+    \brief 試行毎の各文字列の最初の出現位置を1バイトずつ保持するクラスの宣言
+
+    Copyright © 2017 @dc1394 All Rights Reserved.
+    This software is released under the BSD 2-Clause License.
+*/
+
+#ifndef _TRIALSTORE_H_
+#define _TRIALSTORE_H_
+
+#pragma once
+
+#include <cstddef>                                  // for std::size_t
+#include <cstdint>                                  // for std::uint8_t, std::uint32_t, std::uint64_t
+#include <memory>                                   // for std::unique_ptr
+#include <string>                                   // for std::string
+#include <vector>                                   // for std::vector
+#include <boost/interprocess/mapped_region.hpp>     // for boost::interprocess::mapped_region
+
+namespace trialstore {
+    //! A class.
+    /*!
+        試行毎の各文字列の最初の出現位置を1バイトずつ保持するクラス
+        文字列毎に全試行の出現位置を連続して並べる（structure of arrays）ので、一つの文字列に関する統計は
+        連続したメモリを読むだけで求まる
+        出現位置は1始まりで、見つからなかった場合は0とする
+        大きさがMEMORYLIMITを超える場合とファイル名が指定された場合は、ファイルにメモリマップする
+        （ファイル名が指定されていなければ、一時ディレクトリに重ならない名前のファイルを作成し、デストラクタで削除する）
+    */
+    class TrialStore final {
+        // #region コンストラクタ・デストラクタ
+
+    public:
+        //! A constructor.
+        /*!
+            唯一のコンストラクタ
+            \param len 文字列の長さ
+            \param horizon UかDの文字列の長さ
+            \param trials 試行回数
+            \param filename メモリマップするファイル名（空の場合は大きさに応じて決める）
+        */
+        TrialStore(std::uint32_t len, std::uint32_t horizon, std::uint64_t trials, std::string const & filename);
+
+        //! A destructor.
+        /*!
+            デストラクタ
+            自動的に作成したファイルは削除する
+        */
+        ~TrialStore();
+
+        // #endregion コンストラクタ・デストラクタ
+
+        // #region メンバ関数
+
+        //! A public member function.
+        /*!
+            文字列の全試行の出現位置を返す
+            \param code 文字列のビット列
+            \return 文字列の全試行の出現位置の先頭へのポインタ
+        */
+        std::uint8_t const * column(std::uint32_t code) const
+        {
+            return data_ + static_cast<std::size_t>(code) * trials_;
+        }
+
+        //! A public member function.
+        /*!
+            文字列の全試行の出現位置を返す
+            \param code 文字列のビット列
+            \return 文字列の全試行の出現位置の先頭へのポインタ
+        */
+        std::uint8_t * column(std::uint32_t code)
+        {
+            return data_ + static_cast<std::size_t>(code) * trials_;
+        }
+
+        // #endregion メンバ関数
+
+        // #region プロパティ
+
+        //! A property.
+        /*!
+            UかDの文字列の長さを返す
+        */
+        std::uint32_t horizon() const
+        {
+            return horizon_;
+        }
+
+        //! A property.
+        /*!
+            文字列の長さを返す
+        */
+        std::uint32_t len() const
+        {
+            return len_;
+        }
+
+        //! A property.
+        /*!
+            ファイルにメモリマップしているかどうかを返す
+        */
+        bool mapped() const
+        {
+            return static_cast<bool>(region_);
+        }
+
+        //! A property.
+        /*!
+            文字列の数を返す
+        */
+        std::uint32_t npattern() const
+        {
+            return 1U << len_;
+        }
+
+        //! A property.
+        /*!
+            試行回数を返す
+        */
+        std::uint64_t trials() const
+        {
+            return trials_;
+        }
+
+        // #endregion プロパティ
+
+        // #region メンバ変数
+
+        //! A public static member variable (constant expression).
+        /*!
+            メモリ上に確保する大きさの上限（これを超える場合はファイルにメモリマップする）
+        */
+        static auto constexpr MEMORYLIMIT = static_cast<std::size_t>(1) << 28;
+
+        //! A public static member variable (constant expression).
+        /*!
+            扱うことのできる文字列の長さの最大値
+        */
+        static auto constexpr MAXLENGTH = 10U;
+
+    private:
+        //! A private member variable.
+        /*!
+            メモリ上に確保した領域
+        */
+        std::vector<std::uint8_t> buffer_;
+
+        //! A private member variable.
+        /*!
+            出現位置を格納する領域の先頭へのポインタ
+        */
+        std::uint8_t * data_;
+
+        //! A private member variable.
+        /*!
+            メモリマップしたファイル名
+        */
+        std::string filename_;
+
+        //! A private member variable.
+        /*!
+            UかDの文字列の長さ
+        */
+        std::uint32_t const horizon_;
+
+        //! A private member variable.
+        /*!
+            文字列の長さ
+        */
+        std::uint32_t const len_;
+
+        //! A private member variable.
+        /*!
+            メモリマップした領域
+        */
+        std::unique_ptr<boost::interprocess::mapped_region> region_;
+
+        //! A private member variable.
+        /*!
+            ファイルを自動的に作成したかどうか
+        */
+        bool removefile_;
+
+        //! A private member variable.
+        /*!
+            試行回数
+        */
+        std::uint64_t const trials_;
+
+        // #endregion メンバ変数
+
+        // #region 禁止されたコンストラクタ・メンバ関数
+
+        //! A private constructor (deleted).
+        /*!
+            デフォルトコンストラクタ（禁止）
+        */
+        TrialStore() = delete;
+
+        //! A private copy constructor (deleted).
+        /*!
+            コピーコンストラクタ（禁止）
+            \param dummy コピー元のオブジェクト（未使用）
+        */
+        TrialStore(TrialStore const & dummy) = delete;
+
+        //! A private member function (deleted).
+        /*!
+            operator=()の宣言（禁止）
+            \param dummy コピー元のオブジェクト（未使用）
+            \return コピー元のオブジェクト
+        */
+        TrialStore & operator=(TrialStore const & dummy) = delete;
+
+        // #endregion 禁止されたコンストラクタ・メンバ関数
+    };
+
+    // #region 非メンバ関数
+
+    //! A function.
+    /*!
+        全試行の各文字列の最初の出現位置を、TBBで並列化したモンテカルロ・シミュレーションで求めて格納する
+        \param store 出現位置を格納するオブジェクト
+        \param seed 乱数の種（0の場合は試行の塊毎に種を設定しない）
+    */
+    void montecarlo(TrialStore & store, std::uint64_t seed);
+
+    // #endregion 非メンバ関数
+}
+
+#endif  // _TRIALSTORE_H_
@@ -0,0 +1,138 @@
+﻿/*! \file waitingtime.cpp
+    \brief 各文字列が最初に出現するまでの回数（待ち時間）の分布を求める関数の実装
+
+    Copyright © 2017 @dc1394 All Rights Reserved.
+    This software is released under the BSD 2-Clause License.
+*/
+
+#include "waitingtime.h"
+#ifdef HAVE_SSE2
+    #include "../myrandom/myrandsfmt.h"
+#else
+    #include "../myrandom/myrand.h"
+#endif
+#include <cstddef>                              // for std::size_t
+#include <stdexcept>                            // for std::invalid_argument
+#include <tbb/blocked_range.h>                  // for tbb::blocked_range
+#include <tbb/enumerable_thread_specific.h>     // for tbb::enumerable_thread_specific
+#include <tbb/parallel_for.h>                   // for tbb::parallel_for
+
+namespace waitingtime {
+    namespace {
+        //! A struct.
+        /*!
+            スレッド毎の集計結果
+        */
+        struct Accumulator final {
+            //! A constructor.
+            /*!
+                唯一のコンストラクタ
+                \param npattern 文字列の数
+                \param npair ペアの数
+            */
+            Accumulator(std::uint32_t npattern, std::uint32_t npair)
+                : first(npattern), pairs(npair), patterns(npattern)
+            {
+            }
+
+            //! A public member variable.
+            /*!
+                各文字列の最初の出現位置（試行毎に使い回す）
+            */
+            std::vector<std::uint64_t> first;
+
+            //! A public member variable.
+            /*!
+                ペアの決着までの回数の分布
+            */
+            std::vector<histogram::LogHistogram> pairs;
+
+            //! A public member variable.
+            /*!
+                各文字列の待ち時間の分布
+            */
+            std::vector<histogram::LogHistogram> patterns;
+        };
+
+        //! A function.
+        /*!
+            スレッド毎のヒストグラムを足し合わせる
+            ヒストグラム毎に独立に足し合わせるので、ヒストグラムについて並列化でき、ロックも必要ない
+            \param accs スレッド毎の集計結果
+            \param member 足し合わせるヒストグラムの配列を表すメンバ変数へのポインタ
+            \param result 足し合わせた結果
+        */
+        void mergehistograms(
+            tbb::enumerable_thread_specific<Accumulator> & accs,
+            std::vector<histogram::LogHistogram> Accumulator::* member,
+            std::vector<histogram::LogHistogram> & result)
+        {
+            tbb::parallel_for(
+                tbb::blocked_range<std::size_t>(0U, result.size()),
+                [&](auto const & range) {
+                for (auto k = range.begin(); k != range.end(); ++k) {
+                    for (auto const & acc : accs) {
+                        result[k].merge((acc.*member)[k]);
+                    }
+                }
+            });
+        }
+    }
+
+    Result montecarlo(std::uint32_t len, std::uint64_t trials)
+    {
+        if (len == 0U || len > MAXLENGTH) {
+            throw std::invalid_argument("文字列の長さは1以上12以下でなければなりません");
+        }
+
+#ifdef HAVE_SSE2
+        using myrand = myrandom::MyRandSfmt;
+#else
+        using myrand = myrandom::MyRand;
+#endif
+        auto const npattern = 1U << len;
+        auto const npair = len <= PAIRMAXLENGTH ? npattern * (npattern - 1U) / 2U : 0U;
+
+        // スレッド毎の自作乱数クラスのオブジェクト
+        tbb::enumerable_thread_specific<myrand> mrs(1, 6);
+
+        // スレッド毎の集計結果
+        tbb::enumerable_thread_specific<Accumulator> accs(npattern, npair);
+
+        tbb::parallel_for(
+            tbb::blocked_range<std::uint64_t>(0U, trials, 64U),
+            [&](auto const & range) {
+            auto & mr = mrs.local();
+            auto & acc = accs.local();
+
+            for (auto n = range.begin(); n != range.end(); ++n) {
+                firstoccurrence(mr, len, acc.first);
+
+                for (auto i = 0U; i < npattern; i++) {
+                    acc.patterns[i].record(acc.first[i]);
+                }
+
+                // ペア(i, j)の決着はどちらかが先に出現したとき
+                if (npair) {
+                    auto k = 0U;
+                    for (auto i = 0U; i < npattern; i++) {
+                        for (auto j = i + 1U; j < npattern; j++) {
+                            acc.pairs[k++].record(acc.first[i] < acc.first[j] ? acc.first[i] : acc.first[j]);
+                        }
+                    }
+                }
+            }
+        });
+
+        Result result;
+        result.len = len;
+        result.pairs.resize(npair);
+        result.patterns.resize(npattern);
+
+        // スレッド毎の集計結果を足し合わせる
+        mergehistograms(accs, &Accumulator::pairs, result.pairs);
+        mergehistograms(accs, &Accumulator::patterns, result.patterns);
+
+        return result;
+    }
+}
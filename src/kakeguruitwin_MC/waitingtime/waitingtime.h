@@ -0,0 +1,107 @@
+﻿/*! \file waitingtime.h
+    \brief 各文字列が最初に出現するまでの回数（待ち時間）の分布を求める関数の宣言
+
+    Copyright © 2017 @dc1394 All Rights Reserved.
+    This software is released under the BSD 2-Clause License.
+*/
+
+#ifndef _WAITINGTIME_H_
+#define _WAITINGTIME_H_
+
+#pragma once
+
+#include "../flips/packedflips.h"
+#include "../histogram/histogram.h"
+#include <algorithm>    // for std::fill
+#include <cstdint>      // for std::uint32_t, std::uint64_t
+#include <vector>       // for std::vector
+
+namespace waitingtime {
+    //! A global variable (constant expression).
+    /*!
+        扱うことのできる文字列の長さの最大値
+    */
+    static auto constexpr MAXLENGTH = 12U;
+
+    //! A global variable (constant expression).
+    /*!
+        ペアの決着までの回数の分布を求める文字列の長さの最大値
+    */
+    static auto constexpr PAIRMAXLENGTH = 4U;
+
+    //! A struct.
+    /*!
+        待ち時間の分布の集計結果
+    */
+    struct Result final {
+        //! A public member variable.
+        /*!
+            文字列の長さ
+        */
+        std::uint32_t len;
+
+        //! A public member variable.
+        /*!
+            ペアの決着までの回数の分布（i < jのペア(i, j)の順に並べる、len > PAIRMAXLENGTHのときは空）
+        */
+        std::vector<histogram::LogHistogram> pairs;
+
+        //! A public member variable.
+        /*!
+            各文字列の待ち時間の分布
+        */
+        std::vector<histogram::LogHistogram> patterns;
+    };
+
+    template <typename T>
+    //! A template function.
+    /*!
+        全ての文字列が出現するまで、UとDのランダム列を64個ずつ生成しながら走査し、各文字列の最初の出現位置を求める
+        （決められた回数で打ち切らないので、待ち時間の分布の裾まで正しく求まる）
+        \param mr 自作乱数クラスのオブジェクト
+        \param len 文字列の長さ
+        \param first 各文字列の最初の出現位置（1始まり、要素数は2^len）を格納するvector
+    */
+    void firstoccurrence(T & mr, std::uint32_t len, std::vector<std::uint64_t> & first)
+    {
+        auto const npattern = 1U << len;
+        auto const mask = npattern - 1U;
+
+        std::fill(first.begin(), first.end(), UINT64_C(0));
+
+        // 直近len個のUとDを表すビット列
+        auto window = 0U;
+
+        // 既に出現した文字列の個数
+        auto found = 0U;
+
+        auto t = UINT64_C(0);
+        for (;;) {
+            auto bits = flips::makerandomword(mr);
+            for (auto b = 0U; b < flips::WORDBITS; b++) {
+                window = ((window << 1) | static_cast<std::uint32_t>(bits & 1U)) & mask;
+                bits >>= 1;
+
+                if (++t < len || first[window]) {
+                    continue;
+                }
+
+                first[window] = t;
+                if (++found == npattern) {
+                    return;
+                }
+            }
+        }
+    }
+
+    //! A function.
+    /*!
+        待ち時間の分布のモンテカルロ・シミュレーションを、TBBで並列化して行う
+        \param len 文字列の長さ
+        \param trials 試行回数
+        \return 待ち時間の分布の集計結果
+    */
+    Result montecarlo(std::uint32_t len, std::uint64_t trials);
+}
+
+#endif  // _WAITINGTIME_H_
@@ -0,0 +1,584 @@
+﻿/*! \file winmatrix.cpp
+    \brief 長さKの全ての文字列のペアに対する勝利回数を集計するクラスの実装
+
+    Copyright © 2017 @dc1394 All Rights Reserved.
+    This software is released under the BSD 2-Clause License.
+*/
+
+#include "winmatrix.h"
+#include "../columnar/columnarwriter.h"
+#include "../flips/packedflips.h"
+#include "../pattern/pattern.h"
+#ifdef HAVE_SSE2
+    #include "../myrandom/myrandsfmt.h"
+#else
+    #include "../myrandom/myrand.h"
+#endif
+#include <algorithm>                            // for std::fill, std::max, std::min, std::sort
+#include <fstream>                              // for std::ofstream
+#include <functional>                           // for std::ref
+#include <limits>                               // for std::numeric_limits
+#include <random>                               // for std::mt19937_64, std::random_device
+#include <stdexcept>                            // for std::invalid_argument, std::runtime_error
+#include <string>                               // for std::to_string
+#include <unordered_set>                        // for std::unordered_set
+#include <tbb/blocked_range.h>                  // for tbb::blocked_range
+#include <tbb/enumerable_thread_specific.h>     // for tbb::enumerable_thread_specific
+#include <tbb/parallel_for.h>                   // for tbb::parallel_for
+
+#if defined(__AVX2__)
+    #include <immintrin.h>                      // for _mm256_*
+#elif defined(__SSE2__) || defined(_M_X64)
+    #include <emmintrin.h>                      // for _mm_*
+#endif
+
+namespace winmatrix {
+    namespace {
+        //! A global variable (constant expression).
+        /*!
+            16ビットのカウンタがあふれないように、総和に加えるまでに処理できる試行回数の上限
+        */
+        static auto constexpr COUNTERMAX = static_cast<std::uint32_t>(std::numeric_limits<std::uint16_t>::max());
+
+        //! A global variable (constant expression).
+        /*!
+            集計できる文字列のペアの数の上限（総和は128MiB、スレッド毎の16ビットのカウンタは32MiB）
+            全てのペアを集計する場合は、文字列の長さ12（4096 × 4096）まで
+        */
+        static auto constexpr PAIRSMAX = UINT64_C(1) << 24;
+
+        //! A global variable (constant expression).
+        /*!
+            バイナリファイルの識別子
+        */
+        static char const MAGIC[8] = { 'K', 'M', 'C', 'W', 'I', 'N', 'M', '\0' };
+
+        //! A global variable (constant expression).
+        /*!
+            バイナリファイルのバージョン
+        */
+        static auto constexpr VERSION = 1U;
+
+#if defined(__AVX2__)
+        //! A typedef.
+        /*!
+            16ビット整数のSIMDレジスタ
+        */
+        using vec = __m256i;
+
+        //! A global variable (constant expression).
+        /*!
+            SIMDレジスタ一つに格納される16ビット整数の数
+        */
+        static auto constexpr LANES = 16U;
+
+        inline vec load(std::int16_t const * p) { return _mm256_loadu_si256(reinterpret_cast<__m256i const *>(p)); }
+        inline vec load(std::uint16_t const * p) { return _mm256_loadu_si256(reinterpret_cast<__m256i const *>(p)); }
+        inline void store(std::uint16_t * p, vec v) { _mm256_storeu_si256(reinterpret_cast<__m256i *>(p), v); }
+        inline vec broadcast(std::int16_t x) { return _mm256_set1_epi16(x); }
+        inline vec cmpgt(vec a, vec b) { return _mm256_cmpgt_epi16(a, b); }
+        inline vec sub(vec a, vec b) { return _mm256_sub_epi16(a, b); }
+#elif defined(__SSE2__) || defined(_M_X64)
+        using vec = __m128i;
+
+        static auto constexpr LANES = 8U;
+
+        inline vec load(std::int16_t const * p) { return _mm_loadu_si128(reinterpret_cast<__m128i const *>(p)); }
+        inline vec load(std::uint16_t const * p) { return _mm_loadu_si128(reinterpret_cast<__m128i const *>(p)); }
+        inline void store(std::uint16_t * p, vec v) { _mm_storeu_si128(reinterpret_cast<__m128i *>(p), v); }
+        inline vec broadcast(std::int16_t x) { return _mm_set1_epi16(x); }
+        inline vec cmpgt(vec a, vec b) { return _mm_cmpgt_epi16(a, b); }
+        inline vec sub(vec a, vec b) { return _mm_sub_epi16(a, b); }
+#else
+        using vec = std::int16_t;
+
+        static auto constexpr LANES = 1U;
+
+        inline vec load(std::int16_t const * p) { return *p; }
+        inline vec load(std::uint16_t const * p) { return static_cast<vec>(*p); }
+        inline void store(std::uint16_t * p, vec v) { *p = static_cast<std::uint16_t>(v); }
+        inline vec broadcast(std::int16_t x) { return x; }
+        inline vec cmpgt(vec a, vec b) { return a > b ? -1 : 0; }
+        inline vec sub(vec a, vec b) { return static_cast<vec>(a - b); }
+#endif
+
+        //! A function.
+        /*!
+            16ビットの位置を、大小関係を保ったまま符号付き16ビット整数に変換する
+            \param x 位置
+            \return 変換された値
+        */
+        inline std::int16_t tosigned(std::uint16_t x)
+        {
+            return static_cast<std::int16_t>(static_cast<std::int32_t>(x) - 0x8000);
+        }
+
+        //! A function.
+        /*!
+            文字列の長さとUかDの文字列の長さが扱える範囲か確認する
+            \param len 文字列の長さ
+            \param horizon UかDの文字列の長さ
+        */
+        void checkrange(std::uint32_t len, std::uint32_t horizon)
+        {
+            if (len == 0U || len > 16U) {
+                throw std::invalid_argument("文字列の長さは1以上16以下でなければなりません");
+            }
+
+            if (horizon < len || horizon > COUNTERMAX) {
+                throw std::invalid_argument("UかDの文字列の長さは文字列の長さ以上65535以下でなければなりません");
+            }
+        }
+
+        //! A function.
+        /*!
+            集計する文字列のペアの数が、総和とカウンタの表に収まるか確認する
+            \param npair 文字列のペアの数
+        */
+        void checkpairs(std::uint64_t npair)
+        {
+            if (npair > PAIRSMAX) {
+                throw std::invalid_argument(
+                    "集計する文字列のペアの数は" + std::to_string(PAIRSMAX) +
+                    "以下でなければなりません（全てのペアを集計できる文字列の長さは12まで、それより長い場合は--sample-pairsを指定してください）");
+            }
+        }
+
+        //! A function.
+        /*!
+            値をリトルエンディアンのバイト列としてファイルに書き出す
+            \param ofs 出力ファイルストリーム
+            \param val 書き出す値
+        */
+        template <typename T>
+        void writevalue(std::ofstream & ofs, T val)
+        {
+            char buf[sizeof(T)];
+            for (auto i = 0U; i < sizeof(T); i++) {
+                buf[i] = static_cast<char>((static_cast<std::uint64_t>(val) >> (8U * i)) & 0xFFU);
+            }
+
+            ofs.write(buf, sizeof(T));
+        }
+    }
+
+    // #region コンストラクタ
+
+    WinMatrix::WinMatrix(std::uint32_t len, std::uint32_t horizon)
+        : horizon_(horizon),
+          len_(len),
+          npattern_(1U << len),
+          trials_(0U)
+    {
+        checkrange(len, horizon);
+        checkpairs(static_cast<std::uint64_t>(npattern_) * npattern_);
+
+        totals_.assign(static_cast<std::size_t>(npattern_) * npattern_, 0U);
+        inithistogram();
+    }
+
+    WinMatrix::WinMatrix(std::uint32_t len, std::uint32_t horizon, std::vector<indexpair> const & pairs)
+        : horizon_(horizon),
+          len_(len),
+          npattern_(1U << len),
+          pairs_(pairs),
+          trials_(0U)
+    {
+        checkrange(len, horizon);
+        checkpairs(pairs_.size());
+
+        for (auto const & p : pairs_) {
+            if (p.first >= npattern_ || p.second >= npattern_) {
+                throw std::invalid_argument("文字列のペアの添字が範囲外です");
+            }
+        }
+
+        totals_.assign(pairs_.size(), 0U);
+        inithistogram();
+    }
+
+    WinCounter::WinCounter(WinMatrix & wm)
+        : stride_((wm.npattern() + TILE - 1U) / TILE * TILE),
+          wm_(wm)
+    {
+        histogram_.assign(wm_.histogram().size(), 0U);
+        moments_.assign(2U * static_cast<std::size_t>(wm_.npattern()), 0U);
+
+        if (wm_.pairs().empty()) {
+            batch_.assign(static_cast<std::size_t>(BATCH) * stride_, std::numeric_limits<std::int16_t>::max());
+            counters_.assign(static_cast<std::size_t>(wm_.npattern()) * stride_, 0U);
+        }
+        else {
+            counters_.assign(wm_.pairs().size(), 0U);
+        }
+    }
+
+    // #endregion コンストラクタ
+
+    // #region メンバ関数
+
+    void WinMatrix::add(std::vector<std::uint16_t> const & counters, std::uint32_t stride, std::vector<std::uint16_t> const & histogram, std::vector<std::uint64_t> const & moments, std::uint64_t trials)
+    {
+        std::lock_guard<std::mutex> lock(mtx_);
+
+        for (auto k = 0U; k < histogram.size(); k++) {
+            histogram_[k] += histogram[k];
+        }
+
+        for (auto k = 0U; k < moments.size(); k++) {
+            moments_[k] += static_cast<double>(moments[k]);
+        }
+
+        if (pairs_.empty()) {
+            for (auto i = 0U; i < npattern_; i++) {
+                auto const * src = counters.data() + static_cast<std::size_t>(i) * stride;
+                auto * dst = totals_.data() + static_cast<std::size_t>(i) * npattern_;
+                for (auto j = 0U; j < npattern_; j++) {
+                    dst[j] += src[j];
+                }
+            }
+        }
+        else {
+            for (auto k = 0U; k < totals_.size(); k++) {
+                totals_[k] += counters[k];
+            }
+        }
+
+        trials_ += trials;
+    }
+
+    void WinMatrix::inithistogram()
+    {
+        auto const nbin = static_cast<std::uint64_t>(npattern_) * (horizon_ + 1U);
+        if (nbin <= HISTOGRAMMAX) {
+            histogram_.assign(static_cast<std::size_t>(nbin), 0U);
+        }
+
+        moments_.assign(2U * static_cast<std::size_t>(npattern_), 0.0);
+    }
+
+    void WinMatrix::write(std::string const & filename) const
+    {
+        std::ofstream ofs(filename, std::ios::binary);
+        if (!ofs) {
+            throw std::runtime_error("ファイルを開けませんでした: " + filename);
+        }
+
+        // ヘッダ
+        ofs.write(MAGIC, sizeof(MAGIC));
+        writevalue<std::uint32_t>(ofs, VERSION);
+        writevalue<std::uint32_t>(ofs, len_);
+        writevalue<std::uint32_t>(ofs, npattern_);
+        writevalue<std::uint32_t>(ofs, horizon_);
+        writevalue<std::uint64_t>(ofs, static_cast<std::uint64_t>(pairs_.size()));
+        writevalue<std::uint64_t>(ofs, trials_);
+
+        if (pairs_.empty()) {
+            // npattern × npatternの行列（行優先）
+            for (auto const t : totals_) {
+                writevalue<std::uint64_t>(ofs, t);
+            }
+        }
+        else {
+            // (前者, 後者, 勝利回数)の組の配列
+            for (auto k = 0U; k < pairs_.size(); k++) {
+                writevalue<std::uint32_t>(ofs, pairs_[k].first);
+                writevalue<std::uint32_t>(ofs, pairs_[k].second);
+                writevalue<std::uint64_t>(ofs, totals_[k]);
+            }
+        }
+
+        if (!ofs) {
+            throw std::runtime_error("ファイルに書き込めませんでした: " + filename);
+        }
+    }
+
+    void WinMatrix::writecolumnar(std::string const & filename) const
+    {
+        columnar::Writer writer;
+
+        writer.add<std::uint32_t>("len", { len_ });
+        writer.add<std::uint32_t>("horizon", { horizon_ });
+        writer.add<std::uint64_t>("trials", { trials_ });
+
+        // 各文字列と、その最初の出現位置の平均と分散
+        std::vector<std::string> patterns(npattern_);
+        std::vector<double> mean(npattern_), variance(npattern_);
+        auto const n = static_cast<double>(trials_);
+        for (auto i = 0U; i < npattern_; i++) {
+            patterns[i] = pattern::tostring(i, len_);
+
+            if (trials_) {
+                mean[i] = moments_[i] / n;
+                variance[i] = std::max(moments_[npattern_ + i] / n - mean[i] * mean[i], 0.0);
+            }
+        }
+
+        writer.add("pattern", patterns);
+        writer.add("mean", mean);
+        writer.add("variance", variance);
+
+        if (!histogram_.empty()) {
+            writer.add("histogram", histogram_);
+        }
+
+        // 勝利回数と勝率（全てのペアを集計する場合はnpattern × npatternの行列、そうでない場合はペア毎の配列）
+        std::vector<double> probability(totals_.size());
+        for (auto k = 0U; k < totals_.size(); k++) {
+            probability[k] = trials_ ? static_cast<double>(totals_[k]) / n : 0.0;
+        }
+
+        if (!pairs_.empty()) {
+            std::vector<std::uint32_t> a(pairs_.size()), b(pairs_.size());
+            for (auto k = 0U; k < pairs_.size(); k++) {
+                a[k] = pairs_[k].first;
+                b[k] = pairs_[k].second;
+            }
+
+            writer.add("a", a);
+            writer.add("b", b);
+        }
+
+        writer.add("wins", totals_);
+        writer.add("probability", probability);
+
+        writer.write(filename);
+    }
+
+    void WinCounter::accumulate(std::uint16_t const * first)
+    {
+        auto const & pairs = wm_.pairs();
+        auto const npattern = wm_.npattern();
+
+        // 最初の出現位置の総和と二乗和
+        for (auto j = 0U; j < npattern; j++) {
+            auto const f = static_cast<std::uint64_t>(first[j]);
+            moments_[j] += f;
+            moments_[npattern + j] += f * f;
+        }
+
+        if (!pairs.empty()) {
+            // 抽出されたペアのみをスカラーで集計
+            for (auto k = 0U; k < pairs.size(); k++) {
+                counters_[k] += first[pairs[k].first] < first[pairs[k].second] ? 1U : 0U;
+            }
+
+            if (!histogram_.empty()) {
+                auto const nbin = wm_.horizon() + 1U;
+                for (auto j = 0U; j < npattern; j++) {
+                    histogram_[static_cast<std::size_t>(j) * nbin + first[j]]++;
+                }
+            }
+
+            if (++pending_ == COUNTERMAX) {
+                flushcounters();
+            }
+
+            return;
+        }
+
+        // 試行をためる
+        auto * row = batch_.data() + static_cast<std::size_t>(nbatch_) * stride_;
+        for (auto j = 0U; j < npattern; j++) {
+            row[j] = tosigned(first[j]);
+        }
+
+        if (++nbatch_ == BATCH) {
+            processbatch();
+        }
+    }
+
+    void WinCounter::flush()
+    {
+        if (nbatch_) {
+            processbatch();
+        }
+
+        if (pending_) {
+            flushcounters();
+        }
+    }
+
+    void WinCounter::flushcounters()
+    {
+        wm_.add(counters_, stride_, histogram_, moments_, pending_);
+
+        std::fill(counters_.begin(), counters_.end(), static_cast<std::uint16_t>(0U));
+        std::fill(histogram_.begin(), histogram_.end(), static_cast<std::uint16_t>(0U));
+        std::fill(moments_.begin(), moments_.end(), static_cast<std::uint64_t>(0U));
+        pending_ = 0U;
+    }
+
+    void WinCounter::processbatch()
+    {
+        // カウンタがあふれる前に総和に加える
+        if (pending_ + nbatch_ > COUNTERMAX) {
+            flushcounters();
+        }
+
+        static auto constexpr NVEC = TILE / LANES;
+        auto const npattern = wm_.npattern();
+
+        // ヒストグラムはカウンタと同時に総和に加えるので、あふれの確認の後で更新する
+        if (!histogram_.empty()) {
+            auto const nbin = wm_.horizon() + 1U;
+            for (auto b = 0U; b < nbatch_; b++) {
+                auto const * f = batch_.data() + static_cast<std::size_t>(b) * stride_;
+                for (auto j = 0U; j < npattern; j++) {
+                    histogram_[static_cast<std::size_t>(j) * nbin + static_cast<std::uint32_t>(f[j] + 0x8000)]++;
+                }
+            }
+        }
+
+        // TILE列ずつ処理することで、ためている試行のタイル（BATCH × TILE）をL1キャッシュに載せたままにする
+        for (auto cj = 0U; cj < stride_; cj += TILE) {
+            for (auto i = 0U; i < npattern; i++) {
+                auto * row = counters_.data() + static_cast<std::size_t>(i) * stride_ + cj;
+
+                vec acc[NVEC];
+                for (auto v = 0U; v < NVEC; v++) {
+                    acc[v] = load(row + v * LANES);
+                }
+
+                for (auto b = 0U; b < nbatch_; b++) {
+                    auto const * f = batch_.data() + static_cast<std::size_t>(b) * stride_;
+
+                    // first[i] < first[j]のとき比較結果は-1なので、引けばカウンタが1増える
+                    auto const fi = broadcast(f[i]);
+                    for (auto v = 0U; v < NVEC; v++) {
+                        acc[v] = sub(acc[v], cmpgt(load(f + cj + v * LANES), fi));
+                    }
+                }
+
+                for (auto v = 0U; v < NVEC; v++) {
+                    store(row + v * LANES, acc[v]);
+                }
+            }
+        }
+
+        pending_ += nbatch_;
+        nbatch_ = 0U;
+    }
+
+    // #endregion メンバ関数
+
+    // #region 非メンバ関数
+
+    void montecarlo(WinMatrix & wm, std::uint64_t trials)
+    {
+#ifdef HAVE_SSE2
+        using myrand = myrandom::MyRandSfmt;
+#else
+        using myrand = myrandom::MyRand;
+#endif
+        // スレッド毎の自作乱数クラスのオブジェクト
+        tbb::enumerable_thread_specific<myrand> mrs(1, 6);
+
+        // スレッド毎の16ビットのカウンタ
+        tbb::enumerable_thread_specific<WinCounter> counters(std::ref(wm));
+
+        auto const horizon = wm.horizon();
+        auto const len = wm.len();
+
+        tbb::parallel_for(
+            tbb::blocked_range<std::uint64_t>(0U, trials, 1024U),
+            [&](auto const & range) {
+            auto & mr = mrs.local();
+            auto & counter = counters.local();
+
+            // UとDのランダム列
+            flips::packedflips words;
+
+            // 各文字列の最初の出現位置
+            std::vector<std::uint16_t> first(wm.npattern());
+
+            for (auto i = range.begin(); i != range.end(); ++i) {
+                flips::makepackedflips(mr, horizon, words);
+                flips::firstoccurrence(words, horizon, len, first.data());
+                counter.accumulate(first.data());
+            }
+        });
+
+        for (auto && counter : counters) {
+            counter.flush();
+        }
+    }
+
+    std::uint64_t replay(WinMatrix & wm, flips::packedflips const & stream, std::uint64_t nflips)
+    {
+        auto const horizon = wm.horizon();
+        auto const len = wm.len();
+
+        // 重ならないUかDの文字列の長さ毎の区間に分ける（余りは捨てる）
+        auto const nsegment = nflips / horizon;
+
+        // スレッド毎の16ビットのカウンタ
+        tbb::enumerable_thread_specific<WinCounter> counters(std::ref(wm));
+
+        tbb::parallel_for(
+            tbb::blocked_range<std::uint64_t>(0U, nsegment, 1024U),
+            [&](auto const & range) {
+            auto & counter = counters.local();
+
+            // 区間のUとDの列
+            flips::packedflips words;
+
+            // 各文字列の最初の出現位置
+            std::vector<std::uint16_t> first(wm.npattern());
+
+            for (auto i = range.begin(); i != range.end(); ++i) {
+                flips::extractflips(stream, i * horizon, horizon, words);
+                flips::firstoccurrence(words, horizon, len, first.data());
+                counter.accumulate(first.data());
+            }
+        });
+
+        for (auto && counter : counters) {
+            counter.flush();
+        }
+
+        return nsegment;
+    }
+
+    std::vector<indexpair> samplepairs(std::uint32_t len, std::uint64_t n, std::uint64_t seed)
+    {
+        checkrange(len, len);
+
+        auto const npattern = 1U << len;
+        auto const all = static_cast<std::uint64_t>(npattern) * (npattern - 1U);
+
+        checkpairs(std::min(n, all));
+
+        std::vector<indexpair> pairs;
+        if (n >= all) {
+            pairs.reserve(all);
+            for (auto i = 0U; i < npattern; i++) {
+                for (auto j = 0U; j < npattern; j++) {
+                    if (i != j) {
+                        pairs.emplace_back(i, j);
+                    }
+                }
+            }
+
+            return pairs;
+        }
+
+        std::mt19937_64 engine(seed ? seed : std::random_device()());
+        std::uniform_int_distribution<std::uint32_t> dist(0U, npattern - 1U);
+
+        std::unordered_set<std::uint64_t> used;
+        while (pairs.size() < n) {
+            auto const i = dist(engine);
+            auto const j = dist(engine);
+            if (i != j && used.insert(static_cast<std::uint64_t>(i) * npattern + j).second) {
+                pairs.emplace_back(i, j);
+            }
+        }
+
+        std::sort(pairs.begin(), pairs.end());
+
+        return pairs;
+    }
+
+    // #endregion 非メンバ関数
+}
@@ -0,0 +1,447 @@
+﻿/*! \file winmatrix.h
+    \brief 長さKの全ての文字列のペアに対する勝利回数を集計するクラスの宣言
+
+    Copyright © 2017 @dc1394 All Rights Reserved.
+    This software is released under the BSD 2-Clause License.
+*/
+
+#ifndef _WINMATRIX_H_
+#define _WINMATRIX_H_
+
+#pragma once
+
+#include "../flips/packedflips.h"
+#include <cstdint>      // for std::int16_t, std::uint16_t, std::uint32_t, std::uint64_t
+#include <mutex>        // for std::mutex
+#include <string>       // for std::string
+#include <utility>      // for std::pair
+#include <vector>       // for std::vector
+
+namespace winmatrix {
+    //! A typedef.
+    /*!
+        文字列のペアの添字（ビット列）
+    */
+    using indexpair = std::pair<std::uint32_t, std::uint32_t>;
+
+    //! A class.
+    /*!
+        文字列のペアに対する勝利回数の64ビットの総和を保持するクラス
+        全てのペアを集計する場合は、i行j列目に「iがjより先に出現した回数」を格納する
+        あわせて、各文字列の最初の出現位置の総和と二乗和、（大きすぎなければ）ヒストグラムも保持する
+    */
+    class WinMatrix final {
+        // #region コンストラクタ・デストラクタ
+
+    public:
+        //! A constructor.
+        /*!
+            全てのペアを集計する場合のコンストラクタ
+            \param len 文字列の長さ
+            \param horizon UかDの文字列の長さ
+        */
+        WinMatrix(std::uint32_t len, std::uint32_t horizon);
+
+        //! A constructor.
+        /*!
+            与えられたペアのみを集計する場合のコンストラクタ
+            \param len 文字列の長さ
+            \param horizon UかDの文字列の長さ
+            \param pairs 集計する文字列のペア
+        */
+        WinMatrix(std::uint32_t len, std::uint32_t horizon, std::vector<indexpair> const & pairs);
+
+        //! A destructor.
+        /*!
+            デフォルトデストラクタ
+        */
+        ~WinMatrix() = default;
+
+        // #endregion コンストラクタ・デストラクタ
+
+        // #region メンバ関数
+
+        //! A public member function.
+        /*!
+            スレッド毎の16ビットのカウンタを64ビットの総和に加える
+            \param counters スレッド毎のカウンタ
+            \param stride 全てのペアを集計する場合の、カウンタの一行の要素数
+            \param histogram スレッド毎の最初の出現位置のヒストグラム（ヒストグラムを保持しない場合は空）
+            \param moments スレッド毎の最初の出現位置の総和と二乗和
+            \param trials カウンタに含まれる試行回数
+        */
+        void add(std::vector<std::uint16_t> const & counters, std::uint32_t stride, std::vector<std::uint16_t> const & histogram, std::vector<std::uint64_t> const & moments, std::uint64_t trials);
+
+        //! A public member function.
+        /*!
+            文字列iが文字列jより先に出現した回数を返す（全てのペアを集計する場合のみ）
+            \param i 前者の文字列のビット列
+            \param j 後者の文字列のビット列
+            \return 勝利回数
+        */
+        std::uint64_t count(std::uint32_t i, std::uint32_t j) const
+        {
+            return totals_[static_cast<std::size_t>(i) * npattern_ + j];
+        }
+
+        //! A public member function.
+        /*!
+            勝利回数の総和を、コンパクトなバイナリ形式でファイルに書き出す
+            \param filename ファイル名
+        */
+        void write(std::string const & filename) const;
+
+        //! A public member function.
+        /*!
+            文字列、勝利回数と勝率、最初の出現位置の平均と分散とヒストグラムを、
+            メモリマップしてそのまま読める列指向のバイナリ形式でファイルに書き出す
+            \param filename ファイル名
+        */
+        void writecolumnar(std::string const & filename) const;
+
+        // #endregion メンバ関数
+
+        // #region プロパティ
+
+        //! A property.
+        /*!
+            各文字列の最初の出現位置のヒストグラムを返す（i番目の文字列のk番目のビンはi * (horizon + 1) + k番目の要素、
+            horizon番目のビンは出現しなかった場合を含む。大きすぎて保持しない場合は空）
+        */
+        std::vector<std::uint64_t> const & histogram() const
+        {
+            return histogram_;
+        }
+
+        //! A property.
+        /*!
+            UかDの文字列の長さを返す
+        */
+        std::uint32_t horizon() const
+        {
+            return horizon_;
+        }
+
+        //! A property.
+        /*!
+            文字列の長さを返す
+        */
+        std::uint32_t len() const
+        {
+            return len_;
+        }
+
+        //! A property.
+        /*!
+            各文字列の最初の出現位置（出現しなかった場合はUかDの文字列の長さ）の総和（先頭のnpattern個）と二乗和（残りのnpattern個）を返す
+        */
+        std::vector<double> const & moments() const
+        {
+            return moments_;
+        }
+
+        //! A property.
+        /*!
+            文字列の個数を返す
+        */
+        std::uint32_t npattern() const
+        {
+            return npattern_;
+        }
+
+        //! A property.
+        /*!
+            集計する文字列のペアを返す（空の場合は全てのペアを集計する）
+        */
+        std::vector<indexpair> const & pairs() const
+        {
+            return pairs_;
+        }
+
+        //! A property.
+        /*!
+            勝利回数の総和を返す
+        */
+        std::vector<std::uint64_t> const & totals() const
+        {
+            return totals_;
+        }
+
+        //! A property.
+        /*!
+            集計された試行回数を返す
+        */
+        std::uint64_t trials() const
+        {
+            return trials_;
+        }
+
+        // #endregion プロパティ
+
+        // #region メンバ変数
+
+        //! A public static member variable (constant expression).
+        /*!
+            ヒストグラムを保持する場合の、ビンの数の上限
+        */
+        static auto constexpr HISTOGRAMMAX = 1U << 22;
+
+    private:
+        //! A private member function.
+        /*!
+            ビンの数が上限以下ならヒストグラムを確保する
+        */
+        void inithistogram();
+
+        //! A private member variable.
+        /*!
+            最初の出現位置のヒストグラム
+        */
+        std::vector<std::uint64_t> histogram_;
+
+        //! A private member variable.
+        /*!
+            UかDの文字列の長さ
+        */
+        std::uint32_t horizon_;
+
+        //! A private member variable.
+        /*!
+            文字列の長さ
+        */
+        std::uint32_t len_;
+
+        //! A private member variable.
+        /*!
+            総和を更新するときのミューテックス
+        */
+        std::mutex mtx_;
+
+        //! A private member variable.
+        /*!
+            最初の出現位置の総和と二乗和
+        */
+        std::vector<double> moments_;
+
+        //! A private member variable.
+        /*!
+            文字列の個数
+        */
+        std::uint32_t npattern_;
+
+        //! A private member variable.
+        /*!
+            集計する文字列のペア
+        */
+        std::vector<indexpair> pairs_;
+
+        //! A private member variable.
+        /*!
+            勝利回数の総和
+        */
+        std::vector<std::uint64_t> totals_;
+
+        //! A private member variable.
+        /*!
+            集計された試行回数
+        */
+        std::uint64_t trials_;
+
+        // #endregion メンバ変数
+
+        // #region 禁止されたコンストラクタ・メンバ関数
+
+        //! A private constructor (deleted).
+        /*!
+            デフォルトコンストラクタ（禁止）
+        */
+        WinMatrix() = delete;
+
+        //! A private copy constructor (deleted).
+        /*!
+            コピーコンストラクタ（禁止）
+            \param dummy コピー元のオブジェクト（未使用）
+        */
+        WinMatrix(WinMatrix const & dummy) = delete;
+
+        //! A private member function (deleted).
+        /*!
+            operator=()の宣言（禁止）
+            \param dummy コピー元のオブジェクト（未使用）
+            \return コピー元のオブジェクト
+        */
+        WinMatrix & operator=(WinMatrix const & dummy) = delete;
+
+        // #endregion 禁止されたコンストラクタ・メンバ関数
+    };
+
+    //! A class.
+    /*!
+        スレッド毎に16ビットのカウンタで勝利回数を集計するクラス
+        最初の出現位置の配列をBATCH試行分ためてから、TILE列ずつのタイルに区切って、
+        ブロードキャストしたSIMD比較でまとめてカウンタを更新する
+    */
+    class WinCounter final {
+        // #region コンストラクタ・デストラクタ
+
+    public:
+        //! A constructor.
+        /*!
+            唯一のコンストラクタ
+            \param wm 勝利回数の総和を保持するオブジェクト
+        */
+        explicit WinCounter(WinMatrix & wm);
+
+        //! A destructor.
+        /*!
+            デフォルトデストラクタ
+        */
+        ~WinCounter() = default;
+
+        // #endregion コンストラクタ・デストラクタ
+
+        // #region メンバ関数
+
+        //! A public member function.
+        /*!
+            一回の試行の結果を集計する
+            \param first 各文字列の最初の出現位置の配列（要素数は2^len）
+        */
+        void accumulate(std::uint16_t const * first);
+
+        //! A public member function.
+        /*!
+            ためている試行を処理し、カウンタを64ビットの総和に加える
+        */
+        void flush();
+
+        // #endregion メンバ関数
+
+        // #region メンバ変数
+
+        //! A public static member variable (constant expression).
+        /*!
+            まとめて処理する試行の数
+        */
+        static auto constexpr BATCH = 64U;
+
+        //! A public static member variable (constant expression).
+        /*!
+            タイルの列数
+        */
+        static auto constexpr TILE = 64U;
+
+    private:
+        //! A private member function.
+        /*!
+            ためている試行をタイル毎に処理する
+        */
+        void processbatch();
+
+        //! A private member function.
+        /*!
+            カウンタを64ビットの総和に加えて0に戻す
+        */
+        void flushcounters();
+
+        //! A private member variable.
+        /*!
+            ためている試行の、符号付き16ビットに変換した最初の出現位置の配列
+        */
+        std::vector<std::int16_t> batch_;
+
+        //! A private member variable.
+        /*!
+            16ビットのカウンタ
+        */
+        std::vector<std::uint16_t> counters_;
+
+        //! A private member variable.
+        /*!
+            16ビットの最初の出現位置のヒストグラム
+        */
+        std::vector<std::uint16_t> histogram_;
+
+        //! A private member variable.
+        /*!
+            最初の出現位置の総和と二乗和
+        */
+        std::vector<std::uint64_t> moments_;
+
+        //! A private member variable.
+        /*!
+            ためている試行の数
+        */
+        std::uint32_t nbatch_ = 0U;
+
+        //! A private member variable.
+        /*!
+            カウンタに含まれる試行回数
+        */
+        std::uint32_t pending_ = 0U;
+
+        //! A private member variable.
+        /*!
+            カウンタと試行の配列の一行の要素数（TILEの倍数）
+        */
+        std::uint32_t stride_;
+
+        //! A private member variable.
+        /*!
+            勝利回数の総和を保持するオブジェクト
+        */
+        WinMatrix & wm_;
+
+        // #region 禁止されたコンストラクタ・メンバ関数
+
+        //! A private constructor (deleted).
+        /*!
+            デフォルトコンストラクタ（禁止）
+        */
+        WinCounter() = delete;
+
+        //! A private member function (deleted).
+        /*!
+            operator=()の宣言（禁止）
+            \param dummy コピー元のオブジェクト（未使用）
+            \return コピー元のオブジェクト
+        */
+        WinCounter & operator=(WinCounter const & dummy) = delete;
+
+        // #endregion 禁止されたコンストラクタ・メンバ関数
+    };
+
+    // #region 非メンバ関数
+
+    //! A function.
+    /*!
+        長さKの全ての文字列のペアに対する勝利回数のモンテカルロ・シミュレーションを、TBBで並列化して行う
+        \param wm 勝利回数の総和を保持するオブジェクト
+        \param trials 試行回数
+    */
+    void montecarlo(WinMatrix & wm, std::uint64_t trials);
+
+    //! A function.
+    /*!
+        記録されたUとDの列を、UかDの文字列の長さ毎の重ならない区間に分け、各区間を一回の試行として並列に集計する
+        \param wm 勝利回数の総和を保持するオブジェクト
+        \param stream 記録されたUとDの列を詰めたワードの可変長配列
+        \param nflips 記録されたUかDの個数
+        \return 集計した区間の数
+    */
+    std::uint64_t replay(WinMatrix & wm, flips::packedflips const & stream, std::uint64_t nflips);
+
+    //! A function.
+    /*!
+        文字列の可能な順列から、重複のないペアを無作為に抽出する
+        \param len 文字列の長さ
+        \param n 抽出するペアの数
+        \param seed 乱数の種（0の場合は非決定的な種を使う）
+        \return 抽出したペア
+    */
+    std::vector<indexpair> samplepairs(std::uint32_t len, std::uint64_t n, std::uint64_t seed);
+
+    // #endregion 非メンバ関数
+}
+
+#endif  // _WINMATRIX_H_